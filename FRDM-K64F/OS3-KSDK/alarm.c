@@ -0,0 +1,241 @@
+/*
+*********************************************************************************************************
+* Battery alarm logic: the voltage read from ADC0 selects the color of the LED (0-1V green, 1-2V blue,
+* 2-3V red) and the rate of blinking (long/short alternating every 0.5V, steady over 3V). The early warning
+* blinks at the unused BLINK_SHORTEST rate, led_rate and the band table are left as they are.
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <hal.h>
+#include  <app_cfg.h>
+#include  <band.h>
+#include  <alarm.h>
+#include  <prof.h>
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+volatile blink_mode  led_rate;
+volatile uint32_t	 current_led;
+uint32_t			 alarm_change_ts;
+volatile uint32_t	 alarm_warning;
+
+#if (APP_CFG_JOURNAL_EN == DEF_ENABLED)
+journal_t			 alarm_journal;
+#endif
+
+/*
+*********************************************************************************************************
+*                                       LOCAL GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+// the table in use and the one alarm_set_cfg() builds, switched by a single store of band_cur
+static band_table_t		band_tbl[2];
+static band_cfg_t		band_cfg[2];					// sources of band_tbl
+static volatile uint32_t band_cur;
+static uint32_t			led_idx;						// index of current_led in led_pin
+
+// FTM1 modulo of each blink_mode, BLINK_NONE stops the timer
+static volatile uint16_t blink_mod[BAND_RATE_NBR] = {
+	BLINK_SHORT_MOD, BLINK_LONG_MOD, BLINK_SHORTEST_MOD, 0u
+};
+
+static const uint32_t	led_pin[BAND_LED_NBR] = {
+	BOARD_GPIO_LED_GREEN,
+	BOARD_GPIO_LED_BLUE,
+	BOARD_GPIO_LED_RED
+};
+
+// LEDs switched off when the one of the index is selected
+static const uint32_t	led_off[BAND_LED_NBR][BAND_LED_NBR - 1u] = {
+	{ BOARD_GPIO_LED_BLUE,  BOARD_GPIO_LED_RED   },
+	{ BOARD_GPIO_LED_GREEN, BOARD_GPIO_LED_RED   },
+	{ BOARD_GPIO_LED_BLUE,  BOARD_GPIO_LED_GREEN }
+};
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+void alarm_init(void){
+    // all the LEDs are switched off initially
+    hal_gpio_set(BOARD_GPIO_LED_RED);
+    hal_gpio_set(BOARD_GPIO_LED_GREEN);
+    hal_gpio_set(BOARD_GPIO_LED_BLUE);
+
+    // the output of the wave is initially low
+    hal_gpio_clear(kGpioWave1Out);
+
+    // thresholds of app_cfg.h
+    band_cur = 0u;
+    band_build(&band_tbl[0], &band_cfg_default);
+    band_cfg[0] = band_cfg_default;
+
+    // initial settings
+    ftm1_change_pulse(BLINK_SHORT);
+    led_idx = BAND_LED_RED;
+    current_led = BOARD_GPIO_LED_RED;
+    led_rate = BLINK_NONE;
+    alarm_warning = 0u;
+#if (APP_CFG_JOURNAL_EN == DEF_ENABLED)
+    journal_init(&alarm_journal);
+#endif
+}
+
+int alarm_set_cfg(const band_cfg_t *cfg){
+	uint32_t next = band_cur ^ 1u;
+
+	// AppTask is not in range_check() while a task of lower priority runs, and from the store on it
+	// takes the new table: the old one is free for the next call
+	if (band_build(&band_tbl[next], cfg) != 0)
+		return -1;
+	band_cfg[next] = *cfg;
+	__atomic_store_n(&band_cur, next, __ATOMIC_RELEASE);
+	return 0;
+}
+
+const band_cfg_t *alarm_cfg(void){
+	return &band_cfg[band_cur];
+}
+
+uint16_t alarm_blink_mod(blink_mode rate){
+	return blink_mod[rate];
+}
+
+void alarm_set_blink_mod(blink_mode rate, uint16_t mod){
+	HAL_SR_ALLOC();
+
+	// the same value again would restart the wave, and a stream of them stop it
+	if (blink_mod[rate] == mod)
+		return;
+	// the wave being generated restarts with the new period; AppTask cannot change it in between
+	HAL_CRITICAL_ENTER();
+	PROF_START(m);
+	blink_mod[rate] = mod;
+	if (rate != BLINK_NONE && rate == (alarm_warning ? BLINK_SHORTEST : led_rate))
+		hal_ftm1_start(mod);
+	PROF_END(m);
+	HAL_CRITICAL_EXIT();
+	PROF_RECORD(PROF_MASK_CONFIG, m);
+}
+
+void alarm_set_state(blink_mode rate, uint32_t led){
+	if (rate != led_rate || alarm_warning)
+		ftm1_change_pulse(rate);
+	led_rate = rate;
+	alarm_warning = 0u;
+	led_idx = led < BAND_LED_NBR ? led : BAND_LED_RED;
+	current_led = led_pin[led_idx];
+	hal_ftm1_dma_led(current_led);
+	hal_gpio_set(led_off[led_idx][0]);
+	hal_gpio_set(led_off[led_idx][1]);
+}
+
+uint32_t range_check_block(const volatile uint16_t *block, uint32_t len){
+	uint32_t last = 0u;
+	uint32_t i;
+
+	for (i = 0u; i < len; i++)
+		if (range_check(block[i]))
+			last = i + 1u;
+	return last;
+}
+
+int alarm_window(uint32_t sample, uint16_t *lo, uint16_t *hi){
+	return band_window(&band_tbl[band_cur], BAND_STATE(led_rate, led_idx), sample, lo, hi);
+}
+
+int alarm_predict(const trend_t *t, uint32_t horizon, uint32_t min_delta){
+	uint32_t cross = TREND_NEVER;
+	uint32_t warn;
+	uint16_t lo, hi;
+
+	// band around the last reading, none if it is about to change the state anyway
+	if (t->nbr > 0u && alarm_window(trend_last(t), &lo, &hi))
+		cross = trend_cross(t, lo, hi, min_delta);
+	warn = alarm_warning ? (cross / 2u <= horizon) : (cross <= horizon);
+	if (warn == alarm_warning)
+		return 0;
+	alarm_warning = warn;
+	ftm1_change_pulse(warn ? BLINK_SHORTEST : led_rate);
+	return 1;
+}
+
+void ftm1_change_pulse(blink_mode rate){
+	HAL_SR_ALLOC();
+	PROF_START(t);
+
+	// period and counter of FTM1 written without an overflow of the old period in between
+	HAL_CRITICAL_ENTER();
+	PROF_START(m);
+	switch(rate){
+		case BLINK_LONG:
+		case BLINK_SHORT:
+		case BLINK_SHORTEST:
+			hal_ftm1_start(blink_mod[rate]);
+			break;
+		case BLINK_NONE:
+			hal_gpio_clear(current_led);
+			hal_ftm1_stop();
+			break;
+	}
+	PROF_END(m);
+	HAL_CRITICAL_EXIT();
+	PROF_RECORD(PROF_MASK_PULSE, m);
+	PROF_STOP(PROF_CHANGE_PULSE, t);
+}
+
+void blink_toggle(void){
+	hal_gpio_toggle(current_led);
+	hal_gpio_toggle(kGpioWave1Out);
+}
+
+int range_check(uint32_t sample){
+	PROF_START(t);
+	uint32_t from = BAND_STATE(led_rate, led_idx);
+	uint8_t  act = band_classify(&band_tbl[band_cur], from, sample);
+
+	// nearly every sample stays in the band of the current state
+	if (act == BAND_NOP){
+		PROF_STOP(PROF_RANGE_CHECK, t);
+		return 0;
+	}
+
+	/* Early warning over, the blink of the new state */
+	if (alarm_warning){
+		alarm_warning = 0u;
+		if (BAND_ACT_RATE(act) == BAND_KEEP)
+			ftm1_change_pulse(led_rate);
+	}
+	/* Rate of blink */
+	if (BAND_ACT_RATE(act) != BAND_KEEP){
+		ftm1_change_pulse((blink_mode)BAND_ACT_RATE(act));
+		led_rate = (blink_mode)BAND_ACT_RATE(act);
+	}
+	/* LED color, the others are switched off */
+	if (BAND_ACT_LED(act) != BAND_KEEP){
+		led_idx = BAND_ACT_LED(act);
+		current_led = led_pin[led_idx];
+		hal_ftm1_dma_led(current_led);
+		hal_gpio_set(led_off[led_idx][0]);
+		hal_gpio_set(led_off[led_idx][1]);
+	}
+	alarm_change_ts = hal_ts_get();
+#if (APP_CFG_JOURNAL_EN == DEF_ENABLED)
+	journal_add(&alarm_journal, alarm_change_ts, sample, from, BAND_STATE(led_rate, led_idx));
+#endif
+	PROF_STOP(PROF_RANGE_CHECK, t);
+	return 1;
+}
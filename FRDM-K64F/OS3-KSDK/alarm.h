@@ -0,0 +1,82 @@
+/*
+*********************************************************************************************************
+*                                          BATTERY ALARM LOGIC
+*
+* Voltage range checking and blink state of the LEDs. This module only talks to the peripherals through
+* hal.h, so the same code runs on the board and in the host simulator.
+*********************************************************************************************************
+*/
+
+#ifndef  ALARM_MODULE_PRESENT
+#define  ALARM_MODULE_PRESENT
+
+#include  <stdint.h>
+#include  <app_cfg.h>
+#include  <band.h>
+#include  <trend.h>
+#include  <journal.h>
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+extern volatile blink_mode  led_rate;
+extern volatile uint32_t    current_led;
+
+// cycle counter right after the last change of blink state
+extern uint32_t             alarm_change_ts;
+
+// early warning: the blink is at BLINK_SHORTEST while led_rate keeps the state of the band
+extern volatile uint32_t    alarm_warning;
+
+#if (APP_CFG_JOURNAL_EN == DEF_ENABLED)
+// changes of state made by range_check(), emptied by the report task
+extern journal_t            alarm_journal;
+#endif
+
+/*
+*********************************************************************************************************
+*                                         FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+// LEDs off, wave low, initial blink state, empty journal
+void alarm_init(void);
+
+// bands of range_check() from cfg instead of app_cfg.h, from AppTask or a single task of lower priority;
+// returns -1 (and keeps the previous bands) if they are not valid
+int  alarm_set_cfg(const band_cfg_t *cfg);
+
+// bands in use
+const band_cfg_t *alarm_cfg(void);
+
+// FTM1 modulo of a blink rate other than BLINK_NONE, BLINK_xx_MOD of app_cfg.h at reset; a new one
+// applies at once if the rate is being generated, from any task; the value in use changes nothing
+uint16_t alarm_blink_mod(blink_mode rate);
+void     alarm_set_blink_mod(blink_mode rate, uint16_t mod);
+
+// blink state set without going through range_check(), for a replay starting from a captured state
+void alarm_set_state(blink_mode rate, uint32_t led);
+
+// procedure of voltage range checking, returns 1 if the blink state changed
+int      range_check(uint32_t sample);
+// returns 1 + index of the last sample that changed the blink state, 0 if none did
+uint32_t range_check_block(const volatile uint16_t *block, uint32_t len);
+
+// codes around the sample that leave the blink state unchanged; returns 0 if there are none
+int  alarm_window(uint32_t sample, uint16_t *lo, uint16_t *hi);
+
+// early warning from the line through the last readings of channel 0: set when it leaves the band of the
+// current state within horizon cycles, cleared beyond twice that or at the next change of state by
+// range_check(); returns 1 if alarm_warning changed
+int  alarm_predict(const trend_t *t, uint32_t horizon, uint32_t min_delta);
+
+// change of the FTM1 period
+void ftm1_change_pulse(blink_mode rate);
+
+// one edge of the blink wave, called at every FTM1 overflow
+void blink_toggle(void);
+
+#endif
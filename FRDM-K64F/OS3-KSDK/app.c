@@ -2,14 +2,19 @@
 *********************************************************************************************************
 * STUDENT: Alessandro Stefanini
 * This software implements an embedded battery alarm. The system checks continuously the voltage provided
-* at the pin PTB2 (w.r.t. GND) and controls the blinking of the on-board LEDs.
+* at the pin PTB2 (w.r.t. GND) and controls the blinking of the on-board LEDs. Up to 15 more rails can be
+* scanned together with ADC1 (APP_CFG_MON_CH_NBR), each one with its own thresholds and alarm output.
 * It is not possible to control on-board LEDs directly from the FlexTimer module because there is no physical
 * connection between the two inside the board, a possibility is to use an interrupt which toggles the
 * associated LED pin.
-* FTM0 used for triggering ADC0
-* ADC0 used for analog input reading
+* FTM0 used for triggering ADC0 (and ADC1)
+* ADC0 used for analog input reading, ADC1 for the scan of the other rails
 * FTM1 used for output wave generation
-* eDMA used for fast and deterministic transfer of data between ADC0 and SRAM
+* eDMA used for fast and deterministic transfer of data between ADC0 and SRAM (and of the commands received
+* on UART0, APP_CFG_CONSOLE_EN)
+* ADC0 hardware averaging and a CIC decimator trade the reading rate for resolution (APP_CFG_ADC_AVG_LOG2,
+* APP_CFG_DECIM_LOG2)
+* Hours of readings kept compressed in SRAM for the debugger (APP_CFG_HISTORY_EN)
 *********************************************************************************************************
 */
 
@@ -19,7 +24,6 @@
 *********************************************************************************************************
 */
 
-#include  <math.h>
 #include  <lib_math.h>
 #include  <cpu_core.h>
 
@@ -32,6 +36,26 @@
 
 #include  <bsp_ser.h>
 
+#include  <hal.h>
+#include  <alarm.h>
+#include  <filter.h>
+#include  <decim.h>
+#include  <spsc.h>
+#include  <prof.h>
+#include  <stream.h>
+#include  <monitor.h>
+#include  <calib.h>
+#include  <rate.h>
+#include  <trend.h>
+#include  <capture.h>
+#include  <history.h>
+#include  <journal.h>
+#include  <flog.h>
+#include  <stats.h>
+#include  <console.h>
+#include  <bench.h>
+#include  <pipeline.h>
+
 
 /*
 *********************************************************************************************************
@@ -42,6 +66,128 @@
 #include "fsl_interrupt_manager.h"
 #include "fsl_gpio_common.h"
 
+// posts from ISRs queued to the ISR handler task of the kernel (os_cfg.h of the BSP), or done at once
+#if defined(OS_CFG_ISR_POST_DEFERRED_EN) && (OS_CFG_ISR_POST_DEFERRED_EN > 0u)
+#define APP_ISR_POST			"deferred"
+#else
+#define APP_ISR_POST			"direct"
+#endif
+
+// with the compare function armed every reading that reaches the DMA leaves the band: one sample per half
+#if (APP_CFG_ADC_COMPARE_EN == DEF_ENABLED)
+#define APP_ADC_BLOCK_SIZE		1u
+#define APP_ADC_FILTER			FILTER_NONE
+#else
+#define APP_ADC_BLOCK_SIZE		APP_CFG_ADC_BLOCK_SIZE
+#define APP_ADC_FILTER			APP_CFG_FILTER
+#endif
+
+// readings of one FTM0 trigger: ADC0 alone, or ADC0 and ADC1 scanning the channels in parallel
+#if (APP_CFG_MON_CH_NBR > 1u)
+#define APP_ADC_PER_TRIG		2u
+#else
+#define APP_ADC_PER_TRIG		1u
+#endif
+
+// bus cycles of a reading, SFCAdder + AverageNum * (BCT + LSTAdder + HSCAdder) ADCK at 16 bit, and the
+// fastest trigger period it must fit in
+#define APP_ADC_CONV_BUS		(5u + ((3u + (1u << APP_CFG_ADC_AVG_LOG2) * \
+								 (25u + ((APP_CFG_ADC_OPTS & HAL_ADC_LSMP) ? 20u : 0u) + \
+								  ((APP_CFG_ADC_OPTS & HAL_ADC_HSC) ? 2u : 0u))) << ((APP_CFG_ADC_OPTS >> 4) & 0x3u)))
+#if (APP_CFG_RATE_EN == DEF_ENABLED)
+#define APP_ADC_TRIG_PS_MIN		APP_CFG_RATE_PS_FAST
+#else
+#define APP_ADC_TRIG_PS_MIN		APP_CFG_ADC_TRIG_PS
+#endif
+
+// baud rate of UART0, BSP_Ser_Init() or the stream
+#if (APP_CFG_STREAM_EN == DEF_ENABLED)
+#define APP_SER_BAUD			APP_CFG_STREAM_BAUD
+#else
+#define APP_SER_BAUD			115200u
+#endif
+
+#if (APP_CFG_MON_CH_NBR > 1u) && ((APP_CFG_MON_CH_NBR % 2u) != 0u || APP_CFG_MON_CH_NBR > 2u * HAL_SCAN_MAX)
+#error  "APP_CFG_MON_CH_NBR must be 1 or an even number up to 2 * HAL_SCAN_MAX"
+#endif
+
+#if (APP_ADC_BLOCK_SIZE % APP_CFG_MON_CH_NBR) != 0u
+#error  "a half of the DMA ring must hold whole scans"
+#endif
+
+#if (APP_CFG_MON_CH_NBR > 1u) && ((APP_CFG_ADC_COMPARE_EN == DEF_ENABLED) || (APP_CFG_STREAM_EN == DEF_ENABLED))
+#error  "the compare function and the stream frames only support the single channel of ADC0"
+#endif
+
+#if (SPSC_SIZE < 2u * APP_ADC_BLOCK_SIZE)
+#error  "SPSC_SIZE must hold at least the two halves of the DMA ring"
+#endif
+
+#if (APP_CFG_STREAM_EN == DEF_ENABLED) && (APP_ADC_BLOCK_SIZE > FRAME_SAMPLES_MAX)
+#error  "a half of the DMA ring must fit in one stream frame"
+#endif
+
+#if (APP_CFG_RATE_EN == DEF_ENABLED) && ((APP_CFG_MON_CH_NBR > 1u) || (APP_CFG_ADC_COMPARE_EN == DEF_ENABLED))
+#error  "the adaptive rate only supports the single channel of ADC0, without compare function"
+#endif
+
+// one half of the ring at the slowest rate within the latency bound, FTM0 counts the 60MHz bus clock
+#if (APP_CFG_RATE_EN == DEF_ENABLED) && \
+	((APP_CFG_RATE_PS_SLOW < APP_CFG_RATE_PS_FAST) || (APP_CFG_RATE_PS_SLOW - APP_CFG_RATE_PS_FAST >= RATE_LEVEL_MAX) || \
+	 ((((APP_CFG_ADC_TRIG_MOD + 1u) << APP_CFG_RATE_PS_SLOW) / 60000u) * APP_ADC_BLOCK_SIZE > APP_CFG_RATE_LATENCY_MS))
+#error  "APP_CFG_RATE_PS_SLOW: at most RATE_LEVEL_MAX levels, a half of the ring within APP_CFG_RATE_LATENCY_MS"
+#endif
+
+// the compare function leaves out the readings of the line; twice the horizon in 32 bits of 120MHz cycles
+#if (APP_CFG_TREND_EN == DEF_ENABLED) && \
+	((APP_CFG_ADC_COMPARE_EN == DEF_ENABLED) || (APP_CFG_TREND_WIN > TREND_WIN_MAX) || (APP_CFG_TREND_HORIZON_MS > 17000u))
+#error  "the early warning needs every reading, APP_CFG_TREND_WIN <= TREND_WIN_MAX and APP_CFG_TREND_HORIZON_MS <= 17000"
+#endif
+
+// the compare function leaves out the readings in the band
+#if (APP_CFG_STATS_EN == DEF_ENABLED) && ((APP_CFG_ADC_COMPARE_EN == DEF_ENABLED) || (APP_CFG_STATS_WIN == 0u))
+#error  "the statistics need every reading and APP_CFG_STATS_WIN > 0"
+#endif
+
+// the log in whole sectors of the second block, away from the code; the dump in one batch
+#if (APP_CFG_JOURNAL_EN == DEF_ENABLED) && (APP_CFG_JOURNAL_OUT == JOURNAL_OUT_FLASH) && \
+	((APP_CFG_FLOG_BASE % HAL_FLASH_SECTOR) != 0u || APP_CFG_FLOG_BASE < 0x00080000u || APP_CFG_FLOG_SECTORS < 2u || \
+	 APP_CFG_FLOG_BASE + APP_CFG_FLOG_SECTORS * HAL_FLASH_SECTOR > 0x00100000u || APP_CFG_JOURNAL_DUMP > JOURNAL_SIZE)
+#error  "the flash log takes 2 or more sectors of the second block, APP_CFG_JOURNAL_DUMP <= JOURNAL_SIZE"
+#endif
+
+// bytes of two polls at 10 bits per byte, a ring the eDMA channel can count
+#if (APP_CFG_CONSOLE_EN == DEF_ENABLED) && \
+	((APP_CFG_CONSOLE_RING & (APP_CFG_CONSOLE_RING - 1u)) != 0u || APP_CFG_CONSOLE_RING > 0x4000u || \
+	 2u * (APP_SER_BAUD / 10u) * APP_CFG_CONSOLE_POLL_MS / 1000u > APP_CFG_CONSOLE_RING)
+#error  "APP_CFG_CONSOLE_RING must be a power of 2 up to 0x4000 holding the bytes of two polls"
+#endif
+
+#if (APP_CFG_ADC_AVG_LOG2 == 1u) || (APP_CFG_ADC_AVG_LOG2 > 5u) || \
+	(APP_ADC_CONV_BUS >= ((APP_CFG_ADC_TRIG_MOD + 1u) << APP_ADC_TRIG_PS_MIN)) || \
+	((APP_CFG_CALIB_EN == DEF_ENABLED) && (APP_ADC_CONV_BUS >= ((APP_CFG_CALIB_TRIG_MOD + 1u) << APP_CFG_CALIB_TRIG_PS)))
+#error  "APP_CFG_ADC_AVG_LOG2 must be 0 or 2 to 5, the conversions of a reading within the fastest trigger period"
+#endif
+
+// the outputs stand for channel 0 alone; the compare function leaves out the readings in the band
+#if (APP_CFG_DECIM_LOG2 > 0u) && \
+	((APP_CFG_DECIM_LOG2 > DECIM_LOG2_MAX) || (APP_CFG_DECIM_ORDER < 1u) || (APP_CFG_DECIM_ORDER > DECIM_ORDER_MAX) || \
+	 (APP_CFG_MON_CH_NBR > 1u) || (APP_CFG_ADC_COMPARE_EN == DEF_ENABLED))
+#error  "the decimation takes 2^1 to 2^DECIM_LOG2_MAX readings of the single channel, without compare function"
+#endif
+
+// the values stand for channel 0 alone; the compare function leaves out the readings in the band
+#if (APP_CFG_HISTORY_EN == DEF_ENABLED) && \
+	((APP_CFG_HISTORY_CHUNKS < 2u) || (APP_CFG_HISTORY_AVG_LOG2 > HISTORY_AVG_LOG2_MAX) || \
+	 (APP_CFG_MON_CH_NBR > 1u) || (APP_CFG_ADC_COMPARE_EN == DEF_ENABLED))
+#error  "the history takes 2 or more chunks of the single channel, without compare function"
+#endif
+
+#if (APP_CFG_CALIB_EN == DEF_ENABLED) && \
+	(APP_CFG_CALIB_SAMPLES < CALIB_SAMPLES_MIN || APP_CFG_CALIB_SAMPLES > CALIB_SAMPLES_MAX)
+#error  "APP_CFG_CALIB_SAMPLES must be within CALIB_SAMPLES_MIN and CALIB_SAMPLES_MAX"
+#endif
+
 /*
 *********************************************************************************************************
 *                                       LOCAL GLOBAL VARIABLES
@@ -52,15 +198,91 @@ static  OS_TCB       AppStartupTaskTCB;
 static  CPU_STK      AppStartupTaskStk[APP_CFG_TASK_START_STK_SIZE];
 
 static  OS_TCB       AppTaskTCB;
-static  CPU_STK      AppTaskStk[APP_CFG_TASK_START_STK_SIZE];
+static  CPU_STK      AppTaskStk[APP_CFG_TASK_APP_STK_SIZE];
+
+static  OS_TCB       AppReportTaskTCB;
+static  CPU_STK      AppReportTaskStk[APP_CFG_TASK_REPORT_STK_SIZE];
 
-static  OS_SEM       semaphore_main;
-static  OS_SEM       semaphore_starttask;
+#if (APP_CFG_CONSOLE_EN == DEF_ENABLED)
+static  OS_TCB       AppConsoleTaskTCB;
+static  CPU_STK      AppConsoleTaskStk[APP_CFG_TASK_CONSOLE_STK_SIZE];
+#endif
 
-volatile uint32_t	 adc_in;
+#if (OS_CFG_TASK_STK_CHK_EN > 0u)
+// peak of the startup task, measured before it deletes itself
+static  CPU_STK_SIZE app_start_stk_used;
+#endif
 
-volatile blink_mode  led_rate;
-volatile uint32_t	 current_led;
+// ADC0 readings, written by the DMA one half at a time
+static  volatile uint16_t  adc_ring[2u * APP_ADC_BLOCK_SIZE];
+static  uint32_t     adc_ring_half;						// half completed at the next DMA interrupt
+
+// readings moved out of the ring by dma_int_handler, with produced/consumed/overrun counters
+spsc_t               adc_queue;
+
+// batch of samples being filtered and checked, the stages of app_cfg.h
+static  spsc_sample_t  adc_batch[APP_ADC_BLOCK_SIZE];
+static  uint16_t     adc_block[APP_ADC_BLOCK_SIZE];
+static  filter_t     adc_filter;
+static  decim_t      adc_decim;
+static  pipeline_t   adc_pipeline;
+
+#if (APP_CFG_STREAM_EN == DEF_ENABLED)
+static  stream_t     adc_stream;
+#endif
+
+#if (APP_CFG_RATE_EN == DEF_ENABLED)
+static  rate_t       adc_rate;
+#endif
+
+#if (APP_CFG_TREND_EN == DEF_ENABLED)
+static  trend_t      adc_trend;
+#endif
+
+#if (APP_CFG_STATS_EN == DEF_ENABLED)
+static  stats_t      adc_stats;
+#endif
+
+#if (APP_CFG_CAPTURE_EN == DEF_ENABLED)
+// header and records in a row, the image of a capture file
+static  struct {
+	capture_hdr_t   hdr;
+	capture_rec_t   rec[APP_CFG_CAPTURE_LEN];
+} app_capture;
+#endif
+
+#if (APP_CFG_HISTORY_EN == DEF_ENABLED)
+// header and ring in a row, the image of a history dump
+static  struct {
+	history_hdr_t   hdr;
+	history_chunk_t ring[APP_CFG_HISTORY_CHUNKS];
+} app_history;
+static  history_t    adc_history;
+#endif
+
+#if (APP_CFG_JOURNAL_EN == DEF_ENABLED)
+// batch taken out of alarm_journal by the report task
+static  journal_rec_t  journal_batch[JOURNAL_SIZE];
+static  uint32_t     journal_lost;						// alarm_journal.lost at the last batch
+#if (APP_CFG_JOURNAL_OUT == JOURNAL_OUT_FLASH)
+static  flog_t       journal_log;
+static  uint32_t     journal_dropped;					// records the log did not take
+#endif
+#endif
+
+#if (APP_CFG_CONSOLE_EN == DEF_ENABLED)
+// bytes received by UART0, written by the DMA
+static  volatile uint8_t  console_ring[APP_CFG_CONSOLE_RING];
+static  console_t    app_console;
+#endif
+
+#if (APP_CFG_MON_CH_NBR > 1u)
+// band tables, states and alarm outputs of the scanned rails
+static  mon_t        adc_mon;
+static  const uint8_t   mon_adc0_ch[] = APP_CFG_MON_ADC0_CH;
+static  const uint8_t   mon_adc1_ch[] = APP_CFG_MON_ADC1_CH;
+static  const uint32_t  mon_pin[] = APP_CFG_MON_ALARM_PINS;
+#endif
 
 /*
 *********************************************************************************************************
@@ -70,26 +292,57 @@ volatile uint32_t	 current_led;
 
 static void AppStartupTask (void  *p_arg);
 static void AppTask (void  *p_arg);
+static void AppReportTask (void  *p_arg);
+#if (APP_CFG_CONSOLE_EN == DEF_ENABLED)
+static void AppConsoleTask (void  *p_arg);
+#endif
 
-// setup of FTM0, ADC0 and DMA handling
-static void ftm0_adc0_trigger_setup(void);
-static void dma_int_handler(void);
+#if (OS_CFG_TASK_STK_CHK_EN > 0u)
+// peak use of the task stacks, printed on SW2
+static void app_stk_report(void);
+static void app_stk_line(const char *name, CPU_STK_SIZE used, CPU_STK_SIZE size);
+#endif
 
-// this timer is for blink wave generation
-static void ftm1_setup(void);
-static void ftm1_int_handler(void);
-static void ftm1_change_pulse(blink_mode rate);
+#if (APP_CFG_FILTER_BENCH_EN == DEF_ENABLED) || (APP_CFG_PIPE_BENCH_EN == DEF_ENABLED)
+static uint32_t app_cycles(void);
+#endif
 
-// ADC0 for input signal
-static void adc0_setup(void);
-static void adc0_start_reading(void);
+#if (APP_CFG_STATS_EN == DEF_ENABLED)
+// last window and total of the statistics, on SW2
+static void app_stats_report(void);
+static void app_stats_line(const char *name, const stats_sum_t *sum);
+#endif
+
+#if (APP_CFG_JOURNAL_EN == DEF_ENABLED)
+// records of the journal to their output, the counters and the end of the log on SW2
+static void app_journal_drain(void);
+static void app_journal_report(void);
+static void app_journal_line(const journal_rec_t *r);
+#endif
+
+#if (APP_CFG_HISTORY_EN == DEF_ENABLED)
+// ratio, span and address of the history, on SW2
+static void app_history_report(void);
+#endif
+
+#if (APP_CFG_RATE_EN == DEF_ENABLED)
+// FTM0 period of a level of the adaptive rate
+static void app_rate_set(uint32_t level);
+#endif
+
+#if (APP_CFG_CALIB_EN == DEF_ENABLED)
+// bands of channel 0 from the readings of the reference levels
+static void app_calibrate(void);
+static void app_calib_wait(void);
+#endif
 
-// procedure of voltage range checking
-static void range_check(void);
+// interrupt of eDMA after the transfer of ADC0 reading
+static void dma_int_handler(void);
 
-// procedure of range extension check
-static uint8_t extend_range_color(uint32_t required_led);
-static uint8_t extend_range_rate(blink_mode required_rate);
+#if (APP_CFG_BLINK_DMA_EN != DEF_ENABLED)
+// interrupt of FTM1 for blink wave generation
+static void ftm1_int_handler(void);
+#endif
 
 /*
 *********************************************************************************************************
@@ -112,8 +365,19 @@ int  main (void){
     GPIO_DRV_Init(switchPins, outPins);
 
     // setup of all the hardware modules
-    ftm0_adc0_trigger_setup();
-    ftm1_setup();
+    spsc_init(&adc_queue);
+#if (APP_CFG_MON_CH_NBR > 1u)
+    hal_adc_scan_setup(adc_ring, 2u * APP_ADC_BLOCK_SIZE, mon_adc0_ch, mon_adc1_ch, APP_CFG_MON_CH_NBR / 2u,
+                       dma_int_handler);
+#else
+    hal_ftm0_adc0_trigger_setup(adc_ring, 2u * APP_ADC_BLOCK_SIZE, dma_int_handler);
+#endif
+    hal_adc_config(APP_CFG_ADC_AVG_LOG2, APP_CFG_ADC_OPTS);
+#if (APP_CFG_BLINK_DMA_EN == DEF_ENABLED)
+    hal_ftm1_dma_setup(BOARD_GPIO_LED_RED, kGpioWave1Out);		/* LED of alarm_init()                                  */
+#else
+    hal_ftm1_setup(ftm1_int_handler);
+#endif
 
 
 #if (CPU_CFG_NAME_EN == DEF_ENABLED)
@@ -122,6 +386,14 @@ int  main (void){
 #endif
 
     BSP_Ser_Init(115200u);
+#if (APP_CFG_STREAM_EN == DEF_ENABLED)
+    stream_init(&adc_stream, APP_CFG_STREAM_BAUD);
+#endif
+#if (APP_CFG_CONSOLE_EN == DEF_ENABLED)
+    // from the first byte received on, the task reads it when it first runs
+    console_init(&app_console, console_ring, APP_CFG_CONSOLE_RING);
+    hal_uart_rx_dma_setup(console_ring, APP_CFG_CONSOLE_RING);
+#endif
     OSA_Init();                                                 /* Init uC/OS-III.                                      */
 
     OSTaskCreate( &AppStartupTaskTCB,                           /* Create the start task                                */
@@ -130,7 +402,7 @@ int  main (void){
                   0u,
                   APP_CFG_TASK_START_PRIO,
                   &AppStartupTaskStk[0u],
-                  (APP_CFG_TASK_START_STK_SIZE / 10u),
+                  APP_CFG_TASK_STK_LIMIT(APP_CFG_TASK_START_STK_SIZE),
                   APP_CFG_TASK_START_STK_SIZE,
                   0u,
                   0u,
@@ -148,6 +420,9 @@ int  main (void){
 
 static  void  AppStartupTask (void *p_arg){
     OS_ERR    os_err;
+#if (OS_CFG_TASK_STK_CHK_EN > 0u)
+    CPU_STK_SIZE  stk_free;
+#endif
 
     (void)p_arg;
 
@@ -163,255 +438,545 @@ static  void  AppStartupTask (void *p_arg){
     CPU_IntDisMeasMaxCurReset();
 #endif
 
-    // this semaphore will put this task in wait state so that it will not be scheduled anymore
-    OSSemCreate(&semaphore_starttask,
-    				"Start Task Lock",
-    				0u,
-    				&os_err);
+#if (APP_CFG_FILTER_BENCH_EN == DEF_ENABLED)
+    {
+        filter_bench_t  bench;
+        uint32_t        type;
+
+        filter_bench(&bench, app_cycles, 64u);
+        for (type = 0u; type < FILTER_TYPE_NBR; type++) {
+            APP_TRACE_INFO(("filter %-8s %5u.%02u cycles/sample\r\n", filter_name(type),
+                            bench.cycles_x100[type] / 100u, bench.cycles_x100[type] % 100u));
+        }
+    }
+    {
+        decim_bench_t   bench;
+        uint32_t        order, log2;
+
+        decim_bench(&bench, app_cycles, 64u);
+        for (order = 1u; order <= DECIM_ORDER_MAX; order++) {
+            for (log2 = 1u; log2 <= DECIM_LOG2_MAX; log2++) {
+                APP_TRACE_INFO(("decim order %u by %2u %6u.%02u cycles/output\r\n", order, 1u << log2,
+                                bench.cycles_x100[order - 1u][log2 - 1u] / 100u,
+                                bench.cycles_x100[order - 1u][log2 - 1u] % 100u));
+            }
+        }
+    }
+#if (APP_CFG_HISTORY_EN == DEF_ENABLED)
+    {
+        history_bench_t bench;
+
+        // on the ring of the history, history_init() starts it over below
+        history_bench(&bench, &adc_history, &app_history.hdr, APP_CFG_HISTORY_CHUNKS, app_cycles,
+                      APP_ADC_BLOCK_SIZE, 1024u);
+        APP_TRACE_INFO(("history %u readings/batch %u cycles/batch mean %u max (budget %u)\r\n",
+                        APP_ADC_BLOCK_SIZE, bench.mean, bench.max, APP_CFG_HISTORY_BUDGET));
+    }
+#endif
+#endif
+#if (APP_CFG_PIPE_BENCH_EN == DEF_ENABLED)
+    {
+        static bench_t  bench;
+        bench_result_t *b;
+        uint32_t        w;
+
+        // no branch counter on the M4
+        bench_run(&bench, app_cycles, hal_ts_hz(), NULL, 64u);
+        for (w = 0u; w < BENCH_WORKLOAD_NBR; w++) {
+            b = &bench.w[w];
+            APP_TRACE_INFO(("bench %-6s %5u.%02u cycles/sample %5u.%02u ns/sample %7s branches/sample path %5u cycles %4u transitions\r\n",
+                            bench_name(w), b->cycles_x100 / 100u, b->cycles_x100 % 100u, b->ns_x100 / 100u,
+                            b->ns_x100 % 100u, "-", b->path, b->transitions));
+        }
+    }
+#endif
 
     OSTaskCreate(&AppTaskTCB,                              		/* Create the start task                                */
                  "App Task",
                  AppTask,
                  0u,
-                 APP_CFG_TASK_START_PRIO,
+                 APP_CFG_TASK_APP_PRIO,
                  &AppTaskStk[0u],
-                 (APP_CFG_TASK_START_STK_SIZE / 10u),
-                 APP_CFG_TASK_START_STK_SIZE,
+                 APP_CFG_TASK_STK_LIMIT(APP_CFG_TASK_APP_STK_SIZE),
+                 APP_CFG_TASK_APP_STK_SIZE,
                  0u,
                  0u,
                  0u,
-                 (OS_OPT_TASK_STK_CHK | OS_OPT_TASK_STK_CLR | OS_OPT_TASK_SAVE_FP),
+                 (OS_OPT_TASK_STK_CHK | OS_OPT_TASK_STK_CLR),      /* range checking is integer only, no FP context      */
                  &os_err);
 
-    // do not schedule this task anymore
-    OSSemPend(&semaphore_starttask,
-    				  0u,
-    				  OS_OPT_PEND_BLOCKING,
-    				  0u,
-    				  &os_err);
+    // low priority, prints the profiling figures on demand
+    OSTaskCreate(&AppReportTaskTCB,
+                 "App Report Task",
+                 AppReportTask,
+                 0u,
+                 APP_CFG_TASK_REPORT_PRIO,
+                 &AppReportTaskStk[0u],
+                 APP_CFG_TASK_STK_LIMIT(APP_CFG_TASK_REPORT_STK_SIZE),
+                 APP_CFG_TASK_REPORT_STK_SIZE,
+                 0u,
+                 0u,
+                 0u,
+                 (OS_OPT_TASK_STK_CHK | OS_OPT_TASK_STK_CLR),
+                 &os_err);
+
+#if (APP_CFG_CONSOLE_EN == DEF_ENABLED)
+    // below the report task: preempted by every other task, it never delays them
+    OSTaskCreate(&AppConsoleTaskTCB,
+                 "App Console Task",
+                 AppConsoleTask,
+                 0u,
+                 APP_CFG_TASK_CONSOLE_PRIO,
+                 &AppConsoleTaskStk[0u],
+                 APP_CFG_TASK_STK_LIMIT(APP_CFG_TASK_CONSOLE_STK_SIZE),
+                 APP_CFG_TASK_CONSOLE_STK_SIZE,
+                 0u,
+                 0u,
+                 0u,
+                 (OS_OPT_TASK_STK_CHK | OS_OPT_TASK_STK_CLR),
+                 &os_err);
+#endif
+
+#if (OS_CFG_TASK_STK_CHK_EN > 0u)
+    OSTaskStkChk((OS_TCB *)0, &stk_free, &app_start_stk_used, &os_err);
+#endif
+    // done: the TCB leaves the ready and debug lists, AppTask of the same priority runs
+#if (OS_CFG_TASK_DEL_EN > 0u)
+    OSTaskDel((OS_TCB *)0, &os_err);
+#else
+    OSTaskSuspend((OS_TCB *)0, &os_err);
+#endif
     while (DEF_TRUE) {}
 }
 
 static  void  AppTask (void *p_arg){
 	CPU_ERR     cpu_err;
 	OS_ERR      os_err;
+	uint32_t    n;
+#if (APP_CFG_MON_CH_NBR > 1u)
+	uint32_t    i;
+#endif
 
     (void)p_arg;
 
-    // this semaphore is for ADC0 reading
-    OSSemCreate(&semaphore_main,
-				"Main Task Lock",
-				0u,
-				&os_err);
-
-    // all the LEDs are switched off initially
-    GPIO_DRV_SetPinOutput(BOARD_GPIO_LED_RED);
-    GPIO_DRV_SetPinOutput(BOARD_GPIO_LED_GREEN);
-    GPIO_DRV_SetPinOutput(BOARD_GPIO_LED_BLUE);
-
-    // the output of the wave is initially low
-    GPIO_DRV_ClearPinOutput(kGpioWave1Out);
+    // LEDs off, wave low and initial blink state
+    alarm_init();
+    filter_init(&adc_filter, APP_ADC_FILTER, APP_CFG_FILTER_MAVG_LOG2);
+#if (APP_CFG_MON_CH_NBR > 1u)
+    mon_init(&adc_mon, APP_CFG_MON_CH_NBR);
+    for (i = 1u; i < APP_CFG_MON_CH_NBR && i <= sizeof(mon_pin) / sizeof(mon_pin[0]); i++)
+    	mon_set_output(&adc_mon, i, mon_pin[i - 1u], APP_CFG_MON_ALARM_LEDS);
+#endif
+#if (APP_CFG_CALIB_EN == DEF_ENABLED)
+    // switch held at reset, active low
+    if (GPIO_DRV_ReadPinInput(APP_CFG_CALIB_SW) == 0u)
+    	app_calibrate();
+#endif
+    decim_init(&adc_decim, APP_CFG_DECIM_LOG2, APP_CFG_DECIM_ORDER);
+#if (APP_CFG_RATE_EN == DEF_ENABLED)
+    // fastest until the first block tells how far the edges are
+    app_rate_set(0u);
+    rate_init(&adc_rate, APP_CFG_RATE_PS_SLOW - APP_CFG_RATE_PS_FAST + 1u, hal_adc_trigger_cycles(),
+              APP_ADC_BLOCK_SIZE, APP_CFG_RATE_NEAR);
+#endif
+#if (APP_CFG_TREND_EN == DEF_ENABLED)
+    trend_init(&adc_trend, APP_CFG_TREND_WIN);
+#endif
+#if (APP_CFG_STATS_EN == DEF_ENABLED)
+    // bands after the calibration
+    stats_init(&adc_stats, APP_CFG_STATS_WIN, alarm_cfg());
+#endif
+#if (APP_CFG_CAPTURE_EN == DEF_ENABLED)
+    // the records are the outputs of the decimator
+    capture_init(&app_capture.hdr, hal_ts_hz(), hal_adc_trigger_cycles() << APP_CFG_DECIM_LOG2, alarm_cfg(),
+                 APP_ADC_FILTER, APP_CFG_FILTER_MAVG_LOG2, led_rate, BAND_LED_RED);
+#endif
+#if (APP_CFG_HISTORY_EN == DEF_ENABLED)
+    history_init(&adc_history, &app_history.hdr, APP_CFG_HISTORY_CHUNKS, hal_ts_hz(), APP_CFG_HISTORY_AVG_LOG2);
+#endif
 
-    // initial settings
-    ftm1_change_pulse(BLINK_SHORT);
-    current_led = BOARD_GPIO_LED_RED;
-    led_rate = BLINK_NONE;
+    // the stages enabled in app_cfg.h, in the order of pipeline_batch()
+    pipeline_init(&adc_pipeline);
+    adc_pipeline.filter = &adc_filter;
+    adc_pipeline.block = adc_block;
+#if (APP_CFG_STREAM_EN == DEF_ENABLED)
+    adc_pipeline.stream = &adc_stream;
+#endif
+#if (APP_CFG_MON_CH_NBR > 1u)
+    adc_pipeline.mon = &adc_mon;
+#endif
+#if (APP_CFG_DECIM_LOG2 > 0u)
+    adc_pipeline.decim = &adc_decim;
+#endif
+#if (APP_CFG_CAPTURE_EN == DEF_ENABLED)
+    adc_pipeline.capture = &app_capture.hdr;
+    adc_pipeline.capture_rec = app_capture.rec;
+    adc_pipeline.capture_cap = APP_CFG_CAPTURE_LEN;
+#endif
+#if (APP_CFG_HISTORY_EN == DEF_ENABLED)
+    adc_pipeline.history = &adc_history;
+    adc_pipeline.history_budget = APP_CFG_HISTORY_BUDGET;
+#endif
+#if (APP_CFG_STATS_EN == DEF_ENABLED)
+    adc_pipeline.stats = &adc_stats;
+#endif
+#if (APP_CFG_TREND_EN == DEF_ENABLED)
+    adc_pipeline.trend = &adc_trend;
+    adc_pipeline.trend_horizon = APP_CFG_TREND_HORIZON_MS * (hal_ts_hz() / 1000u);
+    adc_pipeline.trend_min_codes = APP_CFG_TREND_MIN_CODES;
+#endif
+#if (APP_CFG_ADC_COMPARE_EN == DEF_ENABLED)
+    adc_pipeline.compare = 1u;
+#endif
+#if (APP_CFG_RATE_EN == DEF_ENABLED)
+    adc_pipeline.rate = &adc_rate;
+    adc_pipeline.rate_set = app_rate_set;
+#endif
 
     // main cycle
     while (DEF_TRUE) {
-    	// wait for ADC0 reading
-    	OSSemPend(&semaphore_main,
-				  0u,
-				  OS_OPT_PEND_BLOCKING,
-				  0u,
-				  &os_err);
-    	// do the check and eventually change FTM1 settings and LED
-    	range_check();
+    	// wait for readings in the queue, the task semaphore is only a wake-up: a single pass can drain
+    	// the samples of several posts
+    	OSTaskSemPend(0u,
+				      OS_OPT_PEND_BLOCKING,
+				      0u,
+				      &os_err);
+    	// filter, do the check and eventually change FTM1 settings and LED
+    	while ((n = spsc_pop(&adc_queue, adc_batch, APP_ADC_BLOCK_SIZE)) > 0u)
+    		(void)pipeline_batch(&adc_pipeline, adc_batch, n);
     }
 }
 
-static void ftm0_adc0_trigger_setup(void){
-	INT_SYS_EnableIRQ(DMA0_IRQn);							// enable interrupts of eDMA module
-	INT_SYS_InstallHandler(DMA0_IRQn, dma_int_handler);		// install routine for interrupt
-
-	SIM_SCGC6 |= SIM_SCGC6_DMAMUX_MASK;						// enable DMAMUX module
-	SIM_SCGC7 |= SIM_SCGC7_DMA_MASK;						// enable eDMA module
-	DMAMUX_CHCFG0 = (DMAMUX_CHCFG_ENBL_MASK|DMAMUX_CHCFG_SOURCE(40));
-															// route ADC0 DMA request to channel 0 of eDMA
-	DMA_CR = (DMA_CR_EDBG_MASK);							// enable debug
-															// word is 32bit NBYTES
-	DMA_ERQ |= (DMA_ERQ_ERQ0_MASK);							// enable DMA requests on channel 0
-	DMA_DCHPRI0 = ((uint32_t) (0));							// static priority
-	DMA_TCD0_CSR = (DMA_CSR_INTMAJOR_MASK);					// generate interrupt after major cycle
-	DMA_TCD0_SADDR = DMA_SADDR_SADDR(&ADC0_RA);				// set source address i.e. ADC0 register A,
-															// where the reading is stored
-	DMA_TCD0_SOFF = DMA_SOFF_SOFF(0);						// no offset
-	DMA_TCD0_DADDR = DMA_DADDR_DADDR(&adc_in);				// set destination address in SRAM:
-															// address of the variable
-	DMA_TCD0_DOFF = DMA_DOFF_DOFF(0);						// no offset
-	DMA_TCD0_ATTR = (DMA_ATTR_SSIZE(1)|DMA_ATTR_DSIZE(1)|
-					 DMA_ATTR_SMOD(0)|DMA_ATTR_DMOD(0));	// 16b read and write, disable modulo function
-	DMA_TCD0_NBYTES_MLNO = 2;								// 16bits minor cycle
-	DMA_TCD0_SLAST = 0;										// do not correct source address after major cycle
-	DMA_TCD0_CITER_ELINKNO = 1;								// number of major cycles
-	DMA_TCD0_BITER_ELINKNO = 1;								// initial count of major cycles
-	DMA_TCD0_DLASTSGA = 0;									// do not correct destination address after major cycle
-
-	SIM_SCGC6 |= SIM_SCGC6_ADC0_MASK;						// enable ADC0
-	SIM_SOPT7 |= (SIM_SOPT7_ADC0TRGSEL(8)|SIM_SOPT7_ADC0ALTTRGEN_MASK);
-															// ADC0 trigger source: FTM0
-	ADC0_SC2 = (ADC_SC2_ADTRG_MASK|ADC_SC2_DMAEN_MASK);		// ADC0 enable hardware triggers and DMA requests after
-															// conversion
-	ADC0_SC1A = ADC_SC1_ADCH(0xC);							// enable conversion on selected channel
-	ADC0_CFG1 = ADC_CFG1_MODE(3);							// single ended 16B
-
-	SIM_SCGC6 |= SIM_SCGC6_FTM0_MASK;						// enable FTM0
-	FTM0_CONF = 0xC0; 										// set the timer in Debug mode, with BDM mode = 0xC0
-	FTM0_FMS =  0x0;										// enable modifications to the FTM0 configuration
-	FTM0_MODE |= (FTM_MODE_WPDIS_MASK|FTM_MODE_FTMEN_MASK);	// allowing writing in the registers
-	FTM0_CNTIN = FTM_CNTIN_INIT(0);							// initial value of 16 bit counter
-	FTM0_MOD = FTM_MOD_MOD(0xFFFF);							// module of the count over 16 bits
-	FTM0_EXTTRIG |= FTM_EXTTRIG_INITTRIGEN_MASK;			// enable hw trigger on init count
-	FTM0_SC = (FTM_SC_PS(7)|FTM_SC_CLKS(0x1));				// enable FTM0 with prescaler set to FTM_C_PS(7)=128
+static  void  AppReportTask (void *p_arg){
+	OS_ERR      os_err;
+	uint32_t    pressed = 0u;
+#if (APP_CFG_MON_CH_NBR > 1u) || (APP_CFG_RATE_EN == DEF_ENABLED)
+	uint32_t    i;
+#endif
+
+    (void)p_arg;
+#if (APP_CFG_JOURNAL_EN == DEF_ENABLED) && (APP_CFG_JOURNAL_OUT == JOURNAL_OUT_FLASH)
+    if (flog_mount(&journal_log, APP_CFG_FLOG_BASE, APP_CFG_FLOG_SECTORS))
+    	APP_TRACE_INFO(("flash log sector %u seq %u slot %u\r\n", journal_log.cur, journal_log.seq, journal_log.next));
+#endif
+
+    while (DEF_TRUE) {
+    	OSTimeDlyHMSM(0u, 0u, 0u, 50u, OS_OPT_TIME_HMSM_STRICT, &os_err);
+#if (APP_CFG_JOURNAL_EN == DEF_ENABLED)
+    	app_journal_drain();
+#endif
+    	// probes asked for by the console, this task writes PROF_MASK_SNAPSHOT
+    	if (prof_dump_requested())
+    		prof_dump();
+    	// dump once per press of the switch, active low
+    	if (GPIO_DRV_ReadPinInput(BOARD_SW_GPIO) == 0u) {
+    		if (!pressed) {
+    			prof_dump();
+    			APP_TRACE_INFO(("queue produced %u consumed %u overruns %u\r\n", adc_queue.produced,
+    							adc_queue.consumed, adc_queue.overruns));
+#if (APP_CFG_MON_CH_NBR > 1u)
+    			for (i = 1u; i < APP_CFG_MON_CH_NBR; i++)
+    				APP_TRACE_INFO(("rail %2u state %2u alarm %u changes %u\r\n", i, adc_mon.state[i],
+    								adc_mon.alarm[i], adc_mon.changes[i]));
+#endif
+#if (APP_CFG_RATE_EN == DEF_ENABLED)
+    			APP_TRACE_INFO(("rate level %u faster %u slower %u\r\n", adc_rate.level, adc_rate.ups, adc_rate.downs));
+    			for (i = 0u; i < adc_rate.levels; i++)
+    				APP_TRACE_INFO(("  level %u: %u blocks\r\n", i, adc_rate.blocks[i]));
+#endif
+#if (APP_CFG_CAPTURE_EN == DEF_ENABLED)
+    			// where the debugger finds the capture file
+    			APP_TRACE_INFO(("capture %u of %u readings, %u bytes at 0x%08x\r\n", app_capture.hdr.nbr,
+    							APP_CFG_CAPTURE_LEN, app_capture.hdr.hdr_size + app_capture.hdr.nbr * sizeof(capture_rec_t),
+    							(uint32_t)(uintptr_t)&app_capture));
+#endif
+#if (APP_CFG_HISTORY_EN == DEF_ENABLED)
+    			app_history_report();
+#endif
+#if (APP_CFG_TREND_EN == DEF_ENABLED)
+    			APP_TRACE_INFO(("early warning %u, %u raised\r\n", alarm_warning, adc_pipeline.warnings));
+#endif
+#if (APP_CFG_STATS_EN == DEF_ENABLED)
+    			app_stats_report();
+#endif
+#if (APP_CFG_JOURNAL_EN == DEF_ENABLED)
+    			app_journal_report();
+#endif
+#if (APP_CFG_CONSOLE_EN == DEF_ENABLED)
+    			APP_TRACE_INFO(("console %u bytes %u lines %u errors %u too long, ring peak %u of %u\r\n",
+    							app_console.bytes, app_console.lines, app_console.errors, app_console.dropped,
+    							app_console.peak, APP_CFG_CONSOLE_RING));
+#endif
+#ifdef CPU_CFG_INT_DIS_MEAS_EN
+    			APP_TRACE_INFO(("interrupts disabled max %u cycles, %s ISR posts\r\n", (unsigned)CPU_IntDisMeasMaxGet(),
+    							APP_ISR_POST));
+#endif
+#if (OS_CFG_TASK_STK_CHK_EN > 0u)
+    			app_stk_report();
+#endif
+    		}
+    		pressed = 1u;
+    	} else {
+    		pressed = 0u;
+    	}
+    }
 }
 
-static void dma_int_handler(void){
+#if (APP_CFG_CONSOLE_EN == DEF_ENABLED)
+static  void  AppConsoleTask (void *p_arg){
 	OS_ERR      os_err;
 
-	// disable interrupts
-	CPU_CRITICAL_ENTER();
-	OSIntEnter();
+    (void)p_arg;
 
-	// enable main task
-	OSSemPost(&semaphore_main,
-				  OS_OPT_POST_1,
-				  &os_err);
+    while (DEF_TRUE) {
+    	OSTimeDlyHMSM(0u, 0u, 0u, APP_CFG_CONSOLE_POLL_MS, OS_OPT_TIME_HMSM_STRICT, &os_err);
+    	// the lines received meanwhile, answered on the same port
+    	(void)console_poll(&app_console, hal_uart_rx_head());
+    }
+}
+#endif
 
-	// allow other DMA requests
-	DMA_CINT = DMA_CINT_CINT(0);
+#if (OS_CFG_TASK_STK_CHK_EN > 0u)
+static void app_stk_report(void){
+	OS_ERR          os_err;
+	CPU_STK_SIZE    free, used;
+#if (OS_CFG_DBG_EN > 0u)
+	OS_TCB         *p_tcb;
+
+	// kernel and application tasks, all created before the report task first runs
+	for (p_tcb = OSTaskDbgListPtr; p_tcb != (OS_TCB *)0; p_tcb = p_tcb->DbgNextPtr) {
+		OSTaskStkChk(p_tcb, &free, &used, &os_err);
+		if (os_err == OS_ERR_NONE)
+			app_stk_line((const char *)p_tcb->NamePtr, used, free + used);
+	}
+#else
+	OSTaskStkChk(&AppTaskTCB, &free, &used, &os_err);
+	app_stk_line("App Task", used, free + used);
+	OSTaskStkChk(&AppReportTaskTCB, &free, &used, &os_err);
+	app_stk_line("App Report Task", used, free + used);
+#if (APP_CFG_CONSOLE_EN == DEF_ENABLED)
+	OSTaskStkChk(&AppConsoleTaskTCB, &free, &used, &os_err);
+	app_stk_line("App Console Task", used, free + used);
+#endif
+#endif
+	app_stk_line("App Startup Task (deleted)", app_start_stk_used, APP_CFG_TASK_START_STK_SIZE);
+}
 
-	// re-enable interrupts
-	CPU_CRITICAL_EXIT();
-	OSIntExit();
+// peak in words, and the stack size APP_CFG_TASK_STK_FIT() gives for it as APP_CFG_TASK_..._STK_PEAK
+static void app_stk_line(const char *name, CPU_STK_SIZE used, CPU_STK_SIZE size){
+	APP_TRACE_INFO(("stack %-26s %4u of %4u words %3u%%, with margin %4u\r\n", name, (unsigned)used,
+					(unsigned)size, (unsigned)(size ? used * 100u / size : 0u), (unsigned)APP_CFG_TASK_STK_FIT(used)));
 }
+#endif
+
+#if (APP_CFG_STATS_EN == DEF_ENABLED)
+static void app_stats_report(void){
+	static stats_snap_t  snap;							// off the stack
+	uint32_t             i;
 
-static void ftm1_setup(void){
-	INT_SYS_EnableIRQ(FTM1_IRQn);
-	INT_SYS_InstallHandler(FTM1_IRQn, ftm1_int_handler);
-    SIM_SCGC6 |= SIM_SCGC6_FTM1_MASK;
-    FTM1_CONF = 0xC0;
-    FTM1_FMS =  0x0;
-    FTM1_MODE |= (FTM_MODE_WPDIS_MASK|FTM_MODE_FTMEN_MASK);
-    FTM1_CNTIN = FTM_CNTIN_INIT(0);
-    FTM1_SYNCONF |= (FTM_SYNCONF_SWWRBUF_MASK|FTM_SYNCONF_SWRSTCNT_MASK);
+	// AppTask publishes at the end of each window and preempts this copy, which then starts again
+	if (stats_read(&adc_stats, &snap) != 0 || snap.windows == 0u) {
+		APP_TRACE_INFO(("stats: no window yet\r\n"));
+		return;
+	}
+	app_stats_line("window", &snap.win);
+	app_stats_line("total", &snap.all);
+	for (i = 0u; i < STATS_BANDS; i++)
+		APP_TRACE_INFO(("band from %u.%uV %10u ms\r\n", i / 2u, (i % 2u) * 5u,
+						(uint32_t)(snap.all.band_ts[i] / (hal_ts_hz() / 1000u))));
+	for (i = 0u; i < STATS_BINS; i++)
+		if (snap.all.hist[i] != 0u)
+			APP_TRACE_INFO(("codes %5u.. %10u\r\n", i << STATS_BIN_SHIFT, snap.all.hist[i]));
+}
+
+static void app_stats_line(const char *name, const stats_sum_t *sum){
+	uint32_t sd_x100 = stats_sd_x100(sum);
+
+	// no floating point here, the task has no FP context
+	APP_TRACE_INFO(("stats %-6s %10u readings min %5u max %5u mean %5u.%02u sd %5u.%02u\r\n", name, sum->n, sum->min,
+					sum->max, (uint32_t)sum->mean >> STATS_MEAN_SHIFT, ((uint32_t)sum->mean & 0xFFu) * 100u / 256u,
+					sd_x100 / 100u, sd_x100 % 100u));
 }
+#endif
+
+#if (APP_CFG_JOURNAL_EN == DEF_ENABLED)
+// one batch per call: JOURNAL_SIZE changes in 50 ms are already a chattering input, the rest is counted
+static void app_journal_drain(void){
+	uint32_t n = journal_pop(&alarm_journal, journal_batch, JOURNAL_SIZE);
+#if (APP_CFG_JOURNAL_OUT == JOURNAL_OUT_FLASH)
 
-static void ftm1_change_pulse(blink_mode rate){
-	CPU_CRITICAL_ENTER();
-	OSIntEnter();
-	switch(rate){
-		case BLINK_LONG:
-			FTM1_MOD = FTM_MOD_MOD(0x5B8D);
-			break;
-		case BLINK_SHORT:
-			FTM1_MOD = FTM_MOD_MOD(0x2DC6);
-			break;
-		case BLINK_SHORTEST:
-			FTM1_MOD = FTM_MOD_MOD(0x3210);
-			break;
-		case BLINK_NONE:
-			GPIO_DRV_ClearPinOutput(current_led);
-			FTM1_SC  &= FTM_SC_CLKS(0x0);
-			CPU_CRITICAL_EXIT();
-			OSIntExit();
-			return;
+	// a sector erase in the batch blocks this task for tens of milliseconds, AppTask preempts it
+	journal_dropped += n - flog_append(&journal_log, journal_batch, n);
+#else
+	uint32_t i;
+
+	for (i = 0u; i < n; i++)
+		app_journal_line(&journal_batch[i]);
+#endif
+	if (alarm_journal.lost != journal_lost) {
+		APP_TRACE_INFO(("journal full, %u changes lost\r\n", alarm_journal.lost - journal_lost));
+		journal_lost = alarm_journal.lost;
 	}
-	FTM1_SYNC |= (FTM_SYNC_SWSYNC_MASK|FTM_SYNC_REINIT_MASK);
-	FTM1_SC  = (FTM_SC_PS(7)|FTM_SC_CLKS(0x1)|FTM_SC_TOIE_MASK);
-	CPU_CRITICAL_EXIT();
-	OSIntExit();
 }
 
+static void app_journal_report(void){
+#if (APP_CFG_JOURNAL_OUT == JOURNAL_OUT_FLASH)
+	uint32_t min, max, n, i;
+#endif
+
+	APP_TRACE_INFO(("journal added %u lost %u\r\n", alarm_journal.added, alarm_journal.lost));
+#if (APP_CFG_JOURNAL_OUT == JOURNAL_OUT_FLASH)
+	flog_wear(&journal_log, &min, &max);
+	APP_TRACE_INFO(("flash log sector %u seq %u written %u dropped %u erases %u (per sector %u to %u) errors %u\r\n",
+					journal_log.cur, journal_log.seq, journal_log.written, journal_dropped, journal_log.erases,
+					min, max, journal_log.errors));
+	n = flog_last(&journal_log, journal_batch, APP_CFG_JOURNAL_DUMP);
+	for (i = 0u; i < n; i++)
+		app_journal_line(&journal_batch[i]);
+#endif
+}
+
+// states as BAND_STATE(led_rate, led index)
+static void app_journal_line(const journal_rec_t *r){
+	APP_TRACE_INFO(("change %10u state %2u -> %2u reading %5u\r\n", r->ts, r->from, r->to, r->sample));
+}
+#endif
+
+#if (APP_CFG_HISTORY_EN == DEF_ENABLED)
+static void app_history_report(void){
+	static history_chunk_t  first, last;				// off the stack of the task
+	uint32_t head = app_history.hdr.head;
+	uint32_t values = adc_history.values;
+	uint32_t bits_x100 = values ? (uint32_t)((uint64_t)adc_history.bytes * 800u / values) : 0u;
+	uint32_t span_s = 0u;
+
+	// from the oldest chunk kept to the end of the last one closed; AppTask may overwrite either meanwhile
+	if (head > 0u && history_read(&app_history.hdr, history_find(&app_history.hdr, 0u), &first) == HISTORY_OK &&
+		history_read(&app_history.hdr, head - 1u, &last) == HISTORY_OK)
+		span_s = (last.time_ms - first.time_ms) / 1000u +
+				 (uint32_t)((uint64_t)last.nbr * last.period / app_history.hdr.ts_hz);
+	APP_TRACE_INFO(("history %u readings %u values, %u chunks closed, %u.%02u bits/value, %u s kept, %u bytes at 0x%08x\r\n",
+					adc_history.readings, values, head, bits_x100 / 100u, bits_x100 % 100u, span_s,
+					(uint32_t)sizeof(app_history), (uint32_t)(uintptr_t)&app_history));
+	APP_TRACE_INFO(("history batches over %u cycles %u\r\n", APP_CFG_HISTORY_BUDGET, adc_pipeline.history_over));
+}
+#endif
+
+static void dma_int_handler(void){
+	OS_ERR      os_err;
+	PROF_START(t);
+
+	HAL_ISR_ENTER();
+
+	// move the completed half out of the ring before the DMA comes back to it; the queue is wait-free
+	// and this is its only producer
+	spsc_push_scan(&adc_queue, &adc_ring[adc_ring_half * APP_ADC_BLOCK_SIZE], APP_ADC_BLOCK_SIZE,
+				   APP_CFG_MON_CH_NBR, APP_ADC_PER_TRIG, hal_adc_trigger_ts(), hal_adc_trigger_cycles());
+	adc_ring_half ^= 1u;
+
+	// allow other DMA requests
+	hal_dma_clear_int();
+
+	// wake AppTask up; with OS_CFG_ISR_POST_DEFERRED_EN the post is queued to the ISR handler task and
+	// the kernel locks the scheduler instead of masking interrupts in its own critical sections. The
+	// post is the only part of the body that masks, its length bounds the kernel's windows; the running
+	// maximum of uC/CPU belongs to the interrupted task and is left alone
+	PROF_START(m);
+	OSTaskSemPost(&AppTaskTCB,
+				  OS_OPT_POST_NONE,
+				  &os_err);
+	PROF_STOP(PROF_MASK_DMA_ISR, m);
+	PROF_STOP(PROF_DMA_ISR, t);
+
+	HAL_ISR_EXIT();
+}
+
+#if (APP_CFG_BLINK_DMA_EN != DEF_ENABLED)
+// no kernel call: neither OSIntEnter()/OSIntExit() nor masking, ftm1_change_pulse() masks this one
 static void ftm1_int_handler(void){
-	OS_ERR      err;
-	CPU_ERR     cpu_err;
+	PROF_START(t);
 
-	CPU_CRITICAL_ENTER();
-	OSIntEnter();
-	// assuming that FMT1 has overflown, unique source of interrupts
-	FTM1_SC &= 0x7F;
+	hal_ftm1_clear_int();
+	blink_toggle();
+	PROF_STOP(PROF_FTM1_ISR, t);
+}
+#endif
 
-	GPIO_DRV_TogglePinOutput(current_led);
-	GPIO_DRV_TogglePinOutput(kGpioWave1Out);
+#if (APP_CFG_RATE_EN == DEF_ENABLED)
+static void app_rate_set(uint32_t level){
+	uint32_t    ps, mod;
 
-	CPU_CRITICAL_EXIT();
-	OSIntExit();
+	rate_ftm(APP_CFG_RATE_PS_FAST, APP_CFG_ADC_TRIG_MOD, level, &ps, &mod);
+	hal_adc_trigger_rate(ps, mod);
 }
+#endif
 
-static void range_check(void){
-	/* Rate of blink check */
-	// 0.0 <= V < 0.5 | 1.0 <= V < 1.5 | 2.0 <= V < 2.5
-	if (led_rate != BLINK_LONG &&(
-			((adc_in >= VOLT_00)&&
-					(adc_in < (VOLT_05 - THRE_FACT_RIGHT * THRE_05 * extend_range_rate(BLINK_SHORT) * extend_range_color(BOARD_GPIO_LED_GREEN))))||
-			((adc_in >= (VOLT_10 + THRE_FACT_LEFT * THRE_10 * extend_range_rate(BLINK_SHORT) * extend_range_color(BOARD_GPIO_LED_GREEN)))&&
-					(adc_in < (VOLT_15 - THRE_FACT_RIGHT * THRE_15 * extend_range_rate(BLINK_SHORT) * extend_range_color(BOARD_GPIO_LED_BLUE))))||
-			((adc_in >= (VOLT_20 + THRE_FACT_LEFT * THRE_20 * extend_range_rate(BLINK_SHORT) * extend_range_color(BOARD_GPIO_LED_BLUE)))&&
-					(adc_in < (VOLT_25 - THRE_FACT_RIGHT * THRE_25 * extend_range_rate(BLINK_SHORT) * extend_range_color(BOARD_GPIO_LED_RED)))))){
-		ftm1_change_pulse(BLINK_LONG);
-		led_rate = BLINK_LONG;
-	}
-	// 0.5 <= V < 1.0 | 1.5 <= V < 2.0 | 2.5 <= V < 3.0
-	else if (led_rate != BLINK_SHORT &&(
-			((adc_in >= (VOLT_05 + THRE_FACT_LEFT * THRE_05 * extend_range_rate(BLINK_LONG) * extend_range_color(BOARD_GPIO_LED_GREEN)))&&
-					(adc_in < (VOLT_10 - THRE_FACT_RIGHT * THRE_10 * extend_range_rate(BLINK_LONG) * extend_range_color(BOARD_GPIO_LED_BLUE))))||
-			((adc_in >= (VOLT_15 + THRE_FACT_LEFT * THRE_15 * extend_range_rate(BLINK_LONG) * extend_range_color(BOARD_GPIO_LED_BLUE)))&&
-					(adc_in < (VOLT_20 - THRE_FACT_RIGHT * THRE_20 * extend_range_rate(BLINK_LONG) * extend_range_color(BOARD_GPIO_LED_RED))))||
-			((adc_in >= (VOLT_25 + THRE_FACT_LEFT * THRE_25 * extend_range_rate(BLINK_LONG) * extend_range_color(BOARD_GPIO_LED_RED)))&&
-					(adc_in < (VOLT_30 - THRE_FACT_RIGHT * THRE_30 * extend_range_rate(BLINK_LONG) * extend_range_color(BOARD_GPIO_LED_RED)))))){
-		ftm1_change_pulse(BLINK_SHORT);
-		led_rate = BLINK_SHORT;
-	}
-	// 3.0 <= V
-	else if (led_rate != BLINK_NONE &&
-			(adc_in >= (VOLT_30 + THRE_FACT_LEFT * THRE_30 * extend_range_rate(BLINK_SHORT) * extend_range_color(BOARD_GPIO_LED_RED)))){
-		ftm1_change_pulse(BLINK_NONE);
-		led_rate = BLINK_NONE;
-	}
-	/* LED color check */
-	// 0.0 <= V < 1.0 ---> GREEN
-	if ((current_led != BOARD_GPIO_LED_GREEN) &&
-			(adc_in >= VOLT_00) &&
-			(adc_in < (VOLT_10 - THRE_FACT_RIGHT * THRE_10 * extend_range_color(BOARD_GPIO_LED_BLUE)))){
-		current_led = BOARD_GPIO_LED_GREEN;
-		GPIO_DRV_SetPinOutput(BOARD_GPIO_LED_BLUE);
-		GPIO_DRV_SetPinOutput(BOARD_GPIO_LED_RED);
-	}
-	// 1.0 <= V < 2.0 ---> BLUE
-	else if ((current_led != BOARD_GPIO_LED_BLUE) &&
-			(adc_in >= (VOLT_10 + THRE_FACT_LEFT * THRE_10 * extend_range_color(BOARD_GPIO_LED_GREEN))) &&
-			(adc_in <  (VOLT_20 - THRE_FACT_RIGHT * THRE_20 * extend_range_color(BOARD_GPIO_LED_RED)))){
-		current_led = BOARD_GPIO_LED_BLUE;
-		GPIO_DRV_SetPinOutput(BOARD_GPIO_LED_GREEN);
-		GPIO_DRV_SetPinOutput(BOARD_GPIO_LED_RED);
+#if (APP_CFG_CALIB_EN == DEF_ENABLED)
+static void app_calibrate(void){
+	static calib_t  cal;
+	band_cfg_t  cfg;
+	OS_ERR      os_err;
+	uint32_t    level, n, i, k;
+	int         err;
+
+	calib_init(&cal);
+	for (level = 0u; level < BAND_VOLT_NBR; level++) {
+		APP_TRACE_INFO(("calib: input at %u.%u V, then press the switch\r\n", level / 2u, (level % 2u) * 5u));
+		app_calib_wait();
+		// burst at the calibration rate, only channel 0 is taken, the noise measured after the decimation
+		hal_adc_trigger_rate(APP_CFG_CALIB_TRIG_PS, APP_CFG_CALIB_TRIG_MOD);
+		decim_init(&adc_decim, APP_CFG_DECIM_LOG2, APP_CFG_DECIM_ORDER);
+		while (cal.level[level].n < APP_CFG_CALIB_SAMPLES) {
+			OSTaskSemPend(0u,
+					      OS_OPT_PEND_BLOCKING,
+					      0u,
+					      &os_err);
+			while ((n = spsc_pop(&adc_queue, adc_batch, APP_ADC_BLOCK_SIZE)) > 0u) {
+#if (APP_CFG_DECIM_LOG2 > 0u)
+				n = decim_batch(&adc_decim, adc_batch, n);
+#endif
+				for (i = 0u, k = 0u; i < n; i++)
+					if (adc_batch[i].ch == 0u)
+						adc_block[k++] = adc_batch[i].code;
+				calib_add(&cal, level, adc_block, k);
+			}
+		}
+		hal_adc_trigger_rate(APP_CFG_ADC_TRIG_PS, APP_CFG_ADC_TRIG_MOD);
+		n = calib_sigma_x100(&cal, level);
+		APP_TRACE_INFO(("calib: %u.%u V mean %u sigma %u.%02u min %u max %u\r\n", level / 2u, (level % 2u) * 5u,
+						calib_mean(&cal, level), n / 100u, n % 100u, cal.level[level].min, cal.level[level].max));
 	}
-	// 2.0 <= V 	  ---> RED
-	else if ((current_led != BOARD_GPIO_LED_RED) &&
-			(adc_in >= (VOLT_20 + THRE_FACT_LEFT * THRE_20 * extend_range_color(BOARD_GPIO_LED_BLUE)))) {
-		current_led = BOARD_GPIO_LED_RED;
-		GPIO_DRV_SetPinOutput(BOARD_GPIO_LED_BLUE);
-		GPIO_DRV_SetPinOutput(BOARD_GPIO_LED_GREEN);
+
+	err = calib_build(&cal, &cfg);
+	if (err == CALIB_OK)
+		err = alarm_set_cfg(&cfg) == 0 ? CALIB_OK : CALIB_ERR_TABLE;
+	if (err != CALIB_OK) {
+		APP_TRACE_INFO(("calib: failed (%d), bands of app_cfg.h kept\r\n", err));
+		return;
 	}
+	// in the form of app_cfg.h, to make them the defaults
+	for (level = 1u; level < BAND_VOLT_NBR; level++)
+		APP_TRACE_INFO(("#define VOLT_%u%u %5u\r\n", level / 2u, (level % 2u) * 5u, cfg.volt[level]));
+	for (level = 1u; level < BAND_VOLT_NBR; level++)
+		APP_TRACE_INFO(("#define THRE_%u%u %5u\r\n", level / 2u, (level % 2u) * 5u, cfg.thre[level]));
 }
 
-static uint8_t extend_range_color(uint32_t required_led){
-	if (current_led == required_led)
-		return ((uint8_t)(1));
-	return 0;
+// release and press of the calibration switch, the readings meanwhile are dropped
+static void app_calib_wait(void){
+	OS_ERR      os_err;
+	uint32_t    released = 0u;
+
+	while (!released || GPIO_DRV_ReadPinInput(APP_CFG_CALIB_SW) != 0u) {
+		if (GPIO_DRV_ReadPinInput(APP_CFG_CALIB_SW) != 0u)
+			released = 1u;
+		OSTimeDlyHMSM(0u, 0u, 0u, 20u, OS_OPT_TIME_HMSM_STRICT, &os_err);
+		while (spsc_pop(&adc_queue, adc_batch, APP_ADC_BLOCK_SIZE) > 0u) {}
+	}
 }
+#endif
 
-static uint8_t extend_range_rate(blink_mode required_rate){
-	if (led_rate == required_rate)
-		return ((uint8_t)(1));
-	return 0;
+#if (APP_CFG_FILTER_BENCH_EN == DEF_ENABLED) || (APP_CFG_PIPE_BENCH_EN == DEF_ENABLED)
+static uint32_t app_cycles(void){
+	return ((uint32_t)CPU_TS_TmrRd());
 }
+#endif
@@ -52,33 +52,54 @@
 */
 
 #define  APP_CFG_TASK_START_PRIO                      2u
-#define  APP_CFG_TASK_OBJ_PRIO                        3u
-#define  APP_CFG_TASK_EQ_PRIO                         4u
+#define  APP_CFG_TASK_APP_PRIO                        2u        /* the startup task deletes itself after creating it    */
+#define  APP_CFG_TASK_REPORT_PRIO                    10u
+#define  APP_CFG_TASK_CONSOLE_PRIO                   11u        /* below every other task, APP_CFG_CONSOLE_EN           */
 
 
 /*
 *********************************************************************************************************
 *                                            TASK STACK SIZES
+*
+* Peak use of each task in CPU_STK words, as OSTaskStkChk() reports it (SW2 prints the peaks and the
+* sizes they give), and the margin kept over it. The startup task only runs until the other tasks are
+* created; APP_CFG_FILTER_BENCH_EN and APP_CFG_PIPE_BENCH_EN add to its peak.
+* The peaks below are provisional: estimates from -fstack-usage of the host build plus room for printf,
+* CONSOLE a guess, none read on the board yet. Until the SW2 report of OS_CFG_TASK_STK_CHK_EN confirms
+* them and APP_CFG_TASK_STK_MEASURED_EN is enabled, every task keeps the former APP_CFG_TASK_STK_BASE.
 *********************************************************************************************************
 */
 
-#define  APP_CFG_TASK_START_STK_SIZE                512u
-#define  APP_CFG_TASK_EQ_STK_SIZE                   512u
-#define  APP_CFG_TASK_OBJ_STK_SIZE                  256u
+#define  APP_CFG_TASK_STK_MEASURED_EN             DEF_DISABLED
+#define  APP_CFG_TASK_STK_BASE                      512u
+#define  APP_CFG_TASK_STK_MARGIN_PCT                 50u
+
+#define  APP_CFG_TASK_START_STK_PEAK                256u        /* provisional, see above                               */
+#define  APP_CFG_TASK_APP_STK_PEAK                  256u        /* provisional                                          */
+#define  APP_CFG_TASK_REPORT_STK_PEAK               224u        /* provisional                                          */
+#define  APP_CFG_TASK_CONSOLE_STK_PEAK              256u        /* guess                                                */
+
+// peak and margin, rounded up to 8 words for the 8 byte stack alignment of the ABI
+#define  APP_CFG_TASK_STK_FIT(peak)              ((((peak) * (100u + APP_CFG_TASK_STK_MARGIN_PCT) / 100u) + 7u) & ~7u)
+#define  APP_CFG_TASK_STK_SIZE(peak)             ((APP_CFG_TASK_STK_MEASURED_EN == DEF_ENABLED) ? \
+                                                  APP_CFG_TASK_STK_FIT(peak) : APP_CFG_TASK_STK_BASE)
+
+#define  APP_CFG_TASK_START_STK_SIZE             APP_CFG_TASK_STK_SIZE(APP_CFG_TASK_START_STK_PEAK)
+#define  APP_CFG_TASK_APP_STK_SIZE               APP_CFG_TASK_STK_SIZE(APP_CFG_TASK_APP_STK_PEAK)
+#define  APP_CFG_TASK_REPORT_STK_SIZE            APP_CFG_TASK_STK_SIZE(APP_CFG_TASK_REPORT_STK_PEAK)
+#define  APP_CFG_TASK_CONSOLE_STK_SIZE           APP_CFG_TASK_STK_SIZE(APP_CFG_TASK_CONSOLE_STK_PEAK)
 
 /*
 *********************************************************************************************************
 *                                          TASK STACK SIZES LIMIT
+*
+* Words left free when OSTaskCreate() flags a task as close to overflow: 10% of the stack.
 *********************************************************************************************************
 */
 
-#define  APP_CFG_TASK_START_STK_SIZE_PCT_FULL             90u
-#define  APP_CFG_TASK_EQ_STK_SIZE_PCT_FULL                90u
+#define  APP_CFG_TASK_STK_SIZE_PCT_FULL                   90u
 
-
-#define  APP_CFG_TASK_START_STK_SIZE_LIMIT       (APP_CFG_TASK_START_STK_SIZE * (100u - APP_CFG_TASK_START_STK_SIZE_PCT_FULL)) / 100u
-#define  APP_CFG_TASK_EQ_STK_SIZE_LIMIT          (APP_CFG_TASK_EQ_STK_SIZE    * (100u - APP_CFG_TASK_EQ_STK_SIZE_PCT_FULL   )) / 100u
-#define  APP_CFG_TASK_OBJ_STK_SIZE_LIMIT         (APP_CFG_TASK_OBJ_STK_SIZE   * (100u - APP_CFG_TASK_EQ_STK_SIZE_PCT_FULL   )) / 100u
+#define  APP_CFG_TASK_STK_LIMIT(size)            (((size) * (100u - APP_CFG_TASK_STK_SIZE_PCT_FULL)) / 100u)
 
 
 /*
@@ -109,10 +130,18 @@
 #endif
 
 #include  <stdio.h>
+#ifdef   APP_HOST_BUILD
+#define  DEF_DISABLED                               0u	// lib_def.h
+#define  DEF_ENABLED                                1u
+#define  APP_TRACE_LEVEL                            TRACE_LEVEL_DBG
+#define  APP_CFG_TRACE                              printf
+#else
+#include  <cpu.h>
 void  BSP_Ser_Printf (CPU_CHAR *p_fmt,
                       ...);
 #define  APP_TRACE_LEVEL                            TRACE_LEVEL_DBG
 #define  APP_CFG_TRACE                              BSP_Ser_Printf
+#endif
 
 #define  APP_TRACE_INFO(x)               ((APP_TRACE_LEVEL >= TRACE_LEVEL_INFO)  ? (void)(APP_CFG_TRACE x) : (void)0u)
 #define  APP_TRACE_DBG(x)                ((APP_TRACE_LEVEL >= TRACE_LEVEL_DBG)   ? (void)(APP_CFG_TRACE x) : (void)0u)
@@ -124,12 +153,158 @@ typedef enum blink_rate {
 	BLINK_NONE
 } blink_mode;
 
+/*
+*********************************************************************************************************
+*                                          SAMPLING CONFIGURATION
+*********************************************************************************************************
+*/
+
+// FTM0 triggers ADC0 every (APP_CFG_ADC_TRIG_MOD + 1) * 2^APP_CFG_ADC_TRIG_PS bus cycles: 114Hz at 60MHz
+#define  APP_CFG_ADC_TRIG_PS                        7u
+#define  APP_CFG_ADC_TRIG_MOD                  0x0FFFu
+
+// samples in each half of the DMA ring, AppTask wakes once per half (7Hz with the values above)
+#define  APP_CFG_ADC_BLOCK_SIZE                    16u
+
+// each reading the mean of 2^APP_CFG_ADC_AVG_LOG2 conversions by the ADC (0, or 2 to 5 for 4 to 32):
+// lower noise for no CPU time, the conversions must fit in a trigger period. HAL_ADC_xx of hal.h: high
+// speed sequence, low power, long sample time, ADCK divider
+#define  APP_CFG_ADC_AVG_LOG2                       0u
+#define  APP_CFG_ADC_OPTS                           0u
+
+// readings of channel 0 decimated by 2^APP_CFG_DECIM_LOG2 (0 for none, up to DECIM_LOG2_MAX) with a CIC
+// of order APP_CFG_DECIM_ORDER (1 boxcar, 2), before the capture, filter and range_check(), which see
+// the outputs: raise the trigger rate by as much to keep the output rate. Single channel, without
+// compare function
+#define  APP_CFG_DECIM_LOG2                         0u
+#define  APP_CFG_DECIM_ORDER                        1u
+
+// FTM0 rate adapted to the signal (rate.h), single channel without compare function: the prescaler of
+// APP_CFG_ADC_TRIG_MOD goes from 2^APP_CFG_RATE_PS_FAST near a band edge or on a steep slope to
+// 2^APP_CFG_RATE_PS_SLOW on a steady signal (beyond 2^7 the modulo is doubled instead), 458Hz to 14Hz.
+// One half of the ring at the slowest rate must fit in APP_CFG_RATE_LATENCY_MS, the longest delay of
+// a change the slope did not announce
+#define  APP_CFG_RATE_EN                  DEF_DISABLED
+#define  APP_CFG_RATE_PS_FAST                       5u
+#define  APP_CFG_RATE_PS_SLOW                      10u
+#define  APP_CFG_RATE_NEAR                       1000u	// codes from a band edge
+#define  APP_CFG_RATE_LATENCY_MS                 1200u
+
+// inputs scanned by FTM0: 1 (ADC0 only, PTB2) or an even number up to 16, one on ADC0 and one on ADC1
+// at every trigger. Channel 0 drives the LEDs, the others the alarm outputs of monitor.h; each channel
+// is read every APP_CFG_MON_CH_NBR / 2 triggers and APP_CFG_ADC_BLOCK_SIZE counts the readings of all
+#define  APP_CFG_MON_CH_NBR                         1u
+
+// ADCH of the inputs, channel 2k is entry k of ADC0 and channel 2k+1 entry k of ADC1; A0-A5 of the
+// Arduino header are the first two of ADC0 (PTB2, PTB3) and the first four of ADC1 (PTB10, PTB11, and
+// PTC11, PTC10 on the "b" side of the mux)
+#define  APP_CFG_MON_ADC0_CH        { 12u, 13u,  1u,  0u, 14u, 15u,  8u,  9u }
+#define  APP_CFG_MON_ADC1_CH        { 14u, 15u,  7u,  6u,  4u,  5u,  1u,  0u }
+
+// alarm output of channels 1.., high while the channel is in one of these LED bands (below 1 V)
+#define  APP_CFG_MON_ALARM_LEDS       (1u << BAND_LED_GREEN)
+#define  APP_CFG_MON_ALARM_PINS     { kGpioAlarm1, kGpioAlarm2, kGpioAlarm3, kGpioAlarm4, \
+                                      kGpioAlarm5, kGpioAlarm6, kGpioAlarm7 }
+
+// early warning (trend.h): least squares line through the last APP_CFG_TREND_WIN readings of channel 0
+// after the filter, checked once per batch. The blink turns to BLINK_SHORTEST while the line leaves the
+// band of the current state within APP_CFG_TREND_HORIZON_MS, back beyond twice that or at the change of
+// state; a line moving by less than APP_CFG_TREND_MIN_CODES over the window is taken as noise
+#define  APP_CFG_TREND_EN                 DEF_DISABLED
+#define  APP_CFG_TREND_WIN                         64u	// power of 2, up to TREND_WIN_MAX
+#define  APP_CFG_TREND_HORIZON_MS                2000u
+#define  APP_CFG_TREND_MIN_CODES                  200u
+
+// running statistics of the readings of channel 0 after the filter (stats.h): minimum, maximum, mean,
+// variance, histogram and time in each VOLT_xx band, over windows of APP_CFG_STATS_WIN readings and since
+// reset, updated once per batch and printed on SW2
+#define  APP_CFG_STATS_EN                 DEF_DISABLED
+#define  APP_CFG_STATS_WIN                      1024u
+
+// ADC0 compare function armed with the band of the current state: AppTask wakes only when a reading
+// leaves it, one sample at a time, and the filter is bypassed
+#define  APP_CFG_ADC_COMPARE_EN           DEF_DISABLED
+
+// filter between the DMA ring and range_check(), FILTER_xx of filter.h
+#define  APP_CFG_FILTER                    FILTER_NONE
+#define  APP_CFG_FILTER_MAVG_LOG2                   3u	// moving average over 8 samples
+
+// cycles per sample of the filters, per output of the decimator and per batch of the history coder
+// printed at startup
+#define  APP_CFG_FILTER_BENCH_EN          DEF_DISABLED
+
+// cycles per sample and slowest path of range_check() over the workloads of bench.h printed at startup,
+// in the format of host/pipe_bench.c; the LEDs flicker meanwhile
+#define  APP_CFG_PIPE_BENCH_EN            DEF_DISABLED
+
+// ADC readings streamed in frames (frame.h) on UART0 by the TX DMA, at APP_CFG_STREAM_BAUD; the
+// APP_TRACE output shares the port, the host decoder skips it
+#define  APP_CFG_STREAM_EN                DEF_DISABLED
+#define  APP_CFG_STREAM_BAUD                  921600u
+
+// first APP_CFG_CAPTURE_LEN raw readings of channel 0 kept in app_capture (capture.h), 8 bytes each,
+// for host/replay.c; dumped from RAM by the debugger
+#define  APP_CFG_CAPTURE_EN               DEF_DISABLED
+#define  APP_CFG_CAPTURE_LEN                    4096u
+
+// compressed history of the readings of channel 0 (history.h): one value per 2^APP_CFG_HISTORY_AVG_LOG2
+// readings, Rice coded differences in a ring of APP_CFG_HISTORY_CHUNKS chunks of 256 bytes (about 20
+// hours of a quiet battery in 32 KB by 64, 4.5 hours by 16); SW2 prints its span and address for the dump.
+// history_add() must code a batch within APP_CFG_HISTORY_BUDGET cycles, the batches over it are counted
+#define  APP_CFG_HISTORY_EN               DEF_DISABLED
+#define  APP_CFG_HISTORY_CHUNKS                  128u
+#define  APP_CFG_HISTORY_AVG_LOG2                  6u
+#define  APP_CFG_HISTORY_BUDGET                 4000u
+
+// changes of blink state made by range_check() recorded in a journal (journal.h), 8 bytes each, and
+// emptied by the report task every 50 ms to APP_CFG_JOURNAL_OUT: JOURNAL_OUT_SERIAL prints one line per
+// change, JOURNAL_OUT_FLASH appends to the log of flog.h in APP_CFG_FLOG_SECTORS sectors of 4 KB from
+// APP_CFG_FLOG_BASE, which the linker file must leave out of m_text (the last 32 KB of the second
+// block here, the last 3577 to 4088 changes); SW2 prints the last APP_CFG_JOURNAL_DUMP records of the log
+#define  APP_CFG_JOURNAL_EN               DEF_DISABLED
+#define  APP_CFG_JOURNAL_OUT        JOURNAL_OUT_SERIAL
+#define  APP_CFG_FLOG_BASE                0x000F8000u
+#define  APP_CFG_FLOG_SECTORS                       8u
+#define  APP_CFG_JOURNAL_DUMP                      16u
+
+// commands on the serial port (console.h: bands, blink moduli, FTM0 period, probes): the eDMA moves the
+// bytes received by UART0 into a ring of APP_CFG_CONSOLE_RING bytes without interrupts, and a task below
+// all the others reads it every APP_CFG_CONSOLE_POLL_MS; the ring holds twice what arrives meanwhile at
+// the baud rate of the port (APP_CFG_STREAM_BAUD with APP_CFG_STREAM_EN)
+#define  APP_CFG_CONSOLE_EN               DEF_DISABLED
+#define  APP_CFG_CONSOLE_RING                    256u	// power of 2
+#define  APP_CFG_CONSOLE_POLL_MS                  10u
+
+// blink wave toggled by the eDMA at every FTM1 overflow (hal_ftm1_dma_setup()) instead of
+// ftm1_int_handler: no interrupt per edge
+#define  APP_CFG_BLINK_DMA_EN             DEF_DISABLED
+
+// cycle counts of ISRs, range_check() and trigger-to-LED latency (prof.h), printed when BOARD_SW_GPIO
+// is pressed
+#define  APP_CFG_PROF_EN                   DEF_ENABLED
+
+// calibration of the bands of channel 0 (calib.h) when APP_CFG_CALIB_SW is held at reset: for each of
+// 0.0, 0.5 ... 3.0 V the input is set to the level, the switch pressed, and APP_CFG_CALIB_SAMPLES are
+// read with FTM0 at 10kHz (0.4s per level); the VOLT_xx/THRE_xx found replace those below until reset
+#define  APP_CFG_CALIB_EN                  DEF_DISABLED
+#define  APP_CFG_CALIB_SW                     kGpioSW3
+#define  APP_CFG_CALIB_SAMPLES                  4096u
+#define  APP_CFG_CALIB_TRIG_PS                      0u
+#define  APP_CFG_CALIB_TRIG_MOD                 5999u
+
+/*
+*********************************************************************************************************
+*                                            ALARM CONFIGURATION
+*********************************************************************************************************
+*/
+
+// at reset, the console changes them (alarm_set_blink_mod())
 #define BLINK_LONG_MOD		0x5B8D	// 10Hz
 #define BLINK_SHORT_MOD 	0x2DC6	// 20Hz
 #define BLINK_SHORTEST_MOD	0x3210	// 36Hz
 
-#define THRE_FACT_LEFT		0		// threshold factor from left
-#define THRE_FACT_RIGHT		1.1		// threshold factor from right
+#define THRE_FACT_LEFT_PCT	0		// threshold factor from left, in percent
+#define THRE_FACT_RIGHT_PCT	110		// threshold factor from right, in percent (1.1)
 
 // proportionally computed (65535 = 3.3V)
 //#define VOLT_00				     0	// 0.0 V
@@ -0,0 +1,160 @@
+/*
+*********************************************************************************************************
+* Construction of the voltage band table (see band.h).
+* Every threshold of the range checking is a segment boundary, so the action taken inside a segment is
+* found by evaluating the checks once at its first code; adjacent segments with the same action are merged.
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <band.h>
+
+/*
+*********************************************************************************************************
+*                                            LOCAL DEFINES
+*********************************************************************************************************
+*/
+
+#define BAND_CODE_MAX			0xFFFFu
+#define BAND_BREAK_MAX			(1u + 3u * BAND_VOLT_NBR)
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+const band_cfg_t band_cfg_default = {
+	{ VOLT_00, VOLT_05, VOLT_10, VOLT_15, VOLT_20, VOLT_25, VOLT_30 },
+	{       0, THRE_05, THRE_10, THRE_15, THRE_20, THRE_25, THRE_30 },
+};
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static int32_t band_left(const band_cfg_t *cfg, uint32_t i, uint32_t ext);
+static int32_t band_right(const band_cfg_t *cfg, uint32_t i, uint32_t ext);
+static uint8_t band_eval(const band_cfg_t *cfg, uint32_t rate, uint32_t led, int32_t x);
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+int band_build(band_table_t *tbl, const band_cfg_t *cfg){
+	int32_t  brk[BAND_BREAK_MAX];
+	uint32_t brk_nbr = 0u;
+	uint32_t i, j, s;
+
+	// every bound a sample is compared with, extended or not by the hysteresis
+	brk[brk_nbr++] = 0;
+	for (i = 0u; i < BAND_VOLT_NBR; i++){
+		brk[brk_nbr++] = cfg->volt[i];
+		brk[brk_nbr++] = band_left(cfg, i, 1u);
+		brk[brk_nbr++] = band_right(cfg, i, 1u);
+	}
+	// insertion sort, a few tens of values
+	for (i = 1u; i < brk_nbr; i++){
+		int32_t v = brk[i];
+
+		for (j = i; j > 0u && brk[j - 1u] > v; j--)
+			brk[j] = brk[j - 1u];
+		brk[j] = v;
+	}
+
+	for (s = 0u; s < BAND_STATE_NBR; s++){
+		uint32_t rate = s / BAND_LED_NBR;
+		uint32_t led = s % BAND_LED_NBR;
+		uint32_t n = 0u;
+
+		for (i = 0u; i < brk_nbr; i++){
+			uint8_t act;
+
+			if (brk[i] < 0 || brk[i] > (int32_t)BAND_CODE_MAX || (i > 0u && brk[i] == brk[i - 1u]))
+				continue;
+			act = band_eval(cfg, rate, led, brk[i]);
+			if (n > 0u && tbl->act[s][n - 1u] == act)
+				continue;
+			if (n == BAND_SEG_MAX)
+				return -1;
+			tbl->lo[s][n] = (uint16_t)brk[i];
+			tbl->act[s][n] = act;
+			n++;
+		}
+		tbl->nbr[s] = (uint8_t)n;
+		// unused entries never match a sample below the last code
+		for (i = n; i < BAND_SEG_MAX; i++){
+			tbl->lo[s][i] = BAND_CODE_MAX;
+			tbl->act[s][i] = tbl->act[s][n - 1u];
+		}
+	}
+	return 0;
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+// VOLT_xx + THRE_FACT_LEFT * THRE_xx rounded up, the first code satisfying ">="
+static int32_t band_left(const band_cfg_t *cfg, uint32_t i, uint32_t ext){
+	return (int32_t)cfg->volt[i] + (int32_t)(ext * ((THRE_FACT_LEFT_PCT * cfg->thre[i] + 99u) / 100u));
+}
+
+// VOLT_xx - THRE_FACT_RIGHT * THRE_xx rounded up, the first code failing "<"
+static int32_t band_right(const band_cfg_t *cfg, uint32_t i, uint32_t ext){
+	return (int32_t)cfg->volt[i] - (int32_t)(ext * ((THRE_FACT_RIGHT_PCT * cfg->thre[i]) / 100u));
+}
+
+// range checking of a sample in a state, the hysteresis extends the band of the current rate and LED
+static uint8_t band_eval(const band_cfg_t *cfg, uint32_t rate, uint32_t led, int32_t x){
+	uint32_t s_g = (rate == BLINK_SHORT) && (led == BAND_LED_GREEN);
+	uint32_t s_b = (rate == BLINK_SHORT) && (led == BAND_LED_BLUE);
+	uint32_t s_r = (rate == BLINK_SHORT) && (led == BAND_LED_RED);
+	uint32_t l_g = (rate == BLINK_LONG) && (led == BAND_LED_GREEN);
+	uint32_t l_b = (rate == BLINK_LONG) && (led == BAND_LED_BLUE);
+	uint32_t l_r = (rate == BLINK_LONG) && (led == BAND_LED_RED);
+	uint32_t new_rate = BAND_KEEP;
+	uint32_t new_led = BAND_KEEP;
+
+	/* Rate of blink check */
+	// 0.0 <= V < 0.5 | 1.0 <= V < 1.5 | 2.0 <= V < 2.5
+	if (rate != BLINK_LONG && (
+			(x >= cfg->volt[0] && x < band_right(cfg, 1u, s_g)) ||
+			(x >= band_left(cfg, 2u, s_g) && x < band_right(cfg, 3u, s_b)) ||
+			(x >= band_left(cfg, 4u, s_b) && x < band_right(cfg, 5u, s_r))))
+		new_rate = BLINK_LONG;
+	// 0.5 <= V < 1.0 | 1.5 <= V < 2.0 | 2.5 <= V < 3.0
+	else if (rate != BLINK_SHORT && (
+			(x >= band_left(cfg, 1u, l_g) && x < band_right(cfg, 2u, l_b)) ||
+			(x >= band_left(cfg, 3u, l_b) && x < band_right(cfg, 4u, l_r)) ||
+			(x >= band_left(cfg, 5u, l_r) && x < band_right(cfg, 6u, l_r))))
+		new_rate = BLINK_SHORT;
+	// 3.0 <= V
+	else if (rate != BLINK_NONE && x >= band_left(cfg, 6u, s_r))
+		new_rate = BLINK_NONE;
+
+	/* LED color check */
+	// 0.0 <= V < 1.0 ---> GREEN
+	if (led != BAND_LED_GREEN && x >= cfg->volt[0] && x < band_right(cfg, 2u, led == BAND_LED_BLUE))
+		new_led = BAND_LED_GREEN;
+	// 1.0 <= V < 2.0 ---> BLUE
+	else if (led != BAND_LED_BLUE && x >= band_left(cfg, 2u, led == BAND_LED_GREEN) &&
+			x < band_right(cfg, 4u, led == BAND_LED_RED))
+		new_led = BAND_LED_BLUE;
+	// 2.0 <= V 	  ---> RED
+	else if (led != BAND_LED_RED && x >= band_left(cfg, 4u, led == BAND_LED_BLUE))
+		new_led = BAND_LED_RED;
+
+	return BAND_ACT(new_rate, new_led);
+}
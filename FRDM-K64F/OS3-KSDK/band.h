@@ -0,0 +1,109 @@
+/*
+*********************************************************************************************************
+*                                        VOLTAGE BAND TABLE
+*
+* Integer form of the range checking of alarm.c. For every state of the alarm (led_rate, current_led) the
+* 16 bit ADC range is split in segments, each one with the action taken when a sample falls in it (new
+* blink rate and/or new LED, or nothing). The segments are found from the VOLT_xx/THRE_xx values once, at
+* init, so classifying a sample is a fixed 5 step search with no floating point.
+*********************************************************************************************************
+*/
+
+#ifndef  BAND_MODULE_PRESENT
+#define  BAND_MODULE_PRESENT
+
+#include  <stdint.h>
+#include  <app_cfg.h>
+
+/*
+*********************************************************************************************************
+*                                               DEFINES
+*********************************************************************************************************
+*/
+
+#define BAND_VOLT_NBR			7u						// VOLT_00 ... VOLT_30
+#define BAND_RATE_NBR			4u						// blink_mode values
+#define BAND_LED_NBR			3u
+#define BAND_STATE_NBR			(BAND_RATE_NBR * BAND_LED_NBR)
+#define BAND_SEG_MAX			32u						// power of 2, segments of one state
+
+// LED indexes, in order of voltage
+#define BAND_LED_GREEN			0u
+#define BAND_LED_BLUE			1u
+#define BAND_LED_RED			2u
+
+// action of a segment: new rate in the low nibble, new LED in the high one
+#define BAND_KEEP				0xFu
+#define BAND_ACT(rate, led)		((uint8_t)(((led) << 4) | (rate)))
+#define BAND_ACT_RATE(act)		((act) & 0xFu)
+#define BAND_ACT_LED(act)		((act) >> 4)
+#define BAND_NOP				BAND_ACT(BAND_KEEP, BAND_KEEP)
+
+#define BAND_STATE(rate, led)	((uint32_t)(rate) * BAND_LED_NBR + (led))
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+// band boundaries and hysteresis widths, index i is VOLT_(i*05) and THRE_(i*05), thre[0] unused
+typedef struct band_cfg {
+	uint16_t	volt[BAND_VOLT_NBR];
+	uint16_t	thre[BAND_VOLT_NBR];
+} band_cfg_t;
+
+typedef struct band_table {
+	uint16_t	lo[BAND_STATE_NBR][BAND_SEG_MAX];		// first ADC code of the segment, lo[s][0] = 0
+	uint8_t		act[BAND_STATE_NBR][BAND_SEG_MAX];
+	uint8_t		nbr[BAND_STATE_NBR];					// segments actually used, the rest repeat the last
+} band_table_t;
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+// VOLT_xx/THRE_xx of app_cfg.h
+extern const band_cfg_t band_cfg_default;
+
+/*
+*********************************************************************************************************
+*                                         FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+// returns 0 on success, -1 if a state needs more than BAND_SEG_MAX segments
+int band_build(band_table_t *tbl, const band_cfg_t *cfg);
+
+// index of the segment of the state containing the sample
+static inline uint32_t band_segment(const band_table_t *tbl, uint32_t state, uint32_t sample){
+	const uint16_t *lo = tbl->lo[state];
+	uint32_t k = 0u;
+
+	k += (lo[k + 16u] <= sample) ? 16u : 0u;
+	k += (lo[k +  8u] <= sample) ?  8u : 0u;
+	k += (lo[k +  4u] <= sample) ?  4u : 0u;
+	k += (lo[k +  2u] <= sample) ?  2u : 0u;
+	k += (lo[k +  1u] <= sample) ?  1u : 0u;
+	return k;
+}
+
+static inline uint8_t band_classify(const band_table_t *tbl, uint32_t state, uint32_t sample){
+	return tbl->act[state][band_segment(tbl, state, sample)];
+}
+
+// codes [*lo, *hi] around the sample where the state does not change; returns 0 if the sample itself
+// changes the state
+static inline int band_window(const band_table_t *tbl, uint32_t state, uint32_t sample, uint16_t *lo, uint16_t *hi){
+	uint32_t k = band_segment(tbl, state, sample);
+
+	if (tbl->act[state][k] != BAND_NOP)
+		return 0;
+	*lo = tbl->lo[state][k];
+	*hi = (k + 1u < tbl->nbr[state]) ? (uint16_t)(tbl->lo[state][k + 1u] - 1u) : 0xFFFFu;
+	return 1;
+}
+
+#endif
@@ -0,0 +1,146 @@
+/*
+*********************************************************************************************************
+* Alarm pipeline benchmark (see bench.h).
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <app_cfg.h>
+#include  <band.h>
+#include  <alarm.h>
+#include  <bench.h>
+
+/*
+*********************************************************************************************************
+*                                       LOCAL GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+static uint16_t		bench_codes[BENCH_LEN];
+static uint32_t		bench_min[BENCH_LEN];				// least cycles of each sample over the rounds
+
+static const char * const bench_names[BENCH_WORKLOAD_NBR] = { "ramp", "dither", "step", "random" };
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static void bench_fill(uint32_t workload, const band_cfg_t *cfg);
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+void bench_run(bench_t *res, uint32_t (*clk)(void), uint32_t clk_hz, uint32_t (*events)(void),
+			   uint32_t rounds){
+	uint32_t w, r, i, t, overhead = UINT32_MAX;
+
+	alarm_init();
+	if (rounds == 0u)
+		rounds = 1u;
+
+	// cost of reading the clock, taken off every sample of the path
+	for (i = 0u; i < 64u; i++){
+		t = clk();
+		t = clk() - t;
+		if (t < overhead)
+			overhead = t;
+	}
+
+	for (w = 0u; w < BENCH_WORKLOAD_NBR; w++){
+		bench_result_t *b = &res->w[w];
+		uint32_t best = UINT32_MAX, e = 0u;
+		uint64_t ev = 0u;
+
+		bench_fill(w, alarm_cfg());
+
+		// whole workload between two reads of the counters, the fastest round
+		b->transitions = 0u;
+		for (r = 0u; r < rounds; r++){
+			alarm_set_state(BLINK_NONE, BAND_LED_RED);
+			if (events)
+				e = events();
+			t = clk();
+			for (i = 0u; i < BENCH_LEN; i++)
+				if (range_check(bench_codes[i]) && r == 0u)
+					b->transitions++;
+			t = clk() - t;
+			if (t < best)
+				best = t;
+			if (events)
+				ev += events() - e;
+		}
+		b->cycles_x100 = (uint32_t)(((uint64_t)best * 100u) / BENCH_LEN);
+		b->ns_x100 = (uint32_t)(((uint64_t)b->cycles_x100 * 1000000000u) / clk_hz);
+		b->events_x100 = events ? (uint32_t)((ev * 100u) / ((uint64_t)rounds * BENCH_LEN)) : BENCH_NA;
+
+		// path: every sample timed on its own, the same sequence of states at every round
+		for (i = 0u; i < BENCH_LEN; i++)
+			bench_min[i] = UINT32_MAX;
+		for (r = 0u; r < BENCH_PATH_ROUNDS; r++){
+			alarm_set_state(BLINK_NONE, BAND_LED_RED);
+			for (i = 0u; i < BENCH_LEN; i++){
+				t = clk();
+				range_check(bench_codes[i]);
+				t = clk() - t;
+				if (t < bench_min[i])
+					bench_min[i] = t;
+			}
+		}
+		b->path = 0u;
+		for (i = 0u; i < BENCH_LEN; i++){
+			t = bench_min[i] > overhead ? bench_min[i] - overhead : 0u;
+			if (t > b->path)
+				b->path = t;
+		}
+	}
+	alarm_init();
+}
+
+const char *bench_name(uint32_t workload){
+	return workload < BENCH_WORKLOAD_NBR ? bench_names[workload] : "?";
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+static void bench_fill(uint32_t workload, const band_cfg_t *cfg){
+	uint32_t seed = 1u;
+	uint32_t i, level, code;
+
+	for (i = 0u; i < BENCH_LEN; i++){
+		seed = seed * 1664525u + 1013904223u;
+		switch (workload){
+			case BENCH_RAMP:
+				code = (i < BENCH_LEN / 2u ? i : BENCH_LEN - 1u - i) * 65535u / (BENCH_LEN / 2u - 1u);
+				break;
+			case BENCH_DITHER:
+				code = cfg->volt[2] - 2u * cfg->thre[2] + (seed >> 16) % (4u * cfg->thre[2] + 1u);
+				break;
+			case BENCH_STEP:
+				// up then down through the bands
+				level = (i / BENCH_STEP_LEN) % (2u * BAND_VOLT_NBR - 2u);
+				level = level < BAND_VOLT_NBR ? level : 2u * BAND_VOLT_NBR - 2u - level;
+				code = level < BAND_VOLT_NBR - 1u ? (cfg->volt[level] + cfg->volt[level + 1u]) / 2u :
+					   cfg->volt[level] + (cfg->volt[level] - cfg->volt[level - 1u]) / 2u;
+				break;
+			case BENCH_RANDOM:
+			default:
+				code = seed >> 16;
+				break;
+		}
+		bench_codes[i] = (uint16_t)(code > 65535u ? 65535u : code);
+	}
+}
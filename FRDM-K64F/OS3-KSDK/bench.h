@@ -0,0 +1,72 @@
+/*
+*********************************************************************************************************
+*                                        ALARM PIPELINE BENCHMARK
+*
+* range_check() (band classification and blink state update) run over synthetic workloads of
+* BENCH_LEN codes, from the initial blink state at every round:
+*  - ramp   : triangle over the full ADC range, one transition per band edge
+*  - dither : noise of twice the hysteresis around the 1.0 V boundary, transitions at a high rate
+*  - step   : middle of every band in turn, BENCH_STEP_LEN samples each
+*  - random : uniform codes
+* For each one: cycles and nanoseconds per sample of the fastest round, to leave interrupts and cache
+* misses of the first round out, the mean events of an optional second counter per sample (branches on
+* the host, none on the board), and the path of the slowest sample: for every position of the workload
+* the least cycles over BENCH_PATH_ROUNDS rounds and the largest of those.
+* The same code runs on the board (APP_CFG_PIPE_BENCH_EN) and in host/pipe_bench.c.
+*********************************************************************************************************
+*/
+
+#ifndef  BENCH_MODULE_PRESENT
+#define  BENCH_MODULE_PRESENT
+
+#include  <stdint.h>
+
+/*
+*********************************************************************************************************
+*                                               DEFINES
+*********************************************************************************************************
+*/
+
+#define BENCH_RAMP				0u
+#define BENCH_DITHER			1u
+#define BENCH_STEP				2u
+#define BENCH_RANDOM			3u
+#define BENCH_WORKLOAD_NBR		4u
+
+#define BENCH_LEN				512u					// samples of a workload
+#define BENCH_STEP_LEN			32u
+#define BENCH_PATH_ROUNDS		64u						// rounds timing every sample for the path
+#define BENCH_NA				0xFFFFFFFFu				// no second counter
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+typedef struct bench_result {
+	uint32_t	cycles_x100;							// per sample in the fastest round, 1/100 of cycle
+	uint32_t	ns_x100;
+	uint32_t	events_x100;							// of the second counter, BENCH_NA without one
+	uint32_t	path;									// cycles of the slowest sample
+	uint32_t	transitions;							// per round
+} bench_result_t;
+
+typedef struct bench {
+	bench_result_t	w[BENCH_WORKLOAD_NBR];
+} bench_t;
+
+/*
+*********************************************************************************************************
+*                                         FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+// clk is a free running counter of clk_hz, events a second counter or NULL; leaves the alarm logic
+// as alarm_init() does
+void        bench_run(bench_t *res, uint32_t (*clk)(void), uint32_t clk_hz, uint32_t (*events)(void),
+					  uint32_t rounds);
+
+const char *bench_name(uint32_t workload);
+
+#endif
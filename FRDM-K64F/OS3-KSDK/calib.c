@@ -0,0 +1,125 @@
+/*
+*********************************************************************************************************
+* Band calibration from measured readings (see calib.h).
+* The variance comes from the sums as (n * sumsq - sum^2) / (n * (n - 1)): with at most 2^15 readings of
+* 16 bits every product fits in 64 bits, and the square root is an integer one.
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <string.h>
+
+#include  <calib.h>
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static uint32_t isqrt64(uint64_t x);
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+void calib_init(calib_t *c){
+	uint32_t i;
+
+	memset(c, 0, sizeof(*c));
+	for (i = 0u; i < BAND_VOLT_NBR; i++)
+		c->level[i].min = 0xFFFFu;
+}
+
+uint32_t calib_add(calib_t *c, uint32_t level, const uint16_t *codes, uint32_t n){
+	calib_level_t *l = &c->level[level];
+	uint32_t i;
+
+	if (n > CALIB_SAMPLES_MAX - l->n)
+		n = CALIB_SAMPLES_MAX - l->n;
+	for (i = 0u; i < n; i++){
+		uint32_t x = codes[i];
+
+		l->sum += x;
+		l->sumsq += (uint64_t)(x * x);
+		if (x < l->min)
+			l->min = (uint16_t)x;
+		if (x > l->max)
+			l->max = (uint16_t)x;
+	}
+	l->n += n;
+	return l->n;
+}
+
+uint32_t calib_mean(const calib_t *c, uint32_t level){
+	const calib_level_t *l = &c->level[level];
+
+	return l->n ? (l->sum + l->n / 2u) / l->n : 0u;
+}
+
+uint32_t calib_sigma_x100(const calib_t *c, uint32_t level){
+	const calib_level_t *l = &c->level[level];
+	uint64_t num;
+
+	if (l->n < 2u)
+		return 0u;
+	num = (uint64_t)l->n * l->sumsq - (uint64_t)l->sum * l->sum;
+	// 100^2 * num / (n * (n - 1)), the division first keeps it within 64 bits
+	return isqrt64(num / ((uint64_t)l->n * (l->n - 1u)) * 10000u +
+				   num % ((uint64_t)l->n * (l->n - 1u)) * 10000u / ((uint64_t)l->n * (l->n - 1u)));
+}
+
+int calib_build(const calib_t *c, band_cfg_t *cfg){
+	static band_table_t tbl;							// off the stack of AppTask
+	uint32_t i;
+
+	for (i = 0u; i < BAND_VOLT_NBR; i++){
+		uint32_t thre = (CALIB_THRE_SIGMA * calib_sigma_x100(c, i) + 99u) / 100u;
+
+		if (c->level[i].n < CALIB_SAMPLES_MIN)
+			return CALIB_ERR_SAMPLES;
+		cfg->volt[i] = (uint16_t)calib_mean(c, i);
+		cfg->thre[i] = (uint16_t)(thre > CALIB_THRE_MIN ? thre : CALIB_THRE_MIN);
+	}
+	// the lowest band starts at code 0 whatever the offset of the ADC
+	cfg->volt[0] = 0u;
+	cfg->thre[0] = 0u;
+	for (i = 1u; i < BAND_VOLT_NBR; i++)
+		if (cfg->volt[i] <= cfg->volt[i - 1u] + cfg->thre[i - 1u] + cfg->thre[i])
+			return CALIB_ERR_ORDER;
+	if (band_build(&tbl, cfg) != 0)
+		return CALIB_ERR_TABLE;
+	return CALIB_OK;
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+// floor of the square root, bit by bit
+static uint32_t isqrt64(uint64_t x){
+	uint64_t r = 0u;
+	uint64_t bit = (uint64_t)1u << 62;
+
+	while (bit > x)
+		bit >>= 2;
+	while (bit){
+		if (x >= r + bit){
+			x -= r + bit;
+			r = (r >> 1) + bit;
+		} else {
+			r >>= 1;
+		}
+		bit >>= 2;
+	}
+	return (uint32_t)r;
+}
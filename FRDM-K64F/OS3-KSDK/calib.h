@@ -0,0 +1,72 @@
+/*
+*********************************************************************************************************
+*                                         BAND CALIBRATION
+*
+* Derives the VOLT_xx/THRE_xx of the band table from readings of the board itself. A burst of readings
+* is taken at each reference level (0.0, 0.5, ... 3.0 V applied to the input): their mean becomes the
+* boundary VOLT_xx and their spread the hysteresis width THRE_xx, CALIB_THRE_SIGMA standard deviations
+* and never less than CALIB_THRE_MIN. Only integer sums are kept while the readings arrive, the
+* statistics are computed once per level.
+*********************************************************************************************************
+*/
+
+#ifndef  CALIB_MODULE_PRESENT
+#define  CALIB_MODULE_PRESENT
+
+#include  <stdint.h>
+#include  <band.h>
+
+/*
+*********************************************************************************************************
+*                                               DEFINES
+*********************************************************************************************************
+*/
+
+#define CALIB_SAMPLES_MAX		32768u					// per level, keeps sum * sum within 64 bits
+#define CALIB_SAMPLES_MIN		256u
+#define CALIB_THRE_SIGMA		5u						// hysteresis width in standard deviations
+#define CALIB_THRE_MIN			8u						// LSB
+
+// errors of calib_build()
+#define CALIB_OK				0
+#define CALIB_ERR_SAMPLES		-1						// a level has less than CALIB_SAMPLES_MIN readings
+#define CALIB_ERR_ORDER			-2						// levels not increasing by more than their hysteresis
+#define CALIB_ERR_TABLE			-3						// band_build() failed with the result
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+typedef struct calib_level {
+	uint32_t	n;
+	uint32_t	sum;
+	uint64_t	sumsq;
+	uint16_t	min;
+	uint16_t	max;
+} calib_level_t;
+
+typedef struct calib {
+	calib_level_t	level[BAND_VOLT_NBR];				// level i: i * 0.5 V
+} calib_t;
+
+/*
+*********************************************************************************************************
+*                                         FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+void     calib_init(calib_t *c);
+
+// readings of a level, beyond CALIB_SAMPLES_MAX they are ignored; returns the readings of the level
+uint32_t calib_add(calib_t *c, uint32_t level, const uint16_t *codes, uint32_t n);
+
+// mean (rounded) and standard deviation in hundredths of LSB of a level
+uint32_t calib_mean(const calib_t *c, uint32_t level);
+uint32_t calib_sigma_x100(const calib_t *c, uint32_t level);
+
+// VOLT_xx/THRE_xx of all the levels, VOLT_00 stays 0; returns CALIB_OK or a CALIB_ERR_xx
+int      calib_build(const calib_t *c, band_cfg_t *cfg);
+
+#endif
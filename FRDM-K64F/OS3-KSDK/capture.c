@@ -0,0 +1,65 @@
+/*
+*********************************************************************************************************
+* Capture of ADC readings (see capture.h).
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <string.h>
+
+#include  <capture.h>
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+void capture_init(capture_hdr_t *h, uint32_t ts_hz, uint32_t period, const band_cfg_t *cfg,
+				  uint32_t filter, uint32_t mavg_log2, uint32_t rate, uint32_t led){
+	memset(h, 0, sizeof(*h));
+	h->magic = CAPTURE_MAGIC;
+	h->version = CAPTURE_VERSION;
+	h->hdr_size = sizeof(*h);
+	h->ts_hz = ts_hz;
+	h->period = period;
+	h->filter = (uint8_t)filter;
+	h->mavg_log2 = (uint8_t)mavg_log2;
+	h->rate = (uint8_t)rate;
+	h->led = (uint8_t)led;
+	h->cfg = *cfg;
+}
+
+uint32_t capture_add(capture_hdr_t *h, capture_rec_t *rec, uint32_t cap, const spsc_sample_t *s, uint32_t n){
+	uint32_t i;
+
+	if (n > cap - h->nbr)
+		n = cap - h->nbr;
+	for (i = 0u; i < n; i++){
+		rec[h->nbr + i].ts = s[i].ts;
+		rec[h->nbr + i].code = s[i].code;
+		rec[h->nbr + i].ch = s[i].ch;
+	}
+	h->nbr += n;
+	return n;
+}
+
+int capture_check(const capture_hdr_t *h, size_t len){
+	static band_table_t tbl;							// off the stack of the caller
+
+	if (h->magic != CAPTURE_MAGIC)
+		return CAPTURE_ERR_MAGIC;
+	if (h->version != CAPTURE_VERSION || h->hdr_size < sizeof(*h))
+		return CAPTURE_ERR_VERSION;
+	if (len != 0u && (len < h->hdr_size ||
+		(h->nbr != CAPTURE_NBR_STREAM && (len - h->hdr_size) / sizeof(capture_rec_t) < h->nbr)))
+		return CAPTURE_ERR_SIZE;
+	if (band_build(&tbl, &h->cfg) != 0)
+		return CAPTURE_ERR_CFG;
+	return CAPTURE_OK;
+}
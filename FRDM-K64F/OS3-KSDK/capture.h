@@ -0,0 +1,81 @@
+/*
+*********************************************************************************************************
+*                                          ADC READING CAPTURE
+*
+* Timestamped readings of channel 0 kept in RAM for an offline replay of the range checking. The layout in
+* memory is the file format, all fields little endian: a capture_hdr_t then hdr.nbr capture_rec_t. A
+* capture taken on the board is dumped from RAM with the debugger; the simulator and stream_decode write
+* the same files. Readings are raw, before the filter named in the header.
+*
+* A writer that cannot come back to the header (a pipe) leaves nbr at CAPTURE_NBR_STREAM: the records
+* then go on until the end of the file.
+*********************************************************************************************************
+*/
+
+#ifndef  CAPTURE_MODULE_PRESENT
+#define  CAPTURE_MODULE_PRESENT
+
+#include  <stddef.h>
+#include  <stdint.h>
+#include  <band.h>
+#include  <spsc.h>
+
+/*
+*********************************************************************************************************
+*                                               DEFINES
+*********************************************************************************************************
+*/
+
+#define CAPTURE_MAGIC			0x43524241u				// "ABRC"
+#define CAPTURE_VERSION			1u
+#define CAPTURE_NBR_STREAM		0xFFFFFFFFu
+
+#define CAPTURE_OK				0
+#define CAPTURE_ERR_MAGIC		-1
+#define CAPTURE_ERR_VERSION		-2
+#define CAPTURE_ERR_SIZE		-3						// fewer bytes than the header announces
+#define CAPTURE_ERR_CFG			-4						// bands that band_build() refuses
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+typedef struct capture_hdr {
+	uint32_t	magic;
+	uint16_t	version;
+	uint16_t	hdr_size;								// bytes, the records start there
+	uint32_t	ts_hz;									// clock of the timestamps
+	uint32_t	period;									// cycles between two FTM0 triggers at the start
+	uint32_t	nbr;									// records
+	uint8_t		filter;									// FILTER_xx applied before range_check()
+	uint8_t		mavg_log2;
+	uint8_t		rate;									// blink state at the first record
+	uint8_t		led;									// BAND_LED_xx
+	band_cfg_t	cfg;									// bands of range_check()
+} capture_hdr_t;
+
+// as spsc_sample_t
+typedef struct capture_rec {
+	uint32_t	ts;
+	uint16_t	code;
+	uint16_t	ch;
+} capture_rec_t;
+
+/*
+*********************************************************************************************************
+*                                         FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+void     capture_init(capture_hdr_t *h, uint32_t ts_hz, uint32_t period, const band_cfg_t *cfg,
+					  uint32_t filter, uint32_t mavg_log2, uint32_t rate, uint32_t led);
+
+// appends up to n samples while there is room for them among the cap records; returns the number added
+uint32_t capture_add(capture_hdr_t *h, capture_rec_t *rec, uint32_t cap, const spsc_sample_t *s, uint32_t n);
+
+// checks a header, len is the size of the whole file or 0 when it is not known (streaming)
+int      capture_check(const capture_hdr_t *h, size_t len);
+
+#endif
@@ -0,0 +1,329 @@
+/*
+*********************************************************************************************************
+* Command console (see console.h).
+* A line is kept in console_t as it arrives, so a poll may end in the middle of one. At its end the
+* words are cut in place by terminators and the command is found in a table: no copy, no allocation,
+* and the cost of a line is bounded by CONSOLE_LINE_MAX whatever comes in.
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <string.h>
+
+#include  <app_cfg.h>
+#include  <hal.h>
+#include  <band.h>
+#include  <alarm.h>
+#include  <prof.h>
+#include  <console.h>
+
+/*
+*********************************************************************************************************
+*                                          LOCAL DATA TYPES
+*********************************************************************************************************
+*/
+
+typedef int (*console_fn_t)(uint32_t argc, char **argv);
+
+typedef struct console_cmd {
+	const char	   *name;
+	uint8_t			args_min;							// words after the command
+	uint8_t			args_max;
+	console_fn_t	fn;
+	const char	   *usage;
+} console_cmd_t;
+
+typedef struct console_blink {
+	const char	   *name;
+	blink_mode		rate;
+} console_blink_t;
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static int  cmd_help(uint32_t argc, char **argv);
+static int  cmd_show(uint32_t argc, char **argv);
+static int  cmd_volt(uint32_t argc, char **argv);
+static int  cmd_thre(uint32_t argc, char **argv);
+static int  cmd_blink(uint32_t argc, char **argv);
+static int  cmd_rate(uint32_t argc, char **argv);
+static int  cmd_prof(uint32_t argc, char **argv);
+static int  console_band(uint32_t argc, char **argv, uint32_t thre);
+static int  console_num(const char *s, uint32_t max, uint32_t *v);
+
+/*
+*********************************************************************************************************
+*                                       LOCAL GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+static const console_cmd_t console_cmds[] = {
+	{ "help",  0u, 0u, cmd_help,  ""                                },
+	{ "show",  0u, 0u, cmd_show,  ""                                },
+	{ "volt",  1u, 2u, cmd_volt,  "<1..6> [code]"                   },
+	{ "thre",  1u, 2u, cmd_thre,  "<1..6> [code]"                   },
+	{ "blink", 1u, 2u, cmd_blink, "<short|long|shortest> [mod]"     },
+	{ "rate",  0u, 2u, cmd_rate,  "[<ps 0..7> <mod>]"               },
+	{ "prof",  0u, 1u, cmd_prof,  "[reset]"                         },
+};
+
+#define CONSOLE_CMD_NBR			(sizeof(console_cmds) / sizeof(console_cmds[0]))
+
+static const console_blink_t console_blinks[] = {
+	{ "short",    BLINK_SHORT    },
+	{ "long",     BLINK_LONG     },
+	{ "shortest", BLINK_SHORTEST },
+};
+
+#define CONSOLE_BLINK_NBR		(sizeof(console_blinks) / sizeof(console_blinks[0]))
+
+// by -result of console_exec()
+static const char *const console_errs[] = {
+	"unknown command or arguments", "bad value", "refused"
+};
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+void console_init(console_t *c, const volatile uint8_t *ring, uint32_t len){
+	memset(c, 0, sizeof(*c));
+	c->ring = ring;
+	c->mask = len - 1u;
+}
+
+uint32_t console_poll(console_t *c, uint32_t head){
+	uint32_t lines = 0u;
+	uint32_t wait = (head - c->tail) & c->mask;
+	char     ch;
+
+	if (wait > c->peak)
+		c->peak = wait;
+	while (c->tail != head){
+		ch = (char)c->ring[c->tail];
+		c->tail = (c->tail + 1u) & c->mask;
+		c->bytes++;
+		if (ch == '\r' || ch == '\n'){
+			if (c->skip){
+				c->dropped++;
+				APP_TRACE_INFO(("line too long\r\n"));
+			} else if (c->n > 0u){
+				c->line[c->n] = '\0';
+				(void)console_exec(c, c->line);
+				lines++;
+			}
+			c->n = 0u;
+			c->skip = 0u;
+		} else if (ch == '\b' || ch == 0x7F){
+			if (c->n > 0u)
+				c->n--;
+		} else if (c->n < CONSOLE_LINE_MAX - 1u){
+			c->line[c->n++] = ch;
+		} else {
+			c->skip = 1u;
+		}
+	}
+	return lines;
+}
+
+int console_exec(console_t *c, char *line){
+	char    *argv[CONSOLE_ARGS_MAX];
+	uint32_t argc = 0u, over = 0u, k;
+	int      err = CONSOLE_ERR_CMD;
+
+	// words cut in place, a word beyond CONSOLE_ARGS_MAX fails the line
+	while (*line != '\0'){
+		if (*line == ' ' || *line == '\t'){
+			line++;
+			continue;
+		}
+		if (argc == CONSOLE_ARGS_MAX){
+			over = 1u;
+			break;
+		}
+		argv[argc++] = line;
+		while (*line != '\0' && *line != ' ' && *line != '\t')
+			line++;
+		if (*line != '\0')
+			*line++ = '\0';
+	}
+	if (argc == 0u)
+		return CONSOLE_OK;
+	c->lines++;
+
+	for (k = 0u; !over && k < CONSOLE_CMD_NBR; k++)
+		if (strcmp(argv[0], console_cmds[k].name) == 0){
+			if (argc - 1u >= console_cmds[k].args_min && argc - 1u <= console_cmds[k].args_max)
+				err = console_cmds[k].fn(argc - 1u, &argv[1]);
+			break;
+		}
+	if (err != CONSOLE_OK){
+		c->errors++;
+		APP_TRACE_INFO(("%s: %s\r\n", argv[0], console_errs[-err - 1]));
+	}
+	return err;
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+static int cmd_help(uint32_t argc, char **argv){
+	uint32_t k;
+
+	(void)argc;
+	(void)argv;
+	for (k = 0u; k < CONSOLE_CMD_NBR; k++)
+		APP_TRACE_INFO(("%-5s %s\r\n", console_cmds[k].name, console_cmds[k].usage));
+	return CONSOLE_OK;
+}
+
+static int cmd_show(uint32_t argc, char **argv){
+	const band_cfg_t *cfg = alarm_cfg();
+	uint32_t          cycles = hal_adc_trigger_cycles();
+	uint32_t          hz_x100 = (uint32_t)((uint64_t)hal_ts_hz() * 100u / cycles);
+	uint32_t          i;
+
+	(void)argc;
+	(void)argv;
+	for (i = 1u; i < BAND_VOLT_NBR; i++)
+		APP_TRACE_INFO(("%u %u.%uV volt %5u thre %5u\r\n", i, i / 2u, (i % 2u) * 5u, cfg->volt[i], cfg->thre[i]));
+	for (i = 0u; i < CONSOLE_BLINK_NBR; i++)
+		APP_TRACE_INFO(("blink %-8s mod 0x%04X\r\n", console_blinks[i].name, alarm_blink_mod(console_blinks[i].rate)));
+	APP_TRACE_INFO(("rate %u cycles, %u.%02u Hz\r\n", cycles, hz_x100 / 100u, hz_x100 % 100u));
+	APP_TRACE_INFO(("state rate %u warning %u\r\n", (uint32_t)led_rate, alarm_warning));
+	return CONSOLE_OK;
+}
+
+static int cmd_volt(uint32_t argc, char **argv){
+	return console_band(argc, argv, 0u);
+}
+
+static int cmd_thre(uint32_t argc, char **argv){
+	return console_band(argc, argv, 1u);
+}
+
+static int cmd_blink(uint32_t argc, char **argv){
+	uint32_t i, mod;
+
+	for (i = 0u; i < CONSOLE_BLINK_NBR && strcmp(argv[0], console_blinks[i].name) != 0; i++)
+		;
+	if (i == CONSOLE_BLINK_NBR)
+		return CONSOLE_ERR_ARG;
+	if (argc == 1u){
+		APP_TRACE_INFO(("blink %s mod 0x%04X\r\n", argv[0], alarm_blink_mod(console_blinks[i].rate)));
+		return CONSOLE_OK;
+	}
+	if (console_num(argv[1], 0xFFFFu, &mod) != 0 || mod == 0u)
+		return CONSOLE_ERR_ARG;
+	alarm_set_blink_mod(console_blinks[i].rate, (uint16_t)mod);
+	return CONSOLE_OK;
+}
+
+static int cmd_rate(uint32_t argc, char **argv){
+	uint32_t ps, mod;
+
+	if (argc == 0u){
+		APP_TRACE_INFO(("rate %u cycles\r\n", hal_adc_trigger_cycles()));
+		return CONSOLE_OK;
+	}
+	if (argc != 2u)
+		return CONSOLE_ERR_CMD;
+	if (console_num(argv[0], 7u, &ps) != 0 || console_num(argv[1], 0xFFFFu, &mod) != 0)
+		return CONSOLE_ERR_ARG;
+#if (APP_CFG_RATE_EN == DEF_ENABLED)
+	// AppTask sets the period itself
+	return CONSOLE_ERR_CFG;
+#else
+	{
+		HAL_SR_ALLOC();
+
+		// dma_int_handler reads the period back from FTM0, never halfway through the change
+		HAL_CRITICAL_ENTER();
+		PROF_START(m);
+		hal_adc_trigger_rate(ps, mod);
+		PROF_END(m);
+		HAL_CRITICAL_EXIT();
+		PROF_RECORD(PROF_MASK_CONFIG, m);
+	}
+	return CONSOLE_OK;
+#endif
+}
+
+// the report task prints the probes, the only writer of PROF_MASK_SNAPSHOT; the console task only
+// writes PROF_MASK_CONFIG
+static int cmd_prof(uint32_t argc, char **argv){
+	if (argc == 0u){
+		prof_request_dump();
+		return CONSOLE_OK;
+	}
+	if (strcmp(argv[0], "reset") != 0)
+		return CONSOLE_ERR_ARG;
+	prof_reset();
+	return CONSOLE_OK;
+}
+
+// VOLT_xx or THRE_xx of index argv[0], read or set to argv[1]
+static int console_band(uint32_t argc, char **argv, uint32_t thre){
+	band_cfg_t  cfg = *alarm_cfg();
+	uint16_t   *val = thre ? cfg.thre : cfg.volt;
+	uint32_t    i, v;
+
+	if (console_num(argv[0], BAND_VOLT_NBR - 1u, &i) != 0 || i == 0u)
+		return CONSOLE_ERR_ARG;
+	if (argc == 1u){
+		APP_TRACE_INFO(("%s %u %u\r\n", thre ? "thre" : "volt", i, val[i]));
+		return CONSOLE_OK;
+	}
+	if (console_num(argv[1], 0xFFFFu, &v) != 0)
+		return CONSOLE_ERR_ARG;
+	val[i] = (uint16_t)v;
+	// as calib_build(): levels increasing by more than their hysteresis
+	for (i = 1u; i < BAND_VOLT_NBR; i++)
+		if (cfg.volt[i] <= cfg.volt[i - 1u] + cfg.thre[i - 1u] + cfg.thre[i])
+			return CONSOLE_ERR_CFG;
+	if (alarm_set_cfg(&cfg) != 0)
+		return CONSOLE_ERR_CFG;
+#if (APP_CFG_ADC_COMPARE_EN == DEF_ENABLED)
+	// every reading until AppTask arms the compare function around the new bands
+	hal_adc0_compare_off();
+#endif
+	return CONSOLE_OK;
+}
+
+// decimal or 0x hexadecimal up to max; returns -1 for anything else
+static int console_num(const char *s, uint32_t max, uint32_t *v){
+	uint32_t base = 10u, x = 0u, d;
+
+	if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')){
+		base = 16u;
+		s += 2;
+	}
+	if (*s == '\0')
+		return -1;
+	for (; *s != '\0'; s++){
+		if (*s >= '0' && *s <= '9')
+			d = (uint32_t)(*s - '0');
+		else if (base == 16u && (*s | 0x20) >= 'a' && (*s | 0x20) <= 'f')
+			d = (uint32_t)((*s | 0x20) - 'a') + 10u;
+		else
+			return -1;
+		if (d > max || x > (max - d) / base)
+			return -1;
+		x = x * base + d;
+	}
+	*v = x;
+	return 0;
+}
@@ -0,0 +1,82 @@
+/*
+*********************************************************************************************************
+*                                          COMMAND CONSOLE
+*
+* Commands typed on the serial port, to read and change at run time what app_cfg.h fixes at build time:
+* the bands of channel 0 (VOLT_xx/THRE_xx), the FTM1 modulo of each blink rate (BLINK_xx_MOD), the FTM0
+* trigger period, and the profiling probes. The bytes come from a ring that the eDMA fills from UART0
+* (hal_uart_rx_dma_setup()), so receiving takes no interrupt; console_poll() runs in the lowest priority
+* task and assembles the lines in place, splits them into words and executes them, without allocation.
+* What AppTask reads is changed either with a single store (the band table of alarm_set_cfg()) or with
+* interrupts masked for a few register writes (blink and trigger periods, PROF_MASK_CONFIG), so AppTask
+* and the ISRs never wait for the console. The answers go through APP_TRACE_INFO; a change that succeeds
+* prints nothing. The line is not echoed.
+*   help                          commands
+*   show                          bands, blink moduli, trigger period, blink state
+*   volt <1..6> [code]            VOLT_05 ... VOLT_30 of channel 0
+*   thre <1..6> [code]            THRE_05 ... THRE_30
+*   blink <short|long|shortest> [mod]
+*   rate [<ps 0..7> <mod>]        FTM0 period (mod + 1) << ps bus cycles, not with APP_CFG_RATE_EN
+*   prof [reset]                  probes of prof.h, printed by the report task
+* The ring has no counter of the bytes written: if it fills up between two polls the oldest bytes are
+* lost without notice, peak tells how close it came.
+*********************************************************************************************************
+*/
+
+#ifndef  CONSOLE_MODULE_PRESENT
+#define  CONSOLE_MODULE_PRESENT
+
+#include  <stdint.h>
+
+/*
+*********************************************************************************************************
+*                                               DEFINES
+*********************************************************************************************************
+*/
+
+#define CONSOLE_LINE_MAX		48u						// characters of a line, the terminator included
+#define CONSOLE_ARGS_MAX		4u						// words of a line, the command included
+
+// results of console_exec()
+#define CONSOLE_OK				0
+#define CONSOLE_ERR_CMD			-1						// unknown command or number of arguments
+#define CONSOLE_ERR_ARG			-2						// argument not a number or out of range
+#define CONSOLE_ERR_CFG			-3						// bands not increasing or not buildable, rate adaptive
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+typedef struct console {
+	const volatile uint8_t *ring;
+	uint32_t	mask;									// bytes of the ring - 1
+	uint32_t	tail;									// next byte to read
+	uint32_t	n;										// characters in line
+	uint32_t	skip;									// line too long, dropped up to its end
+	char		line[CONSOLE_LINE_MAX];
+	// since console_init()
+	uint32_t	bytes;
+	uint32_t	lines;									// executed
+	uint32_t	errors;									// lines with a result other than CONSOLE_OK
+	uint32_t	dropped;								// lines too long
+	uint32_t	peak;									// most bytes waiting at a poll
+} console_t;
+
+/*
+*********************************************************************************************************
+*                                         FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+// ring of len bytes, a power of 2, read from index 0
+void     console_init(console_t *c, const volatile uint8_t *ring, uint32_t len);
+
+// bytes of the ring up to head (exclusive), every line ended by CR or LF executed; returns the lines
+uint32_t console_poll(console_t *c, uint32_t head);
+
+// one line, split in place; returns CONSOLE_OK or a CONSOLE_ERR_xx, which is also printed
+int      console_exec(console_t *c, char *line);
+
+#endif
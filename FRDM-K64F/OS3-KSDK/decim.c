@@ -0,0 +1,141 @@
+/*
+*********************************************************************************************************
+* CIC decimation of the readings (see decim.h).
+* Order 1 only adds the readings of the window. Order 2 runs two integrators per reading and, per output,
+* two combs that subtract the value their input had at the previous output; the first output covers a
+* partial triangle and is dropped. The output is the comb sum divided by its gain 2^(order * n) with
+* rounding, which cannot exceed 0xFFFF.
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <string.h>
+
+#include  <decim.h>
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static uint32_t decim_box(decim_t *d, spsc_sample_t *s, uint32_t n);
+static uint32_t decim_cic2(decim_t *d, spsc_sample_t *s, uint32_t n);
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+void decim_init(decim_t *d, uint32_t log2, uint32_t order){
+	memset(d, 0, sizeof(*d));
+	d->log2 = log2 < DECIM_LOG2_MAX ? log2 : DECIM_LOG2_MAX;
+	d->order = order < 1u ? 1u : order > DECIM_ORDER_MAX ? DECIM_ORDER_MAX : order;
+	d->warm = d->order - 1u;
+}
+
+uint32_t decim_batch(decim_t *d, spsc_sample_t *s, uint32_t n){
+	uint32_t m;
+
+	if (d->log2 == 0u)
+		return n;
+	m = d->order == 1u ? decim_box(d, s, n) : decim_cic2(d, s, n);
+	d->outputs += m;
+	return m;
+}
+
+void decim_bench(decim_bench_t *res, uint32_t (*clk)(void), uint32_t rounds){
+	static decim_t	d;
+	spsc_sample_t	src[DECIM_BENCH_LEN];
+	spsc_sample_t	buf[DECIM_BENCH_LEN];
+	uint32_t		seed = 1u;
+	uint32_t		order, log2, r, i;
+
+	// slow ramp with 1024 LSB of noise, as filter_bench()
+	for (i = 0u; i < DECIM_BENCH_LEN; i++){
+		seed = seed * 1664525u + 1013904223u;
+		src[i].ts = i;
+		src[i].code = (uint16_t)(20000u + i * 64u + (seed >> 22));
+		src[i].ch = 0u;
+	}
+	for (order = 1u; order <= DECIM_ORDER_MAX; order++)
+		for (log2 = 1u; log2 <= DECIM_LOG2_MAX; log2++){
+			uint32_t cycles = 0u, outputs = 0u;
+
+			decim_init(&d, log2, order);
+			for (r = 0u; r < rounds; r++){
+				uint32_t start;
+
+				memcpy(buf, src, sizeof(buf));
+				start = clk();
+				outputs += decim_batch(&d, buf, DECIM_BENCH_LEN);
+				cycles += clk() - start;
+			}
+			res->cycles_x100[order - 1u][log2 - 1u] = outputs ?
+				(uint32_t)(((uint64_t)cycles * 100u) / outputs) : 0u;
+		}
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+static uint32_t decim_box(decim_t *d, spsc_sample_t *s, uint32_t n){
+	uint32_t len = 1u << d->log2;
+	uint32_t sum = d->integ[0];
+	uint32_t k = d->n;
+	uint32_t i, m = 0u;
+
+	for (i = 0u; i < n; i++){
+		sum += s[i].code;
+		if (++k < len)
+			continue;
+		s[m].ts = s[i].ts;
+		s[m].code = (uint16_t)((sum + (len >> 1)) >> d->log2);
+		s[m++].ch = 0u;
+		sum = 0u;
+		k = 0u;
+	}
+	d->integ[0] = sum;
+	d->n = k;
+	return m;
+}
+
+static uint32_t decim_cic2(decim_t *d, spsc_sample_t *s, uint32_t n){
+	uint32_t len = 1u << d->log2;
+	uint32_t shift = 2u * d->log2;
+	uint32_t i1 = d->integ[0], i2 = d->integ[1];
+	uint32_t k = d->n;
+	uint32_t i, m = 0u, c1, c2;
+
+	for (i = 0u; i < n; i++){
+		i1 += s[i].code;
+		i2 += i1;
+		if (++k < len)
+			continue;
+		k = 0u;
+		c1 = i2 - d->comb[0];
+		d->comb[0] = i2;
+		c2 = c1 - d->comb[1];
+		d->comb[1] = c1;
+		if (d->warm){
+			d->warm--;
+			continue;
+		}
+		s[m].ts = s[i].ts;
+		s[m].code = (uint16_t)((c2 + (1u << (shift - 1u))) >> shift);
+		s[m++].ch = 0u;
+	}
+	d->integ[0] = i1;
+	d->integ[1] = i2;
+	d->n = k;
+	return m;
+}
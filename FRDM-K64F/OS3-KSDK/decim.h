@@ -0,0 +1,68 @@
+/*
+*********************************************************************************************************
+*                                            DECIMATION
+*
+* Readings of channel 0 reduced to one output per 2^n by a CIC decimator: order 1 is the boxcar (sum of
+* the 2^n readings of the window), order 2 a second integrator and comb, a triangle over 2^(n+1) - 1
+* readings with a deeper rejection of what would alias. Both have a unity gain at DC and lower white
+* noise by sqrt(2^n) (order 1) or sqrt(1.5 * 2^n) (order 2), half a bit per doubling; the output is
+* delayed by order * (2^n - 1) / 2 readings. Integrators and combs wrap modulo 2^32, which holds the
+* 16 + order * n bits of the sums. The filter of filter.h and range_check() then run at the output rate.
+* Works in place on the batch of AppTask and keeps its state across batches.
+*********************************************************************************************************
+*/
+
+#ifndef  DECIM_MODULE_PRESENT
+#define  DECIM_MODULE_PRESENT
+
+#include  <stdint.h>
+#include  <spsc.h>
+
+/*
+*********************************************************************************************************
+*                                               DEFINES
+*********************************************************************************************************
+*/
+
+#define DECIM_LOG2_MAX			6u						// up to 64 readings per output
+#define DECIM_ORDER_MAX			2u
+#define DECIM_BENCH_LEN			64u						// readings per call of decim_bench()
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+typedef struct decim {
+	uint32_t	log2;
+	uint32_t	order;
+	uint32_t	n;										// readings of the window in progress
+	uint32_t	warm;									// outputs still to drop while the combs fill
+	uint32_t	integ[DECIM_ORDER_MAX];
+	uint32_t	comb[DECIM_ORDER_MAX];					// input of each comb at the last output
+	uint32_t	outputs;
+} decim_t;
+
+// cycles per output for each order and 2^1 to 2^DECIM_LOG2_MAX readings, in 1/100 of cycle
+typedef struct decim_bench {
+	uint32_t	cycles_x100[DECIM_ORDER_MAX][DECIM_LOG2_MAX];
+} decim_bench_t;
+
+/*
+*********************************************************************************************************
+*                                         FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+// one output per 2^log2 readings (0 passes them through), order 1 or 2
+void     decim_init(decim_t *d, uint32_t log2, uint32_t order);
+
+// n readings of channel 0 replaced in place by their outputs, each stamped with the ts of the last
+// reading of its window; returns the number of outputs
+uint32_t decim_batch(decim_t *d, spsc_sample_t *s, uint32_t n);
+
+// runs every setting over rounds batches of DECIM_BENCH_LEN readings, clk is a free running cycle counter
+void     decim_bench(decim_bench_t *res, uint32_t (*clk)(void), uint32_t rounds);
+
+#endif
@@ -0,0 +1,274 @@
+/*
+*********************************************************************************************************
+* Block filters of the ADC readings (see filter.h).
+* The FIR works on signed Q15 samples (ADC code XOR 0x8000) so that pairs of samples and coefficients can be
+* multiplied and accumulated by one SMLAD on the Cortex-M4; the host build uses PMADDWD (SSE2) when
+* available, otherwise plain C. All the paths give the same result.
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <string.h>
+
+#include  <filter.h>
+
+#if defined(__ARM_FEATURE_DSP) && !defined(APP_HOST_BUILD)
+#include  "fsl_device_registers.h"						// CMSIS SIMD intrinsics of the M4 core
+#define FILTER_SIMD_M4
+#elif defined(__SSE2__)
+#include  <emmintrin.h>
+#define FILTER_SIMD_SSE2
+#endif
+
+/*
+*********************************************************************************************************
+*                                            LOCAL DEFINES
+*********************************************************************************************************
+*/
+
+#define FILTER_Q15_OFFSET		0x8000u
+
+/*
+*********************************************************************************************************
+*                                       LOCAL GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+// low-pass, cut-off at 0.05 fs, Hamming window, Q15 with unity DC gain; symmetric so it is also its reverse
+static const int16_t fir_coef[FILTER_FIR_TAPS] = {
+	 112,  243,  618, 1293, 2217, 3225, 4089, 4587,
+	4587, 4089, 3225, 2217, 1293,  618,  243,  112
+};
+
+static const char *const filter_names[FILTER_TYPE_NBR] = {
+	"none", "mavg", "fir", "median3", "median5"
+};
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static void     filter_prime(filter_t *f, uint16_t x);
+static void     mavg_block(filter_t *f, uint16_t *buf, uint32_t len);
+static void     fir_block(filter_t *f, uint16_t *buf, uint32_t len);
+static int32_t  fir_dot(const int16_t *x);
+static void     median3_block(filter_t *f, uint16_t *buf, uint32_t len);
+static void     median5_block(filter_t *f, uint16_t *buf, uint32_t len);
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+void filter_init(filter_t *f, uint32_t type, uint32_t mavg_len_log2){
+	memset(f, 0, sizeof(*f));
+	f->type = type < FILTER_TYPE_NBR ? type : FILTER_NONE;
+	if (f->type == FILTER_MAVG){
+		f->u.mavg.len_log2 = mavg_len_log2;
+		while ((1u << f->u.mavg.len_log2) > FILTER_MAVG_LEN_MAX)
+			f->u.mavg.len_log2--;
+	}
+}
+
+void filter_block(filter_t *f, uint16_t *buf, uint32_t len){
+	if (len == 0u || f->type == FILTER_NONE)
+		return;
+	// the history starts from the first sample, not from 0 V
+	if (!f->primed){
+		filter_prime(f, buf[0]);
+		f->primed = 1u;
+	}
+	switch (f->type){
+		case FILTER_MAVG:
+			mavg_block(f, buf, len);
+			break;
+		case FILTER_FIR:
+			while (len > FILTER_BLOCK_MAX){
+				fir_block(f, buf, FILTER_BLOCK_MAX);
+				buf += FILTER_BLOCK_MAX;
+				len -= FILTER_BLOCK_MAX;
+			}
+			fir_block(f, buf, len);
+			break;
+		case FILTER_MEDIAN3:
+			median3_block(f, buf, len);
+			break;
+		case FILTER_MEDIAN5:
+			median5_block(f, buf, len);
+			break;
+	}
+}
+
+const char *filter_name(uint32_t type){
+	return type < FILTER_TYPE_NBR ? filter_names[type] : "?";
+}
+
+void filter_bench(filter_bench_t *res, uint32_t (*clk)(void), uint32_t rounds){
+	static filter_t	f;
+	uint16_t		src[FILTER_BLOCK_MAX];
+	uint16_t		buf[FILTER_BLOCK_MAX];
+	uint32_t		seed = 1u;
+	uint32_t		type, r, i;
+
+	// slow ramp with 1024 LSB of noise
+	for (i = 0u; i < FILTER_BLOCK_MAX; i++){
+		seed = seed * 1664525u + 1013904223u;
+		src[i] = (uint16_t)(20000u + i * 64u + (seed >> 22));
+	}
+	for (type = 0u; type < FILTER_TYPE_NBR; type++){
+		uint32_t cycles = 0u;
+
+		filter_init(&f, type, 3u);
+		for (r = 0u; r < rounds; r++){
+			uint32_t start;
+
+			memcpy(buf, src, sizeof(buf));
+			start = clk();
+			filter_block(&f, buf, FILTER_BLOCK_MAX);
+			cycles += clk() - start;
+		}
+		res->cycles_x100[type] = (uint32_t)(((uint64_t)cycles * 100u) / ((uint64_t)rounds * FILTER_BLOCK_MAX));
+	}
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+static void filter_prime(filter_t *f, uint16_t x){
+	uint32_t i;
+
+	switch (f->type){
+		case FILTER_MAVG:
+			for (i = 0u; i < (1u << f->u.mavg.len_log2); i++)
+				f->u.mavg.hist[i] = x;
+			f->u.mavg.sum = (uint32_t)x << f->u.mavg.len_log2;
+			break;
+		case FILTER_FIR:
+			for (i = 0u; i < FILTER_FIR_TAPS - 1u; i++)
+				f->u.fir.hist[i] = (int16_t)(x ^ FILTER_Q15_OFFSET);
+			break;
+		case FILTER_MEDIAN3:
+		case FILTER_MEDIAN5:
+			for (i = 0u; i < 4u; i++)
+				f->u.median.hist[i] = x;
+			break;
+	}
+}
+
+static void mavg_block(filter_t *f, uint16_t *buf, uint32_t len){
+	uint32_t mask = (1u << f->u.mavg.len_log2) - 1u;
+	uint32_t sum = f->u.mavg.sum;
+	uint32_t idx = f->u.mavg.idx;
+	uint32_t i;
+
+	for (i = 0u; i < len; i++){
+		sum += (uint32_t)buf[i] - f->u.mavg.hist[idx];
+		f->u.mavg.hist[idx] = buf[i];
+		idx = (idx + 1u) & mask;
+		buf[i] = (uint16_t)(sum >> f->u.mavg.len_log2);
+	}
+	f->u.mavg.sum = sum;
+	f->u.mavg.idx = idx;
+}
+
+static void fir_block(filter_t *f, uint16_t *buf, uint32_t len){
+	int16_t *x = f->u.fir.hist;
+	uint32_t i;
+
+	for (i = 0u; i < len; i++)
+		x[FILTER_FIR_TAPS - 1u + i] = (int16_t)(buf[i] ^ FILTER_Q15_OFFSET);
+	for (i = 0u; i < len; i++){
+		int32_t y = (fir_dot(&x[i]) + (1 << 14)) >> 15;
+
+		if (y > INT16_MAX)
+			y = INT16_MAX;
+		else if (y < INT16_MIN)
+			y = INT16_MIN;
+		buf[i] = (uint16_t)((uint16_t)(int16_t)y ^ FILTER_Q15_OFFSET);
+	}
+	memmove(x, &x[len], (FILTER_FIR_TAPS - 1u) * sizeof(int16_t));
+}
+
+// sum of x[k] * fir_coef[k] over the taps, Q30
+static int32_t fir_dot(const int16_t *x){
+#if defined(FILTER_SIMD_M4)
+	uint32_t acc = 0u;
+	uint32_t xk, ck;
+	uint32_t k;
+
+	// x is at any halfword: memcpy() is one LDR, which the M4 allows unaligned, where a cast through
+	// uint32_t * breaks the aliasing rules and may be merged into an LDRD/LDM that faults
+	for (k = 0u; k < FILTER_FIR_TAPS; k += 2u){
+		memcpy(&xk, &x[k], sizeof(xk));
+		memcpy(&ck, &fir_coef[k], sizeof(ck));
+		acc = __SMLAD(xk, ck, acc);
+	}
+	return (int32_t)acc;
+#elif defined(FILTER_SIMD_SSE2)
+	__m128i acc = _mm_setzero_si128();
+	uint32_t k;
+
+	for (k = 0u; k < FILTER_FIR_TAPS; k += 8u)
+		acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)&x[k]),
+												_mm_loadu_si128((const __m128i *)&fir_coef[k])));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(acc);
+#else
+	int32_t acc = 0;
+	uint32_t k;
+
+	for (k = 0u; k < FILTER_FIR_TAPS; k++)
+		acc += (int32_t)x[k] * fir_coef[k];
+	return acc;
+#endif
+}
+
+#define FILTER_MIN(a, b)		((a) < (b) ? (a) : (b))
+#define FILTER_MAX(a, b)		((a) > (b) ? (a) : (b))
+
+static uint16_t median3(uint16_t a, uint16_t b, uint16_t c){
+	return FILTER_MAX(FILTER_MIN(a, b), FILTER_MIN(FILTER_MAX(a, b), c));
+}
+
+static void median3_block(filter_t *f, uint16_t *buf, uint32_t len){
+	uint16_t *h = f->u.median.hist;
+	uint32_t i;
+
+	for (i = 0u; i < len; i++){
+		uint16_t x = buf[i];
+
+		buf[i] = median3(h[2], h[3], x);
+		h[2] = h[3];
+		h[3] = x;
+	}
+}
+
+static void median5_block(filter_t *f, uint16_t *buf, uint32_t len){
+	uint16_t *h = f->u.median.hist;
+	uint32_t i;
+
+	for (i = 0u; i < len; i++){
+		uint16_t x = buf[i];
+		// the lowest and the highest of the two pairs cannot be the median
+		uint16_t lo = FILTER_MAX(FILTER_MIN(h[0], h[1]), FILTER_MIN(h[2], h[3]));
+		uint16_t hi = FILTER_MIN(FILTER_MAX(h[0], h[1]), FILTER_MAX(h[2], h[3]));
+
+		buf[i] = median3(lo, hi, x);
+		h[0] = h[1];
+		h[1] = h[2];
+		h[2] = h[3];
+		h[3] = x;
+	}
+}
@@ -0,0 +1,81 @@
+/*
+*********************************************************************************************************
+*                                         SAMPLE FILTERING
+*
+* Filtering stage between the DMA ring and the range checking. Filters work in place on blocks of 16 bit
+* ADC readings and keep their history across blocks:
+*  - moving average over 2^n samples (running sum)
+*  - 16 taps FIR low-pass, Q15 coefficients, dual 16 bit MAC (SMLAD on the M4, SSE2 or scalar on the host)
+*  - median of 3 or 5 samples
+*********************************************************************************************************
+*/
+
+#ifndef  FILTER_MODULE_PRESENT
+#define  FILTER_MODULE_PRESENT
+
+#include  <stdint.h>
+
+/*
+*********************************************************************************************************
+*                                               DEFINES
+*********************************************************************************************************
+*/
+
+#define FILTER_NONE				0u
+#define FILTER_MAVG				1u
+#define FILTER_FIR				2u
+#define FILTER_MEDIAN3			3u
+#define FILTER_MEDIAN5			4u
+#define FILTER_TYPE_NBR			5u
+
+#define FILTER_MAVG_LEN_MAX		64u						// power of 2
+#define FILTER_FIR_TAPS			16u						// even, taps are processed in pairs
+#define FILTER_BLOCK_MAX		64u						// longer blocks are filtered in chunks
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+typedef struct filter {
+	uint32_t	type;
+	uint32_t	primed;								// history filled with the first sample
+	union {
+		struct {
+			uint32_t	sum;
+			uint32_t	idx;
+			uint32_t	len_log2;
+			uint16_t	hist[FILTER_MAVG_LEN_MAX];
+		} mavg;
+		struct {
+			// samples as signed Q15, the last FILTER_FIR_TAPS - 1 of the previous chunk first
+			int16_t		hist[FILTER_FIR_TAPS - 1u + FILTER_BLOCK_MAX];
+		} fir;
+		struct {
+			uint16_t	hist[4];						// last samples, oldest first
+		} median;
+	} u;
+} filter_t;
+
+// cycles per sample of every filter, in 1/100 of cycle
+typedef struct filter_bench {
+	uint32_t	cycles_x100[FILTER_TYPE_NBR];
+} filter_bench_t;
+
+/*
+*********************************************************************************************************
+*                                         FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+// mavg_len_log2 is only used by FILTER_MAVG
+void filter_init(filter_t *f, uint32_t type, uint32_t mavg_len_log2);
+void filter_block(filter_t *f, uint16_t *buf, uint32_t len);
+
+const char *filter_name(uint32_t type);
+
+// runs every filter over rounds blocks of FILTER_BLOCK_MAX samples, clk is a free running cycle counter
+void filter_bench(filter_bench_t *res, uint32_t (*clk)(void), uint32_t rounds);
+
+#endif
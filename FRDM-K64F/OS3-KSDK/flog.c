@@ -0,0 +1,172 @@
+/*
+*********************************************************************************************************
+* Journal log in flash (see flog.h).
+* Slots are programmed in order within a sector, so its free slots are the erased ones at the end: the
+* mount scans back from the last slot. A failed program command may leave some of the slots of the batch
+* half programmed, the rest of the sector is given up and the next record opens the next one.
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <string.h>
+
+#include  <band.h>
+#include  <flog.h>
+
+/*
+*********************************************************************************************************
+*                                            LOCAL DEFINES
+*********************************************************************************************************
+*/
+
+#define FLOG_ADDR(f, s, slot)	((f)->base + (s) * HAL_FLASH_SECTOR + (slot) * sizeof(journal_rec_t))
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static int  flog_hdr(const flog_t *f, uint32_t s, flog_hdr_t *h);
+static int  flog_open(flog_t *f, uint32_t s);
+static int  flog_erased(const journal_rec_t *r);
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+int flog_mount(flog_t *f, uint32_t base, uint32_t sectors){
+	journal_rec_t r;
+	flog_hdr_t    h;
+	uint32_t      s;
+
+	memset(f, 0, sizeof(*f));
+	f->base = base;
+	f->sectors = sectors;
+	for (s = 0u; s < sectors; s++)
+		if (flog_hdr(f, s, &h) == 0 && h.seq > f->seq){
+			f->cur = s;
+			f->seq = h.seq;
+		}
+	if (f->seq == 0u){
+		// the first record opens sector 0
+		f->cur = sectors - 1u;
+		f->next = FLOG_SLOTS;
+		return 0;
+	}
+	for (f->next = FLOG_SLOTS; f->next > 1u; f->next--){
+		hal_flash_read(FLOG_ADDR(f, f->cur, f->next - 1u), &r, sizeof(r));
+		if (!flog_erased(&r))
+			break;
+	}
+	return 1;
+}
+
+uint32_t flog_append(flog_t *f, const journal_rec_t *rec, uint32_t n){
+	uint32_t done = 0u, k;
+
+	while (done < n){
+		if (f->next == FLOG_SLOTS && flog_open(f, (f->cur + 1u) % f->sectors) != 0)
+			break;
+		k = FLOG_SLOTS - f->next;
+		if (k > n - done)
+			k = n - done;
+		if (hal_flash_program(FLOG_ADDR(f, f->cur, f->next), &rec[done], k * sizeof(journal_rec_t)) != 0){
+			f->errors++;
+			f->next = FLOG_SLOTS;
+			break;
+		}
+		f->next += k;
+		f->written += k;
+		done += k;
+	}
+	return done;
+}
+
+uint32_t flog_last(const flog_t *f, journal_rec_t *out, uint32_t max){
+	uint32_t   s = f->cur, seq = f->seq, slot = f->next, n = 0u;
+	flog_hdr_t h;
+
+	if (seq == 0u)
+		return 0u;
+	// from the newest record back, into out from its end
+	while (n < max){
+		if (slot <= 1u){
+			// the sector before, as long as it has not been erased for a newer one
+			s = (s + f->sectors - 1u) % f->sectors;
+			if (s == f->cur || flog_hdr(f, s, &h) != 0 || h.seq != seq - 1u)
+				break;
+			seq--;
+			slot = FLOG_SLOTS;
+		}
+		slot--;
+		hal_flash_read(FLOG_ADDR(f, s, slot), &out[max - 1u - n], sizeof(journal_rec_t));
+		// cut by a reset or left erased by a failed batch
+		if (out[max - 1u - n].from >= BAND_STATE_NBR || out[max - 1u - n].to >= BAND_STATE_NBR)
+			continue;
+		n++;
+	}
+	memmove(out, &out[max - n], n * sizeof(journal_rec_t));
+	return n;
+}
+
+void flog_wear(const flog_t *f, uint32_t *min, uint32_t *max){
+	flog_hdr_t h;
+	uint32_t   s, e;
+
+	*min = 0xFFFFFFFFu;
+	*max = 0u;
+	for (s = 0u; s < f->sectors; s++){
+		e = flog_hdr(f, s, &h) == 0 ? h.erases : 0u;
+		if (e < *min)
+			*min = e;
+		if (e > *max)
+			*max = e;
+	}
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+// returns -1 if sector s has no header
+static int flog_hdr(const flog_t *f, uint32_t s, flog_hdr_t *h){
+	hal_flash_read(FLOG_ADDR(f, s, 0u), h, sizeof(*h));
+	return (h->magic == FLOG_MAGIC && h->seq != 0xFFFFFFFFu && h->seq != 0u) ? 0 : -1;
+}
+
+// sector s erased for the next sequence number, its erase count carried to the new header
+static int flog_open(flog_t *f, uint32_t s){
+	flog_hdr_t h;
+	uint32_t   erases = flog_hdr(f, s, &h) == 0 ? h.erases : 0u;
+
+	if (hal_flash_erase(FLOG_ADDR(f, s, 0u)) != 0){
+		f->errors++;
+		return -1;
+	}
+	f->erases++;
+	h.seq = f->seq + 1u;
+	h.erases = (uint16_t)(erases < 0xFFFFu ? erases + 1u : erases);
+	h.magic = FLOG_MAGIC;
+	if (hal_flash_program(FLOG_ADDR(f, s, 0u), &h, sizeof(h)) != 0){
+		f->errors++;
+		return -1;
+	}
+	f->cur = s;
+	f->seq = h.seq;
+	f->next = 1u;
+	return 0;
+}
+
+static int flog_erased(const journal_rec_t *r){
+	return r->ts == 0xFFFFFFFFu && r->sample == 0xFFFFu && r->from == JOURNAL_ERASED && r->to == JOURNAL_ERASED;
+}
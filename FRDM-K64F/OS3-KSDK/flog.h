@@ -0,0 +1,76 @@
+/*
+*********************************************************************************************************
+*                                        JOURNAL LOG IN FLASH
+*
+* Records of journal.h appended to a ring of program flash sectors. Each sector starts with a header
+* (sequence number, erase count of the sector) followed by FLOG_SLOTS - 1 records, and each record is
+* programmed once into erased flash, one phrase of the K64F. The sectors are filled in turn, so they wear
+* evenly: a sector is erased only when the log comes back to it, which drops its oldest records, and its
+* erase count moves to the new header. A batch of records is programmed in one command.
+* flog_mount() finds the sector with the highest sequence number and its first free slot; nothing is
+* erased before the first record. A record cut by a reset is skipped when the log is read back; a sector
+* erased but left without header by a reset starts its erase count again.
+*********************************************************************************************************
+*/
+
+#ifndef  FLOG_MODULE_PRESENT
+#define  FLOG_MODULE_PRESENT
+
+#include  <stdint.h>
+#include  <hal.h>
+#include  <journal.h>
+
+/*
+*********************************************************************************************************
+*                                               DEFINES
+*********************************************************************************************************
+*/
+
+#define FLOG_SLOTS				(HAL_FLASH_SECTOR / sizeof(journal_rec_t))	// header included
+#define FLOG_MAGIC				0x474Cu					// "LG"
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+// slot 0 of every sector in use, the size of a record
+typedef struct flog_hdr {
+	uint32_t	seq;									// 1 for the first sector of the log
+	uint16_t	erases;									// of this sector, saturated
+	uint16_t	magic;
+} flog_hdr_t;
+
+typedef struct flog {
+	uint32_t	base;									// address of sector 0
+	uint32_t	sectors;
+	uint32_t	cur;									// sector being written
+	uint32_t	next;									// its first free slot, FLOG_SLOTS when full
+	uint32_t	seq;									// its sequence number, 0 in an empty log
+	// since flog_mount()
+	uint32_t	written;								// records
+	uint32_t	erases;									// sectors
+	uint32_t	errors;									// failed erase or program commands
+} flog_t;
+
+/*
+*********************************************************************************************************
+*                                         FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+// log of sectors sectors from base, aligned on HAL_FLASH_SECTOR; returns 1 if a log was found, 0 if the
+// next record starts a new one
+int      flog_mount(flog_t *f, uint32_t base, uint32_t sectors);
+
+// n records at the end of the log; returns the number written, fewer after a failed flash command
+uint32_t flog_append(flog_t *f, const journal_rec_t *rec, uint32_t n);
+
+// up to max of the last records of the log, oldest first
+uint32_t flog_last(const flog_t *f, journal_rec_t *out, uint32_t max);
+
+// lowest and highest erase count of the sectors, from their headers
+void     flog_wear(const flog_t *f, uint32_t *min, uint32_t *max);
+
+#endif
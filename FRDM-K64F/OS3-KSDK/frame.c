@@ -0,0 +1,234 @@
+/*
+*********************************************************************************************************
+* Encoder and decoder of the sample stream frames (see frame.h).
+* The decoder is fed byte by byte: the length of a frame is only known while its deltas arrive, so it
+* keeps the number of bytes needed so far and the phase of the field being received.
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <string.h>
+
+#include  <frame.h>
+
+/*
+*********************************************************************************************************
+*                                            LOCAL DEFINES
+*********************************************************************************************************
+*/
+
+// field being received by the decoder
+#define FRAME_PH_HDR			0u
+#define FRAME_PH_FIRST			1u
+#define FRAME_PH_DELTA			2u
+#define FRAME_PH_ESC			3u
+#define FRAME_PH_CRC			4u
+
+/*
+*********************************************************************************************************
+*                                       LOCAL GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+// CRC-16/CCITT of a nibble, half the work of the bitwise loop for 32 bytes of table
+static const uint16_t crc16_nibble[16] = {
+	0x0000u, 0x1021u, 0x2042u, 0x3063u, 0x4084u, 0x50A5u, 0x60C6u, 0x70E7u,
+	0x8108u, 0x9129u, 0xA14Au, 0xB16Bu, 0xC18Cu, 0xD1ADu, 0xE1CEu, 0xF1EFu
+};
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static void decode_byte(frame_decoder_t *d, uint8_t b, void (*on_frame)(const frame_t *f, void *arg), void *arg);
+static int  decode_frame(frame_decoder_t *d, frame_t *f);
+static void resync(frame_decoder_t *d, void (*on_frame)(const frame_t *f, void *arg), void *arg);
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+uint16_t frame_crc16(const uint8_t *buf, uint32_t len){
+	uint16_t crc = 0xFFFFu;
+	uint32_t i;
+
+	for (i = 0u; i < len; i++){
+		crc = (uint16_t)((crc << 4) ^ crc16_nibble[(crc >> 12) ^ (buf[i] >> 4)]);
+		crc = (uint16_t)((crc << 4) ^ crc16_nibble[(crc >> 12) ^ (buf[i] & 0xFu)]);
+	}
+	return crc;
+}
+
+uint32_t frame_encode(uint8_t *buf, uint16_t seq, uint32_t ts, const uint16_t *samples, uint32_t stride,
+					  uint32_t nbr){
+	const uint8_t *p = (const uint8_t *)samples;
+	uint32_t prev, i, len;
+	uint16_t crc;
+
+	if (nbr > FRAME_SAMPLES_MAX)
+		nbr = FRAME_SAMPLES_MAX;
+	buf[0] = FRAME_SYNC0;
+	buf[1] = FRAME_SYNC1;
+	buf[2] = (uint8_t)seq;
+	buf[3] = (uint8_t)(seq >> 8);
+	buf[4] = (uint8_t)nbr;
+	buf[5] = (uint8_t)ts;
+	buf[6] = (uint8_t)(ts >> 8);
+	buf[7] = (uint8_t)(ts >> 16);
+	buf[8] = (uint8_t)(ts >> 24);
+	prev = *(const uint16_t *)p;
+	buf[9] = (uint8_t)prev;
+	buf[10] = (uint8_t)(prev >> 8);
+	len = 11u;
+	for (i = 1u; i < nbr; i++){
+		uint32_t x;
+		int32_t  delta;
+
+		p += stride;
+		x = *(const uint16_t *)p;
+		delta = (int32_t)x - (int32_t)prev;
+		if (delta >= -127 && delta <= 127){
+			buf[len++] = (uint8_t)(int8_t)delta;
+		} else {
+			buf[len++] = FRAME_DELTA_ESC;
+			buf[len++] = (uint8_t)x;
+			buf[len++] = (uint8_t)(x >> 8);
+		}
+		prev = x;
+	}
+	crc = frame_crc16(&buf[2], len - 2u);
+	buf[len++] = (uint8_t)crc;
+	buf[len++] = (uint8_t)(crc >> 8);
+	return len;
+}
+
+void frame_decoder_init(frame_decoder_t *d){
+	memset(d, 0, sizeof(*d));
+	d->last_seq = -1;
+}
+
+void frame_decode(frame_decoder_t *d, const uint8_t *buf, uint32_t len,
+				  void (*on_frame)(const frame_t *f, void *arg), void *arg){
+	uint32_t i;
+
+	for (i = 0u; i < len; i++)
+		decode_byte(d, buf[i], on_frame, arg);
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+static void decode_byte(frame_decoder_t *d, uint8_t b, void (*on_frame)(const frame_t *f, void *arg), void *arg){
+	frame_t f;
+
+	// hunt for the sync bytes
+	if (d->len == 0u){
+		if (b == FRAME_SYNC0){
+			d->buf[d->len++] = b;
+			d->need = FRAME_HDR_SIZE;
+			d->phase = FRAME_PH_HDR;
+		} else {
+			d->skipped++;
+		}
+		return;
+	}
+	if (d->len == 1u && b != FRAME_SYNC1){
+		d->skipped++;
+		d->len = 0u;
+		decode_byte(d, b, on_frame, arg);
+		return;
+	}
+	d->buf[d->len++] = b;
+	if (d->len < d->need)
+		return;
+
+	switch (d->phase){
+		case FRAME_PH_HDR:
+			d->left = d->buf[4];
+			if (d->left == 0u || d->left > FRAME_SAMPLES_MAX){
+				resync(d, on_frame, arg);
+				return;
+			}
+			d->left--;
+			d->need += 2u;
+			d->phase = FRAME_PH_FIRST;
+			return;
+		case FRAME_PH_DELTA:
+			if (b == FRAME_DELTA_ESC){
+				d->need += 2u;
+				d->phase = FRAME_PH_ESC;
+				return;
+			}
+			break;
+		case FRAME_PH_CRC:
+			if (!decode_frame(d, &f)){
+				d->crc_errors++;
+				resync(d, on_frame, arg);
+				return;
+			}
+			if (d->last_seq >= 0)
+				d->lost += (uint16_t)(f.seq - (uint16_t)d->last_seq - 1u);
+			d->last_seq = f.seq;
+			d->frames++;
+			d->len = 0u;
+			on_frame(&f, arg);
+			return;
+	}
+	// next delta or the CRC
+	if (d->left > 0u){
+		d->left--;
+		d->need += 1u;
+		d->phase = FRAME_PH_DELTA;
+	} else {
+		d->need += 2u;
+		d->phase = FRAME_PH_CRC;
+	}
+}
+
+static int decode_frame(frame_decoder_t *d, frame_t *f){
+	const uint8_t *b = d->buf;
+	uint32_t pos = 11u;
+	uint32_t i;
+
+	if (frame_crc16(&b[2], d->len - 4u) != (uint16_t)(b[d->len - 2u] | (b[d->len - 1u] << 8)))
+		return 0;
+	f->seq = (uint16_t)(b[2] | (b[3] << 8));
+	f->nbr = b[4];
+	f->ts = (uint32_t)b[5] | ((uint32_t)b[6] << 8) | ((uint32_t)b[7] << 16) | ((uint32_t)b[8] << 24);
+	f->samples[0] = (uint16_t)(b[9] | (b[10] << 8));
+	for (i = 1u; i < f->nbr; i++){
+		if (b[pos] == FRAME_DELTA_ESC){
+			f->samples[i] = (uint16_t)(b[pos + 1u] | (b[pos + 2u] << 8));
+			pos += 3u;
+		} else {
+			f->samples[i] = (uint16_t)(f->samples[i - 1u] + (int8_t)b[pos]);
+			pos += 1u;
+		}
+	}
+	return 1;
+}
+
+// the bytes after a false sync may hold the start of the next frame: decode them again
+static void resync(frame_decoder_t *d, void (*on_frame)(const frame_t *f, void *arg), void *arg){
+	uint8_t  tmp[FRAME_SIZE_MAX];
+	uint32_t len = d->len - 1u;
+	uint32_t i;
+
+	memcpy(tmp, &d->buf[1], len);
+	d->skipped++;
+	d->len = 0u;
+	for (i = 0u; i < len; i++)
+		decode_byte(d, tmp[i], on_frame, arg);
+}
@@ -0,0 +1,88 @@
+/*
+*********************************************************************************************************
+*                                        SAMPLE STREAM FRAMES
+*
+* Frames carrying blocks of ADC readings over the serial port, all fields little endian:
+*
+*   sync   0xA5 0x5A
+*   seq    16 bit, +1 per frame, gaps are frames dropped by the sender
+*   nbr    8 bit, samples in the frame (1 .. FRAME_SAMPLES_MAX)
+*   ts     32 bit, cycle counter at the FTM0 trigger of the first sample
+*   first  16 bit, first sample
+*   deltas nbr - 1 differences from the previous sample: one signed byte in -127..127, otherwise 0x80
+*          followed by the 16 bit sample
+*   crc    CRC-16/CCITT-FALSE of seq .. deltas
+*
+* A slow input costs little more than one byte per sample. The decoder resynchronizes on the sync bytes,
+* so text printed on the same port in between frames is skipped.
+*********************************************************************************************************
+*/
+
+#ifndef  FRAME_MODULE_PRESENT
+#define  FRAME_MODULE_PRESENT
+
+#include  <stdint.h>
+
+/*
+*********************************************************************************************************
+*                                               DEFINES
+*********************************************************************************************************
+*/
+
+#define FRAME_SYNC0				0xA5u
+#define FRAME_SYNC1				0x5Au
+#define FRAME_DELTA_ESC			0x80u
+
+#define FRAME_SAMPLES_MAX		64u
+#define FRAME_HDR_SIZE			9u						// sync, seq, nbr, ts
+#define FRAME_SIZE_MAX			(FRAME_HDR_SIZE + 2u + (FRAME_SAMPLES_MAX - 1u) * 3u + 2u)
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+// one decoded frame
+typedef struct frame {
+	uint16_t	seq;
+	uint8_t		nbr;
+	uint32_t	ts;
+	uint16_t	samples[FRAME_SAMPLES_MAX];
+} frame_t;
+
+typedef struct frame_decoder {
+	uint8_t		buf[FRAME_SIZE_MAX];
+	uint32_t	len;									// bytes of the frame being received
+	uint32_t	need;									// bytes of the frame known so far to be needed
+	uint32_t	left;									// deltas not received yet
+	uint32_t	phase;
+	// statistics
+	uint32_t	frames;
+	uint32_t	crc_errors;
+	uint32_t	lost;									// frames missing from the sequence
+	uint32_t	skipped;								// bytes outside of frames
+	int32_t		last_seq;								// -1 before the first frame
+} frame_decoder_t;
+
+/*
+*********************************************************************************************************
+*                                         FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+uint16_t frame_crc16(const uint8_t *buf, uint32_t len);
+
+// encodes nbr samples (up to FRAME_SAMPLES_MAX) into buf, at least FRAME_SIZE_MAX bytes; returns the
+// frame length. stride is the distance in bytes between two samples, so readings can be taken straight
+// from an array of structures
+uint32_t frame_encode(uint8_t *buf, uint16_t seq, uint32_t ts, const uint16_t *samples, uint32_t stride,
+					  uint32_t nbr);
+
+void     frame_decoder_init(frame_decoder_t *d);
+
+// feeds bytes to the decoder, on_frame is called for every frame with a valid CRC
+void     frame_decode(frame_decoder_t *d, const uint8_t *buf, uint32_t len,
+					  void (*on_frame)(const frame_t *f, void *arg), void *arg);
+
+#endif
@@ -0,0 +1,170 @@
+/*
+*********************************************************************************************************
+*                                      HARDWARE ABSTRACTION LAYER
+*
+* Thin layer between the application and the K64F peripherals used by the battery alarm:
+* FTM0 (ADC0/ADC1 trigger), ADC0 and ADC1 (input reading), eDMA (ADC -> SRAM transfer, channel scan,
+* SRAM -> UART0 streaming, UART0 -> SRAM commands),
+* FTM1 (blink wave), the GPIO pins of the LEDs and the sectors of program flash of the journal log.
+* Two backends implement this interface:
+*  - hal_k64f.c      : register level implementation for the FRDM-K64F board
+*  - host/hal_sim.c  : Linux simulator modelling the same registers and the FTM0->ADC0->DMA trigger chain,
+*                      selected by defining APP_HOST_BUILD
+*********************************************************************************************************
+*/
+
+#ifndef  HAL_MODULE_PRESENT
+#define  HAL_MODULE_PRESENT
+
+#include  <stdint.h>
+
+/*
+*********************************************************************************************************
+*                                          GPIO IDENTIFIERS
+*********************************************************************************************************
+*/
+
+#ifdef  APP_HOST_BUILD
+// on the host the pins of gpio_pins.h/board.h are plain identifiers of the simulated GPIO
+enum hal_sim_pin {
+	kGpioLED1,
+	kGpioLED2,
+	kGpioLED3,
+	kGpioWave1Out,
+	kGpioAlarm1,										// alarm outputs of monitor.h
+	kGpioAlarm2,
+	kGpioAlarm3,
+	kGpioAlarm4,
+	kGpioAlarm5,
+	kGpioAlarm6,
+	kGpioAlarm7,
+	HAL_SIM_PIN_NBR
+};
+
+#define BOARD_GPIO_LED_GREEN	kGpioLED1
+#define BOARD_GPIO_LED_RED		kGpioLED2
+#define BOARD_GPIO_LED_BLUE		kGpioLED3
+#else
+#include  <cpu_core.h>
+#include  <os.h>
+#include  <board.h>
+#endif
+
+/*
+*********************************************************************************************************
+*                                     CRITICAL SECTIONS AND ISRS
+*
+* HAL_CRITICAL_ENTER/EXIT mask interrupts around a few register or variable updates from task context;
+* the kernel is not involved, so nothing is rescheduled on exit. An ISR that calls the kernel starts with
+* HAL_ISR_ENTER(), which only masks interrupts to increment the nesting counter, runs its body with them
+* enabled and ends with HAL_ISR_EXIT(), where OSIntExit() switches to the highest priority ready task.
+* An ISR that does not call the kernel needs neither.
+*********************************************************************************************************
+*/
+
+#ifdef  APP_HOST_BUILD
+#define HAL_SR_ALLOC()
+#define HAL_CRITICAL_ENTER()
+#define HAL_CRITICAL_EXIT()
+#define HAL_ISR_ENTER()
+#define HAL_ISR_EXIT()
+#else
+#define HAL_SR_ALLOC()			CPU_SR_ALLOC()
+#define HAL_CRITICAL_ENTER()	CPU_CRITICAL_ENTER()
+#define HAL_CRITICAL_EXIT()		CPU_CRITICAL_EXIT()
+#define HAL_ISR_ENTER()			do { CPU_SR_ALLOC(); CPU_CRITICAL_ENTER(); OSIntEnter(); CPU_CRITICAL_EXIT(); } while (0)
+#define HAL_ISR_EXIT()			OSIntExit()
+#endif
+
+/*
+*********************************************************************************************************
+*                                         FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+typedef void (*hal_isr_t)(void);
+
+// FTM0 triggers ADC0, every conversion is moved by the eDMA channel 0 into the next entry of ring
+// (len samples, wrapping), dma_isr runs each time a half of the ring is full
+void hal_ftm0_adc0_trigger_setup(volatile uint16_t *ring, uint32_t len, hal_isr_t dma_isr);
+void hal_dma_clear_int(void);
+
+// as above with nbr inputs on each of ADC0 and ADC1, converted in parallel at every FTM0 trigger: after
+// each conversion a linked eDMA channel writes the next input of the list in SC1A. The readings of the
+// two ADCs alternate in ring, input k of ADC0 then input k of ADC1; len is a multiple of 2 * nbr
+#define HAL_SCAN_MAX			8u						// inputs per ADC
+void hal_adc_scan_setup(volatile uint16_t *ring, uint32_t len, const uint8_t *adc0_ch, const uint8_t *adc1_ch,
+						uint32_t nbr, hal_isr_t dma_isr);
+
+// new FTM0 trigger period, (mod + 1) << ps bus cycles, counted from now
+void     hal_adc_trigger_rate(uint32_t ps, uint32_t mod);
+// core cycles between two FTM0 triggers
+uint32_t hal_adc_trigger_cycles(void);
+// frequency of hal_ts_get()
+uint32_t hal_ts_hz(void);
+// hal_ts_get() at the last FTM0 trigger, from the FTM0 counter (one prescaled tick of resolution)
+uint32_t hal_adc_trigger_ts(void);
+
+// conversion of ADC0 (and ADC1 for the scan), after the setup: the mean of 2^avg_log2 conversions per
+// trigger (0 for one, 2 to 5 for the hardware averaging of 4 to 32) and HAL_ADC_xx options. Each
+// conversion of the mean takes the full conversion time, the trigger period must leave room for them
+#define HAL_ADC_HSC				0x01u					// high speed sequence, 2 more ADCK, for ADCK above 8 MHz
+#define HAL_ADC_LPC				0x02u					// low power, lower maximum ADCK
+#define HAL_ADC_LSMP			0x04u					// long sample time, 20 more ADCK, for high impedance sources
+#define HAL_ADC_DIV(log2)		((log2) << 4)			// ADCK = bus clock / 2^log2, 0 to 3
+void hal_adc_config(uint32_t avg_log2, uint32_t opts);
+
+// ADC0 compare function: only readings outside [lo, hi] complete and reach the DMA
+void hal_adc0_compare_set(uint16_t lo, uint16_t hi);
+void hal_adc0_compare_off(void);
+
+// UART0 at baud with its TX fed by the eDMA channel 1, one buffer at a time
+void hal_uart_dma_setup(uint32_t baud);
+void hal_uart_dma_send(const uint8_t *buf, uint32_t len);
+int  hal_uart_dma_busy(void);
+
+// UART0 RX of the BSP_Ser port moved by the eDMA channel 7 into ring (len bytes, a power of 2 up to
+// 0x4000, wrapping) without interrupts; hal_uart_rx_head() is the index of the next byte it writes. A
+// byte transfer has priority over the ADC channels and delays them by one minor loop at most
+void     hal_uart_rx_dma_setup(volatile uint8_t *ring, uint32_t len);
+uint32_t hal_uart_rx_head(void);
+
+// FTM1 overflow generates the blink wave, ftm1_isr runs at every overflow
+void hal_ftm1_setup(hal_isr_t ftm1_isr);
+// as above without interrupts: at every overflow the FTM1 channel 0 match requests the eDMA channel 5,
+// which toggles led_pin through its GPIO PTOR and starts channel 6 for wave_pin
+void hal_ftm1_dma_setup(uint32_t led_pin, uint32_t wave_pin);
+// pin toggled by the channel 5 from the next overflow on, no effect after hal_ftm1_setup()
+void hal_ftm1_dma_led(uint32_t led_pin);
+void hal_ftm1_start(uint16_t mod);
+void hal_ftm1_stop(void);
+void hal_ftm1_clear_int(void);
+
+// program flash, erased by sector and programmed by phrase: a phrase is programmed once between two erases
+// of its sector. Both busy-wait for the flash controller, tens of microseconds per phrase and tens of
+// milliseconds per sector, so they are called from AppReportTask, never from AppTask or an ISR. addr is
+// aligned on its unit and len a multiple of HAL_FLASH_PHRASE; return 0 on success
+#define HAL_FLASH_SECTOR		4096u
+#define HAL_FLASH_PHRASE		8u
+int  hal_flash_erase(uint32_t addr);
+int  hal_flash_program(uint32_t addr, const void *data, uint32_t len);
+void hal_flash_read(uint32_t addr, void *data, uint32_t len);
+
+// free running core cycle counter (DWT CYCCNT through CPU_TS on the board)
+#ifdef  APP_HOST_BUILD
+uint32_t hal_ts_get(void);
+#else
+#define hal_ts_get()			((uint32_t)CPU_TS_TmrRd())
+#endif
+
+#ifdef  APP_HOST_BUILD
+void hal_gpio_set(uint32_t pin);
+void hal_gpio_clear(uint32_t pin);
+void hal_gpio_toggle(uint32_t pin);
+#else
+#define hal_gpio_set(pin)		GPIO_DRV_SetPinOutput(pin)
+#define hal_gpio_clear(pin)		GPIO_DRV_ClearPinOutput(pin)
+#define hal_gpio_toggle(pin)	GPIO_DRV_TogglePinOutput(pin)
+#endif
+
+#endif
@@ -0,0 +1,482 @@
+/*
+*********************************************************************************************************
+* FRDM-K64F backend of the hardware abstraction layer (see hal.h).
+* FTM0 used for triggering ADC0
+* ADC0 used for analog input reading, with ADC1 for the channel scan
+* FTM1 used for output wave generation
+* eDMA used for fast and deterministic transfer of data between ADC0 and SRAM, and of the bytes received
+* by UART0
+* FTFE used, through the flash driver of the KSDK, for the journal log in the second program flash block
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <hal.h>
+#include  <app_cfg.h>
+
+#include  <string.h>
+#include  <system_MK64F12.h>
+
+#include "fsl_interrupt_manager.h"
+#include "fsl_gpio_common.h"
+#include "fsl_gpio_driver.h"
+#include "SSD_FTFx.h"
+
+/*
+*********************************************************************************************************
+*                                            LOCAL DEFINES
+*********************************************************************************************************
+*/
+
+#define HAL_CORE_PER_BUS		2u						// 120MHz core, 60MHz bus clock of the FlexTimers
+
+// eDMA channels of the scan, 1 is the UART TX; channel 0 has the lowest priority (reset values), so when
+// both ADCs complete at once the reading of ADC1 is written before the interrupt of channel 0
+#define HAL_DMA_ADC0			0u
+#define HAL_DMA_ADC0_MUX		2u
+#define HAL_DMA_ADC1			3u
+#define HAL_DMA_ADC1_MUX		4u
+
+// eDMA channels of the blink toggles, FTM1 channel 0 is the request source 28
+#define HAL_DMA_BLINK_LED		5u
+#define HAL_DMA_BLINK_WAVE		6u
+
+// eDMA channel of the console, UART0 receive is the request source 2
+#define HAL_DMA_UART_RX			7u
+
+/*
+*********************************************************************************************************
+*                                       LOCAL GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+// SC1A values written by the linked channels, rotated by one: the entry for the input after the one
+// just converted comes first
+static uint32_t			scan_sc1[2][HAL_SCAN_MAX];
+
+// PTOR values written by the blink channels, LED then wave
+static uint32_t			blink_ptor[2];
+
+// FTM1 overflow interrupt, off when the eDMA toggles the pins
+static uint32_t			ftm1_sc_ie = FTM_SC_TOIE_MASK;
+
+// bytes of the console ring
+static uint32_t			uart_rx_len;
+
+// program flash only, no FlexNVM on the MK64FN1M0
+static FLASH_SSD_CONFIG	flash_ssd = {
+	FTFx_REG_BASE, P_FLASH_BASE, P_FLASH_SIZE, FLEXNVM_BASE, 0u, EERAM_BASE, 0u, DEBUGENABLE, NULL_CALLBACK
+};
+static uint32_t			flash_ready;
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static void ftm0_trigger_start(void);
+static void ftm1_timer_init(void);
+static int  flash_init(void);
+static int  flash_done(uint32_t ret);
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+void hal_ftm0_adc0_trigger_setup(volatile uint16_t *ring, uint32_t len, hal_isr_t dma_isr){
+	INT_SYS_EnableIRQ(DMA0_IRQn);							// enable interrupts of eDMA module
+	INT_SYS_InstallHandler(DMA0_IRQn, dma_isr);				// install routine for interrupt
+
+	SIM_SCGC6 |= SIM_SCGC6_DMAMUX_MASK;						// enable DMAMUX module
+	SIM_SCGC7 |= SIM_SCGC7_DMA_MASK;						// enable eDMA module
+	DMAMUX_CHCFG0 = (DMAMUX_CHCFG_ENBL_MASK|DMAMUX_CHCFG_SOURCE(40));
+															// route ADC0 DMA request to channel 0 of eDMA
+	DMA_CR = (DMA_CR_EDBG_MASK);							// enable debug
+															// word is 32bit NBYTES
+	DMA_ERQ |= (DMA_ERQ_ERQ0_MASK);							// enable DMA requests on channel 0
+	DMA_DCHPRI0 = ((uint32_t) (0));							// static priority
+	DMA_TCD0_CSR = (DMA_CSR_INTMAJOR_MASK|DMA_CSR_INTHALF_MASK);
+															// generate interrupt after half and full major cycle
+	DMA_TCD0_SADDR = DMA_SADDR_SADDR(&ADC0_RA);				// set source address i.e. ADC0 register A,
+															// where the reading is stored
+	DMA_TCD0_SOFF = DMA_SOFF_SOFF(0);						// no offset
+	DMA_TCD0_DADDR = DMA_DADDR_DADDR(ring);					// set destination address in SRAM: the ring
+	DMA_TCD0_DOFF = DMA_DOFF_DOFF(sizeof(uint16_t));		// next entry of the ring after each sample
+	DMA_TCD0_ATTR = (DMA_ATTR_SSIZE(1)|DMA_ATTR_DSIZE(1)|
+					 DMA_ATTR_SMOD(0)|DMA_ATTR_DMOD(0));	// 16b read and write, disable modulo function
+	DMA_TCD0_NBYTES_MLNO = 2;								// 16bits minor cycle
+	DMA_TCD0_SLAST = 0;										// do not correct source address after major cycle
+	DMA_TCD0_CITER_ELINKNO = len;							// number of major cycles
+	DMA_TCD0_BITER_ELINKNO = len;							// initial count of major cycles
+	DMA_TCD0_DLASTSGA = (uint32_t)(-(int32_t)(len * sizeof(uint16_t)));
+															// back to the beginning of the ring after major cycle
+
+	SIM_SCGC6 |= SIM_SCGC6_ADC0_MASK;						// enable ADC0
+	SIM_SOPT7 |= (SIM_SOPT7_ADC0TRGSEL(8)|SIM_SOPT7_ADC0ALTTRGEN_MASK);
+															// ADC0 trigger source: FTM0
+	ADC0_SC2 = (ADC_SC2_ADTRG_MASK|ADC_SC2_DMAEN_MASK);		// ADC0 enable hardware triggers and DMA requests after
+															// conversion
+	ADC0_SC1A = ADC_SC1_ADCH(0xC);							// enable conversion on selected channel
+	ADC0_CFG1 = ADC_CFG1_MODE(3);							// single ended 16B
+
+	ftm0_trigger_start();
+}
+
+void hal_adc_scan_setup(volatile uint16_t *ring, uint32_t len, const uint8_t *adc0_ch, const uint8_t *adc1_ch,
+						uint32_t nbr, hal_isr_t dma_isr){
+	uint32_t per_adc = len / 2u;							// readings of each ADC in the ring
+	uint32_t k;
+
+	for (k = 0u; k < nbr; k++){
+		scan_sc1[0][k] = ADC_SC1_ADCH(adc0_ch[(k + 1u) % nbr]);
+		scan_sc1[1][k] = ADC_SC1_ADCH(adc1_ch[(k + 1u) % nbr]);
+	}
+
+	INT_SYS_EnableIRQ(DMA0_IRQn);
+	INT_SYS_InstallHandler(DMA0_IRQn, dma_isr);
+
+	SIM_SCGC6 |= SIM_SCGC6_DMAMUX_MASK;
+	SIM_SCGC7 |= SIM_SCGC7_DMA_MASK;
+	DMAMUX_CHCFG0 = (DMAMUX_CHCFG_ENBL_MASK|DMAMUX_CHCFG_SOURCE(40));
+															// ADC0 request to channel 0
+	DMAMUX_CHCFG3 = (DMAMUX_CHCFG_ENBL_MASK|DMAMUX_CHCFG_SOURCE(41));
+															// ADC1 request to channel 3
+	DMA_CR = (DMA_CR_EDBG_MASK);
+
+	// ADC0 result -> even entries of the ring, then link to the SC1A writer; the interrupts of the
+	// halves are raised here
+	DMA_TCD0_SADDR = DMA_SADDR_SADDR(&ADC0_RA);
+	DMA_TCD0_SOFF = DMA_SOFF_SOFF(0);
+	DMA_TCD0_DADDR = DMA_DADDR_DADDR(ring);
+	DMA_TCD0_DOFF = DMA_DOFF_DOFF(2u * sizeof(uint16_t));	// skip the entry of ADC1
+	DMA_TCD0_ATTR = (DMA_ATTR_SSIZE(1)|DMA_ATTR_DSIZE(1));
+	DMA_TCD0_NBYTES_MLNO = 2;
+	DMA_TCD0_SLAST = 0;
+	DMA_TCD0_CITER_ELINKYES = (DMA_CITER_ELINKYES_ELINK_MASK|DMA_CITER_ELINKYES_LINKCH(HAL_DMA_ADC0_MUX)|
+							   DMA_CITER_ELINKYES_CITER(per_adc));
+	DMA_TCD0_BITER_ELINKYES = (DMA_BITER_ELINKYES_ELINK_MASK|DMA_BITER_ELINKYES_LINKCH(HAL_DMA_ADC0_MUX)|
+							   DMA_BITER_ELINKYES_BITER(per_adc));
+	DMA_TCD0_DLASTSGA = (uint32_t)(-(int32_t)(len * sizeof(uint16_t)));
+	DMA_TCD0_CSR = (DMA_CSR_INTMAJOR_MASK|DMA_CSR_INTHALF_MASK|DMA_CSR_MAJORELINK_MASK|
+					DMA_CSR_MAJORLINKCH(HAL_DMA_ADC0_MUX));	// the last minor loop links through the major link
+
+	// next input of ADC0, one 32 bit SC1A write per link, wrapping over the list
+	DMA_TCD2_SADDR = DMA_SADDR_SADDR(scan_sc1[0]);
+	DMA_TCD2_SOFF = DMA_SOFF_SOFF(sizeof(uint32_t));
+	DMA_TCD2_DADDR = DMA_DADDR_DADDR(&ADC0_SC1A);
+	DMA_TCD2_DOFF = DMA_DOFF_DOFF(0);
+	DMA_TCD2_ATTR = (DMA_ATTR_SSIZE(2)|DMA_ATTR_DSIZE(2));
+	DMA_TCD2_NBYTES_MLNO = 4;
+	DMA_TCD2_SLAST = (uint32_t)(-(int32_t)(nbr * sizeof(uint32_t)));
+	DMA_TCD2_CITER_ELINKNO = nbr;
+	DMA_TCD2_BITER_ELINKNO = nbr;
+	DMA_TCD2_DLASTSGA = 0;
+	DMA_TCD2_CSR = 0;
+
+	// same pair for ADC1, odd entries of the ring
+	DMA_TCD3_SADDR = DMA_SADDR_SADDR(&ADC1_RA);
+	DMA_TCD3_SOFF = DMA_SOFF_SOFF(0);
+	DMA_TCD3_DADDR = DMA_DADDR_DADDR(ring + 1);
+	DMA_TCD3_DOFF = DMA_DOFF_DOFF(2u * sizeof(uint16_t));
+	DMA_TCD3_ATTR = (DMA_ATTR_SSIZE(1)|DMA_ATTR_DSIZE(1));
+	DMA_TCD3_NBYTES_MLNO = 2;
+	DMA_TCD3_SLAST = 0;
+	DMA_TCD3_CITER_ELINKYES = (DMA_CITER_ELINKYES_ELINK_MASK|DMA_CITER_ELINKYES_LINKCH(HAL_DMA_ADC1_MUX)|
+							   DMA_CITER_ELINKYES_CITER(per_adc));
+	DMA_TCD3_BITER_ELINKYES = (DMA_BITER_ELINKYES_ELINK_MASK|DMA_BITER_ELINKYES_LINKCH(HAL_DMA_ADC1_MUX)|
+							   DMA_BITER_ELINKYES_BITER(per_adc));
+	DMA_TCD3_DLASTSGA = (uint32_t)(-(int32_t)(len * sizeof(uint16_t)));
+	DMA_TCD3_CSR = (DMA_CSR_MAJORELINK_MASK|DMA_CSR_MAJORLINKCH(HAL_DMA_ADC1_MUX));
+
+	DMA_TCD4_SADDR = DMA_SADDR_SADDR(scan_sc1[1]);
+	DMA_TCD4_SOFF = DMA_SOFF_SOFF(sizeof(uint32_t));
+	DMA_TCD4_DADDR = DMA_DADDR_DADDR(&ADC1_SC1A);
+	DMA_TCD4_DOFF = DMA_DOFF_DOFF(0);
+	DMA_TCD4_ATTR = (DMA_ATTR_SSIZE(2)|DMA_ATTR_DSIZE(2));
+	DMA_TCD4_NBYTES_MLNO = 4;
+	DMA_TCD4_SLAST = (uint32_t)(-(int32_t)(nbr * sizeof(uint32_t)));
+	DMA_TCD4_CITER_ELINKNO = nbr;
+	DMA_TCD4_BITER_ELINKNO = nbr;
+	DMA_TCD4_DLASTSGA = 0;
+	DMA_TCD4_CSR = 0;
+
+	DMA_ERQ |= (DMA_ERQ_ERQ0_MASK|DMA_ERQ_ERQ3_MASK);		// the SC1A writers only run when linked
+
+	// both ADCs on the FTM0 trigger, the first input of each list selected; writing SC1A with ADTRG set
+	// does not start a conversion, it only selects the input of the next trigger
+	SIM_SCGC6 |= SIM_SCGC6_ADC0_MASK;
+	SIM_SCGC3 |= SIM_SCGC3_ADC1_MASK;
+	SIM_SOPT7 |= (SIM_SOPT7_ADC0TRGSEL(8)|SIM_SOPT7_ADC0ALTTRGEN_MASK|
+				  SIM_SOPT7_ADC1TRGSEL(8)|SIM_SOPT7_ADC1ALTTRGEN_MASK);
+	ADC0_SC2 = (ADC_SC2_ADTRG_MASK|ADC_SC2_DMAEN_MASK);
+	ADC1_SC2 = (ADC_SC2_ADTRG_MASK|ADC_SC2_DMAEN_MASK);
+	ADC0_CFG1 = ADC_CFG1_MODE(3);
+	ADC1_CFG1 = ADC_CFG1_MODE(3);
+	ADC0_CFG2 = ADC_CFG2_MUXSEL_MASK;						// "b" pins for inputs 4 to 7
+	ADC1_CFG2 = ADC_CFG2_MUXSEL_MASK;
+	ADC0_SC1A = ADC_SC1_ADCH(adc0_ch[0]);
+	ADC1_SC1A = ADC_SC1_ADCH(adc1_ch[0]);
+
+	ftm0_trigger_start();
+}
+
+void hal_dma_clear_int(void){
+	// allow other DMA requests
+	DMA_CINT = DMA_CINT_CINT(0);
+}
+
+void hal_adc_trigger_rate(uint32_t ps, uint32_t mod){
+	FTM0_SC = 0u;											// MOD is written at once with the clock stopped
+	FTM0_MOD = FTM_MOD_MOD(mod);
+	FTM0_CNT = 0u;											// any write reloads CNTIN
+	FTM0_SC = (FTM_SC_PS(ps)|FTM_SC_CLKS(0x1));
+}
+
+uint32_t hal_adc_trigger_cycles(void){
+	return ((FTM0_MOD - FTM0_CNTIN + 1u) << (FTM0_SC & FTM_SC_PS_MASK)) * HAL_CORE_PER_BUS;
+}
+
+uint32_t hal_ts_hz(void){
+	return SystemCoreClock;
+}
+
+uint32_t hal_adc_trigger_ts(void){
+	uint32_t ts = hal_ts_get();
+	uint32_t ticks = (FTM0_CNT - FTM0_CNTIN) << (FTM0_SC & FTM_SC_PS_MASK);
+
+	return ts - ticks * HAL_CORE_PER_BUS;
+}
+
+void hal_adc_config(uint32_t avg_log2, uint32_t opts){
+	uint32_t cfg1 = (ADC_CFG1_MODE(3)|ADC_CFG1_ADIV((opts >> 4) & 0x3u));
+	uint32_t hsc = (opts & HAL_ADC_HSC) ? ADC_CFG2_ADHSC_MASK : 0u;
+	uint32_t sc3 = avg_log2 >= 2u ? (ADC_SC3_AVGE_MASK|ADC_SC3_AVGS(avg_log2 - 2u)) : 0u;
+
+	if (opts & HAL_ADC_LPC)
+		cfg1 |= ADC_CFG1_ADLPC_MASK;
+	if (opts & HAL_ADC_LSMP)
+		cfg1 |= ADC_CFG1_ADLSMP_MASK;						// ADLSTS = 0: 20 more ADCK
+	ADC0_CFG1 = cfg1;
+	ADC0_CFG2 = ((ADC0_CFG2 & ADC_CFG2_MUXSEL_MASK)|hsc);
+	ADC0_SC3 = sc3;											// one COCO, one DMA request per mean
+	// ADC1 only when the scan has clocked it
+	if (SIM_SCGC3 & SIM_SCGC3_ADC1_MASK){
+		ADC1_CFG1 = cfg1;
+		ADC1_CFG2 = ((ADC1_CFG2 & ADC_CFG2_MUXSEL_MASK)|hsc);
+		ADC1_SC3 = sc3;
+	}
+}
+
+void hal_adc0_compare_set(uint16_t lo, uint16_t hi){
+	ADC0_CV1 = lo;											// with ACFGT = 0 and CV1 <= CV2 the compare is true
+	ADC0_CV2 = hi;											// for result < CV1 or result > CV2
+	ADC0_SC2 = (ADC_SC2_ADTRG_MASK|ADC_SC2_DMAEN_MASK|ADC_SC2_ACFE_MASK|ADC_SC2_ACREN_MASK);
+}
+
+void hal_adc0_compare_off(void){
+	ADC0_SC2 = (ADC_SC2_ADTRG_MASK|ADC_SC2_DMAEN_MASK);
+}
+
+void hal_uart_dma_setup(uint32_t baud){
+	// UART0 is clocked by the core clock: baud = clk / (16 * (SBR + BRFA / 32))
+	uint32_t div = (2u * SystemCoreClock + baud / 2u) / baud;
+	uint32_t sbr = div >> 5;
+
+	SIM_SCGC4 |= SIM_SCGC4_UART0_MASK;
+	UART0_C2 &= ~(UART_C2_TE_MASK|UART_C2_RE_MASK);			// baud rate is changed with TX and RX off
+	UART0_BDH = (UART0_BDH & ~UART_BDH_SBR_MASK)|UART_BDH_SBR(sbr >> 8);
+	UART0_BDL = UART_BDL_SBR(sbr);
+	UART0_C4 = (UART0_C4 & ~UART_C4_BRFA_MASK)|UART_C4_BRFA(div & 0x1Fu);
+	UART0_C5 |= UART_C5_TDMAS_MASK;							// TDRE raises DMA requests instead of interrupts
+	UART0_C2 |= (UART_C2_TIE_MASK|UART_C2_TE_MASK|UART_C2_RE_MASK);
+
+	DMAMUX_CHCFG1 = (DMAMUX_CHCFG_ENBL_MASK|DMAMUX_CHCFG_SOURCE(3));
+															// route UART0 transmit request to channel 1
+	DMA_TCD1_SOFF = DMA_SOFF_SOFF(1);						// next byte of the frame
+	DMA_TCD1_DADDR = DMA_DADDR_DADDR(&UART0_D);				// always the data register
+	DMA_TCD1_DOFF = DMA_DOFF_DOFF(0);
+	DMA_TCD1_ATTR = (DMA_ATTR_SSIZE(0)|DMA_ATTR_DSIZE(0));	// 8b read and write
+	DMA_TCD1_NBYTES_MLNO = 1;								// one byte per request
+	DMA_TCD1_SLAST = 0;
+	DMA_TCD1_DLASTSGA = 0;
+	DMA_TCD1_CSR = DMA_CSR_DREQ_MASK;						// requests off at the end of the frame
+}
+
+void hal_uart_dma_send(const uint8_t *buf, uint32_t len){
+	DMA_CDNE = DMA_CDNE_CDNE(1);
+	DMA_TCD1_SADDR = DMA_SADDR_SADDR(buf);
+	DMA_TCD1_CITER_ELINKNO = len;
+	DMA_TCD1_BITER_ELINKNO = len;
+	DMA_SERQ = DMA_SERQ_SERQ(1);
+}
+
+int hal_uart_dma_busy(void){
+	return (DMA_ERQ & DMA_ERQ_ERQ1_MASK) != 0u;
+}
+
+void hal_uart_rx_dma_setup(volatile uint8_t *ring, uint32_t len){
+	uart_rx_len = len;
+
+	SIM_SCGC6 |= SIM_SCGC6_DMAMUX_MASK;
+	SIM_SCGC7 |= SIM_SCGC7_DMA_MASK;
+	DMA_TCD7_SADDR = DMA_SADDR_SADDR(&UART0_D);				// always the data register
+	DMA_TCD7_SOFF = DMA_SOFF_SOFF(0);
+	DMA_TCD7_DADDR = DMA_DADDR_DADDR(ring);
+	DMA_TCD7_DOFF = DMA_DOFF_DOFF(1);						// next byte of the ring
+	DMA_TCD7_ATTR = (DMA_ATTR_SSIZE(0)|DMA_ATTR_DSIZE(0));	// 8b read and write
+	DMA_TCD7_NBYTES_MLNO = 1;								// one byte per request
+	DMA_TCD7_SLAST = 0;
+	DMA_TCD7_CITER_ELINKNO = len;
+	DMA_TCD7_BITER_ELINKNO = len;
+	DMA_TCD7_DLASTSGA = (uint32_t)(-(int32_t)len);			// back to the beginning of the ring
+	DMA_TCD7_CSR = 0;										// no interrupt, requests stay on at the end
+	DMAMUX_CHCFG7 = (DMAMUX_CHCFG_ENBL_MASK|DMAMUX_CHCFG_SOURCE(2));
+															// route UART0 receive request to channel 7
+	DMA_SERQ = DMA_SERQ_SERQ(HAL_DMA_UART_RX);
+
+	// RDRF raises DMA requests instead of the receive interrupt of BSP_Ser
+	UART0_C5 |= UART_C5_RDMAS_MASK;
+	UART0_C2 |= (UART_C2_RIE_MASK|UART_C2_RE_MASK);
+}
+
+uint32_t hal_uart_rx_head(void){
+	// CITER is reloaded from BITER in the same write back as DADDR at the end of the ring
+	return uart_rx_len - DMA_TCD7_CITER_ELINKNO;
+}
+
+void hal_ftm1_setup(hal_isr_t ftm1_isr){
+	INT_SYS_EnableIRQ(FTM1_IRQn);
+	INT_SYS_InstallHandler(FTM1_IRQn, ftm1_isr);
+	ftm1_timer_init();
+}
+
+void hal_ftm1_dma_setup(uint32_t led_pin, uint32_t wave_pin){
+	ftm1_timer_init();
+	ftm1_sc_ie = 0u;
+	FTM1_C0V = 0u;											// match at every reload of the counter
+	FTM1_C0SC = (FTM_CnSC_MSA_MASK|FTM_CnSC_ELSA_MASK|FTM_CnSC_CHIE_MASK|FTM_CnSC_DMA_MASK);
+															// output compare, DMA request instead of interrupt
+	SIM_SCGC6 |= SIM_SCGC6_DMAMUX_MASK;
+	SIM_SCGC7 |= SIM_SCGC7_DMA_MASK;
+
+	// one 32 bit write per request, same source and destination every time
+	blink_ptor[1] = 1u << GPIO_EXTRACT_PIN(wave_pin);
+	DMA_TCD6_SADDR = DMA_SADDR_SADDR(&blink_ptor[1]);
+	DMA_TCD6_SOFF = DMA_SOFF_SOFF(0);
+	DMA_TCD6_DADDR = DMA_DADDR_DADDR(&GPIO_PTOR_REG(g_gpioBase[GPIO_EXTRACT_PORT(wave_pin)]));
+	DMA_TCD6_DOFF = DMA_DOFF_DOFF(0);
+	DMA_TCD6_ATTR = (DMA_ATTR_SSIZE(2)|DMA_ATTR_DSIZE(2));
+	DMA_TCD6_NBYTES_MLNO = 4;
+	DMA_TCD6_SLAST = 0;
+	DMA_TCD6_DLASTSGA = 0;
+	DMA_TCD6_CITER_ELINKNO = 1;
+	DMA_TCD6_BITER_ELINKNO = 1;
+	DMA_TCD6_CSR = 0;
+
+	DMA_TCD5_SADDR = DMA_SADDR_SADDR(&blink_ptor[0]);
+	DMA_TCD5_SOFF = DMA_SOFF_SOFF(0);
+	DMA_TCD5_DOFF = DMA_DOFF_DOFF(0);
+	DMA_TCD5_ATTR = (DMA_ATTR_SSIZE(2)|DMA_ATTR_DSIZE(2));
+	DMA_TCD5_NBYTES_MLNO = 4;
+	DMA_TCD5_SLAST = 0;
+	DMA_TCD5_DLASTSGA = 0;
+	DMA_TCD5_CITER_ELINKNO = 1;
+	DMA_TCD5_BITER_ELINKNO = 1;
+	DMA_TCD5_CSR = (DMA_CSR_MAJORELINK_MASK|DMA_CSR_MAJORLINKCH(HAL_DMA_BLINK_WAVE));
+	blink_ptor[0] = 1u << GPIO_EXTRACT_PIN(led_pin);
+	DMA_TCD5_DADDR = DMA_DADDR_DADDR(&GPIO_PTOR_REG(g_gpioBase[GPIO_EXTRACT_PORT(led_pin)]));
+
+	DMAMUX_CHCFG5 = (DMAMUX_CHCFG_ENBL_MASK|DMAMUX_CHCFG_SOURCE(28));
+	DMA_SERQ = DMA_SERQ_SERQ(HAL_DMA_BLINK_LED);
+}
+
+void hal_ftm1_dma_led(uint32_t led_pin){
+	if (ftm1_sc_ie)
+		return;
+	// mask and port change together: a request in between stays pending in the FTM until SERQ
+	DMA_CERQ = DMA_CERQ_CERQ(HAL_DMA_BLINK_LED);
+	blink_ptor[0] = 1u << GPIO_EXTRACT_PIN(led_pin);
+	DMA_TCD5_DADDR = DMA_DADDR_DADDR(&GPIO_PTOR_REG(g_gpioBase[GPIO_EXTRACT_PORT(led_pin)]));
+	DMA_SERQ = DMA_SERQ_SERQ(HAL_DMA_BLINK_LED);
+}
+
+void hal_ftm1_start(uint16_t mod){
+	FTM1_MOD = FTM_MOD_MOD(mod);
+	FTM1_SYNC |= (FTM_SYNC_SWSYNC_MASK|FTM_SYNC_REINIT_MASK);
+	FTM1_SC  = (FTM_SC_PS(7)|FTM_SC_CLKS(0x1)|ftm1_sc_ie);
+}
+
+void hal_ftm1_stop(void){
+	FTM1_SC  &= FTM_SC_CLKS(0x0);
+}
+
+void hal_ftm1_clear_int(void){
+	// assuming that FMT1 has overflown, unique source of interrupts
+	FTM1_SC &= 0x7F;
+}
+
+// the log is in the second block and this code in the first, which the core keeps reading while the
+// controller works: FlashCommandSequence() needs no copy to RAM
+int hal_flash_erase(uint32_t addr){
+	if (flash_init() != 0)
+		return -1;
+	return flash_done(FlashEraseSector(&flash_ssd, addr, HAL_FLASH_SECTOR, FlashCommandSequence));
+}
+
+int hal_flash_program(uint32_t addr, const void *data, uint32_t len){
+	if (flash_init() != 0)
+		return -1;
+	return flash_done(FlashProgram(&flash_ssd, addr, len, (uint8_t *)data, FlashCommandSequence));
+}
+
+void hal_flash_read(uint32_t addr, void *data, uint32_t len){
+	memcpy(data, (const void *)(uintptr_t)addr, len);
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+static void ftm0_trigger_start(void){
+	SIM_SCGC6 |= SIM_SCGC6_FTM0_MASK;						// enable FTM0
+	FTM0_CONF = 0xC0; 										// set the timer in Debug mode, with BDM mode = 0xC0
+	FTM0_FMS =  0x0;										// enable modifications to the FTM0 configuration
+	FTM0_MODE |= (FTM_MODE_WPDIS_MASK|FTM_MODE_FTMEN_MASK);	// allowing writing in the registers
+	FTM0_CNTIN = FTM_CNTIN_INIT(0);							// initial value of 16 bit counter
+	FTM0_MOD = FTM_MOD_MOD(APP_CFG_ADC_TRIG_MOD);			// module of the count, sets the sampling rate
+	FTM0_EXTTRIG |= FTM_EXTTRIG_INITTRIGEN_MASK;			// enable hw trigger on init count
+	FTM0_SC = (FTM_SC_PS(APP_CFG_ADC_TRIG_PS)|FTM_SC_CLKS(0x1));
+															// enable FTM0 with prescaler 2^APP_CFG_ADC_TRIG_PS
+}
+
+static void ftm1_timer_init(void){
+    SIM_SCGC6 |= SIM_SCGC6_FTM1_MASK;
+    FTM1_CONF = 0xC0;
+    FTM1_FMS =  0x0;
+    FTM1_MODE |= (FTM_MODE_WPDIS_MASK|FTM_MODE_FTMEN_MASK);
+    FTM1_CNTIN = FTM_CNTIN_INIT(0);
+    FTM1_SYNCONF |= (FTM_SYNCONF_SWWRBUF_MASK|FTM_SYNCONF_SWRSTCNT_MASK);
+}
+
+static int flash_init(void){
+	if (!flash_ready)
+		flash_ready = FlashInit(&flash_ssd) == FTFx_OK;
+	return flash_ready ? 0 : -1;
+}
+
+// the flash memory controller caches and prefetches the old contents of the block
+static int flash_done(uint32_t ret){
+	FMC_PFB0CR |= FMC_PFB0CR_CINV_WAY_MASK;
+	FMC_PFB1CR |= FMC_PFB1CR_S_B_INV_MASK;
+	return ret == FTFx_OK ? 0 : -1;
+}
@@ -0,0 +1,316 @@
+/*
+*********************************************************************************************************
+* Compressed history of the readings (see history.h).
+* Values wait in pend[] until a group of HISTORY_GROUP is complete; the group is then sized before any bit
+* is written, and if it does not fit in the chunk any more the chunk is closed without it and the next one
+* starts from its first value. Bits are written most significant first through a 32 bit accumulator that
+* never holds more than 7 bits between two writes, so up to 24 bits go in at once.
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <string.h>
+
+#include  <history.h>
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static void history_value(history_t *h, uint16_t v, uint32_t period);
+static void chunk_start(history_t *h, uint16_t first, uint64_t cycles, uint32_t period);
+static void chunk_carry(history_t *h);
+static void chunk_close(history_t *h);
+static int  group_put(history_t *h);
+
+static inline void bits_put(history_t *h, uint32_t v, uint32_t len){
+	h->acc = (h->acc << len) | v;
+	h->nacc += len;
+	while (h->nacc >= 8u){
+		h->nacc -= 8u;
+		h->cur.data[h->pos++] = (uint8_t)(h->acc >> h->nacc);
+	}
+}
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+void history_init(history_t *h, history_hdr_t *img, uint32_t chunk_nbr, uint32_t ts_hz, uint32_t avg_log2){
+	memset(h, 0, sizeof(*h));
+	memset(img, 0, sizeof(*img));
+	img->magic = HISTORY_MAGIC;
+	img->version = HISTORY_VERSION;
+	img->hdr_size = sizeof(history_hdr_t);
+	img->chunk_size = sizeof(history_chunk_t);
+	img->chunk_nbr = chunk_nbr;
+	img->ts_hz = ts_hz;
+	img->avg_log2 = avg_log2 < HISTORY_AVG_LOG2_MAX ? avg_log2 : HISTORY_AVG_LOG2_MAX;
+	h->img = img;
+	h->ring = (history_chunk_t *)((uint8_t *)img + img->hdr_size);
+}
+
+void history_add(history_t *h, const spsc_sample_t *s, uint32_t n, uint32_t period){
+	uint32_t log2 = h->img->avg_log2;
+	uint32_t i;
+
+	for (i = 0u; i < n; i++){
+		// time of the last reading of the value, the counter wraps in 35 s at 120 MHz
+		h->cycles += h->started ? (uint32_t)(s[i].ts - h->last_ts) : 0u;
+		h->started = 1u;
+		h->last_ts = s[i].ts;
+		h->sum += s[i].code;
+		if (++h->nsum < (1u << log2))
+			continue;
+		history_value(h, (uint16_t)((h->sum + ((1u << log2) >> 1)) >> log2), period << log2);
+		h->sum = 0u;
+		h->nsum = 0u;
+	}
+	h->readings += n;
+}
+
+void history_flush(history_t *h){
+	if (h->cur.nbr == 0u)
+		return;
+	if (h->npend > 0u && group_put(h) != 0){
+		// the rest of the group fits in an empty chunk
+		chunk_carry(h);
+		if (h->npend > 0u)
+			(void)group_put(h);
+	}
+	chunk_close(h);
+}
+
+int history_read(const history_hdr_t *img, uint32_t seq, history_chunk_t *out){
+	const history_chunk_t *ring = (const history_chunk_t *)((const uint8_t *)img + img->hdr_size);
+	uint32_t head = __atomic_load_n(&img->head, __ATOMIC_ACQUIRE);
+
+	if (seq >= head || head - seq > img->chunk_nbr)
+		return HISTORY_ERR_SEQ;
+	memcpy(out, &ring[seq % img->chunk_nbr], sizeof(*out));
+	// the writer preempts the copy only to close a whole chunk: head is past seq + chunk_nbr if it was
+	// this slot
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	head = __atomic_load_n(&img->head, __ATOMIC_RELAXED);
+	return (head - seq > img->chunk_nbr || out->seq != seq) ? HISTORY_ERR_SEQ : HISTORY_OK;
+}
+
+uint32_t history_decode(const history_chunk_t *c, uint16_t *out){
+	uint32_t nbr = c->nbr < HISTORY_VALUES_MAX ? c->nbr : HISTORY_VALUES_MAX;
+	uint32_t prev = c->first;
+	uint32_t bit = 0u, i = 0u, end = HISTORY_DATA_SIZE * 8u;
+
+	if (nbr == 0u)
+		return 0u;
+	out[i++] = (uint16_t)prev;
+	while (i < nbr){
+		uint32_t left = nbr - i < HISTORY_GROUP ? nbr - i : HISTORY_GROUP;
+		uint32_t k = 0u, j, b;
+
+		for (b = 0u; b < 4u && bit < end; b++, bit++)
+			k = (k << 1) | ((c->data[bit >> 3] >> (7u - (bit & 7u))) & 1u);
+		for (j = 0u; j < left; j++){
+			uint32_t q = 0u, z = 0u, zbits = k;
+
+			if (k != HISTORY_K_ZERO){
+				while (q < HISTORY_Q_ESC && bit < end && ((c->data[bit >> 3] >> (7u - (bit & 7u))) & 1u)){
+					q++;
+					bit++;
+				}
+				if (q < HISTORY_Q_ESC)
+					bit++;								// the ending zero
+				else
+					zbits = HISTORY_Z_BITS;
+				for (b = 0u; b < zbits && bit < end; b++, bit++)
+					z = (z << 1) | ((c->data[bit >> 3] >> (7u - (bit & 7u))) & 1u);
+				if (q < HISTORY_Q_ESC)
+					z |= q << k;
+			}
+			prev += (z & 1u) ? (uint32_t)-(int32_t)((z + 1u) >> 1) : z >> 1;
+			out[i++] = (uint16_t)prev;
+		}
+	}
+	return nbr;
+}
+
+uint32_t history_find(const history_hdr_t *img, uint32_t time_ms){
+	const history_chunk_t *ring = (const history_chunk_t *)((const uint8_t *)img + img->hdr_size);
+	uint32_t head = __atomic_load_n(&img->head, __ATOMIC_ACQUIRE);
+	uint32_t lo = head > img->chunk_nbr ? head - img->chunk_nbr : 0u;
+	uint32_t hi = head;
+
+	if (head == 0u)
+		return HISTORY_NONE;
+	// chunks are in order of time: the last one starting at or before time_ms is in [lo, hi)
+	while (hi - lo > 1u){
+		uint32_t mid = lo + (hi - lo) / 2u;
+
+		if (ring[mid % img->chunk_nbr].time_ms <= time_ms)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+int history_check(const history_hdr_t *img, uint32_t len){
+	if (len < sizeof(*img) || img->magic != HISTORY_MAGIC || img->version != HISTORY_VERSION ||
+		img->chunk_size != sizeof(history_chunk_t) || img->chunk_nbr == 0u)
+		return HISTORY_ERR_MAGIC;
+	if ((uint64_t)img->hdr_size + (uint64_t)img->chunk_nbr * img->chunk_size > len)
+		return HISTORY_ERR_SIZE;
+	return HISTORY_OK;
+}
+
+void history_bench(history_bench_t *res, history_t *h, history_hdr_t *img, uint32_t chunk_nbr,
+				   uint32_t (*clk)(void), uint32_t len, uint32_t rounds){
+	spsc_sample_t	s[HISTORY_BENCH_LEN];
+	uint32_t		seed = 1u, ts = 0u;
+	uint64_t		sum = 0u;
+	uint32_t		r, i;
+
+	// 1 kHz readings, a code up every 64 readings and 0 to 7 codes of noise
+	len = len < 1u ? 1u : len > HISTORY_BENCH_LEN ? HISTORY_BENCH_LEN : len;
+	history_init(h, img, chunk_nbr, 1000000u, 0u);
+	res->max = 0u;
+	for (r = 0u; r < rounds; r++){
+		uint32_t start, cycles;
+
+		for (i = 0u; i < len; i++){
+			seed = seed * 1664525u + 1013904223u;
+			s[i].ts = ts;
+			s[i].code = (uint16_t)(30000u + ((r * len + i) >> 6) + (seed >> 29));
+			s[i].ch = 0u;
+			ts += 1000u;
+		}
+		start = clk();
+		history_add(h, s, len, 1000u);
+		cycles = clk() - start;
+		sum += cycles;
+		if (cycles > res->max)
+			res->max = cycles;
+	}
+	res->mean = rounds ? (uint32_t)(sum / rounds) : 0u;
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+static void history_value(history_t *h, uint16_t v, uint32_t period){
+	h->values++;
+	if (h->cur.nbr > 0u && period != h->cur.period)
+		history_flush(h);
+	if (h->cur.nbr == 0u){
+		chunk_start(h, v, h->cycles, period);
+		return;
+	}
+	h->pend[h->npend++] = v;
+	h->cur.nbr++;
+	if (h->npend == HISTORY_GROUP && group_put(h) != 0)
+		chunk_carry(h);
+	if (h->cur.nbr >= HISTORY_VALUES_MAX)
+		history_flush(h);
+}
+
+static void chunk_start(history_t *h, uint16_t first, uint64_t cycles, uint32_t period){
+	h->cur.time_ms = (uint32_t)(cycles / (h->img->ts_hz / 1000u));
+	h->cur.period = period;
+	h->cur.first = first;
+	h->cur.nbr = 1u;
+	h->cur_cycles = cycles;
+	h->pos = 0u;
+	h->acc = 0u;
+	h->nacc = 0u;
+	h->prev = first;
+	h->npend = 0u;
+}
+
+// the pending values start the next chunk
+static void chunk_carry(history_t *h){
+	uint16_t carry[HISTORY_GROUP];
+	uint32_t n = h->npend;
+	uint32_t period = h->cur.period;
+	uint64_t cycles;
+	uint32_t i;
+
+	memcpy(carry, h->pend, n * sizeof(carry[0]));
+	h->cur.nbr = (uint16_t)(h->cur.nbr - n);
+	cycles = h->cur_cycles + (uint64_t)h->cur.nbr * period;
+	h->npend = 0u;
+	chunk_close(h);
+	chunk_start(h, carry[0], cycles, period);
+	for (i = 1u; i < n; i++)
+		h->pend[h->npend++] = carry[i];
+	h->cur.nbr = (uint16_t)(h->cur.nbr + n - 1u);
+}
+
+static void chunk_close(history_t *h){
+	uint32_t seq = h->img->head;
+
+	if (h->nacc > 0u)
+		h->cur.data[h->pos++] = (uint8_t)(h->acc << (8u - h->nacc));
+	h->nacc = 0u;
+	h->cur.seq = seq;
+	// the header and the bytes written, the rest of the slot is never read
+	memcpy(&h->ring[seq % h->img->chunk_nbr], &h->cur, HISTORY_CHUNK_HDR + h->pos);
+	__atomic_store_n(&h->img->head, seq + 1u, __ATOMIC_RELEASE);
+	h->bytes += h->pos;
+	h->cur.nbr = 0u;
+}
+
+// codes the pending values as one group; returns -1, with nothing written, if it does not fit
+static int group_put(history_t *h){
+	uint32_t z[HISTORY_GROUP];
+	uint32_t n = h->npend, prev = h->prev;
+	uint32_t sum = 0u, bits = 4u, k, q, i;
+
+	for (i = 0u; i < n; i++){
+		int32_t d = (int32_t)h->pend[i] - (int32_t)prev;
+
+		z[i] = d >= 0 ? (uint32_t)d << 1 : ((uint32_t)-d << 1) - 1u;
+		sum += z[i];
+		prev = h->pend[i];
+	}
+	if (sum == 0u){
+		k = HISTORY_K_ZERO;
+	} else {
+		// floor(log2()) of the mean, near the best parameter for a geometric distribution
+		k = sum >= n ? 31u - (uint32_t)__builtin_clz(sum / n) : 0u;
+		k = k < HISTORY_K_ZERO ? k : HISTORY_K_ZERO - 1u;
+		for (i = 0u; i < n; i++){
+			q = z[i] >> k;
+			bits += q < HISTORY_Q_ESC ? q + 1u + k : HISTORY_Q_ESC + HISTORY_Z_BITS;
+		}
+	}
+	if (h->pos * 8u + h->nacc + bits > HISTORY_DATA_SIZE * 8u)
+		return -1;
+
+	bits_put(h, k, 4u);
+	if (k != HISTORY_K_ZERO){
+		for (i = 0u; i < n; i++){
+			q = z[i] >> k;
+			if (q < HISTORY_Q_ESC){
+				bits_put(h, ((1u << q) - 1u) << 1, q + 1u);
+				bits_put(h, z[i] & ((1u << k) - 1u), k);
+			} else {
+				bits_put(h, (1u << HISTORY_Q_ESC) - 1u, HISTORY_Q_ESC);
+				bits_put(h, z[i], HISTORY_Z_BITS);
+			}
+		}
+	}
+	h->prev = prev;
+	h->npend = 0u;
+	return 0;
+}
@@ -0,0 +1,146 @@
+/*
+*********************************************************************************************************
+*                                      COMPRESSED READING HISTORY
+*
+* Hours of readings of channel 0 kept in a few tens of KB of SRAM. Every 2^avg_log2 readings are averaged
+* into one value, and the values are coded in chunks of HISTORY_CHUNK_SIZE bytes kept in a ring, the
+* oldest overwritten: a header (sequence number, time of the first value, period, first value, number
+* of values) then the differences between consecutive values, zig-zag mapped (0, -1, 1, -2 ... to
+* 0, 1, 2, 3 ...) and Rice coded by groups of HISTORY_GROUP: 4 bits of parameter k, then per difference
+* z >> k in unary (ones ended by a zero) and the k low bits of z. k comes from the mean of the group;
+* HISTORY_K_ZERO stands for a group of zero differences, and a quotient of HISTORY_Q_ESC ones is followed
+* by the 17 bits of z. A slow battery voltage costs 1 to 4 bits per value, a flat one a quarter of a bit.
+* Each chunk decodes on its own and has a constant period: a new chunk starts when the period changes
+* (APP_CFG_RATE_EN), so the time of every value follows from the header.
+*
+* The memory image is the dump format, all fields little endian: a history_hdr_t, then hdr.chunk_nbr
+* history_chunk_t; chunk seq is in slot seq % chunk_nbr while seq + chunk_nbr >= hdr.head. history_add()
+* codes into a chunk of history_t and copies it into the ring when it is full, so a reader of another task
+* (of lower priority than the writer) only sees closed chunks: history_read() copies one and checks that
+* the writer did not reach its slot meanwhile. No dependency on the OS, compiles on the host.
+*********************************************************************************************************
+*/
+
+#ifndef  HISTORY_MODULE_PRESENT
+#define  HISTORY_MODULE_PRESENT
+
+#include  <stdint.h>
+#include  <spsc.h>
+
+/*
+*********************************************************************************************************
+*                                               DEFINES
+*********************************************************************************************************
+*/
+
+#define HISTORY_MAGIC			0x54534948u				// "HIST"
+#define HISTORY_VERSION			1u
+
+#define HISTORY_CHUNK_SIZE		256u					// bytes, header included
+#define HISTORY_CHUNK_HDR		16u
+#define HISTORY_DATA_SIZE		(HISTORY_CHUNK_SIZE - HISTORY_CHUNK_HDR)
+#define HISTORY_VALUES_MAX		4096u					// per chunk, the first one included
+#define HISTORY_GROUP			16u						// differences sharing a Rice parameter
+#define HISTORY_K_ZERO			15u
+#define HISTORY_Q_ESC			16u
+#define HISTORY_Z_BITS			17u						// zig-zag of a difference of 16 bit codes
+#define HISTORY_AVG_LOG2_MAX	8u
+#define HISTORY_BENCH_LEN		64u						// readings per batch of history_bench() at most
+
+#define HISTORY_OK				0
+#define HISTORY_ERR_SEQ			-1						// chunk not closed yet, or overwritten
+#define HISTORY_ERR_MAGIC		-2
+#define HISTORY_ERR_SIZE		-3						// fewer bytes than the header announces
+
+#define HISTORY_NONE			0xFFFFFFFFu
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+typedef struct history_hdr {
+	uint32_t	magic;
+	uint16_t	version;
+	uint16_t	hdr_size;								// bytes, the ring starts there
+	uint32_t	chunk_size;
+	uint32_t	chunk_nbr;								// slots of the ring
+	uint32_t	ts_hz;									// clock of the periods
+	uint32_t	avg_log2;								// readings per value
+	volatile uint32_t head;								// chunks closed since history_init()
+	uint32_t	reserved;
+} history_hdr_t;
+
+typedef struct history_chunk {
+	uint32_t	seq;
+	uint32_t	time_ms;								// of the first value, from history_init()
+	uint32_t	period;									// cycles between two values
+	uint16_t	first;
+	uint16_t	nbr;									// values, the first one included
+	uint8_t		data[HISTORY_DATA_SIZE];
+} history_chunk_t;
+
+typedef struct history {
+	history_hdr_t	*img;
+	history_chunk_t	*ring;
+	history_chunk_t	cur;								// chunk being coded
+	uint64_t		cur_cycles;							// of its first value
+	uint32_t		pos;								// bytes of data written
+	uint32_t		acc;								// bits not written yet, the last nacc ones
+	uint32_t		nacc;
+	uint32_t		prev;								// last value coded
+	uint16_t		pend[HISTORY_GROUP];				// values waiting for their group
+	uint32_t		npend;
+	// averaging
+	uint32_t		sum;
+	uint32_t		nsum;
+	uint32_t		period;								// cycles between two readings
+	uint32_t		last_ts;
+	uint64_t		cycles;								// unwrapped cycle counter of the last reading
+	uint32_t		started;
+	// since history_init()
+	uint32_t		readings;
+	uint32_t		values;
+	uint32_t		bytes;								// of the data of the closed chunks
+} history_t;
+
+// cycles per call of history_add() with a batch of readings, every reading a value (avg_log2 0)
+typedef struct history_bench {
+	uint32_t	mean;
+	uint32_t	max;
+} history_bench_t;
+
+/*
+*********************************************************************************************************
+*                                         FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+// ring of chunk_nbr chunks right after img, one value per 2^avg_log2 readings
+void     history_init(history_t *h, history_hdr_t *img, uint32_t chunk_nbr, uint32_t ts_hz, uint32_t avg_log2);
+
+// n readings of channel 0, period cycles apart
+void     history_add(history_t *h, const spsc_sample_t *s, uint32_t n, uint32_t period);
+
+// closes the chunk being coded, from the task of history_add(): the last values for the readers
+void     history_flush(history_t *h);
+
+// copy of chunk seq from another task or a dump; returns HISTORY_OK or HISTORY_ERR_SEQ
+int      history_read(const history_hdr_t *img, uint32_t seq, history_chunk_t *out);
+
+// values of a chunk into out, HISTORY_VALUES_MAX at most; returns their number
+uint32_t history_decode(const history_chunk_t *c, uint16_t *out);
+
+// last chunk that starts at or before time_ms, the oldest one kept if none does; HISTORY_NONE if empty
+uint32_t history_find(const history_hdr_t *img, uint32_t time_ms);
+
+// checks the header of a dump of len bytes
+int      history_check(const history_hdr_t *img, uint32_t len);
+
+// codes rounds batches of len readings (up to HISTORY_BENCH_LEN) of a slow noisy ramp, clk is a free
+// running cycle counter; uses h and the ring of img
+void     history_bench(history_bench_t *res, history_t *h, history_hdr_t *img, uint32_t chunk_nbr,
+					   uint32_t (*clk)(void), uint32_t len, uint32_t rounds);
+
+#endif
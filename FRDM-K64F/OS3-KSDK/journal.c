@@ -0,0 +1,43 @@
+/*
+*********************************************************************************************************
+* Transition journal (see journal.h).
+* The same ordering as spsc.c: the records are written before head moves and read before tail moves,
+* each index loaded by the other side with acquire semantics.
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <string.h>
+
+#include  <journal.h>
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+void journal_init(journal_t *j){
+	memset(j, 0, sizeof(*j));
+}
+
+uint32_t journal_pop(journal_t *j, journal_rec_t *out, uint32_t max){
+	uint32_t tail = j->tail;
+	uint32_t avail = __atomic_load_n(&j->head, __ATOMIC_ACQUIRE) - tail;
+	uint32_t n = max < avail ? max : avail;
+	uint32_t i;
+
+	for (i = 0u; i < n; i++)
+		out[i] = j->rec[(tail + i) & (JOURNAL_SIZE - 1u)];
+	__atomic_store_n(&j->tail, tail + n, __ATOMIC_RELEASE);
+	return n;
+}
+
+uint32_t journal_count(const journal_t *j){
+	return __atomic_load_n(&j->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&j->tail, __ATOMIC_ACQUIRE);
+}
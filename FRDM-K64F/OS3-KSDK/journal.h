@@ -0,0 +1,93 @@
+/*
+*********************************************************************************************************
+*                                        TRANSITION JOURNAL
+*
+* Circular journal of the changes of blink state made by range_check(): cycle counter, state before and
+* after (BAND_STATE()) and the reading that caused the change, 8 bytes per record. range_check() is the
+* only writer and the report task the only reader, which takes the records in batches to the serial port
+* or to the flash log of flog.h. As in spsc.h, head and tail run freely and each side only writes its
+* own, so journal_add() is a handful of instructions with no critical section. A full journal drops the
+* new records and counts them in lost, the oldest ones stay for the reader.
+* The code has no dependency on the OS and compiles on the host (see host/journal_bench.c).
+*********************************************************************************************************
+*/
+
+#ifndef  JOURNAL_MODULE_PRESENT
+#define  JOURNAL_MODULE_PRESENT
+
+#include  <stdint.h>
+
+/*
+*********************************************************************************************************
+*                                               DEFINES
+*********************************************************************************************************
+*/
+
+#ifndef JOURNAL_SIZE
+#define JOURNAL_SIZE			64u						// power of 2, records
+#endif
+
+// destinations of the records, APP_CFG_JOURNAL_OUT
+#define JOURNAL_OUT_SERIAL		0u						// one line per record with APP_TRACE
+#define JOURNAL_OUT_FLASH		1u						// flog_append()
+
+// from of a record never written (erased flash), no state has that number
+#define JOURNAL_ERASED			0xFFu
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+typedef struct journal_rec {
+	uint32_t	ts;										// CPU cycle counter after the change
+	uint16_t	sample;									// reading that caused it
+	uint8_t		from;									// BAND_STATE() before
+	uint8_t		to;										// and after
+} journal_rec_t;
+
+typedef struct journal {
+	// producer side
+	uint32_t		head;
+	uint32_t		added;								// records written
+	uint32_t		lost;								// records dropped because the journal was full
+	// consumer side
+	uint32_t		tail;
+	journal_rec_t	rec[JOURNAL_SIZE];
+} journal_t;
+
+/*
+*********************************************************************************************************
+*                                         FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+void     journal_init(journal_t *j);
+
+// producer: one record, dropped and counted in lost if the journal is full; inline since range_check()
+// calls it on every change of state
+static inline void journal_add(journal_t *j, uint32_t ts, uint32_t sample, uint32_t from, uint32_t to){
+	uint32_t		head = j->head;
+	journal_rec_t  *r;
+
+	if (head - __atomic_load_n(&j->tail, __ATOMIC_ACQUIRE) >= JOURNAL_SIZE){
+		j->lost++;
+		return;
+	}
+	r = &j->rec[head & (JOURNAL_SIZE - 1u)];
+	r->ts = ts;
+	r->sample = (uint16_t)sample;
+	r->from = (uint8_t)from;
+	r->to = (uint8_t)to;
+	__atomic_store_n(&j->head, head + 1u, __ATOMIC_RELEASE);
+	j->added++;
+}
+
+// consumer: up to max records, oldest first
+uint32_t journal_pop(journal_t *j, journal_rec_t *out, uint32_t max);
+
+// records waiting, from either side
+uint32_t journal_count(const journal_t *j);
+
+#endif
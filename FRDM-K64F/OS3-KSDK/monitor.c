@@ -0,0 +1,112 @@
+/*
+*********************************************************************************************************
+* Multi-channel monitoring of the scanned rails (see monitor.h).
+* The batch is walked once: channel 0 readings are compacted in place for the LED path of alarm.c, the
+* others are classified in the table of their channel. Only a change of state touches the output.
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <string.h>
+
+#include  <hal.h>
+#include  <app_cfg.h>
+#include  <monitor.h>
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static void mon_change(mon_t *m, uint32_t ch, uint8_t act);
+static void mon_output(mon_t *m, uint32_t ch);
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+void mon_init(mon_t *m, uint32_t nbr){
+	uint32_t ch;
+
+	memset(m, 0, sizeof(*m));
+	m->nbr = nbr < MON_CH_MAX ? nbr : MON_CH_MAX;
+	for (ch = 0u; ch < m->nbr; ch++){
+		m->state[ch] = (uint8_t)BAND_STATE(BLINK_NONE, BAND_LED_RED);
+		m->pin[ch] = MON_PIN_NONE;
+		band_build(&m->tbl[ch], &band_cfg_default);
+	}
+}
+
+int mon_set_cfg(mon_t *m, uint32_t ch, const band_cfg_t *cfg){
+	return band_build(&m->tbl[ch], cfg);
+}
+
+void mon_set_output(mon_t *m, uint32_t ch, uint32_t pin, uint8_t alarm_leds){
+	m->pin[ch] = pin;
+	m->alarm_leds[ch] = alarm_leds;
+	m->alarm[ch] = (uint8_t)((alarm_leds >> (m->state[ch] % BAND_LED_NBR)) & 1u);
+	mon_output(m, ch);
+}
+
+uint32_t mon_check_batch(mon_t *m, spsc_sample_t *batch, uint32_t n){
+	uint32_t k = 0u;
+	uint32_t i;
+
+	for (i = 0u; i < n; i++){
+		uint32_t ch = batch[i].ch;
+		uint8_t  act;
+
+		if (ch == 0u){
+			batch[k++] = batch[i];
+			continue;
+		}
+		if (ch >= m->nbr)
+			continue;
+		act = band_classify(&m->tbl[ch], m->state[ch], batch[i].code);
+		if (act != BAND_NOP)
+			mon_change(m, ch, act);
+	}
+	return k;
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+static void mon_change(mon_t *m, uint32_t ch, uint8_t act){
+	uint32_t rate = m->state[ch] / BAND_LED_NBR;
+	uint32_t led = m->state[ch] % BAND_LED_NBR;
+	uint8_t  alarm;
+
+	if (BAND_ACT_RATE(act) != BAND_KEEP)
+		rate = BAND_ACT_RATE(act);
+	if (BAND_ACT_LED(act) != BAND_KEEP)
+		led = BAND_ACT_LED(act);
+	m->state[ch] = (uint8_t)BAND_STATE(rate, led);
+	m->changes[ch]++;
+
+	alarm = (uint8_t)((m->alarm_leds[ch] >> led) & 1u);
+	if (alarm != m->alarm[ch]){
+		m->alarm[ch] = alarm;
+		mon_output(m, ch);
+	}
+}
+
+static void mon_output(mon_t *m, uint32_t ch){
+	if (m->pin[ch] == MON_PIN_NONE)
+		return;
+	if (m->alarm[ch])
+		hal_gpio_set(m->pin[ch]);
+	else
+		hal_gpio_clear(m->pin[ch]);
+}
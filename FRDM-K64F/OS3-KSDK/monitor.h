@@ -0,0 +1,69 @@
+/*
+*********************************************************************************************************
+*                                       MULTI-CHANNEL MONITORING
+*
+* Range checking of the rails read by the ADC0/ADC1 scan. Channel 0 is the input of the LEDs and stays
+* with alarm.c; every other channel has its own band table (band.h, built from its own thresholds), its
+* own hysteresis state and an alarm output pin, asserted while the state of the channel is in one of the
+* LED bands of its mask. The per-channel data is kept in arrays indexed by channel, so a reading costs
+* the same 5 step search whatever the number of channels and only the table of its channel is touched.
+*********************************************************************************************************
+*/
+
+#ifndef  MONITOR_MODULE_PRESENT
+#define  MONITOR_MODULE_PRESENT
+
+#include  <stdint.h>
+#include  <app_cfg.h>
+#include  <band.h>
+#include  <spsc.h>
+
+/*
+*********************************************************************************************************
+*                                               DEFINES
+*********************************************************************************************************
+*/
+
+// arrays sized for the scan of app_cfg.h, the host tools build with -DMON_CH_MAX=16 (8 inputs per ADC)
+#ifndef MON_CH_MAX
+#define MON_CH_MAX				APP_CFG_MON_CH_NBR
+#endif
+
+#define MON_PIN_NONE			0xFFFFFFFFu
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+typedef struct mon {
+	uint32_t		nbr;								// channels of the scan, channel 0 included
+	uint8_t			state[MON_CH_MAX];					// BAND_STATE(rate, led)
+	uint8_t			alarm[MON_CH_MAX];					// level of the output
+	uint8_t			alarm_leds[MON_CH_MAX];				// bit BAND_LED_xx set: output high in that band
+	uint32_t		pin[MON_CH_MAX];
+	uint32_t		changes[MON_CH_MAX];
+	band_table_t	tbl[MON_CH_MAX];
+} mon_t;
+
+/*
+*********************************************************************************************************
+*                                         FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+// nbr channels with the thresholds of app_cfg.h, initial state of alarm_init(), no output pin
+void     mon_init(mon_t *m, uint32_t nbr);
+
+// thresholds of a channel; returns the result of band_build()
+int      mon_set_cfg(mon_t *m, uint32_t ch, const band_cfg_t *cfg);
+
+// output of a channel, driven at once with the current state
+void     mon_set_output(mon_t *m, uint32_t ch, uint32_t pin, uint8_t alarm_leds);
+
+// checks the readings of channels 1.. and moves the ones of channel 0 to the front of the batch, in
+// order; returns their number
+uint32_t mon_check_batch(mon_t *m, spsc_sample_t *batch, uint32_t n);
+
+#endif
@@ -0,0 +1,107 @@
+/*
+*********************************************************************************************************
+* Per-batch pipeline of AppTask (see pipeline.h).
+* The stages run in the order of the first AppTask loop; those left out cost a test of their pointer. The
+* range checking is the loop of range_check_block(), with the hooks of the simulator around each reading.
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <string.h>
+
+#include  <hal.h>
+#include  <alarm.h>
+#include  <prof.h>
+#include  <pipeline.h>
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+void pipeline_init(pipeline_t *p){
+	memset(p, 0, sizeof(*p));
+}
+
+uint32_t pipeline_batch(pipeline_t *p, spsc_sample_t *batch, uint32_t n){
+	uint32_t last = 0u;
+	uint32_t i;
+	uint16_t lo, hi;
+	int      in_band;
+
+	if (n == 0u)
+		return 0u;
+	// delay of the batch from the trigger of its last reading, what the other tasks may add to
+	PROF_RECORD(PROF_TRIG_TO_TASK, hal_ts_get() - batch[n - 1u].ts);
+	// raw readings, encoded from the batch straight into the frame handed to the DMA
+	if (p->stream != NULL)
+		stream_block(p->stream, batch, n);
+	// alarm outputs of the other rails, the readings of channel 0 are left at the front
+	if (p->mon != NULL)
+		n = mon_check_batch(p->mon, batch, n);
+	// one output per 2^log2 readings, a batch may complete none
+	if (p->decim != NULL)
+		n = decim_batch(p->decim, batch, n);
+	if (n == 0u)
+		return 0u;
+	if (p->capture != NULL)
+		capture_add(p->capture, p->capture_rec, p->capture_cap, batch, n);
+	if (p->history != NULL){
+		uint32_t t = hal_ts_get();
+
+		// readings at the current period, a new chunk starts on a change of the rate
+		history_add(p->history, batch, n, hal_adc_trigger_cycles() << (p->decim != NULL ? p->decim->log2 : 0u));
+		t = hal_ts_get() - t;
+		PROF_RECORD(PROF_HISTORY, t);
+		p->history_over += t > p->history_budget;
+	}
+	for (i = 0u; i < n; i++)
+		p->block[i] = batch[i].code;
+	filter_block(p->filter, p->block, n);
+	if (p->stats != NULL){
+		// bands changed from the console count from this batch on
+		stats_set_cfg(p->stats, alarm_cfg());
+		stats_block(p->stats, p->block, n, batch[n - 1u].ts);
+	}
+	for (i = 0u; i < n; i++){
+		if (p->step != NULL)
+			p->step(i);
+		if (range_check(p->block[i])){
+			last = i + 1u;
+			if (p->change != NULL)
+				p->change(i);
+		}
+	}
+	if (last > 0u)
+		PROF_RECORD(PROF_TRIG_TO_LED, alarm_change_ts - batch[last - 1u].ts);
+	if (p->trend != NULL){
+		// line through the filtered readings, the edge ahead of it checked once per batch
+		for (i = 0u; i < n; i++)
+			trend_add(p->trend, p->block[i], batch[i].ts);
+		if (alarm_predict(p->trend, p->trend_horizon, p->trend_min_codes) && alarm_warning)
+			p->warnings++;
+	}
+	// re-arm around the new state; a sample that would change it again keeps every reading coming
+	if (p->compare){
+		if (alarm_window(p->block[n - 1u], &lo, &hi))
+			hal_adc0_compare_set(lo, hi);
+		else
+			hal_adc0_compare_off();
+	}
+	// period of the next readings from the distance to the band edges and the slope
+	if (p->rate != NULL){
+		in_band = alarm_window(p->block[n - 1u], &lo, &hi);
+		i = rate_update(p->rate, p->block[n - 1u], batch[n - 1u].ts, in_band, lo, hi);
+		if (i != p->level){
+			p->level = i;
+			p->rate_set(p->level);
+		}
+	}
+	return n;
+}
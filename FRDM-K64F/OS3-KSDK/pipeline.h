@@ -0,0 +1,75 @@
+/*
+*********************************************************************************************************
+*                                        PER-BATCH PIPELINE
+*
+* What AppTask does with each batch popped from the sample queue, shared with the host simulator so that
+* host/sim_main.c runs the code that ships: stream of the raw readings, alarm outputs of the other rails,
+* decimation, capture, history, filter, statistics, range checking, early warning, then the ADC0 compare
+* window and the adaptive rate for the next readings. Every stage is optional: app.c sets the ones of
+* app_cfg.h once, the simulator those of its options. No dependency on the OS, compiles on the host.
+*********************************************************************************************************
+*/
+
+#ifndef  PIPELINE_MODULE_PRESENT
+#define  PIPELINE_MODULE_PRESENT
+
+#include  <stdint.h>
+#include  <spsc.h>
+#include  <filter.h>
+#include  <decim.h>
+#include  <monitor.h>
+#include  <stream.h>
+#include  <capture.h>
+#include  <history.h>
+#include  <stats.h>
+#include  <trend.h>
+#include  <rate.h>
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+// stages in the order they run, NULL (or 0) for the ones left out; filter and block are required
+typedef struct pipeline {
+	stream_t	   *stream;								// raw readings of every channel
+	mon_t		   *mon;								// rails other than channel 0
+	decim_t		   *decim;								// a batch may complete no output
+	capture_hdr_t  *capture;							// records in capture_rec[capture_cap]
+	capture_rec_t  *capture_rec;
+	uint32_t	    capture_cap;
+	history_t	   *history;
+	uint32_t	    history_budget;						// cycles of history_add() per batch
+	filter_t	   *filter;
+	uint16_t	   *block;								// filtered codes, room for the longest batch
+	stats_t		   *stats;
+	trend_t		   *trend;
+	uint32_t	    trend_horizon;						// cycles
+	uint32_t	    trend_min_codes;
+	uint32_t	    compare;							// re-arm the ADC0 compare function
+	rate_t		   *rate;
+	void		   (*rate_set)(uint32_t level);			// FTM0 period of a level of the rate
+	// host: before the range checking of reading i of the batch, and after it changed the blink state
+	void		   (*step)(uint32_t i);
+	void		   (*change)(uint32_t i);
+	// counters
+	uint32_t	    level;								// of the adaptive rate
+	uint32_t	    history_over;						// batches coded in more than history_budget
+	uint32_t	    warnings;							// early warnings raised
+} pipeline_t;
+
+/*
+*********************************************************************************************************
+*                                         FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+// stages left out and counters cleared; the caller then sets filter, block and the stages it uses
+void     pipeline_init(pipeline_t *p);
+
+// one batch of n readings from the queue, changed in place; returns the readings of channel 0 that went
+// through range_check()
+uint32_t pipeline_batch(pipeline_t *p, spsc_sample_t *batch, uint32_t n);
+
+#endif
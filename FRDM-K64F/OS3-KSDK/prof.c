@@ -0,0 +1,97 @@
+/*
+*********************************************************************************************************
+* Statistics of the profiling probes (see prof.h).
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <string.h>
+
+#include  <hal.h>
+#include  <prof.h>
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+prof_stat_t        prof_stats[PROF_PROBE_NBR];
+volatile uint32_t  prof_gen;
+
+/*
+*********************************************************************************************************
+*                                       LOCAL GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+static uint32_t  prof_dump_req;
+
+static const char *const prof_names[PROF_PROBE_NBR] = {
+	"dma_isr", "ftm1_isr", "range_check", "change_pulse", "trig_to_led", "trig_to_task", "dma_mask", "pulse_mask",
+	"snap_mask", "cfg_mask", "history"
+};
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+void prof_reset(void){
+	// a writer in the middle of a record finishes it in the old generation
+	__atomic_fetch_add(&prof_gen, 1u, __ATOMIC_RELAXED);
+}
+
+const char *prof_name(uint32_t probe){
+	return probe < PROF_PROBE_NBR ? prof_names[probe] : "?";
+}
+
+void prof_snapshot(uint32_t probe, prof_stat_t *out){
+	HAL_SR_ALLOC();
+
+	// one probe at a time, interrupts stay off for a copy of ~150 bytes
+	HAL_CRITICAL_ENTER();
+	PROF_START(m);
+	*out = prof_stats[probe];
+	PROF_END(m);
+	HAL_CRITICAL_EXIT();
+	if (out->gen != prof_gen)
+		memset(out, 0, sizeof(*out));
+	PROF_RECORD(PROF_MASK_SNAPSHOT, m);
+}
+
+void prof_dump(void){
+	prof_stat_t s;
+	uint32_t    probe, k;
+
+	APP_TRACE_INFO(("probe              nbr        min        max       mean  cycles\r\n"));
+	for (probe = 0u; probe < PROF_PROBE_NBR; probe++){
+		prof_snapshot(probe, &s);
+		if (s.nbr == 0u){
+			APP_TRACE_INFO(("%-12s %9u          -          -          -\r\n", prof_name(probe), 0u));
+			continue;
+		}
+		APP_TRACE_INFO(("%-12s %9u %10u %10u %10u\r\n", prof_name(probe), (unsigned)s.nbr, (unsigned)s.min,
+						(unsigned)s.max, (unsigned)(s.sum / s.nbr)));
+		// non empty buckets as <upper bound>:<count>
+		APP_TRACE_INFO(("  log2"));
+		for (k = 0u; k < PROF_HIST_NBR; k++)
+			if (s.hist[k])
+				APP_TRACE_INFO((" <2^%u:%u", (unsigned)k, (unsigned)s.hist[k]));
+		APP_TRACE_INFO(("\r\n"));
+	}
+}
+
+void prof_request_dump(void){
+	__atomic_store_n(&prof_dump_req, 1u, __ATOMIC_RELAXED);
+}
+
+uint32_t prof_dump_requested(void){
+	return __atomic_exchange_n(&prof_dump_req, 0u, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,128 @@
+/*
+*********************************************************************************************************
+*                                        HOT PATH PROFILING
+*
+* Cycle counts of the interrupt handlers and of the alarm logic, taken with the free running cycle counter
+* of hal_ts_get() (DWT CYCCNT on the board, simulated cycles on the host). Every probe keeps count, min,
+* max, sum and a log2 histogram of its samples; each probe is written from a single context (one ISR or
+* task), so recording needs no lock. prof_reset() only starts a new generation, each probe clears itself
+* on its next record, and prof_dump() runs in the report task, the writer of PROF_MASK_SNAPSHOT: other
+* tasks ask for it with prof_request_dump().
+* The *_mask probes time the interrupts-disabled window of each site that masks them: from the first to
+* the last statement under the mask for the critical sections of the application (PROF_START right after
+* masking, PROF_END right before unmasking, the record once unmasked), and for dma_int_handler the length
+* of its post, the only part of its body with the kernel's critical sections.
+* With APP_CFG_PROF_EN disabled the macros expand to nothing.
+*********************************************************************************************************
+*/
+
+#ifndef  PROF_MODULE_PRESENT
+#define  PROF_MODULE_PRESENT
+
+#include  <stdint.h>
+#include  <app_cfg.h>
+#include  <hal.h>
+
+/*
+*********************************************************************************************************
+*                                               DEFINES
+*********************************************************************************************************
+*/
+
+// probe points
+#define PROF_DMA_ISR			0u						// dma_int_handler
+#define PROF_FTM1_ISR			1u						// ftm1_int_handler
+#define PROF_RANGE_CHECK		2u						// range_check(), one sample
+#define PROF_CHANGE_PULSE		3u						// ftm1_change_pulse()
+#define PROF_TRIG_TO_LED		4u						// FTM0 trigger of a sample -> GPIO/FTM1 write it causes
+#define PROF_TRIG_TO_TASK		5u						// FTM0 trigger of the last sample of a batch -> AppTask
+#define PROF_MASK_DMA_ISR		6u						// OSTaskSemPost() of dma_int_handler, the masked part
+#define PROF_MASK_PULSE			7u						// by ftm1_change_pulse()
+#define PROF_MASK_SNAPSHOT		8u						// by prof_snapshot()
+#define PROF_MASK_CONFIG		9u						// by the changes of the console (console.h)
+#define PROF_HISTORY			10u						// history_add(), one batch
+#define PROF_PROBE_NBR			11u
+
+#define PROF_HIST_NBR			32u						// bucket k: [2^(k-1), 2^k) cycles, bucket 0: 0 cycles
+
+#if (APP_CFG_PROF_EN == DEF_ENABLED)
+#define PROF_START(t)			uint32_t t = hal_ts_get()
+#define PROF_STOP(probe, t)		prof_record((probe), hal_ts_get() - (t))
+#define PROF_END(t)				((t) = hal_ts_get() - (t))
+#define PROF_RECORD(probe, c)	prof_record((probe), (c))
+#else
+#define PROF_START(t)
+#define PROF_STOP(probe, t)		((void)0)
+#define PROF_END(t)				((void)0)
+#define PROF_RECORD(probe, c)	((void)0)
+#endif
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+typedef struct prof_stat {
+	uint32_t	gen;									// of prof_gen at the first record
+	uint32_t	nbr;
+	uint32_t	min;
+	uint32_t	max;
+	uint64_t	sum;
+	uint32_t	hist[PROF_HIST_NBR];
+} prof_stat_t;
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+extern prof_stat_t        prof_stats[PROF_PROBE_NBR];
+extern volatile uint32_t  prof_gen;						// incremented by prof_reset()
+
+/*
+*********************************************************************************************************
+*                                         FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+// from any task: the records before it are left out of the next snapshots
+void        prof_reset(void);
+const char *prof_name(uint32_t probe);
+
+// copy of one probe taken with interrupts disabled, empty if not recorded since prof_reset()
+void        prof_snapshot(uint32_t probe, prof_stat_t *out);
+
+// prints every probe through APP_TRACE_INFO, from the report task
+void        prof_dump(void);
+
+// from any other task: prof_dump_requested() of the report task returns 1 once
+void        prof_request_dump(void);
+uint32_t    prof_dump_requested(void);
+
+static inline void prof_record(uint32_t probe, uint32_t cycles){
+	prof_stat_t *p = &prof_stats[probe];
+	uint32_t     k = cycles ? 32u - (uint32_t)__builtin_clz(cycles) : 0u;
+	uint32_t     gen = prof_gen;
+	uint32_t     i;
+
+	// first record since prof_reset(), the writer of the probe clears it
+	if (p->gen != gen){
+		p->gen = gen;
+		p->nbr = 0u;
+		p->sum = 0u;
+		p->max = 0u;
+		for (i = 0u; i < PROF_HIST_NBR; i++)
+			p->hist[i] = 0u;
+	}
+	p->nbr++;
+	p->sum += cycles;
+	if (cycles < p->min || p->nbr == 1u)
+		p->min = cycles;
+	if (cycles > p->max)
+		p->max = cycles;
+	p->hist[k < PROF_HIST_NBR ? k : PROF_HIST_NBR - 1u]++;
+}
+
+#endif
@@ -0,0 +1,85 @@
+/*
+*********************************************************************************************************
+* Adaptive sampling rate (see rate.h).
+* Integer only: the time to the edge is distance << RATE_SLOPE_SHIFT / slope cycles, compared with the
+* duration of RATE_MARGIN blocks at each level.
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <string.h>
+
+#include  <rate.h>
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+void rate_ftm(uint32_t ps0, uint32_t mod0, uint32_t level, uint32_t *ps, uint32_t *mod){
+	uint32_t shift = ps0 + level;
+
+	*ps = shift > 7u ? 7u : shift;
+	*mod = ((mod0 + 1u) << (shift - *ps)) - 1u;
+}
+
+void rate_init(rate_t *r, uint32_t levels, uint32_t period0, uint32_t block, uint32_t near){
+	memset(r, 0, sizeof(*r));
+	r->levels = levels < 1u ? 1u : levels > RATE_LEVEL_MAX ? RATE_LEVEL_MAX : levels;
+	r->period0 = period0;
+	r->block = block;
+	r->near = near;
+}
+
+uint32_t rate_update(rate_t *r, uint16_t code, uint32_t ts, int in_band, uint16_t lo, uint16_t hi){
+	uint32_t dist = 0u, target;
+
+	// slope since the last decision, the peak decays by a quarter per block
+	if (r->has_last && ts != r->last_ts){
+		uint32_t dc = code > r->last_code ? code - r->last_code : r->last_code - code;
+		uint64_t s = ((uint64_t)dc << RATE_SLOPE_SHIFT) / (uint32_t)(ts - r->last_ts);
+
+		if (s > UINT32_MAX)
+			s = UINT32_MAX;
+		r->slope -= r->slope / 4u;
+		if (s > r->slope)
+			r->slope = (uint32_t)s;
+	}
+	r->last_code = code;
+	r->last_ts = ts;
+	r->has_last = 1u;
+
+	// the ends of the ADC range are not edges
+	if (in_band){
+		uint32_t below = lo == 0u ? UINT16_MAX : code - lo;
+		uint32_t above = hi == UINT16_MAX ? UINT16_MAX : hi - code;
+
+		dist = below < above ? below : above;
+	}
+	if (dist <= r->near){
+		target = 0u;
+	} else {
+		uint64_t t_edge = r->slope ? ((uint64_t)dist << RATE_SLOPE_SHIFT) / r->slope : UINT64_MAX;
+
+		for (target = r->levels - 1u;
+			 target > 0u && (uint64_t)RATE_MARGIN * r->block * ((uint64_t)r->period0 << target) > t_edge;
+			 target--)
+			;
+	}
+
+	if (target < r->level){
+		r->level = target;
+		r->ups++;
+	} else if (target > r->level){
+		r->level++;
+		r->downs++;
+	}
+	r->blocks[r->level]++;
+	return r->level;
+}
@@ -0,0 +1,67 @@
+/*
+*********************************************************************************************************
+*                                        ADAPTIVE SAMPLING RATE
+*
+* Chooses the FTM0 trigger period block by block. Level k triggers every period0 << k cycles, level 0 is
+* the fastest. After each block the distance of its last reading from the edges of the current band and
+* the slope of the signal give the time left before a change of state; the slowest level whose next block
+* (RATE_MARGIN blocks, to be safe) completes within that time is chosen. Within RATE_NEAR codes of an edge,
+* or when the reading itself changes the state, level 0 is used. The rate rises at once and falls one level
+* per block. The worst-case delay of a change that the slope did not announce (a step) is one block at the
+* slowest level.
+*********************************************************************************************************
+*/
+
+#ifndef  RATE_MODULE_PRESENT
+#define  RATE_MODULE_PRESENT
+
+#include  <stdint.h>
+
+/*
+*********************************************************************************************************
+*                                               DEFINES
+*********************************************************************************************************
+*/
+
+#define RATE_LEVEL_MAX			8u
+#define RATE_MARGIN				2u						// blocks that must fit before the edge
+#define RATE_SLOPE_SHIFT		16u						// slope in codes per 2^16 cycles
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+typedef struct rate {
+	uint32_t	levels;
+	uint32_t	period0;								// cycles between triggers at level 0
+	uint32_t	block;									// readings between two decisions
+	uint32_t	near;									// codes from an edge forcing level 0
+	uint32_t	level;
+	uint32_t	slope;									// peak of |codes| per 2^RATE_SLOPE_SHIFT cycles, decaying
+	uint32_t	last_code;
+	uint32_t	last_ts;
+	uint32_t	has_last;
+	uint32_t	ups;									// faster / slower level changes
+	uint32_t	downs;
+	uint32_t	blocks[RATE_LEVEL_MAX];					// decisions taken at each level
+} rate_t;
+
+/*
+*********************************************************************************************************
+*                                         FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+// FTM0 prescaler (at most 7) and modulo triggering every 2^(ps0 + level) * (mod0 + 1) bus cycles
+void     rate_ftm(uint32_t ps0, uint32_t mod0, uint32_t level, uint32_t *ps, uint32_t *mod);
+
+// starts at level 0
+void     rate_init(rate_t *r, uint32_t levels, uint32_t period0, uint32_t block, uint32_t near);
+
+// level of the next block, from the last reading of a block, its cycle counter and the codes [lo, hi]
+// around it where the state does not change (in_band = 0 if the reading itself changed the state)
+uint32_t rate_update(rate_t *r, uint16_t code, uint32_t ts, int in_band, uint16_t lo, uint16_t hi);
+
+#endif
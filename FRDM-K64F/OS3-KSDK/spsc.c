@@ -0,0 +1,90 @@
+/*
+*********************************************************************************************************
+* Single producer / single consumer sample queue (see spsc.h).
+* Each side loads the index of the other one with acquire semantics and publishes its own with release
+* semantics: the samples are written before head moves and read before tail moves. On the Cortex-M4
+* GCC emits a DMB for both, on the host they order the two threads of the stress test.
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <string.h>
+
+#include  <spsc.h>
+
+/*
+*********************************************************************************************************
+*                                            LOCAL DEFINES
+*********************************************************************************************************
+*/
+
+#define SPSC_MASK				(SPSC_SIZE - 1u)
+
+#define SPSC_LOAD_ACQ(p)		__atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define SPSC_STORE_REL(p, v)	__atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+void spsc_init(spsc_t *q){
+	memset(q, 0, sizeof(*q));
+}
+
+uint32_t spsc_push_block(spsc_t *q, const volatile uint16_t *codes, uint32_t len, uint32_t ts, uint32_t ts_step){
+	return spsc_push_scan(q, codes, len, 1u, 1u, ts, ts_step);
+}
+
+uint32_t spsc_push_scan(spsc_t *q, const volatile uint16_t *codes, uint32_t len, uint32_t nch, uint32_t per_trig,
+						uint32_t ts, uint32_t ts_step){
+	uint32_t head = q->head;
+	uint32_t free = SPSC_SIZE - (head - SPSC_LOAD_ACQ(&q->tail));
+	uint32_t n = len < free ? len : free;
+	uint32_t ch = 0u, k = 0u;
+	uint32_t i;
+
+	// the oldest readings are the ones kept
+	ts -= (len / per_trig - 1u) * ts_step;
+	for (i = 0u; i < n; i++){
+		spsc_sample_t *s = &q->buf[(head + i) & SPSC_MASK];
+
+		s->ts = ts;
+		s->code = codes[i];
+		s->ch = (uint16_t)ch;
+		// counters instead of divisions, the ISR runs this for every reading
+		if (++ch == nch)
+			ch = 0u;
+		if (++k == per_trig){
+			k = 0u;
+			ts += ts_step;
+		}
+	}
+	SPSC_STORE_REL(&q->head, head + n);
+	q->produced += n;
+	q->overruns += len - n;
+	return n;
+}
+
+uint32_t spsc_pop(spsc_t *q, spsc_sample_t *out, uint32_t max){
+	uint32_t tail = q->tail;
+	uint32_t avail = SPSC_LOAD_ACQ(&q->head) - tail;
+	uint32_t n = max < avail ? max : avail;
+	uint32_t i;
+
+	for (i = 0u; i < n; i++)
+		out[i] = q->buf[(tail + i) & SPSC_MASK];
+	SPSC_STORE_REL(&q->tail, tail + n);
+	q->consumed += n;
+	return n;
+}
+
+uint32_t spsc_count(const spsc_t *q){
+	return SPSC_LOAD_ACQ(&q->head) - SPSC_LOAD_ACQ(&q->tail);
+}
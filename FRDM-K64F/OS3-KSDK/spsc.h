@@ -0,0 +1,74 @@
+/*
+*********************************************************************************************************
+*                                       SPSC SAMPLE QUEUE
+*
+* Wait-free single producer / single consumer ring of timestamped ADC readings. dma_int_handler pushes
+* every half of the DMA ring as soon as it is complete, AppTask pops them in batches. head is written by
+* the producer only and tail by the consumer only, both run freely and are masked on access, so no
+* critical section is needed on either side. A full queue drops the new samples and counts them.
+* The code has no dependency on the OS and compiles on the host (see host/spsc_stress.c).
+*********************************************************************************************************
+*/
+
+#ifndef  SPSC_MODULE_PRESENT
+#define  SPSC_MODULE_PRESENT
+
+#include  <stdint.h>
+
+/*
+*********************************************************************************************************
+*                                               DEFINES
+*********************************************************************************************************
+*/
+
+#ifndef SPSC_SIZE
+#define SPSC_SIZE				64u						// power of 2, samples
+#endif
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+typedef struct spsc_sample {
+	uint32_t	ts;										// CPU cycle counter
+	uint16_t	code;									// ADC reading
+	uint16_t	ch;										// channel of the scan, 0 without scan
+} spsc_sample_t;
+
+typedef struct spsc {
+	// producer side
+	uint32_t		head;
+	uint32_t		produced;							// samples pushed
+	uint32_t		overruns;							// samples dropped because the queue was full
+	// consumer side
+	uint32_t		tail;
+	uint32_t		consumed;
+	spsc_sample_t	buf[SPSC_SIZE];
+} spsc_t;
+
+/*
+*********************************************************************************************************
+*                                         FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+void     spsc_init(spsc_t *q);
+
+// producer: len readings, the last one taken at ts and the others every ts_step cycles before it;
+// returns the number pushed, the rest is counted in overruns
+uint32_t spsc_push_block(spsc_t *q, const volatile uint16_t *codes, uint32_t len, uint32_t ts, uint32_t ts_step);
+
+// producer: len readings of scans over nch channels, per_trig readings taken at each trigger, the last
+// trigger at ts and the others every ts_step cycles before it; channel 0 is the first of every scan
+uint32_t spsc_push_scan(spsc_t *q, const volatile uint16_t *codes, uint32_t len, uint32_t nch, uint32_t per_trig,
+						uint32_t ts, uint32_t ts_step);
+
+// consumer: up to max samples, oldest first
+uint32_t spsc_pop(spsc_t *q, spsc_sample_t *out, uint32_t max);
+
+// samples waiting, from either side
+uint32_t spsc_count(const spsc_t *q);
+
+#endif
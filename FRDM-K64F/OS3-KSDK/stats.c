@@ -0,0 +1,205 @@
+/*
+*********************************************************************************************************
+* Statistics of the readings (see stats.h).
+* A part of a batch (na readings in the sums, nb new ones of sum sb and sum of squares qb) is merged as
+*   m2 += (qb - sb^2 / nb) + d^2 na nb / (na + nb),   d = sb / nb - mean
+* where the first term is exact for a batch of 16 bit readings in 64 bits, and d^2 (1/2^16 code^2) times
+* na nb / n (a weight below nb, in 1/2^16) is taken on 32 bit halves to stay in 64 bits. The mean is
+* sum / n, one 64 bit division per merge, so it never drifts from the readings.
+* The readings of a batch go to one window: a batch that reaches the end of the window is split there.
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <string.h>
+
+#include  <stats.h>
+
+/*
+*********************************************************************************************************
+*                                            LOCAL DEFINES
+*********************************************************************************************************
+*/
+
+#define STATS_LOAD_ACQ(p)		__atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STATS_STORE_REL(p, v)	__atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static void stats_clear(stats_sum_t *sum);
+static void stats_merge(stats_sum_t *sum, uint32_t nb, uint32_t sb, uint64_t qb, uint16_t lo, uint16_t hi);
+static void stats_publish(stats_t *s, uint32_t ts);
+static uint32_t isqrt64(uint64_t x);
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+void stats_init(stats_t *s, uint32_t win_len, const band_cfg_t *cfg){
+	memset(s, 0, sizeof(*s));
+	s->win_len = win_len ? win_len : 1u;
+	stats_clear(&s->cur);
+	stats_clear(&s->all);
+	stats_clear(&s->pub.win);
+	stats_clear(&s->pub.all);
+	stats_set_cfg(s, cfg);
+}
+
+void stats_set_cfg(stats_t *s, const band_cfg_t *cfg){
+	uint32_t b;
+
+	for (b = 1u; b < STATS_BANDS; b++)
+		s->edge[b - 1u] = cfg->volt[b];
+}
+
+void stats_block(stats_t *s, const uint16_t *codes, uint32_t n, uint32_t ts){
+	uint32_t dt = s->all.n ? ts - s->ts : 0u;
+	uint32_t len = n, cnt[STATS_BANDS];
+	uint32_t sb, k, b, e, i;
+	uint64_t qb, share;
+	uint16_t lo, hi, code;
+
+	while (n > 0u){
+		k = s->win_len - s->cur.n;
+		if (k > n)
+			k = n;
+		memset(cnt, 0, sizeof(cnt));
+		sb = 0u;
+		qb = 0u;
+		lo = 0xFFFFu;
+		hi = 0u;
+		for (i = 0u; i < k; i++){
+			code = codes[i];
+			sb += code;
+			qb += (uint32_t)code * code;
+			lo = code < lo ? code : lo;
+			hi = code > hi ? code : hi;
+			s->cur.hist[code >> STATS_BIN_SHIFT]++;
+			// band of the reading, compares without branches
+			for (b = 0u, e = 0u; e < STATS_BANDS - 1u; e++)
+				b += code >= s->edge[e];
+			cnt[b]++;
+		}
+		stats_merge(&s->cur, k, sb, qb, lo, hi);
+		stats_merge(&s->all, k, sb, qb, lo, hi);
+		for (b = 0u; b < STATS_BANDS; b++)
+			if (cnt[b]){
+				share = (uint64_t)dt * cnt[b] / len;
+				s->cur.band_ts[b] += share;
+				s->all.band_ts[b] += share;
+			}
+		codes += k;
+		n -= k;
+		if (s->cur.n == s->win_len)
+			stats_publish(s, ts);
+	}
+	s->ts = ts;
+}
+
+int stats_read(const stats_t *s, stats_snap_t *snap){
+	uint32_t seq, tries;
+
+	for (tries = 0u; tries < STATS_READ_TRIES; tries++){
+		seq = STATS_LOAD_ACQ(&s->seq);
+		if (seq & 1u)
+			continue;
+		memcpy(snap, &s->pub, sizeof(*snap));
+		// the copy completes before the sequence number is read again
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&s->seq, __ATOMIC_RELAXED) == seq)
+			return 0;
+	}
+	return -1;
+}
+
+uint64_t stats_var(const stats_sum_t *sum){
+	return sum->n > 1u ? (sum->m2 << STATS_MEAN_SHIFT) / sum->n : 0u;
+}
+
+uint32_t stats_sd_x100(const stats_sum_t *sum){
+	// 10000 / 2^STATS_MEAN_SHIFT = 625 / 16, within 64 bits for any variance of 16 bit codes
+	return isqrt64(stats_var(sum) * 625u / 16u);
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+static void stats_clear(stats_sum_t *sum){
+	memset(sum, 0, sizeof(*sum));
+	sum->min = 0xFFFFu;
+}
+
+static void stats_merge(stats_sum_t *sum, uint32_t nb, uint32_t sb, uint64_t qb, uint16_t lo, uint16_t hi){
+	uint32_t n = sum->n + nb;
+	int64_t  d;
+	uint64_t d2, w;
+
+	if (nb == 0u)
+		return;
+	sum->m2 += qb - (uint64_t)sb * sb / nb;
+	if (sum->n > 0u){
+		d = (int64_t)(((uint64_t)sb << STATS_MEAN_SHIFT) / nb) - sum->mean;
+		d2 = (uint64_t)(d * d);
+		w = ((uint64_t)sum->n * nb << 16) / n;
+		sum->m2 += ((d2 >> 16) * w + (((d2 & 0xFFFFu) * w) >> 16)) >> 16;
+	}
+	sum->n = n;
+	sum->sum += sb;
+	sum->mean = (int32_t)((sum->sum << STATS_MEAN_SHIFT) / n);
+	sum->min = lo < sum->min ? lo : sum->min;
+	sum->max = hi > sum->max ? hi : sum->max;
+}
+
+// window and total to pub under the sequence lock, then a new window
+static void stats_publish(stats_t *s, uint32_t ts){
+	uint32_t seq = s->seq;
+	uint32_t i;
+
+	for (i = 0u; i < STATS_BINS; i++)
+		s->all.hist[i] += s->cur.hist[i];
+	s->windows++;
+
+	__atomic_store_n(&s->seq, seq + 1u, __ATOMIC_RELAXED);
+	// odd before any of pub changes
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	s->pub.windows = s->windows;
+	s->pub.ts = ts;
+	s->pub.win = s->cur;
+	s->pub.all = s->all;
+	STATS_STORE_REL(&s->seq, seq + 2u);
+
+	stats_clear(&s->cur);
+}
+
+// floor of the square root, bit by bit
+static uint32_t isqrt64(uint64_t x){
+	uint64_t r = 0u;
+	uint64_t bit = (uint64_t)1u << 62;
+
+	while (bit > x)
+		bit >>= 2;
+	while (bit){
+		if (x >= r + bit){
+			x -= r + bit;
+			r = (r >> 1) + bit;
+		} else {
+			r >>= 1;
+		}
+		bit >>= 2;
+	}
+	return (uint32_t)r;
+}
@@ -0,0 +1,101 @@
+/*
+*********************************************************************************************************
+*                                        STATISTICS OF THE READINGS
+*
+* Running statistics of the readings of channel 0 that reach range_check(): minimum, maximum, mean and
+* variance, a histogram of the codes in STATS_BINS bins and the time spent in each band between two
+* VOLT_xx levels, over windows of a set number of readings and over all of them since stats_init().
+* stats_block() takes a batch of AppTask: per reading it only adds to integer sums, the histogram and a
+* count per band; per batch the sums are merged into the window and the total with the pairwise form of
+* Welford's update (the mean in 1/256 code from the exact sum, the sum of squared deviations in codes^2),
+* and the time of the batch is shared out between the bands. At the end of every window the window and
+* the total are published for readers in other tasks by a sequence lock: stats_read() copies them while
+* the sequence number is even and unchanged, so the writer never waits; a reader that is preempted by a
+* publication copies again. The reader must not have a higher priority than the writer.
+* The code has no dependency on the OS and compiles on the host (see host/replay.c -s).
+*********************************************************************************************************
+*/
+
+#ifndef  STATS_MODULE_PRESENT
+#define  STATS_MODULE_PRESENT
+
+#include  <stdint.h>
+#include  <band.h>
+
+/*
+*********************************************************************************************************
+*                                               DEFINES
+*********************************************************************************************************
+*/
+
+#define STATS_BIN_SHIFT			10u						// 1024 codes per bin
+#define STATS_BINS				(0x10000u >> STATS_BIN_SHIFT)
+#define STATS_BANDS				BAND_VOLT_NBR			// from VOLT_00, VOLT_05 ... and above VOLT_30
+#define STATS_MEAN_SHIFT		8u
+#define STATS_BLOCK_MAX			4096u					// readings per stats_block() call
+#define STATS_READ_TRIES		8u
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+// readings of a window or since stats_init()
+typedef struct stats_sum {
+	uint32_t	n;
+	uint16_t	min;
+	uint16_t	max;
+	uint64_t	sum;
+	int32_t		mean;									// codes << STATS_MEAN_SHIFT
+	uint64_t	m2;										// sum of the squared deviations from the mean
+	uint64_t	band_ts[STATS_BANDS];					// cycles in each band
+	uint32_t	hist[STATS_BINS];
+} stats_sum_t;
+
+typedef struct stats_snap {
+	uint32_t	windows;								// windows completed
+	uint32_t	ts;										// cycle counter at the end of the last one
+	stats_sum_t	win;									// last window
+	stats_sum_t	all;									// since stats_init(), up to the end of win
+} stats_snap_t;
+
+typedef struct stats {
+	// writer
+	uint32_t	win_len;								// readings per window
+	uint16_t	edge[STATS_BANDS - 1u];					// first code of bands 1...
+	uint32_t	ts;										// last reading of the previous batch
+	uint32_t	windows;
+	stats_sum_t	cur;									// window in progress
+	stats_sum_t	all;
+	// published
+	uint32_t	seq;									// odd while pub is written
+	stats_snap_t pub;
+} stats_t;
+
+/*
+*********************************************************************************************************
+*                                         FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+// windows of win_len readings, bands of cfg
+void     stats_init(stats_t *s, uint32_t win_len, const band_cfg_t *cfg);
+
+// new bands for the next readings, the times already counted stay where they are
+void     stats_set_cfg(stats_t *s, const band_cfg_t *cfg);
+
+// n readings (up to STATS_BLOCK_MAX), the last one at the cycle counter ts; the time since the last
+// reading of the previous batch is shared out between them, none for the first batch
+void     stats_block(stats_t *s, const uint16_t *codes, uint32_t n, uint32_t ts);
+
+// copy of the last publication, from another task; returns -1 if every try was overrun by the writer
+int      stats_read(const stats_t *s, stats_snap_t *snap);
+
+// variance in codes^2 << STATS_MEAN_SHIFT, 0 below 2 readings
+uint64_t stats_var(const stats_sum_t *sum);
+
+// standard deviation in hundredths of a code, integer only for the tasks without a floating point context
+uint32_t stats_sd_x100(const stats_sum_t *sum);
+
+#endif
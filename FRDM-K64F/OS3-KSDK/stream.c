@@ -0,0 +1,55 @@
+/*
+*********************************************************************************************************
+* Double buffered sample streaming over the UART TX DMA channel (see stream.h).
+* Frames are only started from stream_block(), in AppTask: with one frame per batch and a frame shorter
+* than the batch period on the wire, the waiting frame is always started at the next batch.
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <string.h>
+
+#include  <hal.h>
+#include  <stream.h>
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+void stream_init(stream_t *s, uint32_t baud){
+	memset(s, 0, sizeof(*s));
+	hal_uart_dma_setup(baud);
+}
+
+void stream_poll(stream_t *s){
+	if (s->pending && !hal_uart_dma_busy()){
+		s->tx ^= 1u;
+		s->pending = 0u;
+		hal_uart_dma_send(s->buf[s->tx], s->len[s->tx]);
+		s->frames++;
+		s->bytes += s->len[s->tx];
+	}
+}
+
+void stream_block(stream_t *s, const spsc_sample_t *batch, uint32_t nbr){
+	uint32_t b;
+
+	stream_poll(s);
+	if (s->pending){
+		s->seq++;
+		s->dropped++;
+		return;
+	}
+	// the buffer not given last to the DMA is free
+	b = s->tx ^ 1u;
+	s->len[b] = frame_encode(s->buf[b], s->seq++, batch[0].ts, &batch[0].code, sizeof(spsc_sample_t), nbr);
+	s->pending = 1u;
+	stream_poll(s);
+}
@@ -0,0 +1,51 @@
+/*
+*********************************************************************************************************
+*                                          SAMPLE STREAMING
+*
+* Sends the ADC readings popped by AppTask over the serial port through the UART TX DMA channel, in the
+* frames of frame.h. Each batch is encoded straight from the queue samples into one of two frame
+* buffers: one is being sent by the DMA while the other waits for it. A batch that finds both taken is
+* dropped and the receiver sees a gap in the sequence numbers.
+*********************************************************************************************************
+*/
+
+#ifndef  STREAM_MODULE_PRESENT
+#define  STREAM_MODULE_PRESENT
+
+#include  <stdint.h>
+#include  <frame.h>
+#include  <spsc.h>
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+typedef struct stream {
+	uint8_t		buf[2][FRAME_SIZE_MAX];
+	uint32_t	len[2];
+	uint32_t	tx;										// buffer given last to the DMA
+	uint32_t	pending;								// the other buffer waits for the DMA
+	uint16_t	seq;
+	uint32_t	frames;									// frames handed to the DMA
+	uint32_t	dropped;
+	uint32_t	bytes;
+} stream_t;
+
+/*
+*********************************************************************************************************
+*                                         FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+// sets the UART baud rate and its TX DMA channel
+void stream_init(stream_t *s, uint32_t baud);
+
+// one frame with the readings of a batch, at most FRAME_SAMPLES_MAX
+void stream_block(stream_t *s, const spsc_sample_t *batch, uint32_t nbr);
+
+// starts the waiting frame if the DMA is idle, called by stream_block()
+void stream_poll(stream_t *s);
+
+#endif
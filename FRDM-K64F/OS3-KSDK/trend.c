@@ -0,0 +1,142 @@
+/*
+*********************************************************************************************************
+* Slope of the readings (see trend.h).
+* With n readings and x from the oldest one, dropping it (x = 0) only takes its y out of the sums, then
+* moving the origin by d to the next one gives sxx - 2 d sx + n d^2, sxy - d sy and sx - n d. The fit is
+* slope = (n sxy - sx sy) / (n sxx - sx^2), two 64 bit divisions per call, so it is done once per batch.
+* The coefficient of determination is cxy^2 / (cxx cyy) with cxy = n sxy - sx sy and so on; the products
+* are compared on the top 27 bits of each term, which is plenty for a threshold.
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <string.h>
+
+#include  <trend.h>
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static uint32_t trend_bits(uint64_t v);
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+void trend_init(trend_t *t, uint32_t win){
+	memset(t, 0, sizeof(*t));
+	for (t->win = TREND_WIN_MAX; t->win > 2u && t->win > win; t->win >>= 1)
+		;
+}
+
+void trend_add(trend_t *t, uint16_t code, uint32_t ts){
+	uint32_t u = ts >> TREND_TS_SHIFT;
+	int64_t  x = 0, d, n;
+
+	if (t->nbr == t->win){
+		// the oldest reading is at x = 0
+		t->sy -= t->y[t->head];
+		t->syy -= (int64_t)t->y[t->head] * t->y[t->head];
+		d = (int64_t)((t->u[(t->head + 1u) & (t->win - 1u)] - t->u[t->head]) & TREND_UNIT_MASK);
+		t->head = (t->head + 1u) & (t->win - 1u);
+		n = --t->nbr;
+		t->sxx += n * d * d - 2 * d * t->sx;
+		t->sxy -= d * t->sy;
+		t->sx -= n * d;
+	}
+	if (t->nbr > 0u)
+		x = (int64_t)((u - t->u[t->head]) & TREND_UNIT_MASK);
+	t->u[(t->head + t->nbr) & (t->win - 1u)] = u;
+	t->y[(t->head + t->nbr) & (t->win - 1u)] = code;
+	t->nbr++;
+	t->sx += x;
+	t->sy += code;
+	t->sxx += x * x;
+	t->sxy += x * code;
+	t->syy += (int64_t)code * code;
+}
+
+uint16_t trend_last(const trend_t *t){
+	return t->nbr ? t->y[(t->head + t->nbr - 1u) & (t->win - 1u)] : 0u;
+}
+
+int trend_fit(const trend_t *t, int64_t *slope, int32_t *fit){
+	int64_t  n = t->nbr;
+	int64_t  den, num, cyy, dx;
+	uint64_t a;
+	uint32_t sx, sy;
+
+	if (t->nbr < t->win)
+		return -1;
+	den = n * t->sxx - t->sx * t->sx;
+	cyy = n * t->syy - t->sy * t->sy;
+	if (den <= 0 || cyy <= 0)
+		return -1;
+	num = n * t->sxy - t->sx * t->sy;
+	// 100 cxy^2 >= TREND_R2_PCT cxx cyy, with as many bits dropped from cxy as from cxx and cyy together
+	sx = trend_bits((uint64_t)den);
+	sy = trend_bits((uint64_t)cyy);
+	sx += (sx + sy) & 1u;
+	a = (uint64_t)(num < 0 ? -num : num) >> ((sx + sy) / 2u);
+	if (a * a * 100u < ((uint64_t)den >> sx) * ((uint64_t)cyy >> sy) * TREND_R2_PCT)
+		return -1;
+	*slope = num * ((int64_t)1 << TREND_SLOPE_SHIFT) / den;
+	if (*slope > TREND_SLOPE_MAX || *slope < -TREND_SLOPE_MAX)
+		return -1;
+	// n times the distance of the last reading from the mean time
+	dx = n * (int64_t)((t->u[(t->head + t->nbr - 1u) & (t->win - 1u)] - t->u[t->head]) & TREND_UNIT_MASK) - t->sx;
+	*fit = (int32_t)((t->sy + *slope * dx / ((int64_t)1 << TREND_SLOPE_SHIFT)) / n);
+	return 0;
+}
+
+uint32_t trend_cross(const trend_t *t, uint16_t lo, uint16_t hi, uint32_t min_delta){
+	int64_t  slope, dist, units;
+	int32_t  fit;
+	uint32_t span;
+
+	if (trend_fit(t, &slope, &fit) != 0)
+		return TREND_NEVER;
+	// flat within the noise over the window
+	span = (t->u[(t->head + t->nbr - 1u) & (t->win - 1u)] - t->u[t->head]) & TREND_UNIT_MASK;
+	if ((slope < 0 ? -slope : slope) * span < ((int64_t)min_delta << TREND_SLOPE_SHIFT))
+		return TREND_NEVER;
+	if (slope > 0){
+		if (hi == 0xFFFFu)
+			return TREND_NEVER;
+		dist = (int64_t)hi + 1 - fit;
+	} else {
+		if (lo == 0u)
+			return TREND_NEVER;
+		dist = fit - ((int64_t)lo - 1);
+		slope = -slope;
+	}
+	if (dist <= 0)
+		return 0u;
+	units = (dist << TREND_SLOPE_SHIFT) / slope;
+	return units > (int64_t)(TREND_NEVER >> TREND_TS_SHIFT) ? TREND_NEVER : (uint32_t)units << TREND_TS_SHIFT;
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+// bits to drop for v to fit in 27
+static uint32_t trend_bits(uint64_t v){
+	uint32_t s = 0u;
+
+	while ((v >> s) >= (1u << 27))
+		s++;
+	return s;
+}
@@ -0,0 +1,80 @@
+/*
+*********************************************************************************************************
+*                                        SLOPE OF THE READINGS
+*
+* Least squares line through the last win readings of a channel against their timestamps, kept as running
+* sums so that adding a reading costs the same whatever the window: the oldest one leaves the sums and the
+* origin of time moves to the next one, exactly, in integers. The fit gives the slope and the value of the
+* line at the last reading, and from the band of the current state (alarm_window()) the time left until
+* the line leaves it: alarm_predict() turns that into the early warning state of alarm.h. Readings that
+* do not lie close to a line (a step within the window, coefficient of determination below TREND_R2_PCT)
+* give no fit.
+* Time is counted in units of 2^TREND_TS_SHIFT cycles, so a window of the 32 bit counter spans at most
+* 2^20 units and every sum fits in 64 bits for TREND_WIN_MAX readings of 16 bits.
+*********************************************************************************************************
+*/
+
+#ifndef  TREND_MODULE_PRESENT
+#define  TREND_MODULE_PRESENT
+
+#include  <stdint.h>
+
+/*
+*********************************************************************************************************
+*                                               DEFINES
+*********************************************************************************************************
+*/
+
+#define TREND_WIN_MAX			64u						// power of 2, readings
+#define TREND_TS_SHIFT			12u						// unit of time in cycles, log2
+#define TREND_UNIT_MASK			(0xFFFFFFFFu >> TREND_TS_SHIFT)
+#define TREND_SLOPE_SHIFT		16u						// slope in codes per 2^16 units
+#define TREND_SLOPE_MAX			((int64_t)1 << 32)		// steeper is a step, left to range_check()
+#define TREND_R2_PCT			90u
+#define TREND_NEVER				0xFFFFFFFFu
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+typedef struct trend {
+	uint32_t	win;
+	uint32_t	nbr;									// readings in the window
+	uint32_t	head;									// index of the oldest one
+	uint32_t	u[TREND_WIN_MAX];						// timestamps in units
+	uint16_t	y[TREND_WIN_MAX];
+	int64_t		sx;										// sums with x from the oldest reading
+	int64_t		sy;
+	int64_t		sxx;
+	int64_t		sxy;
+	int64_t		syy;
+} trend_t;
+
+/*
+*********************************************************************************************************
+*                                         FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+// win rounded down to a power of 2 within 2 and TREND_WIN_MAX
+void     trend_init(trend_t *t, uint32_t win);
+
+// reading taken at the cycle counter ts, the oldest one leaves a full window
+void     trend_add(trend_t *t, uint16_t code, uint32_t ts);
+
+// last reading added, 0 if none
+uint16_t trend_last(const trend_t *t);
+
+// slope in codes per 2^TREND_SLOPE_SHIFT units and value of the line at the last reading; returns -1
+// until the window is full, or if the readings are too close in time, change too fast or are too far
+// from a line
+int      trend_fit(const trend_t *t, int64_t *slope, int32_t *fit);
+
+// cycles from the last reading until the line leaves the codes [lo, hi] through the edge it moves to,
+// 0 if it already has; TREND_NEVER without a fit, if that side of the range is open (lo = 0, hi = 0xFFFF)
+// or if the line moves by less than min_delta codes over the window
+uint32_t trend_cross(const trend_t *t, uint16_t lo, uint16_t hi, uint32_t min_delta);
+
+#endif
@@ -0,0 +1,180 @@
+/*
+*********************************************************************************************************
+* Differential check of the band table of band.c against the floating point range checking it replaced:
+* the range_check() of the first alarm.c is kept below, with the VOLT_xx/THRE_xx of a band_cfg_t in place
+* of the macros and the state in arguments. Every ADC code goes through both in every (led_rate,
+* current_led) state, for the VOLT_xx/THRE_xx of app_cfg.h and for -r random tables of the kind the
+* calibration builds (calib.h); any difference in the next state is printed and the exit status is 1.
+*
+* Build (from FRDM-K64F):
+*   gcc -O2 -DAPP_HOST_BUILD -IOS3-KSDK OS3-KSDK/band.c host/band_diff.c -o band_diff
+*
+* Usage: band_diff [-r random tables] [-s seed]
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <unistd.h>
+
+#include  <app_cfg.h>
+#include  <band.h>
+
+/*
+*********************************************************************************************************
+*                                            LOCAL DEFINES
+*********************************************************************************************************
+*/
+
+#define DIFF_CODE_NBR			65536u
+#define DIFF_PRINT_MAX			20u						// differences printed per table
+
+// factors of the first app_cfg.h
+#define THRE_FACT_LEFT			0
+#define THRE_FACT_RIGHT			1.1
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static uint32_t diff_table(const band_cfg_t *cfg, const char *name);
+static void     range_check_float(const band_cfg_t *cfg, uint32_t adc_in, uint32_t *rate, uint32_t *led);
+static void     random_cfg(band_cfg_t *cfg);
+
+/*
+*********************************************************************************************************
+*                                                main()
+*********************************************************************************************************
+*/
+
+int main(int argc, char **argv){
+	band_cfg_t	cfg;
+	uint32_t	tables = 100u, diffs, r;
+	char		name[32];
+	int			opt;
+
+	while ((opt = getopt(argc, argv, "r:s:")) != -1){
+		switch (opt){
+			case 'r': tables = (uint32_t)atoi(optarg); break;
+			case 's': srand((unsigned)atoi(optarg)); break;
+			default:
+				fprintf(stderr, "usage: %s [-r tables] [-s seed]\n", argv[0]);
+				return 1;
+		}
+	}
+
+	diffs = diff_table(&band_cfg_default, "app_cfg.h");
+	for (r = 0u; r < tables; r++){
+		random_cfg(&cfg);
+		snprintf(name, sizeof(name), "random %u", r);
+		diffs += diff_table(&cfg, name);
+	}
+	printf("%u tables x %u states x %u codes: %u differences\n", 1u + tables, BAND_STATE_NBR, DIFF_CODE_NBR, diffs);
+	return diffs ? 1 : 0;
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+// differences of the next state between the table and the floating point checks
+static uint32_t diff_table(const band_cfg_t *cfg, const char *name){
+	static band_table_t	tbl;
+	uint32_t			diffs = 0u, s, code;
+
+	if (band_build(&tbl, cfg) != 0){
+		printf("%s: more than %u segments in a state\n", name, BAND_SEG_MAX);
+		return 1u;
+	}
+	for (s = 0u; s < BAND_STATE_NBR; s++){
+		for (code = 0u; code < DIFF_CODE_NBR; code++){
+			uint32_t rate = s / BAND_LED_NBR, led = s % BAND_LED_NBR;
+			uint8_t  act = band_classify(&tbl, s, code);
+			uint32_t t_rate = BAND_ACT_RATE(act) != BAND_KEEP ? BAND_ACT_RATE(act) : rate;
+			uint32_t t_led = BAND_ACT_LED(act) != BAND_KEEP ? BAND_ACT_LED(act) : led;
+
+			range_check_float(cfg, code, &rate, &led);
+			if (rate == t_rate && led == t_led)
+				continue;
+			if (diffs++ < DIFF_PRINT_MAX)
+				printf("%s: state %2u code %5u: float rate %u led %u, table rate %u led %u\n", name, s, code,
+						rate, led, t_rate, t_led);
+		}
+	}
+	return diffs;
+}
+
+// range_check() of the first alarm.c; led is a BAND_LED_xx index instead of a GPIO pin
+static void range_check_float(const band_cfg_t *cfg, uint32_t adc_in, uint32_t *rate, uint32_t *led){
+	const uint16_t *v = cfg->volt;
+	const uint16_t *t = cfg->thre;
+	uint32_t led_rate = *rate, current_led = *led;
+	uint8_t  s_g = (led_rate == BLINK_SHORT) && (current_led == BAND_LED_GREEN);
+	uint8_t  s_b = (led_rate == BLINK_SHORT) && (current_led == BAND_LED_BLUE);
+	uint8_t  s_r = (led_rate == BLINK_SHORT) && (current_led == BAND_LED_RED);
+	uint8_t  l_g = (led_rate == BLINK_LONG) && (current_led == BAND_LED_GREEN);
+	uint8_t  l_b = (led_rate == BLINK_LONG) && (current_led == BAND_LED_BLUE);
+	uint8_t  l_r = (led_rate == BLINK_LONG) && (current_led == BAND_LED_RED);
+
+	/* Rate of blink check */
+	// 0.0 <= V < 0.5 | 1.0 <= V < 1.5 | 2.0 <= V < 2.5
+	if (led_rate != BLINK_LONG &&(
+			((adc_in >= v[0])&&
+					(adc_in < (v[1] - THRE_FACT_RIGHT * t[1] * s_g)))||
+			((adc_in >= (v[2] + THRE_FACT_LEFT * t[2] * s_g))&&
+					(adc_in < (v[3] - THRE_FACT_RIGHT * t[3] * s_b)))||
+			((adc_in >= (v[4] + THRE_FACT_LEFT * t[4] * s_b))&&
+					(adc_in < (v[5] - THRE_FACT_RIGHT * t[5] * s_r)))))
+		*rate = BLINK_LONG;
+	// 0.5 <= V < 1.0 | 1.5 <= V < 2.0 | 2.5 <= V < 3.0
+	else if (led_rate != BLINK_SHORT &&(
+			((adc_in >= (v[1] + THRE_FACT_LEFT * t[1] * l_g))&&
+					(adc_in < (v[2] - THRE_FACT_RIGHT * t[2] * l_b)))||
+			((adc_in >= (v[3] + THRE_FACT_LEFT * t[3] * l_b))&&
+					(adc_in < (v[4] - THRE_FACT_RIGHT * t[4] * l_r)))||
+			((adc_in >= (v[5] + THRE_FACT_LEFT * t[5] * l_r))&&
+					(adc_in < (v[6] - THRE_FACT_RIGHT * t[6] * l_r)))))
+		*rate = BLINK_SHORT;
+	// 3.0 <= V
+	else if (led_rate != BLINK_NONE &&
+			(adc_in >= (v[6] + THRE_FACT_LEFT * t[6] * s_r)))
+		*rate = BLINK_NONE;
+	/* LED color check */
+	// 0.0 <= V < 1.0 ---> GREEN
+	if ((current_led != BAND_LED_GREEN) &&
+			(adc_in >= v[0]) &&
+			(adc_in < (v[2] - THRE_FACT_RIGHT * t[2] * (current_led == BAND_LED_BLUE))))
+		*led = BAND_LED_GREEN;
+	// 1.0 <= V < 2.0 ---> BLUE
+	else if ((current_led != BAND_LED_BLUE) &&
+			(adc_in >= (v[2] + THRE_FACT_LEFT * t[2] * (current_led == BAND_LED_GREEN))) &&
+			(adc_in <  (v[4] - THRE_FACT_RIGHT * t[4] * (current_led == BAND_LED_RED))))
+		*led = BAND_LED_BLUE;
+	// 2.0 <= V 	  ---> RED
+	else if ((current_led != BAND_LED_RED) &&
+			(adc_in >= (v[4] + THRE_FACT_LEFT * t[4] * (current_led == BAND_LED_BLUE))))
+		*led = BAND_LED_RED;
+}
+
+// levels 0.5V apart within a few percent, VOLT_00 at 0 or a small offset, hysteresis up to a quarter
+// of a band
+static void random_cfg(band_cfg_t *cfg){
+	uint32_t i;
+
+	cfg->volt[0] = (uint16_t)(rand() % 4 ? 0 : rand() % 200);
+	cfg->thre[0] = 0u;
+	for (i = 1u; i < BAND_VOLT_NBR; i++){
+		cfg->volt[i] = (uint16_t)(i * 9900u + (uint32_t)(rand() % 600));
+		cfg->thre[i] = (uint16_t)(rand() % 2 ? rand() % 40 : rand() % 2400);
+	}
+}
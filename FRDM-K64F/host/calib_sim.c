@@ -0,0 +1,244 @@
+/*
+*********************************************************************************************************
+* Host check of the band calibration of calib.c against synthetic noisy inputs. The board is modelled as
+* code = (V / 3.3 * 65535) * gain + offset + gaussian noise, quantized and clipped to 16 bits; the
+* calibration of app.c (APP_CFG_CALIB_SAMPLES readings per level, in batches of APP_CFG_ADC_BLOCK_SIZE)
+* runs on it -r times and the following figures are reported:
+*  - error of each boundary VOLT_xx from the true code of its level, against sigma / sqrt(samples)
+*  - noise estimated by the calibration against the modelled one, and the hysteresis widths THRE_xx
+*  - duration of the bursts at the calibration rate of FTM0 (APP_CFG_CALIB_TRIG_PS/MOD)
+* Then a slow noisy triangle 0 V -> 3.3 V -> 0 V goes through the range checking with the table of
+* app_cfg.h and with the calibrated one: the transitions beyond those of the noise-free triangle are
+* chatter, and the voltage of each transition is compared with the level of its boundary.
+*
+* Build (from FRDM-K64F):
+*   gcc -O2 -DAPP_HOST_BUILD -IOS3-KSDK -Ihost OS3-KSDK/band.c OS3-KSDK/calib.c host/calib_sim.c -o calib_sim -lm
+*
+* Usage: calib_sim [-n noise lsb] [-g gain] [-o offset lsb] [-N samples per level] [-r runs] [-s seed]
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <math.h>
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <unistd.h>
+
+#include  <app_cfg.h>
+#include  <band.h>
+#include  <calib.h>
+
+/*
+*********************************************************************************************************
+*                                            LOCAL DEFINES
+*********************************************************************************************************
+*/
+
+#define RAMP_SAMPLES			400000u					// per direction of the triangle
+#define LEVEL_V					0.5
+#define FULL_SCALE_V			3.3
+#define BUS_HZ					60000000.0
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+typedef struct board {
+	double	gain;
+	double	offset;
+	double	noise;
+} board_t;
+
+typedef struct ramp_result {
+	uint32_t	transitions[BAND_VOLT_NBR];				// by nearest level
+	double		max_err_mv;								// transition voltage from the nearest level
+} ramp_result_t;
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static uint16_t      board_read(const board_t *b, double v);
+static double        gauss(void);
+static ramp_result_t ramp(const band_table_t *tbl, const board_t *b);
+static uint32_t      step(const band_table_t *tbl, uint32_t state, uint16_t code);
+static void          print_ramp(const char *name, const ramp_result_t *noisy, const ramp_result_t *clean);
+
+/*
+*********************************************************************************************************
+*                                                main()
+*********************************************************************************************************
+*/
+
+int main(int argc, char **argv){
+	board_t		board = { 1.03, 150.0, 20.0 };
+	board_t		clean;
+	uint32_t	samples = APP_CFG_CALIB_SAMPLES, runs = 100u, seed = 1u;
+	uint32_t	r, i, n, failed = 0u;
+	double		err_sum[BAND_VOLT_NBR] = { 0.0 }, err_max[BAND_VOLT_NBR] = { 0.0 };
+	double		sigma_sum[BAND_VOLT_NBR] = { 0.0 };
+	static calib_t	cal;
+	static band_table_t	tbl_default, tbl_calib;
+	band_cfg_t	cfg;
+	uint16_t	batch[APP_CFG_ADC_BLOCK_SIZE];
+	ramp_result_t	def, def_clean, cb, cb_clean;
+	int			opt, err;
+
+	while ((opt = getopt(argc, argv, "n:g:o:N:r:s:")) != -1) {
+		switch (opt) {
+		case 'n': board.noise = atof(optarg); break;
+		case 'g': board.gain = atof(optarg); break;
+		case 'o': board.offset = atof(optarg); break;
+		case 'N': samples = (uint32_t)atoi(optarg); break;
+		case 'r': runs = (uint32_t)atoi(optarg); break;
+		case 's': seed = (uint32_t)atoi(optarg); break;
+		default:
+			fprintf(stderr, "usage: %s [-n noise lsb] [-g gain] [-o offset lsb] [-N samples per level] [-r runs] [-s seed]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (samples < CALIB_SAMPLES_MIN || samples > CALIB_SAMPLES_MAX || runs == 0u) {
+		fprintf(stderr, "samples per level within %u and %u, at least one run\n", CALIB_SAMPLES_MIN, CALIB_SAMPLES_MAX);
+		return 1;
+	}
+	srand(seed);
+
+	for (r = 0u; r < runs; r++) {
+		calib_init(&cal);
+		for (i = 0u; i < BAND_VOLT_NBR; i++) {
+			for (n = 0u; n < samples; n += APP_CFG_ADC_BLOCK_SIZE) {
+				uint32_t k, len = samples - n < APP_CFG_ADC_BLOCK_SIZE ? samples - n : APP_CFG_ADC_BLOCK_SIZE;
+
+				for (k = 0u; k < len; k++)
+					batch[k] = board_read(&board, i * LEVEL_V);
+				calib_add(&cal, i, batch, len);
+			}
+		}
+		err = calib_build(&cal, &cfg);
+		if (err != CALIB_OK) {
+			failed++;
+			continue;
+		}
+		for (i = 1u; i < BAND_VOLT_NBR; i++) {
+			double truth = (i * LEVEL_V / FULL_SCALE_V * 65535.0) * board.gain + board.offset;
+			double e = fabs(cfg.volt[i] - truth);
+
+			err_sum[i] += e;
+			if (e > err_max[i])
+				err_max[i] = e;
+			sigma_sum[i] += calib_sigma_x100(&cal, i) / 100.0;
+		}
+	}
+
+	printf("board: gain %.3f offset %.1f LSB noise %.2f LSB, %u samples per level, %u runs, %u failed\n",
+			board.gain, board.offset, board.noise, samples, runs, failed);
+	printf("calibration bursts: %.2f s at %.0f Hz\n",
+			BAND_VOLT_NBR * samples * (double)(APP_CFG_CALIB_TRIG_MOD + 1u) * (1u << APP_CFG_CALIB_TRIG_PS) / BUS_HZ,
+			BUS_HZ / ((double)(APP_CFG_CALIB_TRIG_MOD + 1u) * (1u << APP_CFG_CALIB_TRIG_PS)));
+	if (failed == runs)
+		return 1;
+	printf("level   true code  VOLT (last)  |err| mean   max  (sigma/sqrt(N) %.2f)  sigma est  THRE  app_cfg VOLT  THRE\n",
+			board.noise / sqrt((double)samples));
+	for (i = 1u; i < BAND_VOLT_NBR; i++)
+		printf("%u.%u V   %9.1f  %11u  %10.2f  %5.2f  %32.2f  %4u  %12u  %4u\n", i / 2u, (i % 2u) * 5u,
+				(i * LEVEL_V / FULL_SCALE_V * 65535.0) * board.gain + board.offset, cfg.volt[i],
+				err_sum[i] / (runs - failed), err_max[i], sigma_sum[i] / (runs - failed), cfg.thre[i],
+				band_cfg_default.volt[i], band_cfg_default.thre[i]);
+
+	// range checking on the triangle, with and without noise
+	if (band_build(&tbl_default, &band_cfg_default) != 0 || band_build(&tbl_calib, &cfg) != 0)
+		return 1;
+	clean = board;
+	clean.noise = 0.0;
+	def_clean = ramp(&tbl_default, &clean);
+	def = ramp(&tbl_default, &board);
+	cb_clean = ramp(&tbl_calib, &clean);
+	cb = ramp(&tbl_calib, &board);
+	printf("triangle    transitions (chatter) at 0.5 V  1.0 V  1.5 V  2.0 V  2.5 V  3.0 V   max error from level\n");
+	print_ramp("app_cfg.h", &def, &def_clean);
+	print_ramp("calibrated", &cb, &cb_clean);
+	return 0;
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+static uint16_t board_read(const board_t *b, double v){
+	double code = (v / FULL_SCALE_V * 65535.0) * b->gain + b->offset;
+
+	if (b->noise > 0.0)
+		code += b->noise * gauss();
+	code = floor(code + 0.5);
+	return (uint16_t)(code < 0.0 ? 0.0 : code > 65535.0 ? 65535.0 : code);
+}
+
+// Box-Muller
+static double gauss(void){
+	double u1 = (rand() + 1.0) / ((double)RAND_MAX + 2.0);
+	double u2 = (rand() + 1.0) / ((double)RAND_MAX + 2.0);
+
+	return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static ramp_result_t ramp(const band_table_t *tbl, const board_t *b){
+	ramp_result_t res = { { 0u }, 0.0 };
+	uint32_t state = BAND_STATE(BLINK_NONE, BAND_LED_RED);
+	uint32_t k;
+
+	for (k = 0u; k < 2u * RAMP_SAMPLES; k++) {
+		double v = FULL_SCALE_V * (k < RAMP_SAMPLES ? k : 2u * RAMP_SAMPLES - k) / RAMP_SAMPLES;
+		uint32_t next = step(tbl, state, board_read(b, v));
+
+		if (next != state) {
+			double level = floor(v / LEVEL_V + 0.5);
+			double e = 1000.0 * fabs(v - LEVEL_V * level);
+
+			res.transitions[level < BAND_VOLT_NBR ? (uint32_t)level : BAND_VOLT_NBR - 1u]++;
+			if (e > res.max_err_mv)
+				res.max_err_mv = e;
+			state = next;
+		}
+	}
+	return res;
+}
+
+// next state of the range checking, as range_check() does it
+static uint32_t step(const band_table_t *tbl, uint32_t state, uint16_t code){
+	uint8_t act = band_classify(tbl, state, code);
+	uint32_t rate = state / BAND_LED_NBR;
+	uint32_t led = state % BAND_LED_NBR;
+
+	if (act == BAND_NOP)
+		return state;
+	if (BAND_ACT_RATE(act) != BAND_KEEP)
+		rate = BAND_ACT_RATE(act);
+	if (BAND_ACT_LED(act) != BAND_KEEP)
+		led = BAND_ACT_LED(act);
+	return BAND_STATE(rate, led);
+}
+
+// transitions of the noisy triangle by level, those beyond the noise-free ones in parentheses
+static void print_ramp(const char *name, const ramp_result_t *noisy, const ramp_result_t *clean){
+	uint32_t i, total = 0u, extra = 0u;
+
+	for (i = 0u; i < BAND_VOLT_NBR; i++) {
+		total += noisy->transitions[i];
+		extra += noisy->transitions[i] - clean->transitions[i];
+	}
+	printf("%-10s  %11u (%7u)   ", name, total, extra);
+	for (i = 1u; i < BAND_VOLT_NBR; i++)
+		printf(" %5u", noisy->transitions[i] - clean->transitions[i]);
+	printf("   %17.1f mV\n", noisy->max_err_mv);
+}
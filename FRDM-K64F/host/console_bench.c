@@ -0,0 +1,357 @@
+/*
+*********************************************************************************************************
+* Host bench of the command console (console.c) against the sampling path, on the simulator of hal_sim.c.
+*  - host time of console_poll() per line and per byte for each command of the flood, executed from a ring
+*    as on the board
+*  - two simulated runs of -t seconds: without input, then with the flood received back to back at -r baud
+*    on UART0 RX. The DMA interrupt and AppTask run as in sim_main.c, AppTask above the console task, which
+*    reads the ring every -p ms when AppTask is not ready and is preempted by it at the next DMA interrupt;
+*    its time is charged in cycles per byte (-y) and per line (-l), estimates for the board from the host
+*    times above. The flood writes the bands and the blink moduli with the values in use, so both runs see
+*    the same transitions; each run reports the delay from the FTM0 trigger of the last sample of a batch to
+*    AppTask (PROF_TRIG_TO_TASK) and of a transition to its LED (PROF_TRIG_TO_LED), the ADC transfers held
+*    behind the console channel, queue overruns and what the console executed. The difference between the
+*    runs is what the console costs the sampling path.
+* With -i the bytes are received by an interrupt each, as the BSP_Ser driver does, instead of the eDMA
+* channel 7, for comparison.
+* Code takes no simulated time here: the masked sections of the commands (cfg_mask of prof.h) are measured
+* on the board, "prof" on the console prints them.
+*
+* Build (from FRDM-K64F):
+*   gcc -O2 -DAPP_HOST_BUILD -IOS3-KSDK -Ihost OS3-KSDK/alarm.c OS3-KSDK/band.c OS3-KSDK/trend.c \
+*       OS3-KSDK/journal.c OS3-KSDK/spsc.c OS3-KSDK/prof.c OS3-KSDK/console.c host/hal_sim.c \
+*       host/console_bench.c -o console_bench -lm
+*
+* Usage: console_bench [-t seconds] [-r baud] [-p poll ms] [-s ftm0 prescaler] [-b samples per DMA half]
+*                      [-c task cycles per sample] [-y console cycles per byte] [-l console cycles per line] [-i]
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <time.h>
+#include  <unistd.h>
+
+#include  <app_cfg.h>
+#include  <hal.h>
+#include  <alarm.h>
+#include  <band.h>
+#include  <spsc.h>
+#include  <prof.h>
+#include  <console.h>
+#include  "hal_sim.h"
+
+/*
+*********************************************************************************************************
+*                                            LOCAL DEFINES
+*********************************************************************************************************
+*/
+
+#define BENCH_CTX_SWITCH_CYCLES	200u					// as SIM_CTX_SWITCH_CYCLES of sim_main.c
+#define BENCH_BLOCK_MAX			(SPSC_SIZE / 2u)
+#define BENCH_RING				APP_CFG_CONSOLE_RING
+#define BENCH_HOST_RING			4096u					// ring of the host time test
+#define BENCH_HOST_POLLS		2000u
+#define BENCH_HOST_EXECS		20000u
+#define BENCH_FLOOD_MAX			256u
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+typedef struct bench_run {
+	prof_stat_t	to_task;
+	prof_stat_t	to_led;
+	uint64_t	dma_irqs;
+	uint64_t	ftm1_irqs;
+	uint64_t	rx_bytes;
+	uint64_t	rx_lost;
+	uint64_t	dma_wait;
+	uint64_t	isr_cycles;
+	uint64_t	console_cycles;
+	uint32_t	overruns;
+	uint32_t	transitions;
+	uint32_t	trig_cycles;
+	console_t	c;
+} bench_run_t;
+
+/*
+*********************************************************************************************************
+*                                       LOCAL GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+static volatile uint16_t	adc_ring[2u * BENCH_BLOCK_MAX];
+static uint32_t				adc_ring_half;
+static uint32_t				adc_block_size;
+static spsc_t				adc_queue;
+static spsc_sample_t		adc_batch[BENCH_BLOCK_MAX];
+static uint32_t				sem_count;					// task semaphore of AppTask
+
+static volatile uint8_t		console_ring[BENCH_RING];
+static uint32_t				rx_head;					// of the receive interrupt, -i
+static char					flood[BENCH_FLOOD_MAX];
+static uint32_t				flood_len;
+
+static double				seconds = 10.0;
+static uint32_t				baud = 115200u;
+static uint32_t				poll_ms = APP_CFG_CONSOLE_POLL_MS;
+static uint32_t				task_cycles = 400u;
+static uint32_t				byte_cycles = 20u;
+static uint32_t				line_cycles = 20000u;
+static int					rx_isr;
+static int					ftm0_ps = -1;
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static double   host_seconds(void);
+static void     bench_host(void);
+static void     bench_sim(int flooded, bench_run_t *r);
+static void     bench_print(const char *name, const bench_run_t *r);
+static void     dma_int_handler(void);
+static void     ftm1_int_handler(void);
+static void     uart_rx_handler(void);
+static uint16_t input(uint64_t cycle, uint32_t adc, uint32_t adch, void *arg);
+
+/*
+*********************************************************************************************************
+*                                                main()
+*********************************************************************************************************
+*/
+
+int main(int argc, char **argv){
+	bench_run_t	quiet, flooded;
+	int			opt;
+
+	adc_block_size = APP_CFG_ADC_BLOCK_SIZE;
+	while ((opt = getopt(argc, argv, "t:r:p:s:b:c:y:l:i")) != -1){
+		switch (opt){
+			case 't': seconds = atof(optarg); break;
+			case 'r': baud = (uint32_t)atoi(optarg); break;
+			case 'p': poll_ms = (uint32_t)atoi(optarg); break;
+			case 's': ftm0_ps = atoi(optarg); break;
+			case 'b':
+				adc_block_size = (uint32_t)atoi(optarg);
+				adc_block_size = adc_block_size < 1u ? 1u : adc_block_size > BENCH_BLOCK_MAX ? BENCH_BLOCK_MAX : adc_block_size;
+				break;
+			case 'c': task_cycles = (uint32_t)atoi(optarg); break;
+			case 'y': byte_cycles = (uint32_t)atoi(optarg); break;
+			case 'l': line_cycles = (uint32_t)atoi(optarg); break;
+			case 'i': rx_isr = 1; break;
+			default:
+				fprintf(stderr, "usage: %s [-t s] [-r baud] [-p ms] [-s ps] [-b block] [-c cycles] [-y cycles] [-l cycles] [-i]\n",
+						argv[0]);
+				return 1;
+		}
+	}
+	poll_ms = poll_ms < 1u ? 1u : poll_ms;
+
+	// the flood rewrites the defaults, as they are at the start of each run
+	alarm_init();
+	flood_len = (uint32_t)snprintf(flood, sizeof(flood),
+			"volt 3 %u\r\nthre 3 %u\r\nblink long 0x%04X\r\nthre 6 %u\r\nblink shortest %u\r\nvolt 1 %u\r\n",
+			alarm_cfg()->volt[3], alarm_cfg()->thre[3], alarm_blink_mod(BLINK_LONG), alarm_cfg()->thre[6],
+			alarm_blink_mod(BLINK_SHORTEST), alarm_cfg()->volt[1]);
+
+	bench_host();
+	bench_sim(0, &quiet);
+	printf("simulation          %.1f s, %u baud, poll %u ms, %u samples per batch, %u+%u cycles per sample,\n"
+		   "                    trigger every %u cycles, console %u cycles per byte %u per line, receive by %s\n",
+			seconds, baud, poll_ms, adc_block_size, BENCH_CTX_SWITCH_CYCLES, task_cycles, quiet.trig_cycles, byte_cycles,
+			line_cycles, rx_isr ? "interrupt" : "eDMA");
+	bench_print("quiet", &quiet);
+	bench_sim(1, &flooded);
+	bench_print("flood", &flooded);
+	printf("added by the flood  trig_to_task max %+d cycles, trig_to_led max %+d cycles\n",
+			(int)(flooded.to_task.max - quiet.to_task.max), (int)(flooded.to_led.max - quiet.to_led.max));
+	return 0;
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+static double host_seconds(void){
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// the flood repeated in a ring, padded with empty lines, polled half a ring at a time
+static void bench_host(void){
+	static volatile uint8_t ring[BENCH_HOST_RING];
+	console_t	c;
+	uint32_t	i, head = 0u, copies = BENCH_HOST_RING / flood_len;
+	char		line[CONSOLE_LINE_MAX];
+	const char *s, *e;
+	double		t;
+
+	for (i = 0u; i < BENCH_HOST_RING; i++)
+		ring[i] = i < copies * flood_len ? (uint8_t)flood[i % flood_len] : '\n';
+
+	alarm_init();
+	console_init(&c, ring, BENCH_HOST_RING);
+	t = host_seconds();
+	for (i = 0u; i < BENCH_HOST_POLLS; i++){
+		head = (head + BENCH_HOST_RING / 2u) & (BENCH_HOST_RING - 1u);
+		console_poll(&c, head);
+	}
+	t = host_seconds() - t;
+	printf("host console_poll   %u lines %u errors, %.1f ns per line, %.2f ns per byte\n", c.lines, c.errors,
+			t * 1e9 / c.lines, t * 1e9 / c.bytes);
+
+	// each command alone, copied back before every call
+	for (s = flood; *s != '\0'; s = e + 2){
+		e = strchr(s, '\r');
+		t = host_seconds();
+		for (i = 0u; i < BENCH_HOST_EXECS; i++){
+			memcpy(line, s, (size_t)(e - s));
+			line[e - s] = '\0';
+			console_exec(&c, line);
+		}
+		t = host_seconds() - t;
+		printf("  %-22.*s %6.1f ns\n", (int)(e - s), s, t * 1e9 / BENCH_HOST_EXECS);
+	}
+}
+
+// AppTask as in sim_main.c, the console task in the time AppTask leaves, interrupted at every cycle
+static void bench_sim(int flooded, bench_run_t *r){
+	uint64_t	end = (uint64_t)(seconds * SIM_CORE_HZ);
+	uint64_t	poll_cycles = (uint64_t)poll_ms * SIM_CORE_HZ / 1000u;
+	uint64_t	due = poll_cycles, left = 0u;
+	uint32_t	bytes, lines, n, i;
+
+	memset(r, 0, sizeof(*r));
+	sim_reset();
+	sim_set_input(input, NULL);
+	adc_ring_half = 0u;
+	sem_count = 0u;
+	rx_head = 0u;
+	spsc_init(&adc_queue);
+	hal_ftm0_adc0_trigger_setup(adc_ring, 2u * adc_block_size, dma_int_handler);
+	if (ftm0_ps >= 0)
+		sim_regs.ftm0.sc = (sim_regs.ftm0.sc & ~SIM_FTM_SC_PS_MASK) | ((uint32_t)ftm0_ps & SIM_FTM_SC_PS_MASK);
+	hal_ftm1_setup(ftm1_int_handler);
+	hal_uart_dma_setup(baud);
+	alarm_init();
+	console_init(&r->c, console_ring, BENCH_RING);
+	if (rx_isr)
+		sim_set_uart_rx_isr(uart_rx_handler);
+	else
+		hal_uart_rx_dma_setup(console_ring, BENCH_RING);
+	prof_reset();
+
+	while (sim_now() < end){
+		if (flooded && sim_uart_rx_waiting() < flood_len)
+			sim_uart_rx((const uint8_t *)flood, flood_len);
+
+		if (sem_count > 0u){
+			sem_count = 0u;
+			sim_advance(BENCH_CTX_SWITCH_CYCLES);
+			while ((n = spsc_pop(&adc_queue, adc_batch, adc_block_size)) > 0u){
+				PROF_RECORD(PROF_TRIG_TO_TASK, hal_ts_get() - adc_batch[n - 1u].ts);
+				for (i = 0u; i < n; i++){
+					sim_advance(task_cycles);
+					if (range_check(adc_batch[i].code)){
+						r->transitions++;
+						PROF_RECORD(PROF_TRIG_TO_LED, alarm_change_ts - adc_batch[i].ts);
+					}
+				}
+			}
+			continue;
+		}
+
+		// console task: the commands act at once, their time is then spent a cycle at a time so that
+		// AppTask takes over as soon as it is ready
+		if (left == 0u && sim_now() >= due){
+			bytes = r->c.bytes;
+			lines = r->c.lines;
+			console_poll(&r->c, rx_isr ? rx_head & (BENCH_RING - 1u) : hal_uart_rx_head());
+			left = BENCH_CTX_SWITCH_CYCLES + (uint64_t)(r->c.bytes - bytes) * byte_cycles +
+				   (uint64_t)(r->c.lines - lines) * line_cycles;
+			r->console_cycles += left;
+			due = sim_now() + poll_cycles;
+		}
+		if (left > 0u){
+			sim_advance(1u);
+			if (--left == 0u)
+				due = sim_now() + poll_cycles;
+			continue;
+		}
+		if (!sim_idle())
+			break;
+	}
+
+	prof_snapshot(PROF_TRIG_TO_TASK, &r->to_task);
+	prof_snapshot(PROF_TRIG_TO_LED, &r->to_led);
+	r->dma_irqs = sim_stats.dma_irqs;
+	r->ftm1_irqs = sim_stats.ftm1_irqs;
+	r->rx_bytes = sim_stats.uart_rx_bytes;
+	r->rx_lost = sim_stats.uart_rx_lost;
+	r->dma_wait = sim_stats.dma_wait_cycles;
+	r->isr_cycles = sim_stats.isr_cycles;
+	r->overruns = adc_queue.overruns;
+	r->trig_cycles = hal_adc_trigger_cycles();
+}
+
+static void bench_print(const char *name, const bench_run_t *r){
+	double secs = (double)sim_now() / SIM_CORE_HZ;
+
+	printf("%s\n", name);
+	printf("  trig_to_task      min %u max %u mean %.0f cycles (%llu batches)\n", r->to_task.min, r->to_task.max,
+			r->to_task.nbr ? (double)r->to_task.sum / r->to_task.nbr : 0.0, (unsigned long long)r->to_task.nbr);
+	printf("  trig_to_led       min %u max %u mean %.0f cycles (%u transitions)\n", r->to_led.min, r->to_led.max,
+			r->to_led.nbr ? (double)r->to_led.sum / r->to_led.nbr : 0.0, r->transitions);
+	printf("  irqs              dma %llu ftm1 %llu, queue overruns %u, adc transfers held %llu cycles\n",
+			(unsigned long long)r->dma_irqs, (unsigned long long)r->ftm1_irqs, r->overruns,
+			(unsigned long long)r->dma_wait);
+	printf("  uart rx           %llu bytes, %llu lost, console read %u, peak %u of %u\n",
+			(unsigned long long)r->rx_bytes, (unsigned long long)r->rx_lost, r->c.bytes, r->c.peak, BENCH_RING);
+	printf("  console           %u lines (%.0f/s) %u errors %u dropped, cpu %.3f%%\n", r->c.lines, r->c.lines / secs,
+			r->c.errors, r->c.dropped, 100.0 * r->console_cycles / sim_now());
+	printf("  isr cpu           %.3f%%\n", 100.0 * r->isr_cycles / sim_now());
+}
+
+static void dma_int_handler(void){
+	spsc_push_scan(&adc_queue, &adc_ring[adc_ring_half * adc_block_size], adc_block_size, 1u, 1u,
+				   hal_adc_trigger_ts(), hal_adc_trigger_cycles());
+	adc_ring_half ^= 1u;
+	sem_count++;
+	hal_dma_clear_int();
+}
+
+static void ftm1_int_handler(void){
+	hal_ftm1_clear_int();
+	blink_toggle();
+}
+
+// BSP_Ser: the byte of UART0 D into the ring
+static void uart_rx_handler(void){
+	console_ring[rx_head++ & (BENCH_RING - 1u)] = (uint8_t)sim_regs.uart_d;
+}
+
+// triangle 0 V -> 3.3 V -> 0 V in 2 s, several transitions per run
+static uint16_t input(uint64_t cycle, uint32_t adc, uint32_t adch, void *arg){
+	double phase = (double)(cycle % (2u * SIM_CORE_HZ)) / (2.0 * SIM_CORE_HZ);
+
+	(void)adc;
+	(void)adch;
+	(void)arg;
+	return (uint16_t)(65535.0 * (phase < 0.5 ? 2.0 * phase : 2.0 - 2.0 * phase));
+}
@@ -0,0 +1,256 @@
+/*
+*********************************************************************************************************
+* Host measure of the oversampling of the readings: ADC0 hardware averaging (hal_adc_config()) and the CIC
+* decimator of decim.c, on the simulator of hal_sim.c. Every setting keeps the output rate of app_cfg.h,
+* FTM0 running 2^n times faster for a decimation by 2^n, and a constant input with gaussian noise of -n LSB
+* per conversion goes through the FTM0 -> ADC0 -> eDMA chain, the DMA interrupt and decim_batch() as in
+* AppTask. Reported per setting:
+*  - noise floor: standard deviation of the outputs and effective bits 16 - log2(sqrt(12 (var + 1/12))),
+*    the output being quantized to 16 bits itself; the offset of their mean from the input
+*  - THRE_xx the calibration would set from it (5 sigma, calib.h)
+*  - delay of an output: half the conversions of the mean and the group delay of the decimator
+*  - per output: conversions, DMA interrupts (AppTask wake-ups), interrupt cycles of the model and host
+*    cycles of decim_batch() from decim_bench(), printed first in the format of APP_CFG_FILTER_BENCH_EN;
+*    and the fraction of time ADC0 is converting, against the energy of the conversions
+* A setting whose conversions do not fit in its trigger period is skipped.
+*
+* Build (from FRDM-K64F):
+*   gcc -O2 -DAPP_HOST_BUILD -IOS3-KSDK -Ihost OS3-KSDK/decim.c OS3-KSDK/spsc.c host/hal_sim.c host/decim_bench.c \
+*       -o decim_bench -lm
+*
+* Usage: decim_bench [-n noise lsb] [-N outputs per setting] [-o ADC options] [-s seed]
+* -o takes the HAL_ADC_xx bits of hal.h as a number: 1 high speed, 2 low power, 4 long sample, 16 to 48
+* the ADCK divider.
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <math.h>
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <time.h>
+#include  <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include  <x86intrin.h>
+#endif
+
+#include  <app_cfg.h>
+#include  <hal.h>
+#include  <spsc.h>
+#include  <decim.h>
+#include  "hal_sim.h"
+
+/*
+*********************************************************************************************************
+*                                            LOCAL DEFINES
+*********************************************************************************************************
+*/
+
+#define BENCH_BLOCK				APP_CFG_ADC_BLOCK_SIZE
+#define BENCH_INPUT				30000.37				// code of the input, between two codes
+#define BENCH_THRE_SIGMAS		5.0						// as calib.c
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+typedef struct bench_res {
+	double		sigma;
+	double		offset;
+	double		enob;
+	double		delay_ms;
+	double		conv_per_out;
+	double		irq_per_out;
+	double		isr_per_out;
+	double		busy;									// fraction of time converting
+} bench_res_t;
+
+/*
+*********************************************************************************************************
+*                                       LOCAL GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+static volatile uint16_t	adc_ring[2u * BENCH_BLOCK];
+static uint32_t				adc_ring_half;
+static spsc_t				adc_queue;
+static spsc_sample_t		adc_batch[BENCH_BLOCK];
+static uint32_t				sem_count;
+static double				noise = 20.0;
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static int      bench_run(uint32_t avg_log2, uint32_t shift, uint32_t order, uint32_t opts, uint32_t outputs,
+						  bench_res_t *r);
+static uint32_t conv_bus(uint32_t avg_log2, uint32_t opts);
+static void     dma_int_handler(void);
+static uint16_t input(uint64_t cycle, uint32_t adc, uint32_t adch, void *arg);
+static double   gauss(void);
+static uint32_t host_cycles(void);
+
+/*
+*********************************************************************************************************
+*                                                main()
+*********************************************************************************************************
+*/
+
+int main(int argc, char **argv){
+	static const uint32_t avgs[] = { 0u, 2u, 3u, 4u, 5u };
+	static const uint32_t decims[] = { 0u, 2u, 4u, 6u };
+	decim_bench_t	host;
+	bench_res_t		r;
+	uint32_t		outputs = 4000u, opts = 0u;
+	uint32_t		a, d, order, shift;
+	int				opt;
+
+	while ((opt = getopt(argc, argv, "n:N:o:s:")) != -1){
+		switch (opt){
+			case 'n': noise = atof(optarg); break;
+			case 'N': outputs = (uint32_t)atoi(optarg); break;
+			case 'o': opts = (uint32_t)strtoul(optarg, NULL, 0); break;
+			case 's': srand((unsigned)atoi(optarg)); break;
+			default:
+				fprintf(stderr, "usage: %s [-n lsb] [-N outputs] [-o opts] [-s seed]\n", argv[0]);
+				return 1;
+		}
+	}
+	outputs = outputs < 100u ? 100u : outputs;
+
+	decim_bench(&host, host_cycles, 100000u);
+	for (order = 1u; order <= DECIM_ORDER_MAX; order++)
+		for (shift = 1u; shift <= DECIM_LOG2_MAX; shift++)
+			printf("decim order %u by %2u %6u.%02u cycles/output\n", order, 1u << shift,
+					host.cycles_x100[order - 1u][shift - 1u] / 100u, host.cycles_x100[order - 1u][shift - 1u] % 100u);
+
+	printf("\ninput %.2f + noise %.1f LSB per conversion, %u outputs per setting at %.1f Hz, ADC options 0x%02X\n",
+			BENCH_INPUT, noise, outputs, (double)SIM_CORE_HZ / (((APP_CFG_ADC_TRIG_MOD + 1u) << APP_CFG_ADC_TRIG_PS) *
+			SIM_BUS_DIV), opts);
+	printf("hw avg  decim order   sigma  offset   ENOB   THRE  delay ms  conv/out  irq/out  isr cyc/out  decim cyc/out  adc busy\n");
+	for (a = 0u; a < sizeof(avgs) / sizeof(avgs[0]); a++)
+		for (d = 0u; d < sizeof(decims) / sizeof(decims[0]); d++)
+			for (order = 1u; order <= (decims[d] ? DECIM_ORDER_MAX : 1u); order++){
+				if (bench_run(avgs[a], decims[d], order, opts, outputs, &r) != 0){
+					printf("%6u  %5u %5u   conversions longer than the trigger period\n", 1u << avgs[a],
+							1u << decims[d], order);
+					continue;
+				}
+				printf("%6u  %5u %5u  %6.2f  %+6.2f  %5.2f  %5.0f  %8.2f  %8.1f  %7.3f  %11.1f  %13.2f  %7.4f%%\n",
+						1u << avgs[a], 1u << decims[d], order, r.sigma, r.offset, r.enob,
+						BENCH_THRE_SIGMAS * r.sigma, r.delay_ms, r.conv_per_out, r.irq_per_out, r.isr_per_out,
+						decims[d] ? host.cycles_x100[order - 1u][decims[d] - 1u] / 100.0 : 0.0, 100.0 * r.busy);
+			}
+	return 0;
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+// one setting, FTM0 at 2^shift times the rate of app_cfg.h; returns -1 if the conversions do not fit
+static int bench_run(uint32_t avg_log2, uint32_t shift, uint32_t order, uint32_t opts, uint32_t outputs,
+					 bench_res_t *r){
+	static decim_t	decim;
+	uint32_t		period = (APP_CFG_ADC_TRIG_MOD + 1u) << (APP_CFG_ADC_TRIG_PS - shift);
+	uint32_t		got = 0u, skip = 2u * order, n, i;
+	double			sum = 0.0, sum2 = 0.0, mean, var;
+
+	if (conv_bus(avg_log2, opts) >= period)
+		return -1;
+	sim_reset();
+	sim_set_input(input, NULL);
+	adc_ring_half = 0u;
+	sem_count = 0u;
+	spsc_init(&adc_queue);
+	hal_ftm0_adc0_trigger_setup(adc_ring, 2u * BENCH_BLOCK, dma_int_handler);
+	hal_adc_config(avg_log2, opts);
+	hal_adc_trigger_rate(APP_CFG_ADC_TRIG_PS - shift, APP_CFG_ADC_TRIG_MOD);
+	decim_init(&decim, shift, order);
+
+	// the first outputs, of a window started at 0, are left out
+	while (got < outputs + skip && sim_idle()){
+		if (sem_count == 0u)
+			continue;
+		sem_count = 0u;
+		while ((n = spsc_pop(&adc_queue, adc_batch, BENCH_BLOCK)) > 0u){
+			n = decim_batch(&decim, adc_batch, n);
+			for (i = 0u; i < n; i++, got++){
+				if (got < skip || got >= outputs + skip)
+					continue;
+				sum += adc_batch[i].code;
+				sum2 += (double)adc_batch[i].code * adc_batch[i].code;
+			}
+		}
+	}
+	mean = sum / outputs;
+	var = sum2 / outputs - mean * mean;
+	var = var < 0.0 ? 0.0 : var;
+	r->sigma = sqrt(var);
+	r->offset = mean - BENCH_INPUT;
+	r->enob = 16.0 - log2(sqrt(12.0 * (var + 1.0 / 12.0)));
+	r->delay_ms = 1e3 * (conv_bus(avg_log2, opts) * SIM_BUS_DIV / 2.0 +
+						 order * ((1u << shift) - 1u) / 2.0 * period * SIM_BUS_DIV) / SIM_CORE_HZ;
+	r->conv_per_out = (double)sim_stats.adc_conversions / got;
+	r->irq_per_out = (double)sim_stats.dma_irqs / got;
+	r->isr_per_out = (double)sim_stats.isr_cycles / got;
+	r->busy = (double)conv_bus(avg_log2, opts) / period;
+	return 0;
+}
+
+// bus cycles of a reading, as APP_ADC_CONV_BUS of app.c
+static uint32_t conv_bus(uint32_t avg_log2, uint32_t opts){
+	uint32_t per = 25u + ((opts & HAL_ADC_LSMP) ? 20u : 0u) + ((opts & HAL_ADC_HSC) ? 2u : 0u);
+
+	return 5u + ((3u + (1u << avg_log2) * per) << ((opts >> 4) & 0x3u));
+}
+
+static void dma_int_handler(void){
+	spsc_push_scan(&adc_queue, &adc_ring[adc_ring_half * BENCH_BLOCK], BENCH_BLOCK, 1u, 1u,
+				   hal_adc_trigger_ts(), hal_adc_trigger_cycles());
+	adc_ring_half ^= 1u;
+	sem_count++;
+	hal_dma_clear_int();
+}
+
+static uint16_t input(uint64_t cycle, uint32_t adc, uint32_t adch, void *arg){
+	double code = BENCH_INPUT + noise * gauss();
+
+	(void)cycle;
+	(void)adc;
+	(void)adch;
+	(void)arg;
+	code = code < 0.0 ? 0.0 : code > 65535.0 ? 65535.0 : code;
+	return (uint16_t)lrint(code);
+}
+
+static double gauss(void){
+	double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+	double v = (rand() + 1.0) / (RAND_MAX + 2.0);
+
+	return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+static uint32_t host_cycles(void){
+#if defined(__x86_64__) || defined(__i386__)
+	return (uint32_t)__rdtsc();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+#endif
+}
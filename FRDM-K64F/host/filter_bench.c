@@ -0,0 +1,70 @@
+/*
+*********************************************************************************************************
+* Host benchmark of the filters of filter.c, printed in the same format as APP_CFG_FILTER_BENCH_EN on the
+* board. Cycles are read with RDTSC on x86 (reference cycles), nanoseconds elsewhere.
+*
+* Build (from FRDM-K64F):
+*   gcc -O2 -DAPP_HOST_BUILD -IOS3-KSDK OS3-KSDK/filter.c host/filter_bench.c -o filter_bench
+*
+* Usage: filter_bench [rounds]
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include  <x86intrin.h>
+#endif
+
+#include  <filter.h>
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static uint32_t host_cycles(void);
+
+/*
+*********************************************************************************************************
+*                                                main()
+*********************************************************************************************************
+*/
+
+int main(int argc, char **argv){
+	filter_bench_t	bench;
+	uint32_t		rounds = argc > 1 ? (uint32_t)atoi(argv[1]) : 100000u;
+	uint32_t		type;
+
+	filter_bench(&bench, host_cycles, rounds);
+	for (type = 0u; type < FILTER_TYPE_NBR; type++)
+		printf("filter %-8s %5u.%02u cycles/sample\n", filter_name(type),
+				bench.cycles_x100[type] / 100u, bench.cycles_x100[type] % 100u);
+	return 0;
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+static uint32_t host_cycles(void){
+#if defined(__x86_64__) || defined(__i386__)
+	return (uint32_t)__rdtsc();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+#endif
+}
@@ -0,0 +1,692 @@
+/*
+*********************************************************************************************************
+* Host fleet simulator: the range checking of alarm.c run as thousands of independent monitors, to compare
+* threshold and filter policies over a whole fleet of battery profiles before flashing any of them.
+* An instance has the blink state of one board (BAND_STATE(led_rate, led), as monitor.c keeps it), a filter
+* of filter.c and a policy: the bands of app_cfg.h with the THRE_xx scaled by a factor, and a filter type.
+* Instances are kept as one array per field (state, window, counters, ...) and read a profile from their
+* own starting point with their own offset in codes: synthetic curves with gaussian noise (discharge to
+* 0.4 V, float around VOLT_15, load pulses from 2.3 V, slow sag between 0.8 and 2.2 V) or the channel 0
+* readings of capture files.
+*
+* Readings go by batches of FLEET_BLOCK: the batch is filled and filtered, then its minimum and maximum
+* (loops the compiler vectorizes) are compared with the codes where the state of the instance holds
+* (band_window() around the last reading); only a batch leaving them is classified reading by reading.
+* Instances are grouped in shards of FLEET_SHARD of one policy. Each thread starts with an equal range of
+* shards and, once it is empty, steals the upper half of the range of another one; a range is one 64 bit
+* word (first and end shard) changed by compare and swap, by its owner and by the thieves.
+*
+* The fleet is run with 1, 2, 4 ... up to -j threads and every run must leave the same counters in every
+* instance (exit 2 otherwise). Reported: per policy and profile the transitions and alarms (entries in the
+* red band) per instance and hour at the trigger rate of app_cfg.h, the instances that alarmed and the
+* batches that had to be scanned; per thread count the readings per second, speedup and shards stolen.
+* -v first replays the first instances of every policy through filter_block() and range_check() of
+* alarm.c and checks the transitions and alarms against the fleet.
+*
+* Build (from FRDM-K64F):
+*   gcc -O2 -pthread -DAPP_HOST_BUILD -IOS3-KSDK -Ihost OS3-KSDK/alarm.c OS3-KSDK/band.c OS3-KSDK/trend.c \
+*       OS3-KSDK/journal.c OS3-KSDK/prof.c OS3-KSDK/filter.c OS3-KSDK/capture.c host/hal_sim.c host/fleet_sim.c \
+*       -o fleet_sim -lm
+*
+* Usage: fleet_sim [-n instances] [-N readings per instance] [-j threads] [-h thre factors] [-f filters]
+*                  [-o offset codes] [-s noise lsb] [-v] [capture files]
+* -h and -f take comma separated lists, e.g. -h 0.5,1,2 -f none,mavg8,fir,median5: one policy per pair.
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <fcntl.h>
+#include  <math.h>
+#include  <pthread.h>
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <sys/mman.h>
+#include  <sys/stat.h>
+#include  <time.h>
+#include  <unistd.h>
+
+#include  <app_cfg.h>
+#include  <hal.h>
+#include  <alarm.h>
+#include  <band.h>
+#include  <filter.h>
+#include  <capture.h>
+#include  "hal_sim.h"
+
+/*
+*********************************************************************************************************
+*                                            LOCAL DEFINES
+*********************************************************************************************************
+*/
+
+#define FLEET_SHARD				64u						// instances per shard, all of one policy
+#define FLEET_BLOCK				FILTER_BLOCK_MAX		// readings per batch
+#define FLEET_POLICY_MAX		16u
+#define FLEET_PROFILE_MAX		16u
+#define FLEET_THREAD_MAX		64u
+#define FLEET_SYN_LEN			65536u					// readings of a synthetic profile
+#define FLEET_VERIFY_NBR		4u						// instances per policy replayed by -v
+#define FLEET_NONE				0xFFFFFFFFu
+
+#define RANGE(first, end)		(((uint64_t)(end) << 32) | (first))
+#define RANGE_FIRST(r)			((uint32_t)(r))
+#define RANGE_END(r)			((uint32_t)((r) >> 32))
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+typedef struct fleet_policy {
+	band_cfg_t		cfg;
+	band_table_t	tbl;
+	uint32_t		filter;
+	uint32_t		mavg_log2;
+	char			name[32];
+} fleet_policy_t;
+
+// readings followed by a copy of the first FLEET_BLOCK, so that a batch never wraps
+typedef struct fleet_profile {
+	uint16_t	   *code;
+	uint32_t		len;
+	char			name[32];
+} fleet_profile_t;
+
+// instances, one array per field
+typedef struct fleet {
+	uint32_t		nbr;
+	uint8_t		   *state;								// BAND_STATE(rate, led)
+	uint8_t		   *policy;
+	uint8_t		   *profile;
+	int32_t		   *offset;								// codes added to the profile
+	uint32_t	   *pos;								// next reading of the profile
+	uint16_t	   *win_lo;								// codes where the state holds, none if lo > hi
+	uint16_t	   *win_hi;
+	uint32_t	   *changes;
+	uint32_t	   *alarms;
+	uint32_t	   *scans;								// batches classified reading by reading
+	filter_t	   *filter;
+} fleet_t;
+
+typedef struct fleet_worker {
+	uint64_t		range;								// shards [first, end) left to this thread
+	pthread_t		th;
+	uint32_t		id;
+	uint32_t		stolen;
+} __attribute__((aligned(64))) fleet_worker_t;
+
+/*
+*********************************************************************************************************
+*                                       LOCAL GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+static fleet_policy_t	policies[FLEET_POLICY_MAX];
+static uint32_t			policy_nbr;
+static fleet_profile_t	profiles[FLEET_PROFILE_MAX];
+static uint32_t			profile_nbr;
+static fleet_t			fleet;
+static fleet_worker_t	workers[FLEET_THREAD_MAX];
+static uint32_t			worker_nbr;
+static uint32_t			batches = 256u;					// per instance
+static int32_t			offset_max = 300;
+static double			noise = 20.0;
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static int      policies_make(const char *thre_list, const char *filter_list);
+static int      filter_parse(const char *s, uint32_t *type, uint32_t *mavg_log2);
+static void     profile_synth(uint32_t kind);
+static int      profile_load(const char *path);
+static void     fleet_alloc(uint32_t nbr);
+static void     fleet_reset(void);
+static void     fleet_variant(uint32_t i, uint32_t *profile, int32_t *offset, uint32_t *pos);
+static double   fleet_run(uint32_t threads);
+static uint64_t fleet_hash(void);
+static void     fleet_report(void);
+static void    *worker_main(void *arg);
+static uint32_t shard_take(fleet_worker_t *w);
+static uint32_t shard_steal(fleet_worker_t *w);
+static void     instance_run(uint32_t i);
+static uint32_t batch_fill(uint16_t *restrict buf, const fleet_profile_t *prof, uint32_t pos, int32_t offset);
+static int      verify(void);
+static uint32_t mix32(uint32_t x);
+static double   gauss(uint32_t *seed);
+static double   trig_hz(void);
+static double   wall(void);
+
+/*
+*********************************************************************************************************
+*                                                main()
+*********************************************************************************************************
+*/
+
+int main(int argc, char **argv){
+	const char	   *thre_list = "1,2";
+	const char	   *filter_list = "none,fir";
+	uint32_t		nbr = 8192u, threads, max_threads = (uint32_t)sysconf(_SC_NPROCESSORS_ONLN);
+	uint32_t		k, steal_sum;
+	uint64_t		hash = 0u;
+	double			t, t1 = 0.0, readings;
+	int				opt, check = 0;
+
+	while ((opt = getopt(argc, argv, "n:N:j:h:f:o:s:v")) != -1){
+		switch (opt){
+			case 'n': nbr = (uint32_t)atoi(optarg); break;
+			case 'N': batches = ((uint32_t)atoi(optarg) + FLEET_BLOCK - 1u) / FLEET_BLOCK; break;
+			case 'j': max_threads = (uint32_t)atoi(optarg); break;
+			case 'h': thre_list = optarg; break;
+			case 'f': filter_list = optarg; break;
+			case 'o': offset_max = atoi(optarg); break;
+			case 's': noise = atof(optarg); break;
+			case 'v': check = 1; break;
+			default:
+				fprintf(stderr, "usage: %s [-n instances] [-N readings] [-j threads] [-h thre factors] [-f filters] "
+						"[-o offset codes] [-s noise lsb] [-v] [capture files]\n", argv[0]);
+				return 1;
+		}
+	}
+	max_threads = max_threads < 1u ? 1u : max_threads > FLEET_THREAD_MAX ? FLEET_THREAD_MAX : max_threads;
+	batches = batches < 1u ? 1u : batches;
+	if (policies_make(thre_list, filter_list) != 0)
+		return 1;
+	for (; optind < argc; optind++)
+		if (profile_load(argv[optind]) != 0)
+			return 1;
+	if (profile_nbr == 0u)
+		for (k = 0u; k < 4u; k++)
+			profile_synth(k);
+
+	// every policy sees the same instances: whole shards of each
+	nbr = (nbr + FLEET_SHARD * policy_nbr - 1u) / (FLEET_SHARD * policy_nbr) * (FLEET_SHARD * policy_nbr);
+	fleet_alloc(nbr);
+	if (check && verify() != 0)
+		return 2;
+
+	readings = (double)nbr * batches * FLEET_BLOCK;
+	printf("%u instances, %u policies, %u profiles, %u readings each (%.1f min at %.1f Hz), %u shards of %u\n",
+			nbr, policy_nbr, profile_nbr, batches * FLEET_BLOCK, batches * FLEET_BLOCK / trig_hz() / 60.0, trig_hz(),
+			nbr / FLEET_SHARD, FLEET_SHARD);
+	printf("threads   wall s   M readings/s   speedup   efficiency   shards stolen\n");
+	for (threads = 1u; ; threads = threads * 2u < max_threads ? threads * 2u : max_threads){
+		fleet_reset();
+		t = fleet_run(threads);
+		if (threads == 1u){
+			t1 = t;
+			hash = fleet_hash();
+		} else if (fleet_hash() != hash){
+			fprintf(stderr, "%u threads: counters differ from the run on one thread\n", threads);
+			return 2;
+		}
+		for (steal_sum = 0u, k = 0u; k < threads; k++)
+			steal_sum += workers[k].stolen;
+		printf("%7u  %7.3f  %13.1f  %8.2f  %10.0f%%  %14u\n", threads, t, readings / t / 1e6, t1 / t,
+				100.0 * t1 / t / threads, steal_sum);
+		if (threads >= max_threads)
+			break;
+	}
+	printf("\n");
+	fleet_report();
+	return 0;
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+// one policy per pair of a THRE_xx factor and a filter
+static int policies_make(const char *thre_list, const char *filter_list){
+	char		thre_buf[256], filter_buf[256];
+	char	   *f, *fs, *h, *hs;
+	uint32_t	j;
+
+	snprintf(filter_buf, sizeof(filter_buf), "%s", filter_list);
+	for (f = strtok_r(filter_buf, ",", &fs); f != NULL; f = strtok_r(NULL, ",", &fs)){
+		snprintf(thre_buf, sizeof(thre_buf), "%s", thre_list);
+		for (h = strtok_r(thre_buf, ",", &hs); h != NULL; h = strtok_r(NULL, ",", &hs)){
+			fleet_policy_t	*p = &policies[policy_nbr];
+			double			fact = atof(h);
+
+			if (policy_nbr == FLEET_POLICY_MAX){
+				fprintf(stderr, "more than %u policies\n", FLEET_POLICY_MAX);
+				return -1;
+			}
+			if (filter_parse(f, &p->filter, &p->mavg_log2) != 0){
+				fprintf(stderr, "unknown filter %s (none, mavg2 ... mavg%u, fir, median3, median5)\n", f,
+						FILTER_MAVG_LEN_MAX);
+				return -1;
+			}
+			p->cfg = band_cfg_default;
+			for (j = 1u; j < BAND_VOLT_NBR; j++){
+				double thre = band_cfg_default.thre[j] * fact + 0.5;
+
+				p->cfg.thre[j] = (uint16_t)(thre < 0.0 ? 0.0 : thre > 65535.0 ? 65535.0 : thre);
+			}
+			if (band_build(&p->tbl, &p->cfg) != 0){
+				fprintf(stderr, "THRE_xx x %s: bands band_build() refuses\n", h);
+				return -1;
+			}
+			snprintf(p->name, sizeof(p->name), "thre x%s %s", h, f);
+			policy_nbr++;
+		}
+	}
+	return policy_nbr > 0u ? 0 : -1;
+}
+
+static int filter_parse(const char *s, uint32_t *type, uint32_t *mavg_log2){
+	uint32_t t, len;
+
+	*mavg_log2 = 0u;
+	if (strncmp(s, "mavg", 4u) == 0){
+		len = (uint32_t)atoi(s + 4);
+		while ((1u << *mavg_log2) < len)
+			(*mavg_log2)++;
+		*type = FILTER_MAVG;
+		return (len >= 2u && len <= FILTER_MAVG_LEN_MAX && (len & (len - 1u)) == 0u) ? 0 : -1;
+	}
+	for (t = 0u; t < FILTER_TYPE_NBR; t++)
+		if (t != FILTER_MAVG && strcmp(s, filter_name(t)) == 0){
+			*type = t;
+			return 0;
+		}
+	return -1;
+}
+
+static void profile_synth(uint32_t kind){
+	static const char *const names[] = { "discharge", "float 1.5V", "load pulses", "sag" };
+	fleet_profile_t	*prof = &profiles[profile_nbr++];
+	uint32_t		seed = 0x9E3779B9u * (kind + 1u);
+	uint32_t		t;
+
+	prof->len = FLEET_SYN_LEN;
+	prof->code = malloc((FLEET_SYN_LEN + FLEET_BLOCK) * sizeof(uint16_t));
+	snprintf(prof->name, sizeof(prof->name), "%s", names[kind]);
+	for (t = 0u; t < FLEET_SYN_LEN; t++){
+		double x = (double)t / FLEET_SYN_LEN;
+		double v;
+
+		switch (kind){
+			case 0u:											// knee at the end of a long plateau
+				v = 60800.0 - (60800.0 - 8000.0) * (0.15 * x + 0.85 * pow(x, 6.0));
+				break;
+			case 1u:
+				v = VOLT_15 + 200.0 * sin(2.0 * M_PI * t / 4096.0);
+				break;
+			case 2u:											// 256 readings of load every 2048
+				v = VOLT_25 - 1500.0 - ((t % 2048u) < 256u ? 10000.0 : 0.0);
+				break;
+			default:
+				v = 29800.0 + 13500.0 * sin(2.0 * M_PI * x * 4.0);
+				break;
+		}
+		v += noise * gauss(&seed);
+		prof->code[t] = (uint16_t)lrint(v < 0.0 ? 0.0 : v > 65535.0 ? 65535.0 : v);
+	}
+	memcpy(&prof->code[FLEET_SYN_LEN], prof->code, FLEET_BLOCK * sizeof(uint16_t));
+}
+
+// readings of channel 0 of a capture file
+static int profile_load(const char *path){
+	fleet_profile_t		*prof = &profiles[profile_nbr];
+	const capture_hdr_t	*hdr;
+	const capture_rec_t	*rec;
+	const uint8_t		*map;
+	struct stat			st;
+	uint32_t			nbr, i;
+	int					fd, err;
+
+	if (profile_nbr == FLEET_PROFILE_MAX){
+		fprintf(stderr, "more than %u profiles\n", FLEET_PROFILE_MAX);
+		return -1;
+	}
+	if ((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st) != 0){
+		perror(path);
+		return -1;
+	}
+	map = (size_t)st.st_size >= sizeof(*hdr) ? mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	close(fd);
+	hdr = (const capture_hdr_t *)map;
+	if (map == MAP_FAILED || (err = capture_check(hdr, (size_t)st.st_size)) != CAPTURE_OK){
+		fprintf(stderr, "%s: not a valid capture\n", path);
+		return -1;
+	}
+	rec = (const capture_rec_t *)(map + hdr->hdr_size);
+	nbr = hdr->nbr != CAPTURE_NBR_STREAM ? hdr->nbr :
+		  (uint32_t)(((size_t)st.st_size - hdr->hdr_size) / sizeof(capture_rec_t));
+	prof->code = malloc(((size_t)nbr + FLEET_BLOCK) * sizeof(uint16_t));
+	for (prof->len = 0u, i = 0u; i < nbr; i++)
+		if (rec[i].ch == 0u)
+			prof->code[prof->len++] = rec[i].code;
+	munmap((void *)map, (size_t)st.st_size);
+	if (prof->len < FLEET_BLOCK){
+		fprintf(stderr, "%s: fewer than %u readings of channel 0\n", path, FLEET_BLOCK);
+		return -1;
+	}
+	memcpy(&prof->code[prof->len], prof->code, FLEET_BLOCK * sizeof(uint16_t));
+	snprintf(prof->name, sizeof(prof->name), "%s", strrchr(path, '/') ? strrchr(path, '/') + 1 : path);
+	profile_nbr++;
+	return 0;
+}
+
+static void fleet_alloc(uint32_t nbr){
+	fleet.nbr = nbr;
+	fleet.state = calloc(nbr, sizeof(*fleet.state));
+	fleet.policy = calloc(nbr, sizeof(*fleet.policy));
+	fleet.profile = calloc(nbr, sizeof(*fleet.profile));
+	fleet.offset = calloc(nbr, sizeof(*fleet.offset));
+	fleet.pos = calloc(nbr, sizeof(*fleet.pos));
+	fleet.win_lo = calloc(nbr, sizeof(*fleet.win_lo));
+	fleet.win_hi = calloc(nbr, sizeof(*fleet.win_hi));
+	fleet.changes = calloc(nbr, sizeof(*fleet.changes));
+	fleet.alarms = calloc(nbr, sizeof(*fleet.alarms));
+	fleet.scans = calloc(nbr, sizeof(*fleet.scans));
+	fleet.filter = calloc(nbr, sizeof(*fleet.filter));
+	if (fleet.filter == NULL || fleet.scans == NULL){
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+}
+
+// initial state of alarm_init() in every instance
+static void fleet_reset(void){
+	uint32_t i, profile;
+
+	for (i = 0u; i < fleet.nbr; i++){
+		const fleet_policy_t *p = &policies[(i / FLEET_SHARD) % policy_nbr];
+
+		fleet.policy[i] = (uint8_t)(p - policies);
+		fleet_variant(i, &profile, &fleet.offset[i], &fleet.pos[i]);
+		fleet.profile[i] = (uint8_t)profile;
+		fleet.state[i] = (uint8_t)BAND_STATE(BLINK_NONE, BAND_LED_RED);
+		fleet.win_lo[i] = 1u;
+		fleet.win_hi[i] = 0u;
+		fleet.changes[i] = 0u;
+		fleet.alarms[i] = 0u;
+		fleet.scans[i] = 0u;
+		filter_init(&fleet.filter[i], p->filter, p->mavg_log2);
+	}
+}
+
+// profile, offset and start of instance i, the same for its rank in the shards of every policy
+static void fleet_variant(uint32_t i, uint32_t *profile, int32_t *offset, uint32_t *pos){
+	uint32_t v = (i / FLEET_SHARD / policy_nbr) * FLEET_SHARD + i % FLEET_SHARD;
+	uint32_t h = mix32(v + 1u);
+
+	*profile = v % profile_nbr;
+	*offset = (int32_t)(h % (2u * (uint32_t)offset_max + 1u)) - offset_max;
+	*pos = mix32(h) % profiles[*profile].len;
+}
+
+static double fleet_run(uint32_t threads){
+	uint32_t	shards = fleet.nbr / FLEET_SHARD;
+	uint32_t	k;
+	double		t;
+
+	worker_nbr = threads;
+	for (k = 0u; k < threads; k++){
+		workers[k].id = k;
+		workers[k].stolen = 0u;
+		workers[k].range = RANGE(shards * k / threads, shards * (k + 1u) / threads);
+	}
+	t = wall();
+	for (k = 1u; k < threads; k++)
+		pthread_create(&workers[k].th, NULL, worker_main, &workers[k]);
+	worker_main(&workers[0]);
+	for (k = 1u; k < threads; k++)
+		pthread_join(workers[k].th, NULL);
+	return wall() - t;
+}
+
+// FNV-1a of the counters and state of every instance
+static uint64_t fleet_hash(void){
+	uint64_t h = 0xCBF29CE484222325u;
+	uint32_t i;
+
+	for (i = 0u; i < fleet.nbr; i++){
+		h = (h ^ fleet.state[i]) * 0x100000001B3u;
+		h = (h ^ fleet.changes[i]) * 0x100000001B3u;
+		h = (h ^ fleet.alarms[i]) * 0x100000001B3u;
+		h = (h ^ fleet.scans[i]) * 0x100000001B3u;
+	}
+	return h;
+}
+
+static void fleet_report(void){
+	double		hours = batches * FLEET_BLOCK / trig_hz() / 3600.0;
+	uint32_t	p, prof, i;
+
+	printf("policy                profile        instances   transitions/h   alarms/h   alarmed   scanned batches\n");
+	for (p = 0u; p < policy_nbr; p++)
+		for (prof = 0u; prof < profile_nbr; prof++){
+			uint64_t changes = 0u, alarms = 0u, scans = 0u;
+			uint32_t nbr = 0u, alarmed = 0u;
+
+			for (i = 0u; i < fleet.nbr; i++){
+				if (fleet.policy[i] != p || fleet.profile[i] != prof)
+					continue;
+				nbr++;
+				changes += fleet.changes[i];
+				alarms += fleet.alarms[i];
+				scans += fleet.scans[i];
+				alarmed += fleet.alarms[i] > 0u;
+			}
+			if (nbr == 0u)
+				continue;
+			printf("%-20s  %-12s  %10u  %14.1f  %9.2f  %7.1f%%  %15.2f%%\n", policies[p].name, profiles[prof].name,
+					nbr, changes / (nbr * hours), alarms / (nbr * hours), 100.0 * alarmed / nbr,
+					100.0 * scans / ((double)nbr * batches));
+		}
+}
+
+static void *worker_main(void *arg){
+	fleet_worker_t	*w = arg;
+	uint32_t		s, i;
+
+	while ((s = shard_take(w)) != FLEET_NONE || (s = shard_steal(w)) != FLEET_NONE)
+		for (i = s * FLEET_SHARD; i < (s + 1u) * FLEET_SHARD; i++)
+			instance_run(i);
+	return NULL;
+}
+
+// first shard of the own range
+static uint32_t shard_take(fleet_worker_t *w){
+	uint64_t r = __atomic_load_n(&w->range, __ATOMIC_ACQUIRE);
+
+	do {
+		if (RANGE_FIRST(r) >= RANGE_END(r))
+			return FLEET_NONE;
+	} while (!__atomic_compare_exchange_n(&w->range, &r, RANGE(RANGE_FIRST(r) + 1u, RANGE_END(r)), 0,
+										  __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+	return RANGE_FIRST(r);
+}
+
+// upper half of the range of the next thread that has shards left: the first one is returned, the others
+// become the own range. Shards in the hands of a thief are not seen by the others, which may then stop
+// early; the thief runs them anyway.
+static uint32_t shard_steal(fleet_worker_t *w){
+	uint32_t k;
+
+	for (k = 1u; k < worker_nbr; k++){
+		fleet_worker_t	*v = &workers[(w->id + k) % worker_nbr];
+		uint64_t		r = __atomic_load_n(&v->range, __ATOMIC_ACQUIRE);
+		uint32_t		first, end, mid;
+
+		do {
+			first = RANGE_FIRST(r);
+			end = RANGE_END(r);
+			if (first >= end)
+				break;
+			mid = end - (end - first + 1u) / 2u;
+		} while (!__atomic_compare_exchange_n(&v->range, &r, RANGE(first, mid), 0,
+											  __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+		if (first >= end)
+			continue;
+		__atomic_store_n(&w->range, RANGE(mid + 1u, end), __ATOMIC_RELEASE);
+		w->stolen += end - mid;
+		return mid;
+	}
+	return FLEET_NONE;
+}
+
+// all the batches of one instance, the state machine of range_check() without the peripherals
+static void instance_run(uint32_t i){
+	const fleet_policy_t	*p = &policies[fleet.policy[i]];
+	const fleet_profile_t	*prof = &profiles[fleet.profile[i]];
+	uint16_t				buf[FLEET_BLOCK];
+	uint32_t				state = fleet.state[i];
+	uint32_t				pos = fleet.pos[i];
+	uint32_t				lo = fleet.win_lo[i], hi = fleet.win_hi[i];
+	uint32_t				changes = 0u, alarms = 0u, scans = 0u;
+	uint32_t				b, k;
+
+	for (b = 0u; b < batches; b++){
+		uint32_t mn = 0xFFFFu, mx = 0u;
+
+		pos = batch_fill(buf, prof, pos, fleet.offset[i]);
+		if (p->filter != FILTER_NONE)
+			filter_block(&fleet.filter[i], buf, FLEET_BLOCK);
+		for (k = 0u; k < FLEET_BLOCK; k++){
+			mn = buf[k] < mn ? buf[k] : mn;
+			mx = buf[k] > mx ? buf[k] : mx;
+		}
+		if (mn >= lo && mx <= hi)
+			continue;
+
+		scans++;
+		for (k = 0u; k < FLEET_BLOCK; k++){
+			uint8_t  act = band_classify(&p->tbl, state, buf[k]);
+			uint32_t rate, led;
+
+			if (act == BAND_NOP)
+				continue;
+			rate = state / BAND_LED_NBR;
+			led = state % BAND_LED_NBR;
+			if (BAND_ACT_RATE(act) != BAND_KEEP)
+				rate = BAND_ACT_RATE(act);
+			if (BAND_ACT_LED(act) != BAND_KEEP){
+				alarms += BAND_ACT_LED(act) == BAND_LED_RED && led != BAND_LED_RED;
+				led = BAND_ACT_LED(act);
+			}
+			state = BAND_STATE(rate, led);
+			changes++;
+		}
+		{
+			uint16_t wlo, whi;
+
+			if (band_window(&p->tbl, state, buf[FLEET_BLOCK - 1u], &wlo, &whi)){
+				lo = wlo;
+				hi = whi;
+			} else {
+				lo = 1u;
+				hi = 0u;
+			}
+		}
+	}
+	fleet.state[i] = (uint8_t)state;
+	fleet.pos[i] = pos;
+	fleet.win_lo[i] = (uint16_t)lo;
+	fleet.win_hi[i] = (uint16_t)hi;
+	fleet.changes[i] += changes;
+	fleet.alarms[i] += alarms;
+	fleet.scans[i] += scans;
+}
+
+// FLEET_BLOCK readings of the profile from pos with the offset of the instance; returns the next pos
+static uint32_t batch_fill(uint16_t *restrict buf, const fleet_profile_t *prof, uint32_t pos, int32_t offset){
+	const uint16_t	*restrict src = &prof->code[pos];
+	uint32_t		k;
+
+	for (k = 0u; k < FLEET_BLOCK; k++){
+		int32_t c = (int32_t)src[k] + offset;
+
+		buf[k] = (uint16_t)(c < 0 ? 0 : c > 0xFFFF ? 0xFFFF : c);
+	}
+	pos += FLEET_BLOCK;
+	return pos >= prof->len ? pos - prof->len : pos;
+}
+
+// the first instances of every policy again through filter_block() and range_check() of alarm.c
+static int verify(void){
+	uint16_t	buf[FLEET_BLOCK];
+	uint32_t	p, k, b, j, i, profile, pos, changes, alarms, led;
+	int32_t		offset;
+	int			fail = 0;
+
+	fleet_reset();
+	for (p = 0u; p < policy_nbr; p++)
+		for (k = 0u; k < FLEET_VERIFY_NBR; k++){
+			i = p * FLEET_SHARD + k;
+			instance_run(i);
+
+			sim_reset();
+			alarm_init();
+			alarm_set_cfg(&policies[p].cfg);
+			filter_init(&fleet.filter[i], policies[p].filter, policies[p].mavg_log2);
+			fleet_variant(i, &profile, &offset, &pos);
+			changes = alarms = 0u;
+			for (b = 0u; b < batches; b++){
+				pos = batch_fill(buf, &profiles[profile], pos, offset);
+				filter_block(&fleet.filter[i], buf, FLEET_BLOCK);
+				for (j = 0u; j < FLEET_BLOCK; j++){
+					led = current_led;
+					if (range_check(buf[j]) == 0)
+						continue;
+					changes++;
+					alarms += current_led == BOARD_GPIO_LED_RED && led != BOARD_GPIO_LED_RED;
+				}
+			}
+			if (changes != fleet.changes[i] || alarms != fleet.alarms[i]){
+				fprintf(stderr, "%s instance %u: %u transitions %u alarms, range_check() %u %u\n",
+						policies[p].name, i, fleet.changes[i], fleet.alarms[i], changes, alarms);
+				fail = 1;
+			}
+		}
+	if (!fail)
+		printf("%u instances of every policy checked against range_check()\n", FLEET_VERIFY_NBR);
+	return fail ? -1 : 0;
+}
+
+// avalanche of a 32 bit integer (murmur3 finalizer)
+static uint32_t mix32(uint32_t x){
+	x ^= x >> 16;
+	x *= 0x85EBCA6Bu;
+	x ^= x >> 13;
+	x *= 0xC2B2AE35u;
+	x ^= x >> 16;
+	return x;
+}
+
+static double gauss(uint32_t *seed){
+	double u, v;
+
+	*seed = *seed * 1664525u + 1013904223u;
+	u = ((*seed >> 8) + 1.0) / 16777218.0;
+	*seed = *seed * 1664525u + 1013904223u;
+	v = (*seed >> 8) / 16777216.0;
+	return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+// readings per second of app_cfg.h
+static double trig_hz(void){
+	return (double)SIM_CORE_HZ / (((APP_CFG_ADC_TRIG_MOD + 1u) << APP_CFG_ADC_TRIG_PS) * SIM_BUS_DIV);
+}
+
+static double wall(void){
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+}
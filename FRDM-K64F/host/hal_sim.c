@@ -0,0 +1,776 @@
+/*
+*********************************************************************************************************
+* Host simulator backend of the hardware abstraction layer (see hal.h and hal_sim.h).
+* The model is cycle-approximate: ADC0 conversion time follows the formula of the K64F reference manual
+* (SFCAdder + AverageNum * (BCT + LSTAdder + HSCAdder)), eDMA and exception entry use fixed costs. With the
+* hardware averaging the input is read at each conversion of the mean, so its noise averages out.
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <string.h>
+
+#include  <app_cfg.h>
+#include  <hal.h>
+#include  "hal_sim.h"
+
+/*
+*********************************************************************************************************
+*                                            LOCAL DEFINES
+*********************************************************************************************************
+*/
+
+#define SIM_NEVER				UINT64_MAX
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+sim_regs_t		sim_regs;
+sim_stats_t		sim_stats;
+sim_flash_t		sim_flash;
+sim_timing_t	sim_timing = {
+	.dma_xfer	= 8u,
+	.irq_entry	= 12u,
+	.isr_body	= 150u,
+};
+
+/*
+*********************************************************************************************************
+*                                       LOCAL GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+static uint64_t		now;
+
+static uint64_t		ftm0_start;						// beginning of the current FTM0 period
+static uint64_t		ftm1_start;						// beginning of the current FTM1 period
+
+static uint64_t		adc_done;						// end of the conversion in progress
+static uint64_t		adc_trigger;					// trigger of the conversion in progress
+static uint64_t		dma_done;						// end of the pending DMA transfers
+static uint32_t		dma_req;						// channels with a pending request
+static uint64_t		dma_trigger;					// trigger of the sample of the pending DMA transfers
+static uint64_t		dma_last_trigger;				// trigger of the sample last moved by the DMA
+static uint64_t		dma_irq;						// pending DMA interrupt
+static uint64_t		ftm1_irq;						// pending FTM1 interrupt
+static uint64_t		ftm1_overflow;					// last FTM1 overflow
+static uint32_t		ftm1_sc_ie;						// FTM1 overflow interrupt, off when the eDMA toggles
+static uint32_t		blink_ptor[2];					// PTOR values of the blink channels
+
+static hal_isr_t	dma_isr;
+static hal_isr_t	ftm1_isr;
+
+static sim_input_fn	input_fn;
+static void		   *input_arg;
+static sim_gpio_fn	gpio_hook;
+
+// SC1A values of the scan, rotated by one as in hal_k64f.c
+static uint32_t		scan_sc1[2][HAL_SCAN_MAX];
+
+static sim_uart_fn	uart_hook;
+static uint32_t		uart_baud;
+static uint64_t		uart_done;						// end of the UART TX DMA transfer in progress
+static int			flash_fresh = 1;				// sim_flash not erased yet
+
+static uint8_t		uart_rx_line[SIM_UART_RX_MAX];	// bytes waiting, a ring
+static uint32_t		uart_rx_in;						// free running indexes
+static uint32_t		uart_rx_out;
+static uint64_t		uart_rx_next;					// end of the byte being received
+static uint64_t		uart_rx_irq;					// pending receive interrupt
+static hal_isr_t	uart_rx_isr;
+static uint32_t		uart_rx_len;					// bytes of the ring of hal_uart_rx_dma_setup()
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static uint64_t ftm_period(const sim_ftm_t *ftm);
+static uint64_t ftm0_next(void);
+static uint64_t ftm1_next(void);
+static uint32_t adc_conv_cycles(void);
+static uint32_t adc_avg(void);
+static uint32_t adc_read(uint32_t adc, uint32_t adch);
+static int      adc_compare(uint32_t code);
+static uint32_t dma_minor_loops(uint32_t ch);
+static void     dma_transfer(uint32_t ch);
+static void     dma_tcd_adc(sim_dma_tcd_t *tcd, sim_adc_t *adc, volatile uint16_t *dst, uint32_t doff, uint32_t len);
+static uint64_t next_event(void);
+static void     dispatch(uint64_t t);
+static void     gpio_write(uint32_t pin, uint8_t level);
+static uint8_t *flash_at(uint32_t addr, uint32_t len);
+static uint64_t uart_byte_cycles(void);
+
+/*
+*********************************************************************************************************
+*                                      SIMULATOR CONTROL FUNCTIONS
+*********************************************************************************************************
+*/
+
+void sim_reset(void){
+	uint32_t ch;
+
+	memset(&sim_regs, 0, sizeof(sim_regs));
+	memset(&sim_stats, 0, sizeof(sim_stats));
+	for (ch = 0u; ch < SIM_DMA_CH_NBR; ch++)
+		sim_regs.tcd[ch].elink = sim_regs.tcd[ch].majorlink = SIM_DMA_LINK_NONE;
+	now = 0u;
+	ftm0_start = 0u;
+	ftm1_start = 0u;
+	adc_done = SIM_NEVER;
+	dma_done = SIM_NEVER;
+	dma_req = 0u;
+	dma_irq = SIM_NEVER;
+	ftm1_irq = SIM_NEVER;
+	ftm1_overflow = SIM_NEVER;
+	ftm1_sc_ie = SIM_FTM_SC_TOIE_MASK;
+	dma_last_trigger = 0u;
+	dma_isr = 0;
+	ftm1_isr = 0;
+	uart_baud = 0u;
+	uart_done = 0u;
+	uart_rx_in = uart_rx_out = 0u;
+	uart_rx_next = SIM_NEVER;
+	uart_rx_irq = SIM_NEVER;
+	uart_rx_isr = 0;
+	uart_rx_len = 0u;
+}
+
+void sim_set_input(sim_input_fn fn, void *arg){
+	input_fn = fn;
+	input_arg = arg;
+}
+
+void sim_set_gpio_hook(sim_gpio_fn fn){
+	gpio_hook = fn;
+}
+
+void sim_set_uart_hook(sim_uart_fn fn){
+	uart_hook = fn;
+}
+
+void sim_set_uart_rx_isr(hal_isr_t isr){
+	uart_rx_isr = isr;
+}
+
+uint32_t sim_uart_rx(const uint8_t *buf, uint32_t len){
+	uint32_t n;
+
+	for (n = 0u; n < len && uart_rx_in - uart_rx_out < SIM_UART_RX_MAX; n++)
+		uart_rx_line[uart_rx_in++ % SIM_UART_RX_MAX] = buf[n];
+	if (n > 0u && uart_rx_next == SIM_NEVER)
+		uart_rx_next = now + uart_byte_cycles();
+	return n;
+}
+
+uint32_t sim_uart_rx_waiting(void){
+	return uart_rx_in - uart_rx_out;
+}
+
+void sim_flash_reset(void){
+	memset(&sim_flash, 0, sizeof(sim_flash));
+	memset(sim_flash.mem, 0xFF, sizeof(sim_flash.mem));
+	flash_fresh = 0;
+}
+
+uint64_t sim_now(void){
+	return now;
+}
+
+uint64_t sim_dma_trigger_cycle(void){
+	return dma_last_trigger;
+}
+
+uint64_t sim_ftm0_period(void){
+	return ftm_period(&sim_regs.ftm0);
+}
+
+uint64_t sim_ftm1_overflow_cycle(void){
+	return ftm1_overflow;
+}
+
+void sim_advance(uint32_t cycles){
+	uint64_t end = now + cycles;
+	uint64_t t;
+
+	// interrupts preempt the task, which completes later by the time spent in them
+	while ((t = next_event()) <= end){
+		uint64_t isr_start = sim_stats.isr_cycles;
+
+		if (t > now)
+			now = t;
+		dispatch(t);
+		end += sim_stats.isr_cycles - isr_start;
+	}
+	now = end;
+}
+
+int sim_idle(void){
+	uint64_t t = next_event();
+	uint64_t isr_start = sim_stats.isr_cycles;
+
+	if (t == SIM_NEVER)
+		return 0;
+	if (t > now)
+		now = t;
+	dispatch(t);
+	now += sim_stats.isr_cycles - isr_start;
+	return 1;
+}
+
+/*
+*********************************************************************************************************
+*                                            HAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+void hal_ftm0_adc0_trigger_setup(volatile uint16_t *ring, uint32_t len, hal_isr_t isr){
+	dma_isr = isr;
+
+	sim_regs.dma_erq |= 0x1u;
+	dma_tcd_adc(&sim_regs.tcd[0], &sim_regs.adc0, ring, sizeof(uint16_t), len);
+	sim_regs.tcd[0].csr = (SIM_DMA_CSR_INTMAJOR|SIM_DMA_CSR_INTHALF);
+
+	sim_regs.adc0.sc2 = (SIM_ADC_SC2_ADTRG_MASK|SIM_ADC_SC2_DMAEN_MASK);
+	sim_regs.adc0.sc1a = 0xCu;
+	sim_regs.adc0.cfg1 = (3u << 2);
+
+	sim_regs.ftm0.cntin = 0u;
+	sim_regs.ftm0.mod = APP_CFG_ADC_TRIG_MOD;
+	sim_regs.ftm0.exttrig |= 0x40u;
+	sim_regs.ftm0.sc = (APP_CFG_ADC_TRIG_PS | (1u << 3));
+	ftm0_start = now;
+}
+
+void hal_adc_scan_setup(volatile uint16_t *ring, uint32_t len, const uint8_t *adc0_ch, const uint8_t *adc1_ch,
+						uint32_t nbr, hal_isr_t isr){
+	uint32_t k;
+
+	for (k = 0u; k < nbr; k++){
+		scan_sc1[0][k] = adc0_ch[(k + 1u) % nbr];
+		scan_sc1[1][k] = adc1_ch[(k + 1u) % nbr];
+	}
+	hal_ftm0_adc0_trigger_setup(ring, len, isr);
+
+	// result channels write every other entry and link to the SC1A writers, channels 2 and 4
+	dma_tcd_adc(&sim_regs.tcd[0], &sim_regs.adc0, ring, 2u * sizeof(uint16_t), len / 2u);
+	dma_tcd_adc(&sim_regs.tcd[3], &sim_regs.adc1, ring + 1, 2u * sizeof(uint16_t), len / 2u);
+	sim_regs.tcd[0].csr = (SIM_DMA_CSR_INTMAJOR|SIM_DMA_CSR_INTHALF);
+	sim_regs.tcd[0].elink = sim_regs.tcd[0].majorlink = 2u;
+	sim_regs.tcd[3].elink = sim_regs.tcd[3].majorlink = 4u;
+	for (k = 0u; k < 2u; k++){
+		sim_dma_tcd_t *tcd = &sim_regs.tcd[2u + 2u * k];
+
+		tcd->saddr = (uintptr_t)scan_sc1[k];
+		tcd->soff = (int32_t)sizeof(uint32_t);
+		tcd->daddr = (uintptr_t)(k ? &sim_regs.adc1.sc1a : &sim_regs.adc0.sc1a);
+		tcd->doff = 0;
+		tcd->nbytes = 4u;
+		tcd->slast = -(int32_t)(nbr * sizeof(uint32_t));
+		tcd->citer = nbr;
+		tcd->biter = nbr;
+		tcd->dlastsga = 0;
+		tcd->csr = 0u;
+		tcd->elink = tcd->majorlink = SIM_DMA_LINK_NONE;
+	}
+	sim_regs.dma_erq |= (1u << 3);
+
+	sim_regs.adc1.sc2 = (SIM_ADC_SC2_ADTRG_MASK|SIM_ADC_SC2_DMAEN_MASK);
+	sim_regs.adc1.cfg1 = sim_regs.adc0.cfg1;
+	sim_regs.adc0.sc1a = adc0_ch[0];
+	sim_regs.adc1.sc1a = adc1_ch[0];
+}
+
+void hal_adc_trigger_rate(uint32_t ps, uint32_t mod){
+	sim_regs.ftm0.mod = mod;
+	sim_regs.ftm0.sc = (ps | (1u << 3));
+	ftm0_start = now;
+}
+
+uint32_t hal_adc_trigger_cycles(void){
+	return (uint32_t)ftm_period(&sim_regs.ftm0);
+}
+
+uint32_t hal_ts_hz(void){
+	return SIM_CORE_HZ;
+}
+
+uint32_t hal_adc_trigger_ts(void){
+	return (uint32_t)ftm0_start;
+}
+
+uint32_t hal_ts_get(void){
+	return (uint32_t)now;
+}
+
+void hal_adc_config(uint32_t avg_log2, uint32_t opts){
+	uint32_t cfg1 = (3u << 2) | (((opts >> 4) & 0x3u) << 5);
+	uint32_t hsc = (opts & HAL_ADC_HSC) ? SIM_ADC_CFG2_ADHSC_MASK : 0u;
+
+	if (opts & HAL_ADC_LPC)
+		cfg1 |= SIM_ADC_CFG1_ADLPC_MASK;
+	if (opts & HAL_ADC_LSMP)
+		cfg1 |= SIM_ADC_CFG1_ADLSMP_MASK;
+	sim_regs.adc0.cfg1 = cfg1;
+	sim_regs.adc0.cfg2 = (sim_regs.adc0.cfg2 & SIM_ADC_CFG2_MUXSEL_MASK) | hsc;
+	sim_regs.adc0.sc3 = avg_log2 >= 2u ? SIM_ADC_SC3_AVGE_MASK | (avg_log2 - 2u) : 0u;
+	if (sim_regs.adc1.sc2 & SIM_ADC_SC2_ADTRG_MASK){
+		sim_regs.adc1.cfg1 = cfg1;
+		sim_regs.adc1.cfg2 = (sim_regs.adc1.cfg2 & SIM_ADC_CFG2_MUXSEL_MASK) | hsc;
+		sim_regs.adc1.sc3 = sim_regs.adc0.sc3;
+	}
+}
+
+void hal_adc0_compare_set(uint16_t lo, uint16_t hi){
+	sim_regs.adc0.cv1 = lo;
+	sim_regs.adc0.cv2 = hi;
+	sim_regs.adc0.sc2 = (SIM_ADC_SC2_ADTRG_MASK|SIM_ADC_SC2_DMAEN_MASK|SIM_ADC_SC2_ACFE_MASK|SIM_ADC_SC2_ACREN_MASK);
+}
+
+void hal_adc0_compare_off(void){
+	sim_regs.adc0.sc2 = (SIM_ADC_SC2_ADTRG_MASK|SIM_ADC_SC2_DMAEN_MASK);
+}
+
+void hal_dma_clear_int(void){
+	sim_regs.dma_int &= ~0x1u;
+}
+
+void hal_uart_dma_setup(uint32_t baud){
+	uart_baud = baud;
+}
+
+// the DMA keeps the UART busy for 10 bit times per byte, with no CPU time
+void hal_uart_dma_send(const uint8_t *buf, uint32_t len){
+	sim_stats.uart_bytes += len;
+	uart_done = now + (uint64_t)len * 10u * SIM_CORE_HZ / (uart_baud ? uart_baud : 115200u);
+	if (uart_hook)
+		uart_hook(buf, len, now);
+}
+
+int hal_uart_dma_busy(void){
+	return now < uart_done;
+}
+
+void hal_uart_rx_dma_setup(volatile uint8_t *ring, uint32_t len){
+	sim_dma_tcd_t *tcd = &sim_regs.tcd[SIM_DMA_UART_RX];
+
+	uart_rx_len = len;
+	tcd->saddr = (uintptr_t)&sim_regs.uart_d;
+	tcd->soff = 0;
+	tcd->daddr = (uintptr_t)ring;
+	tcd->doff = 1;
+	tcd->nbytes = 1u;
+	tcd->slast = 0;
+	tcd->citer = tcd->biter = len;
+	tcd->dlastsga = -(int32_t)len;
+	tcd->csr = 0u;
+	tcd->elink = tcd->majorlink = SIM_DMA_LINK_NONE;
+	sim_regs.dma_erq |= 1u << SIM_DMA_UART_RX;
+}
+
+uint32_t hal_uart_rx_head(void){
+	return uart_rx_len - sim_regs.tcd[SIM_DMA_UART_RX].citer;
+}
+
+void hal_ftm1_setup(hal_isr_t isr){
+	ftm1_isr = isr;
+	sim_regs.ftm1.cntin = 0u;
+}
+
+void hal_ftm1_dma_setup(uint32_t led_pin, uint32_t wave_pin){
+	sim_dma_tcd_t *tcd;
+	uint32_t ch;
+
+	ftm1_isr = 0;
+	ftm1_sc_ie = 0u;
+	sim_regs.ftm1.cntin = 0u;
+	sim_regs.ftm1.c0v = 0u;
+	sim_regs.ftm1.c0sc = (SIM_FTM_CnSC_CHIE_MASK|SIM_FTM_CnSC_DMA_MASK);
+
+	// channel 5 toggles the LED and links to 6 for the wave, one 32 bit write each
+	blink_ptor[0] = 1u << led_pin;
+	blink_ptor[1] = 1u << wave_pin;
+	for (ch = 5u; ch <= 6u; ch++){
+		tcd = &sim_regs.tcd[ch];
+		tcd->saddr = (uintptr_t)&blink_ptor[ch - 5u];
+		tcd->soff = 0;
+		tcd->daddr = (uintptr_t)&sim_regs.gpio_ptor;
+		tcd->doff = 0;
+		tcd->nbytes = 4u;
+		tcd->slast = 0;
+		tcd->citer = tcd->biter = 1u;
+		tcd->dlastsga = 0;
+		tcd->csr = 0u;
+		tcd->elink = tcd->majorlink = SIM_DMA_LINK_NONE;
+	}
+	sim_regs.tcd[5].majorlink = 6u;
+	sim_regs.dma_erq |= (1u << 5);
+}
+
+void hal_ftm1_dma_led(uint32_t led_pin){
+	if (!ftm1_sc_ie)
+		blink_ptor[0] = 1u << led_pin;
+}
+
+void hal_ftm1_start(uint16_t mod){
+	sim_regs.ftm1.mod = mod;
+	sim_regs.ftm1.sc = (7u | (1u << 3) | ftm1_sc_ie);
+	ftm1_start = now;
+}
+
+void hal_ftm1_stop(void){
+	sim_regs.ftm1.sc = 0u;
+}
+
+void hal_ftm1_clear_int(void){
+	sim_regs.ftm1.sc &= 0x7Fu;
+}
+
+int hal_flash_erase(uint32_t addr){
+	uint8_t *p = flash_at(addr, HAL_FLASH_SECTOR);
+
+	if (p == NULL || addr % HAL_FLASH_SECTOR != 0u){
+		sim_flash.errors++;
+		return -1;
+	}
+	memset(p, 0xFF, HAL_FLASH_SECTOR);
+	sim_flash.erases[(addr - SIM_FLASH_BASE) / HAL_FLASH_SECTOR]++;
+	sim_advance(SIM_FLASH_ERASE_CYCLES);
+	return 0;
+}
+
+// as the FTFE, one phrase after the other, up to the first that is not erased
+int hal_flash_program(uint32_t addr, const void *data, uint32_t len){
+	uint8_t *p = flash_at(addr, len);
+	uint32_t i, k;
+
+	if (p == NULL || addr % HAL_FLASH_PHRASE != 0u || len % HAL_FLASH_PHRASE != 0u){
+		sim_flash.errors++;
+		return -1;
+	}
+	for (i = 0u; i < len; i += HAL_FLASH_PHRASE){
+		for (k = 0u; k < HAL_FLASH_PHRASE; k++)
+			if (p[i + k] != 0xFFu){
+				sim_flash.errors++;
+				return -1;
+			}
+		memcpy(&p[i], (const uint8_t *)data + i, HAL_FLASH_PHRASE);
+		sim_flash.phrases++;
+		sim_advance(SIM_FLASH_PHRASE_CYCLES);
+	}
+	return 0;
+}
+
+void hal_flash_read(uint32_t addr, void *data, uint32_t len){
+	uint8_t *p = flash_at(addr, len);
+
+	if (p == NULL)
+		memset(data, 0xFF, len);
+	else
+		memcpy(data, p, len);
+}
+
+void hal_gpio_set(uint32_t pin){
+	gpio_write(pin, 1u);
+}
+
+void hal_gpio_clear(uint32_t pin){
+	gpio_write(pin, 0u);
+}
+
+void hal_gpio_toggle(uint32_t pin){
+	gpio_write(pin, (uint8_t)(sim_regs.gpio[pin] ^ 1u));
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+// core cycles between two overflows (and init triggers) of a FlexTimer
+static uint64_t ftm_period(const sim_ftm_t *ftm){
+	uint64_t ticks = (uint64_t)(ftm->mod - ftm->cntin) + 1u;
+
+	return ticks * (1u << (ftm->sc & SIM_FTM_SC_PS_MASK)) * SIM_BUS_DIV;
+}
+
+static uint64_t ftm0_next(void){
+	if (!(sim_regs.ftm0.sc & SIM_FTM_SC_CLKS_MASK))
+		return SIM_NEVER;
+	return ftm0_start + ftm_period(&sim_regs.ftm0);
+}
+
+static uint64_t ftm1_next(void){
+	if (!(sim_regs.ftm1.sc & SIM_FTM_SC_CLKS_MASK))
+		return SIM_NEVER;
+	return ftm1_start + ftm_period(&sim_regs.ftm1);
+}
+
+static uint32_t adc_conv_cycles(void){
+	static const uint32_t bct[4] = { 17u, 25u, 20u, 25u };	// 8, 12, 10, 16 bit single ended
+	uint32_t cfg1 = sim_regs.adc0.cfg1;
+	uint32_t adck = SIM_BUS_DIV << ((cfg1 >> 5) & 0x3u);	// core cycles per ADCK, ADIV
+	uint32_t lst = 0u;
+	uint32_t hsc = 0u;
+
+	if (cfg1 & SIM_ADC_CFG1_ADLSMP_MASK)
+		lst = 20u;
+	if (sim_regs.adc0.cfg2 & SIM_ADC_CFG2_ADHSC_MASK)
+		hsc = 2u;
+	return adck * (3u + adc_avg() * (bct[(cfg1 >> 2) & 0x3u] + lst + hsc)) + 5u * SIM_BUS_DIV;
+}
+
+// conversions of a mean, SC3 of ADC0 for both
+static uint32_t adc_avg(void){
+	return (sim_regs.adc0.sc3 & SIM_ADC_SC3_AVGE_MASK) ? 4u << (sim_regs.adc0.sc3 & 0x3u) : 1u;
+}
+
+// result of the conversion started by adc_trigger: the input read at each conversion of the mean, the
+// sum divided by the number of conversions
+static uint32_t adc_read(uint32_t adc, uint32_t adch){
+	uint32_t avg = adc_avg();
+	uint32_t step = (adc_conv_cycles() - 5u * SIM_BUS_DIV) / avg;
+	uint32_t sum = 0u, k;
+
+	sim_stats.adc_conversions += avg;
+	if (!input_fn)
+		return 0u;
+	for (k = 0u; k < avg; k++)
+		sum += input_fn(adc_trigger + (uint64_t)k * step, adc, adch, input_arg);
+	return sum / avg;
+}
+
+// compare function of the reference manual, ACFGT/ACREN and the order of CV1/CV2 select the condition
+static int adc_compare(uint32_t code){
+	uint32_t sc2 = sim_regs.adc0.sc2;
+	uint32_t cv1 = sim_regs.adc0.cv1;
+	uint32_t cv2 = sim_regs.adc0.cv2;
+	int      gt = (sc2 & SIM_ADC_SC2_ACFGT_MASK) != 0u;
+
+	if (!(sc2 & SIM_ADC_SC2_ACFE_MASK))
+		return 1;
+	if (!(sc2 & SIM_ADC_SC2_ACREN_MASK))
+		return gt ? code >= cv1 : code < cv1;
+	if (cv1 <= cv2)
+		return gt ? (code >= cv1 && code <= cv2) : (code < cv1 || code > cv2);
+	return gt ? (code >= cv1 || code <= cv2) : (code < cv1 && code > cv2);
+}
+
+// minor loops run by a request of the channel, its links included
+static uint32_t dma_minor_loops(uint32_t ch){
+	const sim_dma_tcd_t *tcd = &sim_regs.tcd[ch];
+	uint32_t link = tcd->citer == 1u ? tcd->majorlink : tcd->elink;
+
+	return 1u + (link != SIM_DMA_LINK_NONE ? 1u : 0u);
+}
+
+static void dma_transfer(uint32_t ch){
+	sim_dma_tcd_t *tcd = &sim_regs.tcd[ch];
+	uint32_t link;
+
+	memcpy((void *)tcd->daddr, (const void *)tcd->saddr, tcd->nbytes);
+	// GPIO PTOR: every pin written with 1 toggles
+	if (tcd->daddr == (uintptr_t)&sim_regs.gpio_ptor){
+		uint32_t pin;
+
+		for (pin = 0u; pin < HAL_SIM_PIN_NBR; pin++)
+			if (sim_regs.gpio_ptor & (1u << pin))
+				gpio_write(pin, sim_regs.gpio[pin] ^ 1u);
+		sim_regs.gpio_ptor = 0u;
+	}
+	tcd->saddr += tcd->soff;
+	tcd->daddr += tcd->doff;
+	sim_stats.dma_transfers++;
+	if (ch != SIM_DMA_UART_RX)
+		dma_last_trigger = dma_trigger;
+
+	if (--tcd->citer == 0u){
+		tcd->saddr += tcd->slast;
+		tcd->daddr += tcd->dlastsga;
+		tcd->citer = tcd->biter;
+		link = tcd->majorlink;
+		if (tcd->csr & SIM_DMA_CSR_INTMAJOR){
+			sim_regs.dma_int |= 1u << ch;
+			if (dma_irq == SIM_NEVER)
+				dma_irq = now + sim_timing.irq_entry;
+		}
+	} else {
+		link = tcd->elink;
+		if ((tcd->csr & SIM_DMA_CSR_INTHALF) && (tcd->citer == tcd->biter / 2u)){
+			sim_regs.dma_int |= 1u << ch;
+			if (dma_irq == SIM_NEVER)
+				dma_irq = now + sim_timing.irq_entry;
+		}
+	}
+	if (link != SIM_DMA_LINK_NONE)
+		dma_transfer(link);
+}
+
+static void dma_tcd_adc(sim_dma_tcd_t *tcd, sim_adc_t *adc, volatile uint16_t *dst, uint32_t doff, uint32_t len){
+	tcd->saddr = (uintptr_t)&adc->ra;
+	tcd->soff = 0;
+	tcd->daddr = (uintptr_t)dst;
+	tcd->doff = (int32_t)doff;
+	tcd->nbytes = 2u;
+	tcd->slast = 0;
+	tcd->citer = len;
+	tcd->biter = len;
+	tcd->dlastsga = -(int32_t)(len * doff);
+	tcd->csr = 0u;
+	tcd->elink = tcd->majorlink = SIM_DMA_LINK_NONE;
+}
+
+static uint64_t next_event(void){
+	uint64_t t = ftm0_next();
+
+	if (adc_done < t)
+		t = adc_done;
+	if (dma_done < t)
+		t = dma_done;
+	if (dma_irq < t)
+		t = dma_irq;
+	if (ftm1_irq < t)
+		t = ftm1_irq;
+	if (ftm1_next() < t)
+		t = ftm1_next();
+	if (uart_rx_next < t)
+		t = uart_rx_next;
+	if (uart_rx_irq < t)
+		t = uart_rx_irq;
+	return t;
+}
+
+static void dispatch(uint64_t t){
+	uint32_t code;
+
+	if (t == ftm0_next()){
+		ftm0_start = t;
+		sim_stats.ftm0_triggers++;
+		// a trigger while converting is ignored
+		if ((sim_regs.ftm0.exttrig & 0x40u) && (sim_regs.adc0.sc2 & SIM_ADC_SC2_ADTRG_MASK) &&
+				adc_done == SIM_NEVER){
+			adc_trigger = t;
+			adc_done = t + adc_conv_cycles();
+		}
+	}
+	else if (t == adc_done){
+		adc_done = SIM_NEVER;
+		// ADC1 converts in step with ADC0 when the scan uses it, same trigger and configuration
+		if (sim_regs.adc1.sc2 & SIM_ADC_SC2_ADTRG_MASK){
+			sim_regs.adc1.ra = adc_read(1u, sim_regs.adc1.sc1a & 0x1Fu);
+			if ((sim_regs.adc1.sc2 & SIM_ADC_SC2_DMAEN_MASK) && (sim_regs.dma_erq & (1u << 3)))
+				dma_req |= 1u << 3;
+		}
+		code = adc_read(0u, sim_regs.adc0.sc1a & 0x1Fu);
+		// with the compare function a false result is discarded: no RA update, no COCO, no DMA request
+		if (adc_compare(code)){
+			sim_regs.adc0.ra = code;
+			sim_regs.adc0.sc1a |= SIM_ADC_SC1_COCO_MASK;
+			if ((sim_regs.adc0.sc2 & SIM_ADC_SC2_DMAEN_MASK) && (sim_regs.dma_erq & 0x1u)){
+				sim_regs.adc0.sc1a &= ~SIM_ADC_SC1_COCO_MASK;
+				dma_req |= 1u;
+			}
+		}
+		if (dma_req){
+			uint32_t loops = 0u, ch;
+
+			for (ch = 0u; ch < SIM_DMA_CH_NBR; ch++)
+				if (dma_req & (1u << ch))
+					loops += dma_minor_loops(ch);
+			dma_trigger = adc_trigger;
+			dma_done = t + loops * sim_timing.dma_xfer;
+		}
+	}
+	else if (t == dma_done){
+		uint32_t ch;
+
+		dma_done = SIM_NEVER;
+		// fixed priority of the reset values, the highest channel first
+		for (ch = SIM_DMA_CH_NBR; ch-- > 0u; )
+			if (dma_req & (1u << ch))
+				dma_transfer(ch);
+		dma_req = 0u;
+	}
+	else if (t == dma_irq){
+		dma_irq = SIM_NEVER;
+		sim_stats.dma_irqs++;
+		sim_stats.isr_cycles += sim_timing.isr_body;
+		if (dma_isr)
+			dma_isr();
+	}
+	else if (t == ftm1_irq){
+		ftm1_irq = SIM_NEVER;
+		sim_stats.ftm1_irqs++;
+		sim_stats.isr_cycles += sim_timing.isr_body;
+		if (ftm1_isr)
+			ftm1_isr();
+	}
+	else if (t == uart_rx_next){
+		sim_regs.uart_d = uart_rx_line[uart_rx_out++ % SIM_UART_RX_MAX];
+		sim_stats.uart_rx_bytes++;
+		uart_rx_next = uart_rx_out != uart_rx_in ? t + uart_byte_cycles() : SIM_NEVER;
+		if (sim_regs.dma_erq & (1u << SIM_DMA_UART_RX)){
+			// highest channel: an ADC transfer still pending waits for this minor loop
+			if (dma_done != SIM_NEVER){
+				dma_done += sim_timing.dma_xfer;
+				sim_stats.dma_wait_cycles += sim_timing.dma_xfer;
+			}
+			dma_transfer(SIM_DMA_UART_RX);
+		} else if (uart_rx_isr && uart_rx_irq == SIM_NEVER){
+			uart_rx_irq = t + sim_timing.irq_entry;
+		} else {
+			sim_stats.uart_rx_lost++;
+		}
+	}
+	else if (t == uart_rx_irq){
+		uart_rx_irq = SIM_NEVER;
+		sim_stats.isr_cycles += sim_timing.isr_body;
+		uart_rx_isr();
+	}
+	else if (t == ftm1_next()){
+		ftm1_start = t;
+		ftm1_overflow = t;
+		sim_regs.ftm1.sc |= SIM_FTM_SC_TOF_MASK;
+		if ((sim_regs.ftm1.sc & SIM_FTM_SC_TOIE_MASK) && ftm1_irq == SIM_NEVER)
+			ftm1_irq = t + sim_timing.irq_entry;
+		// channel 0 matches CNTIN at the reload, its event is a DMA request instead of an interrupt
+		if ((sim_regs.ftm1.c0sc & (SIM_FTM_CnSC_CHIE_MASK|SIM_FTM_CnSC_DMA_MASK)) ==
+				(SIM_FTM_CnSC_CHIE_MASK|SIM_FTM_CnSC_DMA_MASK) && sim_regs.ftm1.c0v == sim_regs.ftm1.cntin &&
+				(sim_regs.dma_erq & (1u << 5))){
+			dma_req |= 1u << 5;
+			if (dma_done == SIM_NEVER)
+				dma_done = t + dma_minor_loops(5u) * sim_timing.dma_xfer;
+		}
+	}
+}
+
+static void gpio_write(uint32_t pin, uint8_t level){
+	sim_regs.gpio[pin] = level;
+	sim_stats.gpio_writes++;
+	if (gpio_hook)
+		gpio_hook(pin, level, now);
+}
+
+// 10 bit times of UART0
+static uint64_t uart_byte_cycles(void){
+	return 10u * (uint64_t)SIM_CORE_HZ / (uart_baud ? uart_baud : 115200u);
+}
+
+// bytes of the flash window at addr, NULL if [addr, addr + len) is not all in it
+static uint8_t *flash_at(uint32_t addr, uint32_t len){
+	if (flash_fresh)
+		sim_flash_reset();
+	if (addr < SIM_FLASH_BASE || len > SIM_FLASH_SIZE || addr - SIM_FLASH_BASE > SIM_FLASH_SIZE - len)
+		return NULL;
+	return &sim_flash.mem[addr - SIM_FLASH_BASE];
+}
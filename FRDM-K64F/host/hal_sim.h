@@ -0,0 +1,206 @@
+/*
+*********************************************************************************************************
+*                                   HOST SIMULATOR OF THE K64F PERIPHERALS
+*
+* Linux backend of hal.h. The registers written by the HAL are kept in sim_regs and an event loop models,
+* at cycle-approximate timing, the FTM0 init trigger -> ADC0 (and ADC1) conversion -> eDMA transfer -> DMA
+* interrupt chain, with the eDMA channel links of the scan, and the FTM1 overflow interrupt. Time is
+* counted in core clock cycles (120 MHz, bus at 60 MHz).
+* A window of program flash (sim_flash) enforces the erase and program rules of the FTFE and counts the
+* erases of each sector. Bytes given to sim_uart_rx() arrive on UART0 RX at the baud rate and are moved by
+* the eDMA channel 7, or raise an interrupt each when a receive ISR is installed instead.
+*
+* The simulated CPU is single threaded: code running in "task" context consumes time with sim_advance(),
+* interrupts are dispatched at their own time in between, and sim_idle() jumps to the next event.
+*********************************************************************************************************
+*/
+
+#ifndef  HAL_SIM_MODULE_PRESENT
+#define  HAL_SIM_MODULE_PRESENT
+
+#include  <stdint.h>
+#include  <hal.h>
+
+/*
+*********************************************************************************************************
+*                                               DEFINES
+*********************************************************************************************************
+*/
+
+#define SIM_CORE_HZ				120000000u
+#define SIM_BUS_DIV				2u					// core cycles per bus cycle
+
+// register bits used by the model (same position as on the K64F)
+#define SIM_FTM_SC_PS_MASK		0x07u
+#define SIM_FTM_SC_CLKS_MASK	0x18u
+#define SIM_FTM_SC_TOIE_MASK	0x40u
+#define SIM_FTM_SC_TOF_MASK		0x80u
+
+#define SIM_FTM_CnSC_CHIE_MASK	0x40u
+#define SIM_FTM_CnSC_DMA_MASK	0x01u
+#define SIM_ADC_SC2_DMAEN_MASK	0x04u
+#define SIM_ADC_SC2_ADTRG_MASK	0x40u
+#define SIM_ADC_SC2_ACFE_MASK	0x20u
+#define SIM_ADC_SC2_ACFGT_MASK	0x10u
+#define SIM_ADC_SC2_ACREN_MASK	0x08u
+#define SIM_ADC_SC1_COCO_MASK	0x80u
+#define SIM_ADC_SC3_AVGE_MASK	0x04u
+#define SIM_ADC_CFG1_ADLSMP_MASK 0x10u
+#define SIM_ADC_CFG1_ADLPC_MASK	0x80u
+#define SIM_ADC_CFG2_ADHSC_MASK	0x04u
+#define SIM_ADC_CFG2_MUXSEL_MASK 0x10u
+
+#define SIM_DMA_CSR_INTMAJOR	0x02u
+#define SIM_DMA_CSR_INTHALF		0x04u
+
+#define SIM_DMA_CH_NBR			8u					// ADC0, UART0 TX, ADC0 SC1A, ADC1, ADC1 SC1A, LED, wave, UART0 RX
+#define SIM_DMA_UART_RX			7u
+#define SIM_DMA_LINK_NONE		0xFFu
+
+// program flash window, out of it hal_flash_xx() fail; typical times of the K64F data sheet
+#define SIM_FLASH_BASE			0x000F0000u
+#define SIM_FLASH_SIZE			0x00010000u
+#define SIM_FLASH_SECTORS		(SIM_FLASH_SIZE / HAL_FLASH_SECTOR)
+#define SIM_FLASH_ERASE_CYCLES	(SIM_CORE_HZ / 1000u * 13u)
+#define SIM_FLASH_PHRASE_CYCLES	(SIM_CORE_HZ / 1000000u * 65u)
+
+#define SIM_UART_RX_MAX			4096u				// bytes waiting to be received
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+typedef struct sim_ftm {
+	uint32_t	sc;
+	uint32_t	cnt;
+	uint32_t	mod;
+	uint32_t	cntin;
+	uint32_t	exttrig;
+	uint32_t	c0sc;
+	uint32_t	c0v;
+} sim_ftm_t;
+
+typedef struct sim_adc {
+	uint32_t	sc1a;
+	uint32_t	sc2;
+	uint32_t	sc3;
+	uint32_t	cfg1;
+	uint32_t	cfg2;
+	uint32_t	ra;
+	uint32_t	cv1;
+	uint32_t	cv2;
+} sim_adc_t;
+
+typedef struct sim_dma_tcd {
+	uintptr_t	saddr;
+	int32_t		soff;
+	uint32_t	nbytes;
+	int32_t		slast;
+	uintptr_t	daddr;
+	int32_t		doff;
+	uint32_t	citer;
+	uint32_t	biter;
+	int32_t		dlastsga;
+	uint32_t	csr;
+	uint32_t	elink;							// channel started after each minor loop but the last
+	uint32_t	majorlink;						// channel started after the last one
+} sim_dma_tcd_t;
+
+typedef struct sim_regs {
+	sim_ftm_t		ftm0;
+	sim_ftm_t		ftm1;
+	sim_adc_t		adc0;
+	sim_adc_t		adc1;
+	uint32_t		dma_erq;
+	uint32_t		dma_int;
+	sim_dma_tcd_t	tcd[SIM_DMA_CH_NBR];
+	uint8_t			gpio[HAL_SIM_PIN_NBR];
+	uint32_t		gpio_ptor;						// all the pins on one port, bit = pin
+	uint32_t		uart_d;							// last byte received by UART0
+} sim_regs_t;
+
+// timing of the model, in core cycles
+typedef struct sim_timing {
+	uint32_t	dma_xfer;						// eDMA minor loop of one 16 bit word
+	uint32_t	irq_entry;						// exception entry until the first ISR instruction
+	uint32_t	isr_body;						// ISR execution including OSIntEnter()/OSIntExit()
+} sim_timing_t;
+
+typedef struct sim_stats {
+	uint64_t	ftm0_triggers;
+	uint64_t	adc_conversions;
+	uint64_t	dma_transfers;
+	uint64_t	dma_irqs;
+	uint64_t	ftm1_irqs;
+	uint64_t	gpio_writes;
+	uint64_t	uart_bytes;
+	uint64_t	uart_rx_bytes;
+	uint64_t	uart_rx_lost;					// overrun: neither DMA nor interrupt read the byte in time
+	uint64_t	isr_cycles;						// time spent in interrupt context
+	uint64_t	dma_wait_cycles;				// ADC transfers delayed behind a UART RX one
+} sim_stats_t;
+
+// erased at the first access, kept by sim_reset() as the chip keeps it over a reset
+typedef struct sim_flash {
+	uint8_t		mem[SIM_FLASH_SIZE];
+	uint32_t	erases[SIM_FLASH_SECTORS];
+	uint64_t	phrases;						// phrases programmed
+	uint32_t	errors;							// commands refused: out of the window, unaligned or
+												// programming a phrase not erased
+} sim_flash_t;
+
+// analog input: ADC code seen by a conversion of input adch of ADC0 or ADC1 sampled at the given cycle
+typedef uint16_t (*sim_input_fn)(uint64_t cycle, uint32_t adc, uint32_t adch, void *arg);
+
+// notification of a GPIO write
+typedef void (*sim_gpio_fn)(uint32_t pin, uint8_t level, uint64_t cycle);
+
+// bytes of a UART TX DMA transfer, given when the transfer starts
+typedef void (*sim_uart_fn)(const uint8_t *buf, uint32_t len, uint64_t cycle);
+
+/*
+*********************************************************************************************************
+*                                          GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+extern sim_regs_t	sim_regs;
+extern sim_timing_t	sim_timing;
+extern sim_stats_t	sim_stats;
+extern sim_flash_t	sim_flash;
+
+/*
+*********************************************************************************************************
+*                                         FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+void     sim_reset(void);
+void     sim_set_input(sim_input_fn fn, void *arg);
+void     sim_set_gpio_hook(sim_gpio_fn fn);
+void     sim_set_uart_hook(sim_uart_fn fn);
+// receive interrupt of UART0 instead of the eDMA, one per byte (in sim_regs.uart_d), as the BSP_Ser driver
+void     sim_set_uart_rx_isr(hal_isr_t isr);
+// bytes received back to back from the end of those already waiting; returns the number taken
+uint32_t sim_uart_rx(const uint8_t *buf, uint32_t len);
+// bytes waiting to be received
+uint32_t sim_uart_rx_waiting(void);
+// flash window erased and its counters cleared, as a new chip
+void     sim_flash_reset(void);
+
+uint64_t sim_now(void);
+// cycle of the FTM0 trigger that started the conversion last moved by the DMA
+uint64_t sim_dma_trigger_cycle(void);
+// core cycles between two FTM0 triggers
+uint64_t sim_ftm0_period(void);
+// cycle of the last FTM1 overflow, UINT64_MAX before the first
+uint64_t sim_ftm1_overflow_cycle(void);
+
+// consume cycles in task context, interrupts falling in between are serviced and delay the task
+void     sim_advance(uint32_t cycles);
+// CPU idle until the next event, which is dispatched; returns 0 if no event is scheduled
+int      sim_idle(void);
+
+#endif
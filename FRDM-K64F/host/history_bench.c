@@ -0,0 +1,316 @@
+/*
+*********************************************************************************************************
+* Host benchmark of the compressed history of history.c on recorded traces: the channel 0 readings of
+* capture files (capture.h), or without them a synthetic discharge at the trigger rate of app_cfg.h with
+* gaussian noise. Every trace goes through history_add() in batches of APP_CFG_ADC_BLOCK_SIZE readings
+* as in AppTask, for each averaging of -a, into a ring large enough to keep it all; every chunk is then
+* decoded, the values compared with the averages of the readings and history_find() checked on the time
+* of every chunk. Reported per trace and averaging:
+*  - bits per value of the ring (whole chunks, headers included) and of a zig-zag varint of the
+*    differences (LEB128, 7 bits per byte) for comparison
+*  - compression against 16 bit values and against the 16 bit readings, and the hours of values that
+*    the APP_CFG_HISTORY_CHUNKS chunks of app_cfg.h hold at that rate
+*  - coding and decoding speed in MB/s of 16 bit readings and values, and the most cycles history_add()
+*    took on one batch (reference cycles of RDTSC on x86, nanoseconds elsewhere)
+* history_bench() runs first, in the format APP_CFG_FILTER_BENCH_EN prints on the board, where the cycles
+* are those of the M4 to compare with APP_CFG_HISTORY_BUDGET.
+*
+* Build (from FRDM-K64F):
+*   gcc -O2 -DAPP_HOST_BUILD -IOS3-KSDK -Ihost OS3-KSDK/history.c OS3-KSDK/band.c OS3-KSDK/capture.c \
+*       host/history_bench.c -o history_bench -lm
+*
+* Usage: history_bench [-a avg log2 list] [-t hours] [-n noise lsb] [capture files]
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <fcntl.h>
+#include  <math.h>
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <sys/mman.h>
+#include  <sys/stat.h>
+#include  <time.h>
+#include  <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include  <x86intrin.h>
+#endif
+
+#include  <app_cfg.h>
+#include  <capture.h>
+#include  <history.h>
+#include  "hal_sim.h"
+
+/*
+*********************************************************************************************************
+*                                            LOCAL DEFINES
+*********************************************************************************************************
+*/
+
+#define BENCH_BLOCK				APP_CFG_ADC_BLOCK_SIZE
+#define BENCH_AVG_MAX			8u
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+typedef struct trace {
+	spsc_sample_t  *s;
+	uint32_t		nbr;
+	uint32_t		ts_hz;
+	uint32_t		period;									// cycles between two readings
+	char			name[32];
+} trace_t;
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static int      trace_load(trace_t *t, const char *path);
+static void     trace_synth(trace_t *t, double hours, double noise);
+static int      bench_run(const trace_t *t, uint32_t avg_log2);
+static uint32_t varint_bits(const uint16_t *v, uint32_t n);
+static uint32_t host_cycles(void);
+static double   wall(void);
+
+/*
+*********************************************************************************************************
+*                                                main()
+*********************************************************************************************************
+*/
+
+int main(int argc, char **argv){
+	static history_t	h;
+	uint32_t			avgs[BENCH_AVG_MAX] = { 0u, 2u, 4u, 6u };
+	uint32_t			avg_nbr = 4u, a;
+	history_bench_t		res;
+	history_hdr_t	   *img;
+	trace_t				t;
+	double				hours = 2.0, noise = 2.0;
+	char			   *tok;
+	int					opt, fail = 0;
+
+	while ((opt = getopt(argc, argv, "a:t:n:")) != -1){
+		switch (opt){
+			case 'a':
+				for (avg_nbr = 0u, tok = strtok(optarg, ","); tok != NULL && avg_nbr < BENCH_AVG_MAX;
+					 tok = strtok(NULL, ","))
+					avgs[avg_nbr++] = (uint32_t)atoi(tok);
+				break;
+			case 't': hours = atof(optarg); break;
+			case 'n': noise = atof(optarg); break;
+			default:
+				fprintf(stderr, "usage: %s [-a avg log2 list] [-t hours] [-n noise lsb] [capture files]\n", argv[0]);
+				return 1;
+		}
+	}
+
+	// touched before the timing, as the static ring of the board
+	img = calloc(1u, sizeof(history_hdr_t) + APP_CFG_HISTORY_CHUNKS * sizeof(history_chunk_t));
+	history_bench(&res, &h, img, APP_CFG_HISTORY_CHUNKS, host_cycles, BENCH_BLOCK, 100000u);
+	printf("history %u readings/batch %6u cycles/batch mean %6u max (budget %u)\n\n", BENCH_BLOCK, res.mean, res.max,
+			APP_CFG_HISTORY_BUDGET);
+	free(img);
+
+	printf("trace         readings  avg   values  bits/value  varint  x values  x readings  h in %2u KB  "
+		   "code MB/s  decode MB/s  max cycles/batch\n", APP_CFG_HISTORY_CHUNKS * HISTORY_CHUNK_SIZE / 1024u);
+	do {
+		if (optind < argc){
+			if (trace_load(&t, argv[optind++]) != 0)
+				return 1;
+		} else {
+			trace_synth(&t, hours, noise);
+		}
+		for (a = 0u; a < avg_nbr; a++)
+			fail |= bench_run(&t, avgs[a]);
+		free(t.s);
+	} while (optind < argc);
+	return fail ? 2 : 0;
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+// readings of channel 0 of a capture file
+static int trace_load(trace_t *t, const char *path){
+	const capture_hdr_t	*hdr;
+	const capture_rec_t	*rec;
+	const uint8_t		*map;
+	struct stat			st;
+	uint32_t			nbr, i;
+	int					fd;
+
+	if ((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st) != 0){
+		perror(path);
+		return -1;
+	}
+	map = (size_t)st.st_size >= sizeof(*hdr) ? mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	close(fd);
+	hdr = (const capture_hdr_t *)map;
+	if (map == MAP_FAILED || capture_check(hdr, (size_t)st.st_size) != CAPTURE_OK){
+		fprintf(stderr, "%s: not a valid capture\n", path);
+		return -1;
+	}
+	rec = (const capture_rec_t *)(map + hdr->hdr_size);
+	nbr = hdr->nbr != CAPTURE_NBR_STREAM ? hdr->nbr :
+		  (uint32_t)(((size_t)st.st_size - hdr->hdr_size) / sizeof(capture_rec_t));
+	t->s = malloc(((size_t)nbr + 1u) * sizeof(spsc_sample_t));
+	for (t->nbr = 0u, i = 0u; i < nbr; i++)
+		if (rec[i].ch == 0u){
+			t->s[t->nbr].ts = rec[i].ts;
+			t->s[t->nbr].code = rec[i].code;
+			t->s[t->nbr++].ch = 0u;
+		}
+	t->ts_hz = hdr->ts_hz;
+	t->period = hdr->period;
+	munmap((void *)map, (size_t)st.st_size);
+	snprintf(t->name, sizeof(t->name), "%s", strrchr(path, '/') ? strrchr(path, '/') + 1 : path);
+	return 0;
+}
+
+// battery from 2.9 V to the knee near 1.9 V over the duration, at the trigger rate of app_cfg.h
+static void trace_synth(trace_t *t, double hours, double noise){
+	uint32_t seed = 12345u;
+	uint32_t i;
+
+	t->ts_hz = SIM_CORE_HZ;
+	t->period = ((APP_CFG_ADC_TRIG_MOD + 1u) << APP_CFG_ADC_TRIG_PS) * SIM_BUS_DIV;
+	t->nbr = (uint32_t)(hours * 3600.0 * t->ts_hz / t->period);
+	t->nbr = t->nbr < 1u ? 1u : t->nbr;
+	t->s = malloc((size_t)t->nbr * sizeof(spsc_sample_t));
+	for (i = 0u; i < t->nbr; i++){
+		double x = (double)i / t->nbr;
+		double u, v, code;
+
+		seed = seed * 1664525u + 1013904223u;
+		u = ((seed >> 8) + 1.0) / 16777218.0;
+		seed = seed * 1664525u + 1013904223u;
+		v = (seed >> 8) / 16777216.0;
+		code = 57600.0 - 14000.0 * (0.3 * x + 0.7 * pow(x, 8.0)) + noise * sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+		t->s[i].ts = i * t->period;
+		t->s[i].code = (uint16_t)lrint(code < 0.0 ? 0.0 : code > 65535.0 ? 65535.0 : code);
+		t->s[i].ch = 0u;
+	}
+	snprintf(t->name, sizeof(t->name), "synth %.0fLSB", noise);
+}
+
+static int bench_run(const trace_t *t, uint32_t avg_log2){
+	static history_t	h;
+	uint32_t			len = 1u << avg_log2;
+	uint32_t			values = t->nbr >> avg_log2;
+	uint32_t			chunk_nbr = values / 32u + 16u;		// a chunk holds 57 values or more
+	history_hdr_t	   *img = calloc(1u, sizeof(history_hdr_t) + (size_t)chunk_nbr * sizeof(history_chunk_t));
+	uint16_t		   *ref = malloc(((size_t)values + 1u) * sizeof(uint16_t));
+	uint16_t		   *out = malloc(((size_t)values + HISTORY_VALUES_MAX) * sizeof(uint16_t));
+	history_chunk_t		c;
+	uint32_t			i, j, got, seq, head, max_cycles = 0u;
+	double				t_code, t_decode, per_value_s;
+	int					fail = 0;
+
+	for (i = 0u; i < values; i++){
+		uint32_t sum = 0u;
+
+		for (j = 0u; j < len; j++)
+			sum += t->s[i * len + j].code;
+		ref[i] = (uint16_t)((sum + (len >> 1)) >> avg_log2);
+	}
+
+	history_init(&h, img, chunk_nbr, t->ts_hz, avg_log2);
+	t_code = wall();
+	for (i = 0u; i < t->nbr; i += BENCH_BLOCK){
+		uint32_t n = t->nbr - i < BENCH_BLOCK ? t->nbr - i : BENCH_BLOCK;
+		uint32_t c0 = host_cycles();
+
+		history_add(&h, &t->s[i], n, t->period);
+		c0 = host_cycles() - c0;
+		max_cycles = c0 > max_cycles ? c0 : max_cycles;
+	}
+	history_flush(&h);
+	t_code = wall() - t_code;
+
+	head = img->head;
+	t_decode = wall();
+	for (got = 0u, seq = 0u; seq < head; seq++){
+		if (history_read(img, seq, &c) != HISTORY_OK){
+			fprintf(stderr, "%s: chunk %u not readable\n", t->name, seq);
+			fail = 1;
+			break;
+		}
+		got += history_decode(&c, &out[got]);
+	}
+	t_decode = wall() - t_decode;
+
+	if (got != values || memcmp(out, ref, values * sizeof(uint16_t)) != 0){
+		for (i = 0u; i < got && i < values && out[i] == ref[i]; i++)
+			;
+		fprintf(stderr, "%s avg %u: %u values decoded of %u, first difference at %u\n", t->name, len, got, values, i);
+		fail = 1;
+	}
+	for (seq = 0u; seq < head && !fail; seq++){
+		uint32_t time_ms;
+
+		history_read(img, seq, &c);
+		time_ms = c.time_ms;
+		j = history_find(img, time_ms);
+		if (j == HISTORY_NONE || j < seq || history_read(img, j, &c) != HISTORY_OK || c.time_ms != time_ms){
+			fprintf(stderr, "%s avg %u: history_find() of chunk %u gives %u\n", t->name, len, seq, j);
+			fail = 1;
+		}
+	}
+
+	per_value_s = (double)t->period * len / t->ts_hz;
+	printf("%-12s %9u  %3u  %7u  %10.2f  %6.2f  %8.1f  %10.1f  %10.1f  %9.1f  %11.1f  %16u%s\n", t->name, t->nbr, len,
+			values, head * HISTORY_CHUNK_SIZE * 8.0 / values, (double)varint_bits(ref, values) / values,
+			values * 2.0 / (head * HISTORY_CHUNK_SIZE), t->nbr * 2.0 / (head * HISTORY_CHUNK_SIZE),
+			(double)values / head * APP_CFG_HISTORY_CHUNKS * per_value_s / 3600.0, t->nbr * 2.0 / t_code / 1e6,
+			values * 2.0 / t_decode / 1e6, max_cycles, fail ? "  FAILED" : "");
+	free(img);
+	free(ref);
+	free(out);
+	return fail;
+}
+
+// first value in 2 bytes, then the zig-zag differences in 7 bit groups
+static uint32_t varint_bits(const uint16_t *v, uint32_t n){
+	uint32_t bits = 16u, i;
+
+	for (i = 1u; i < n; i++){
+		int32_t  d = (int32_t)v[i] - (int32_t)v[i - 1u];
+		uint32_t z = d >= 0 ? (uint32_t)d << 1 : ((uint32_t)-d << 1) - 1u;
+
+		bits += z < 0x80u ? 8u : z < 0x4000u ? 16u : 24u;
+	}
+	return bits;
+}
+
+static uint32_t host_cycles(void){
+#if defined(__x86_64__) || defined(__i386__)
+	return (uint32_t)__rdtsc();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+#endif
+}
+
+static double wall(void){
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+}
@@ -0,0 +1,319 @@
+/*
+*********************************************************************************************************
+* Host test of the transition journal (journal.c) and of its flash log (flog.c) on the flash of the
+* simulator.
+*  - cost of journal_add() alone, with room and with the journal full
+*  - a producer thread adding records as fast as it can against a consumer thread taking them in batches,
+*    as range_check() and the report task do: every record carries its sequence number, so the consumer
+*    checks their order and contents and that the gaps add up to the records counted as lost
+*  - a journal never emptied keeps its first JOURNAL_SIZE records and counts the others as lost
+*  - the flash log written in batches of varying size through several turns of the ring, remounted as
+*    after a reset at random points and once with a record cut by the reset: the end of the log read back
+*    must be the last records appended, and the erase counts of the sectors must stay within one
+*
+* Build (from FRDM-K64F):
+*   gcc -O2 -pthread -DAPP_HOST_BUILD -IOS3-KSDK -Ihost OS3-KSDK/journal.c OS3-KSDK/flog.c host/hal_sim.c \
+*       host/journal_bench.c -o journal_bench
+*
+* Usage: journal_bench [-n records] [-c consumer batch] [-d consumer delay loops] [-y] [-f flash records]
+* -y makes the threads yield as spsc_stress does, for a single CPU.
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <pthread.h>
+#include  <sched.h>
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <time.h>
+#include  <unistd.h>
+
+#include  <band.h>
+#include  <journal.h>
+#include  <flog.h>
+#include  "hal_sim.h"
+
+/*
+*********************************************************************************************************
+*                                            LOCAL DEFINES
+*********************************************************************************************************
+*/
+
+#define BENCH_ADDS				10000000u				// journal_add() calls of the cost test
+#define BENCH_FLOG_SECTORS		8u
+#define BENCH_FLOG_BASE			(SIM_FLASH_BASE + SIM_FLASH_SIZE - BENCH_FLOG_SECTORS * HAL_FLASH_SECTOR)
+
+// record number seq, as the consumer and the log check expect it
+#define BENCH_FROM(seq)			((seq) % BAND_STATE_NBR)
+#define BENCH_TO(seq)			(((seq) + 1u) % BAND_STATE_NBR)
+
+/*
+*********************************************************************************************************
+*                                       LOCAL GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+static journal_t		journal;
+static uint32_t			total = 100000000u;
+static uint32_t			batch = 16u;
+static uint32_t			delay;
+static int				yield;
+static volatile int		done;
+
+static uint32_t			received;
+static uint32_t			gaps;							// records missing from the sequence
+static uint32_t			errors;							// out of order or corrupted records
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static double   seconds(void);
+static int      bench_cost(void);
+static int      bench_threads(void);
+static int      bench_full(void);
+static int      bench_flog(uint32_t records);
+static int      rec_check(const journal_rec_t *r, uint32_t seq);
+static void    *producer(void *arg);
+static void    *consumer(void *arg);
+
+/*
+*********************************************************************************************************
+*                                                main()
+*********************************************************************************************************
+*/
+
+int main(int argc, char **argv){
+	uint32_t	flash = 100000u;
+	int			opt, fail = 0;
+
+	while ((opt = getopt(argc, argv, "n:c:d:yf:")) != -1){
+		switch (opt){
+			case 'n': total = (uint32_t)atol(optarg); break;
+			case 'c': batch = (uint32_t)atoi(optarg); break;
+			case 'd': delay = (uint32_t)atoi(optarg); break;
+			case 'y': yield = 1; break;
+			case 'f': flash = (uint32_t)atol(optarg); break;
+			default:
+				fprintf(stderr, "usage: %s [-n records] [-c batch] [-d delay] [-y] [-f flash records]\n", argv[0]);
+				return 1;
+		}
+	}
+	batch = batch < 1u ? 1u : batch > JOURNAL_SIZE ? JOURNAL_SIZE : batch;
+
+	fail |= bench_cost();
+	fail |= bench_threads();
+	fail |= bench_full();
+	fail |= bench_flog(flash);
+	printf(fail ? "FAIL\n" : "PASS\n");
+	return fail;
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+static double seconds(void){
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// journal_add() emptied every JOURNAL_SIZE records, then into a full journal
+static int bench_cost(void){
+	journal_rec_t	out[JOURNAL_SIZE];
+	uint32_t		i, k;
+	double			t0, t_room, t_full;
+
+	journal_init(&journal);
+	t0 = seconds();
+	for (i = 0u; i < BENCH_ADDS; i += JOURNAL_SIZE){
+		for (k = 0u; k < JOURNAL_SIZE; k++)
+			journal_add(&journal, i + k, i + k, BENCH_FROM(i + k), BENCH_TO(i + k));
+		journal_pop(&journal, out, JOURNAL_SIZE);
+	}
+	t_room = seconds() - t0;
+	t0 = seconds();
+	for (i = 0u; i < BENCH_ADDS; i++)
+		journal_add(&journal, i, i, BENCH_FROM(i), BENCH_TO(i));
+	t_full = seconds() - t0;
+
+	printf("journal_add         %.2f ns with room (pops included), %.2f ns full\n",
+			t_room / BENCH_ADDS * 1e9, t_full / BENCH_ADDS * 1e9);
+	return journal.lost != BENCH_ADDS - JOURNAL_SIZE;
+}
+
+static int bench_threads(void){
+	pthread_t	prod, cons;
+	double		t0, s;
+	int			fail;
+
+	journal_init(&journal);
+	received = gaps = errors = 0u;
+	done = 0;
+	t0 = seconds();
+	pthread_create(&cons, NULL, consumer, NULL);
+	pthread_create(&prod, NULL, producer, NULL);
+	pthread_join(prod, NULL);
+	pthread_join(cons, NULL);
+	s = seconds() - t0;
+
+	printf("records offered     %u in %.3f s (%.1f Mrecords/s)\n", total, s, total / s * 1e-6);
+	printf("added               %u\n", journal.added);
+	printf("received            %u\n", received);
+	printf("lost                %u (%.2f%%)\n", journal.lost, 100.0 * journal.lost / total);
+	printf("sequence gaps       %u\n", gaps);
+	printf("errors              %u\n", errors);
+	fail = errors || gaps != journal.lost || received != journal.added || journal.added + journal.lost != total;
+	printf("threads             %s\n", fail ? "FAIL" : "ok");
+	return fail;
+}
+
+// nobody takes the records out: the first ones stay
+static int bench_full(void){
+	journal_rec_t	out[JOURNAL_SIZE];
+	uint32_t		n, i;
+	int				fail;
+
+	journal_init(&journal);
+	for (i = 0u; i < 1000u; i++)
+		journal_add(&journal, i, i, BENCH_FROM(i), BENCH_TO(i));
+	n = journal_pop(&journal, out, JOURNAL_SIZE);
+	fail = n != JOURNAL_SIZE || journal.added != JOURNAL_SIZE || journal.lost != 1000u - JOURNAL_SIZE;
+	for (i = 0u; i < n; i++)
+		fail |= rec_check(&out[i], i);
+	// room again after the pop
+	journal_add(&journal, 1000u, 1000u, BENCH_FROM(1000u), BENCH_TO(1000u));
+	fail |= journal_pop(&journal, out, JOURNAL_SIZE) != 1u || rec_check(&out[0], 1000u);
+	printf("full journal        1000 added, %u kept (the first), %u lost: %s\n", journal.added - 1u, journal.lost,
+			fail ? "FAIL" : "ok");
+	return fail;
+}
+
+// records in batches of 1 to JOURNAL_SIZE, remounted about every 64 batches and at the end
+static int bench_flog(uint32_t records){
+	journal_rec_t	rec[JOURNAL_SIZE], out[JOURNAL_SIZE];
+	flog_t			f;
+	flog_hdr_t		h;
+	uint64_t		c0;
+	uint32_t		seq = 0u, n, i, k, got, min, max, mounts = 0u, cut = 0u;
+	int				fail = 0;
+
+	sim_reset();
+	sim_flash_reset();
+	srand(1u);
+	fail |= flog_mount(&f, BENCH_FLOG_BASE, BENCH_FLOG_SECTORS) != 0;
+	c0 = sim_now();
+	while (seq < records){
+		n = 1u + (uint32_t)rand() % JOURNAL_SIZE;
+		if (n > records - seq)
+			n = records - seq;
+		for (i = 0u; i < n; i++){
+			rec[i].ts = seq + i;
+			rec[i].sample = (uint16_t)(seq + i);
+			rec[i].from = (uint8_t)BENCH_FROM(seq + i);
+			rec[i].to = (uint8_t)BENCH_TO(seq + i);
+		}
+		if (flog_append(&f, rec, n) != n)
+			fail = 1;
+		seq += n;
+
+		if (rand() % 64 == 0 || seq == records){
+			// reset, at the end as well, once with the slot after the last record half programmed
+			if (cut == 0u && f.next > 1u && f.next < FLOG_SLOTS){
+				uint32_t addr = BENCH_FLOG_BASE + f.cur * HAL_FLASH_SECTOR + f.next * sizeof(journal_rec_t);
+
+				sim_flash.mem[addr - SIM_FLASH_BASE] = 0x5Au;
+				sim_flash.mem[addr - SIM_FLASH_BASE + 7u] = 0x00u;
+				cut = f.next;
+			}
+			fail |= flog_mount(&f, BENCH_FLOG_BASE, BENCH_FLOG_SECTORS) != 1;
+			mounts++;
+			// the end of the log is the last records appended
+			k = seq < JOURNAL_SIZE ? seq : JOURNAL_SIZE;
+			got = flog_last(&f, out, k);
+			fail |= got != k;
+			for (i = 0u; i < got; i++)
+				fail |= rec_check(&out[i], seq - got + i);
+		}
+	}
+	// the log keeps between sectors - 1 and sectors full sectors
+	got = flog_last(&f, rec, JOURNAL_SIZE);
+	for (i = 0u; i < got; i++)
+		fail |= rec_check(&rec[i], seq - got + i);
+	flog_wear(&f, &min, &max);
+	fail |= max - min > 1u || sim_flash.errors != 0u || cut == 0u;
+	for (i = 0u; i < BENCH_FLOG_SECTORS; i++){
+		flog_hdr_t *p = (flog_hdr_t *)&sim_flash.mem[BENCH_FLOG_BASE - SIM_FLASH_BASE + i * HAL_FLASH_SECTOR];
+
+		h = *p;
+		if (h.magic == FLOG_MAGIC)
+			fail |= sim_flash.erases[(BENCH_FLOG_BASE - SIM_FLASH_BASE) / HAL_FLASH_SECTOR + i] != h.erases;
+	}
+
+	printf("flash log           %u records, %u remounts, %llu phrases, sector erases %u to %u, "
+			"%.1f us of flash per record: %s\n", seq, mounts, (unsigned long long)sim_flash.phrases, min, max,
+			(double)(sim_now() - c0) / records / (SIM_CORE_HZ / 1000000u), fail ? "FAIL" : "ok");
+	return fail;
+}
+
+// returns 1 if r is not record number seq
+static int rec_check(const journal_rec_t *r, uint32_t seq){
+	return r->ts != seq || r->sample != (uint16_t)seq || r->from != BENCH_FROM(seq) || r->to != BENCH_TO(seq);
+}
+
+static void *producer(void *arg){
+	uint32_t	seq;
+
+	(void)arg;
+	for (seq = 0u; seq < total; seq++){
+		journal_add(&journal, seq, seq, BENCH_FROM(seq), BENCH_TO(seq));
+		if (yield && (seq & (JOURNAL_SIZE - 1u)) == 0u)
+			sched_yield();
+	}
+	__atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+static void *consumer(void *arg){
+	journal_rec_t	out[JOURNAL_SIZE];
+	uint32_t		next = 0u, n, i;
+	volatile uint32_t d;
+
+	(void)arg;
+	for (;;){
+		int last = __atomic_load_n(&done, __ATOMIC_ACQUIRE);
+
+		n = journal_pop(&journal, out, batch);
+		if (n == 0u){
+			if (last)
+				break;
+			if (yield)
+				sched_yield();
+			continue;
+		}
+		for (i = 0u; i < n; i++){
+			if (out[i].ts < next || rec_check(&out[i], out[i].ts))
+				errors++;
+			else
+				gaps += out[i].ts - next;
+			next = out[i].ts + 1u;
+		}
+		received += n;
+		for (d = 0u; d < delay; d++)
+			;
+	}
+	gaps += total - next;
+	return NULL;
+}
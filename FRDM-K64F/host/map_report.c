@@ -0,0 +1,245 @@
+/*
+*********************************************************************************************************
+* Static RAM and flash breakdown from the map file of the GNU linker (-Wl,-Map=app.map). Every input
+* section of the memory map is counted by object file (archive members under their archive) as code
+* (text, rodata and the other flash sections), data (initialized RAM, also stored in flash) or bss
+* (zeroed RAM, including heap, stacks and noinit), then the largest RAM sections are listed. Build the
+* firmware with -fdata-sections so that each static variable is a section of its own and shows by name.
+*
+* Build (from FRDM-K64F):
+*   gcc -O2 host/map_report.c -o map_report
+*
+* Usage: map_report [-n largest] app.map
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <inttypes.h>
+#include  <stdint.h>
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <unistd.h>
+
+/*
+*********************************************************************************************************
+*                                            LOCAL DEFINES
+*********************************************************************************************************
+*/
+
+#define MAP_LINE_MAX			1024u
+#define MAP_NAME_MAX			128u
+#define MAP_OBJ_MAX				512u
+#define MAP_ITEM_MAX			4096u
+
+#define MAP_CODE				0u
+#define MAP_DATA				1u
+#define MAP_BSS					2u
+#define MAP_KIND_NBR			3u
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+typedef struct map_obj {
+	char		name[MAP_NAME_MAX];
+	uint64_t	size[MAP_KIND_NBR];
+} map_obj_t;
+
+// one input section in RAM
+typedef struct map_item {
+	char		name[MAP_NAME_MAX];
+	char		obj[MAP_NAME_MAX];
+	uint64_t	size;
+	uint32_t	kind;
+} map_item_t;
+
+/*
+*********************************************************************************************************
+*                                       LOCAL GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+static map_obj_t	objs[MAP_OBJ_MAX];
+static uint32_t		obj_nbr;
+static map_item_t	items[MAP_ITEM_MAX];
+static uint32_t		item_nbr;
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static uint32_t kind_of(const char *out_sect);
+static uint32_t obj_find(const char *path);
+static void     add(const char *sect, const char *out_sect, uint64_t size, const char *path);
+static int      by_size(const void *a, const void *b);
+static int      by_ram(const void *a, const void *b);
+
+/*
+*********************************************************************************************************
+*                                                main()
+*********************************************************************************************************
+*/
+
+int main(int argc, char **argv){
+	char		line[MAP_LINE_MAX], sect[MAP_NAME_MAX] = "", out_sect[MAP_NAME_MAX] = "";
+	char		a[MAP_NAME_MAX], b[MAP_NAME_MAX], c[MAP_NAME_MAX], path[MAP_LINE_MAX];
+	uint64_t	total[MAP_KIND_NBR] = { 0u }, addr, size;
+	uint32_t	largest = 20u, i, k;
+	int			in_map = 0, opt, n;
+	FILE	   *f;
+
+	while ((opt = getopt(argc, argv, "n:")) != -1){
+		switch (opt){
+			case 'n': largest = (uint32_t)atoi(optarg); break;
+			default:
+				fprintf(stderr, "usage: %s [-n largest] app.map\n", argv[0]);
+				return 1;
+		}
+	}
+	if (optind >= argc || (f = fopen(argv[optind], "r")) == NULL){
+		fprintf(stderr, "usage: %s [-n largest] app.map\n", argv[0]);
+		return 1;
+	}
+
+	while (fgets(line, sizeof(line), f)){
+		// the discarded sections and the memory configuration come first
+		if (!in_map){
+			in_map = strncmp(line, "Linker script and memory map", 28) == 0;
+			continue;
+		}
+		if (line[0] == '.' || (line[0] != ' ' && line[0] != '\n' && line[0] != '*')){
+			// output section, possibly with its address and size on the same line
+			if (sscanf(line, "%127s", out_sect) != 1)
+				out_sect[0] = '\0';
+			sect[0] = '\0';
+			continue;
+		}
+		if (line[0] != ' ' || (line[1] == ' ' && sect[0] == '\0'))
+			continue;
+
+		n = sscanf(line, " %127s %127s %127s %1023s", a, b, c, path);
+		if (line[1] != ' ' && n == 1){
+			// input section name alone, address, size and file on the next line
+			snprintf(sect, sizeof(sect), "%s", a);
+			continue;
+		}
+		if (line[1] == ' ' && n == 3 && sect[0] != '\0'){
+			// continuation of the name above
+			if (sscanf(b, "%" SCNx64, &size) == 1 && sscanf(a, "%" SCNx64, &addr) == 1 && addr != 0u)
+				add(sect, out_sect, size, c);
+			sect[0] = '\0';
+			continue;
+		}
+		sect[0] = '\0';
+		if (line[1] != ' ' && n == 4 && a[0] != '*' && strncmp(b, "0x", 2) == 0 &&
+			sscanf(b, "%" SCNx64, &addr) == 1 && sscanf(c, "%" SCNx64, &size) == 1 && addr != 0u)
+			add(a, out_sect, size, path);
+	}
+	fclose(f);
+	if (!in_map){
+		fprintf(stderr, "%s: no memory map\n", argv[optind]);
+		return 1;
+	}
+
+	for (i = 0u; i < obj_nbr; i++)
+		for (k = 0u; k < MAP_KIND_NBR; k++)
+			total[k] += objs[i].size[k];
+	printf("flash %9llu bytes  (code %llu + data %llu)\n", (unsigned long long)(total[MAP_CODE] + total[MAP_DATA]),
+			(unsigned long long)total[MAP_CODE], (unsigned long long)total[MAP_DATA]);
+	printf("ram   %9llu bytes  (data %llu + bss %llu)\n\n", (unsigned long long)(total[MAP_DATA] + total[MAP_BSS]),
+			(unsigned long long)total[MAP_DATA], (unsigned long long)total[MAP_BSS]);
+
+	qsort(objs, obj_nbr, sizeof(objs[0]), by_ram);
+	printf("%-40s %9s %9s %9s\n", "object", "code", "data", "bss");
+	for (i = 0u; i < obj_nbr; i++)
+		printf("%-40s %9llu %9llu %9llu\n", objs[i].name, (unsigned long long)objs[i].size[MAP_CODE],
+				(unsigned long long)objs[i].size[MAP_DATA], (unsigned long long)objs[i].size[MAP_BSS]);
+
+	qsort(items, item_nbr, sizeof(items[0]), by_size);
+	printf("\nlargest RAM sections\n");
+	for (i = 0u; i < item_nbr && i < largest; i++)
+		printf("%9llu  %-4s %-40s %s\n", (unsigned long long)items[i].size, items[i].kind == MAP_DATA ? "data" : "bss",
+				items[i].name, items[i].obj);
+	return 0;
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+static uint32_t kind_of(const char *out_sect){
+	if (strstr(out_sect, "bss") || strstr(out_sect, "heap") || strstr(out_sect, "stack") ||
+		strstr(out_sect, "noinit") || strstr(out_sect, "usb"))
+		return MAP_BSS;
+	if (strstr(out_sect, "data") && !strstr(out_sect, "rodata"))
+		return MAP_DATA;
+	return MAP_CODE;
+}
+
+// object of a path, archive members counted under the archive
+static uint32_t obj_find(const char *path){
+	const char *base = strrchr(path, '/');
+	char name[MAP_NAME_MAX];
+	const char *member;
+	uint32_t i;
+
+	// the member of lib/libc.a(printf.o) gives libc.a
+	member = strchr(path, '(');
+	if (member){
+		for (base = member; base > path && base[-1] != '/'; base--)
+			;
+		snprintf(name, sizeof(name), "%.*s", (int)(member - base), base);
+	} else {
+		snprintf(name, sizeof(name), "%s", base ? base + 1 : path);
+	}
+	for (i = 0u; i < obj_nbr; i++)
+		if (!strcmp(objs[i].name, name))
+			return i;
+	if (obj_nbr == MAP_OBJ_MAX)
+		return MAP_OBJ_MAX - 1u;
+	snprintf(objs[obj_nbr].name, sizeof(objs[0].name), "%s", name);
+	return obj_nbr++;
+}
+
+static void add(const char *sect, const char *out_sect, uint64_t size, const char *path){
+	uint32_t kind = kind_of(out_sect);
+	uint32_t obj;
+
+	if (size == 0u)
+		return;
+	obj = obj_find(path);
+	objs[obj].size[kind] += size;
+	if (kind != MAP_CODE && item_nbr < MAP_ITEM_MAX){
+		snprintf(items[item_nbr].name, sizeof(items[0].name), "%s", sect);
+		snprintf(items[item_nbr].obj, sizeof(items[0].obj), "%s", objs[obj].name);
+		items[item_nbr].size = size;
+		items[item_nbr++].kind = kind;
+	}
+}
+
+static int by_size(const void *a, const void *b){
+	const map_item_t *x = a, *y = b;
+
+	return x->size < y->size ? 1 : x->size > y->size ? -1 : 0;
+}
+
+// largest RAM user first
+static int by_ram(const void *a, const void *b){
+	const map_obj_t *x = a, *y = b;
+	uint64_t rx = x->size[MAP_DATA] + x->size[MAP_BSS];
+	uint64_t ry = y->size[MAP_DATA] + y->size[MAP_BSS];
+
+	return rx < ry ? 1 : rx > ry ? -1 : strcmp(x->name, y->name);
+}
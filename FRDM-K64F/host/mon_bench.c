@@ -0,0 +1,175 @@
+/*
+*********************************************************************************************************
+* Host benchmark of the multi-channel monitoring of monitor.c: cost of mon_check_batch() against the
+* number of scanned channels. Each channel reads a slow noisy ramp ("steady": a few changes of state per
+* thousand readings) or a signal jumping across a band boundary at every reading ("switching": every
+* reading changes the state and drives its output), in batches of 4 scans as popped by AppTask.
+* Cycles are read with RDTSC on x86 (reference cycles), nanoseconds elsewhere; the table memory is the
+* part of mon_t used by the channels.
+*
+* Build (from FRDM-K64F):
+*   gcc -O2 -DAPP_HOST_BUILD -DMON_CH_MAX=16 -IOS3-KSDK -Ihost OS3-KSDK/band.c OS3-KSDK/monitor.c host/mon_bench.c -o mon_bench
+*
+* Usage: mon_bench [rounds]
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include  <x86intrin.h>
+#endif
+
+#include  <app_cfg.h>
+#include  <hal.h>
+#include  <monitor.h>
+
+/*
+*********************************************************************************************************
+*                                            LOCAL DEFINES
+*********************************************************************************************************
+*/
+
+#define BENCH_SCANS				4u						// scans per batch
+#define BENCH_BATCH_NBR			64u						// batches of the input, replayed every round
+#define BENCH_BATCH_MAX			(BENCH_SCANS * MON_CH_MAX)
+
+/*
+*********************************************************************************************************
+*                                       LOCAL GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+static mon_t			mon;
+static spsc_sample_t	input[BENCH_BATCH_NBR][BENCH_BATCH_MAX];
+static spsc_sample_t	work[BENCH_BATCH_MAX];
+
+static const uint32_t	channel_nbr[] = { 2u, 4u, 6u, 8u, 12u, 16u };
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static void     make_input(uint32_t nch, int switching);
+static double   run(uint32_t nch, uint32_t rounds, uint64_t *changes);
+static uint32_t host_cycles(void);
+
+/*
+*********************************************************************************************************
+*                                          HAL OF THE OUTPUTS
+*********************************************************************************************************
+*/
+
+void hal_gpio_set(uint32_t pin){
+	(void)pin;
+}
+
+void hal_gpio_clear(uint32_t pin){
+	(void)pin;
+}
+
+/*
+*********************************************************************************************************
+*                                                main()
+*********************************************************************************************************
+*/
+
+int main(int argc, char **argv){
+	uint32_t rounds = argc > 1 ? (uint32_t)atoi(argv[1]) : 2000u;
+	uint32_t i;
+
+	printf("channels  table bytes   steady cycles/reading  cycles/scan  changes/1000   switching cycles/reading  cycles/scan\n");
+	for (i = 0u; i < sizeof(channel_nbr) / sizeof(channel_nbr[0]) && channel_nbr[i] <= MON_CH_MAX; i++){
+		uint32_t nch = channel_nbr[i];
+		uint64_t steady_changes, switch_changes;
+		double   steady, switching;
+
+		make_input(nch, 0);
+		steady = run(nch, rounds, &steady_changes);
+		make_input(nch, 1);
+		switching = run(nch, rounds, &switch_changes);
+		printf("%8u  %11u   %21.2f  %11.1f  %12.2f   %24.2f  %11.1f\n", nch,
+				(unsigned)(nch * (sizeof(band_table_t) + 3u * sizeof(uint8_t) + 2u * sizeof(uint32_t))),
+				steady, steady * nch, 1000.0 * steady_changes / ((double)rounds * BENCH_BATCH_NBR * BENCH_SCANS * nch),
+				switching, switching * nch);
+	}
+	return 0;
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+// readings of all the batches, channel k of every scan offset by k / nch of the ramp
+static void make_input(uint32_t nch, int switching){
+	uint32_t seed = 12345u;
+	uint32_t b, i;
+
+	for (b = 0u; b < BENCH_BATCH_NBR; b++){
+		for (i = 0u; i < BENCH_SCANS * nch; i++){
+			uint32_t ch = i % nch;
+			uint32_t t = b * BENCH_SCANS + i / nch;
+			int32_t  code;
+
+			seed = seed * 1664525u + 1013904223u;
+			if (switching){
+				// each side of the 1.0 V boundary in turn
+				code = (t & 1u) ? VOLT_10 + 2000 : VOLT_10 - 2000;
+			} else {
+				code = (int32_t)((t * 97u + ch * 65536u / nch) & 0xFFFFu) + (int32_t)(seed >> 27) - 16;
+				code = code < 0 ? 0 : code > 0xFFFF ? 0xFFFF : code;
+			}
+			input[b][i].ts = t;
+			input[b][i].code = (uint16_t)code;
+			input[b][i].ch = (uint16_t)ch;
+		}
+	}
+}
+
+// cycles per reading of mon_check_batch(), the copy of the batch excluded
+static double run(uint32_t nch, uint32_t rounds, uint64_t *changes){
+	uint32_t len = BENCH_SCANS * nch;
+	uint64_t cycles = 0u, overhead = 0u;
+	uint32_t r, b, ch, t0;
+
+	mon_init(&mon, nch);
+	for (ch = 1u; ch < nch; ch++)
+		mon_set_output(&mon, ch, ch, 1u << BAND_LED_GREEN);
+	for (r = 0u; r < rounds; r++){
+		for (b = 0u; b < BENCH_BATCH_NBR; b++){
+			memcpy(work, input[b], len * sizeof(spsc_sample_t));
+			t0 = host_cycles();
+			mon_check_batch(&mon, work, len);
+			cycles += host_cycles() - t0;
+			t0 = host_cycles();
+			overhead += host_cycles() - t0;
+		}
+	}
+	for (*changes = 0u, ch = 1u; ch < nch; ch++)
+		*changes += mon.changes[ch];
+	return (double)(cycles - (overhead < cycles ? overhead : cycles)) / ((double)rounds * BENCH_BATCH_NBR * len);
+}
+
+static uint32_t host_cycles(void){
+#if defined(__x86_64__) || defined(__i386__)
+	return (uint32_t)__rdtsc();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+#endif
+}
@@ -0,0 +1,215 @@
+/*
+*********************************************************************************************************
+* Host benchmark of range_check() over the workloads of bench.c, printed in the same format as
+* APP_CFG_PIPE_BENCH_EN on the board. Cycles are read with RDTSC on x86 (reference cycles, converted to
+* nanoseconds with the TSC rate measured at start), nanoseconds elsewhere. Branches per sample come from
+* the hardware counter of perf_event_open(); "-" where the kernel does not allow it.
+*
+* Regression budget: -s writes the results to a baseline file, -c compares a run with it and exits with
+* 3 if the ns/sample or branches/sample of a workload is more than -x percent above its baseline, or its
+* path more than -X percent: a single sample timed by RDTSC in a virtual machine jitters by tens of
+* cycles. Run the baseline and the check on the same machine, idle.
+*
+* Build (from FRDM-K64F):
+*   gcc -O2 -DAPP_HOST_BUILD -IOS3-KSDK -Ihost OS3-KSDK/alarm.c OS3-KSDK/band.c OS3-KSDK/trend.c OS3-KSDK/journal.c OS3-KSDK/prof.c OS3-KSDK/bench.c host/hal_sim.c host/pipe_bench.c -o pipe_bench -lm
+*
+* Usage: pipe_bench [-r rounds] [-s baseline] [-c baseline] [-x percent] [-X path percent]
+*   e.g. pipe_bench -s base.txt; (change range_check()); pipe_bench -c base.txt -x 10
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <time.h>
+#include  <unistd.h>
+#include  <sys/syscall.h>
+#include  <linux/perf_event.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include  <x86intrin.h>
+#endif
+
+#include  <bench.h>
+#include  "hal_sim.h"
+
+/*
+*********************************************************************************************************
+*                                       LOCAL GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+static int				branch_fd = -1;
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static uint32_t host_cycles(void);
+static uint32_t host_cycles_hz(void);
+static uint32_t host_branches(void);
+static int      branches_open(void);
+static void     print_result(uint32_t w, const bench_result_t *b);
+static int      check(const char *file, const bench_t *res, uint32_t percent, uint32_t path_percent);
+static int      over(const char *name, const char *what, double value, double base, uint32_t percent);
+
+/*
+*********************************************************************************************************
+*                                                main()
+*********************************************************************************************************
+*/
+
+int main(int argc, char **argv){
+	bench_t		res;
+	uint32_t	rounds = 20000u, percent = 15u, path_percent = 50u, w;
+	const char *save = NULL, *base = NULL;
+	FILE	   *f;
+	int			opt;
+
+	while ((opt = getopt(argc, argv, "r:s:c:x:X:")) != -1){
+		switch (opt){
+			case 'r': rounds = (uint32_t)atoi(optarg); break;
+			case 's': save = optarg; break;
+			case 'c': base = optarg; break;
+			case 'x': percent = (uint32_t)atoi(optarg); break;
+			case 'X': path_percent = (uint32_t)atoi(optarg); break;
+			default:
+				fprintf(stderr, "usage: %s [-r rounds] [-s baseline] [-c baseline] [-x percent] [-X path percent]\n", argv[0]);
+				return 1;
+		}
+	}
+
+	sim_reset();
+	bench_run(&res, host_cycles, host_cycles_hz(), branches_open() == 0 ? host_branches : NULL, rounds);
+	for (w = 0u; w < BENCH_WORKLOAD_NBR; w++)
+		print_result(w, &res.w[w]);
+
+	if (save){
+		if ((f = fopen(save, "w")) == NULL){
+			perror(save);
+			return 1;
+		}
+		for (w = 0u; w < BENCH_WORKLOAD_NBR; w++)
+			fprintf(f, "%s %u %u %u\n", bench_name(w), res.w[w].ns_x100, res.w[w].events_x100, res.w[w].path);
+		fclose(f);
+	}
+	return base ? check(base, &res, percent, path_percent) : 0;
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+static uint32_t host_cycles(void){
+#if defined(__x86_64__) || defined(__i386__)
+	return (uint32_t)__rdtsc();
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+#endif
+}
+
+// rate of host_cycles() against the monotonic clock over 100 ms
+static uint32_t host_cycles_hz(void){
+#if defined(__x86_64__) || defined(__i386__)
+	struct timespec t0, t1;
+	uint64_t c0, c1;
+	double ns;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	c0 = __rdtsc();
+	do {
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+	} while (ns < 1e8);
+	c1 = __rdtsc();
+	return (uint32_t)((c1 - c0) * 1e9 / ns);
+#else
+	return 1000000000u;
+#endif
+}
+
+static int branches_open(void){
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_BRANCH_INSTRUCTIONS;
+	attr.exclude_kernel = 1u;
+	attr.exclude_hv = 1u;
+	branch_fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+	return branch_fd < 0 ? -1 : 0;
+}
+
+static uint32_t host_branches(void){
+	uint64_t count = 0u;
+
+	if (read(branch_fd, &count, sizeof(count)) != (ssize_t)sizeof(count))
+		return 0u;
+	return (uint32_t)count;
+}
+
+static void print_result(uint32_t w, const bench_result_t *b){
+	char branches[16];
+
+	if (b->events_x100 == BENCH_NA)
+		snprintf(branches, sizeof(branches), "-");
+	else
+		snprintf(branches, sizeof(branches), "%u.%02u", b->events_x100 / 100u, b->events_x100 % 100u);
+	printf("bench %-6s %5u.%02u cycles/sample %5u.%02u ns/sample %7s branches/sample path %5u cycles %4u transitions\n",
+			bench_name(w), b->cycles_x100 / 100u, b->cycles_x100 % 100u, b->ns_x100 / 100u, b->ns_x100 % 100u,
+			branches, b->path, b->transitions);
+}
+
+// returns 3 if a figure of a workload is above its baseline by more than its budget
+static int check(const char *file, const bench_t *res, uint32_t percent, uint32_t path_percent){
+	char		name[16];
+	uint32_t	ns, ev, path, w;
+	int			failed = 0, found = 0;
+	FILE	   *f = fopen(file, "r");
+
+	if (f == NULL){
+		perror(file);
+		return 1;
+	}
+	while (fscanf(f, "%15s %u %u %u", name, &ns, &ev, &path) == 4){
+		for (w = 0u; w < BENCH_WORKLOAD_NBR && strcmp(name, bench_name(w)); w++)
+			;
+		if (w == BENCH_WORKLOAD_NBR)
+			continue;
+		found++;
+		failed |= over(name, "ns/sample", res->w[w].ns_x100 / 100.0, ns / 100.0, percent);
+		if (ev != BENCH_NA && res->w[w].events_x100 != BENCH_NA)
+			failed |= over(name, "branches/sample", res->w[w].events_x100 / 100.0, ev / 100.0, percent);
+		failed |= over(name, "path cycles", res->w[w].path, path, path_percent);
+	}
+	fclose(f);
+	if (found == 0){
+		fprintf(stderr, "%s: no baseline\n", file);
+		return 1;
+	}
+	printf("budget              +%u%% (path +%u%%) over %s: %s\n", percent, path_percent, file,
+			failed ? "EXCEEDED" : "ok");
+	return failed ? 3 : 0;
+}
+
+static int over(const char *name, const char *what, double value, double base, uint32_t percent){
+	if (value <= base * (100.0 + percent) / 100.0)
+		return 0;
+	printf("regression          %s %s %.2f, baseline %.2f (+%.1f%%)\n", name, what, value, base,
+			base > 0.0 ? 100.0 * (value - base) / base : 100.0);
+	return 1;
+}
@@ -0,0 +1,391 @@
+/*
+*********************************************************************************************************
+* Offline replay of a capture (capture.h) through the filter and range_check() of AppTask, from the bands,
+* filter and blink state of its header. Every change of blink state is written as one line
+*
+*   <cycles from the first reading> <seconds> <led_rate> <current_led>
+*
+* so that two runs, or a run and a later build, can be compared with diff. A capture file is mapped in
+* memory; stdin or a pipe is replayed as it is read, e.g. straight from stream_decode -d -. With -n the
+* mapped capture is replayed that many times: the transitions are written once, every pass must give the
+* same ones, and the readings per second and the speed against the duration of the capture are reported.
+*
+* With -p the early warning of APP_CFG_TREND_EN runs along (alarm_predict() after every reading, where the
+* board checks once per batch), its changes are written as "warn" and "clear" lines, and for every change
+* of state the time it was announced ahead of range_check() is measured: the lead of the warned changes,
+* the changes not warned and the warnings cleared without a change are reported.
+*
+* With -s the statistics of APP_CFG_STATS_EN (stats.h) are taken over the filtered readings in windows of
+* the given number of readings, and the last window, the whole capture, the time in each VOLT_xx band and
+* the histogram of the codes are reported: the distributions to set the bands from.
+*
+* Build (from FRDM-K64F):
+*   gcc -O2 -DAPP_HOST_BUILD -IOS3-KSDK -Ihost OS3-KSDK/alarm.c OS3-KSDK/band.c OS3-KSDK/trend.c OS3-KSDK/journal.c OS3-KSDK/filter.c OS3-KSDK/prof.c OS3-KSDK/capture.c OS3-KSDK/stats.c host/hal_sim.c host/replay.c -o replay -lm
+*
+* Usage: replay [-n passes] [-o transitions] [-q] [-p horizon ms] [-m min codes] [-W window]
+*               [-s stats window] [capture file, stdin by default]
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <fcntl.h>
+#include  <math.h>
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <sys/mman.h>
+#include  <sys/stat.h>
+#include  <time.h>
+#include  <unistd.h>
+
+#include  <app_cfg.h>
+#include  <hal.h>
+#include  <alarm.h>
+#include  <band.h>
+#include  <filter.h>
+#include  <capture.h>
+#include  <stats.h>
+#include  "hal_sim.h"
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+// state of one pass, kept across the chunks of a stream
+typedef struct replay {
+	const capture_hdr_t	*hdr;
+	filter_t			filter;
+	FILE			   *out;							// NULL: transitions only counted
+	uint64_t			cycles;							// from the first reading, unwrapped
+	uint32_t			last_ts;
+	uint64_t			readings;
+	uint64_t			transitions;
+	uint64_t			hash;							// FNV-1a of the transitions
+	// early warning, horizon 0 without
+	trend_t				trend;
+	uint32_t			horizon;						// cycles
+	uint64_t			warn_at;						// cycles of the warning on
+	uint64_t			warned;							// changes of state under a warning
+	uint64_t			lead_sum;
+	uint64_t			lead_min;
+	uint64_t			lead_max;
+	uint64_t			false_warn;						// warnings cleared without a change
+	// statistics, window 0 without
+	stats_t				stats;
+} replay_t;
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static void        replay_start(replay_t *r, const capture_hdr_t *hdr, FILE *out);
+static void        replay_chunk(replay_t *r, const capture_rec_t *rec, uint32_t n);
+static void        replay_lead(const replay_t *r);
+static void        replay_stats(const replay_t *r);
+static void        stats_line(const char *name, const stats_sum_t *sum);
+static int         read_full(int fd, void *buf, size_t len);
+static const char *rate_name(blink_mode rate);
+static const char *led_name(uint32_t pin);
+static double      wall(void);
+
+/*
+*********************************************************************************************************
+*                                       LOCAL GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+static uint32_t		trend_ms;
+static uint32_t		trend_min = APP_CFG_TREND_MIN_CODES;
+static uint32_t		trend_win = APP_CFG_TREND_WIN;
+static uint32_t		stats_win;
+
+/*
+*********************************************************************************************************
+*                                                main()
+*********************************************************************************************************
+*/
+
+int main(int argc, char **argv){
+	uint32_t		passes = 1u, p;
+	int				fd = 0, quiet = 0, opt, err;
+	FILE		   *out = stdout;
+	struct stat		st;
+	replay_t		r, again;
+	double			t;
+
+	while ((opt = getopt(argc, argv, "n:o:qp:m:W:s:")) != -1){
+		switch (opt){
+			case 'n': passes = (uint32_t)atoi(optarg); break;
+			case 'o':
+				if ((out = fopen(optarg, "w")) == NULL){
+					perror(optarg);
+					return 1;
+				}
+				break;
+			case 'q': quiet = 1; break;
+			case 'p': trend_ms = (uint32_t)atoi(optarg); break;
+			case 'm': trend_min = (uint32_t)atoi(optarg); break;
+			case 'W': trend_win = (uint32_t)atoi(optarg); break;
+			case 's': stats_win = (uint32_t)atoi(optarg); break;
+			default:
+				fprintf(stderr, "usage: %s [-n passes] [-o transitions] [-q] [-p horizon ms] [-m min codes] [-W window] "
+						"[-s stats window] [capture file]\n", argv[0]);
+				return 1;
+		}
+	}
+	if (passes == 0u)
+		passes = 1u;
+	if (optind < argc && (fd = open(argv[optind], O_RDONLY)) < 0){
+		perror(argv[optind]);
+		return 1;
+	}
+	sim_reset();
+
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0){
+		const uint8_t		*map;
+		const capture_hdr_t	*hdr;
+		const capture_rec_t	*rec;
+		uint32_t			nbr;
+
+		map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map == MAP_FAILED){
+			perror("mmap");
+			return 1;
+		}
+		hdr = (const capture_hdr_t *)map;
+		if ((size_t)st.st_size < sizeof(*hdr) || (err = capture_check(hdr, (size_t)st.st_size)) != CAPTURE_OK){
+			fprintf(stderr, "not a valid capture (%d)\n", (size_t)st.st_size < sizeof(*hdr) ? CAPTURE_ERR_MAGIC : err);
+			return 1;
+		}
+		rec = (const capture_rec_t *)(map + hdr->hdr_size);
+		nbr = hdr->nbr != CAPTURE_NBR_STREAM ? hdr->nbr :
+			  (uint32_t)(((size_t)st.st_size - hdr->hdr_size) / sizeof(capture_rec_t));
+
+		replay_start(&r, hdr, quiet ? NULL : out);
+		replay_chunk(&r, rec, nbr);
+		t = wall();
+		for (p = 1u; p < passes; p++){
+			replay_start(&again, hdr, NULL);
+			replay_chunk(&again, rec, nbr);
+			if (again.hash != r.hash || again.transitions != r.transitions){
+				fprintf(stderr, "pass %u: %llu transitions differ from the first pass\n", p,
+						(unsigned long long)again.transitions);
+				return 2;
+			}
+		}
+		t = wall() - t;
+		fprintf(stderr, "%u readings, %.3f s of capture at %u Hz, %llu transitions\n", nbr,
+				(double)r.cycles / hdr->ts_hz, hdr->ts_hz / (hdr->period ? hdr->period : 1u),
+				(unsigned long long)r.transitions);
+		if (passes > 1u)
+			fprintf(stderr, "%u more passes in %.3f s: %.1f M readings/s, %.0f x real time\n", passes - 1u, t,
+					(passes - 1u) * (double)nbr / t / 1e6, (passes - 1u) * ((double)r.cycles / hdr->ts_hz) / t);
+		replay_lead(&r);
+		replay_stats(&r);
+	} else {
+		capture_hdr_t		hdr;
+		capture_rec_t		rec[FILTER_BLOCK_MAX];
+		uint8_t				skip[64];
+		size_t				extra;
+		ssize_t				n;
+		uint32_t			left = 0u, have = 0u;
+
+		// header, then records as they arrive
+		if (read_full(fd, &hdr, sizeof(hdr)) != 0 || (err = capture_check(&hdr, 0u)) != CAPTURE_OK){
+			fprintf(stderr, "not a valid capture\n");
+			return 1;
+		}
+		for (extra = hdr.hdr_size - sizeof(hdr); extra > 0u; extra -= extra < sizeof(skip) ? extra : sizeof(skip))
+			if (read_full(fd, skip, extra < sizeof(skip) ? extra : sizeof(skip)) != 0)
+				return 1;
+		if (passes > 1u)
+			fprintf(stderr, "-n needs a capture file, a single pass of the stream\n");
+		replay_start(&r, &hdr, quiet ? NULL : out);
+		while (hdr.nbr == CAPTURE_NBR_STREAM || left < hdr.nbr){
+			n = read(fd, (uint8_t *)rec + have, sizeof(rec) - have);
+			if (n <= 0)
+				break;
+			have += (uint32_t)n;
+			p = have / sizeof(rec[0]);
+			if (hdr.nbr != CAPTURE_NBR_STREAM && p > hdr.nbr - left)
+				p = hdr.nbr - left;
+			replay_chunk(&r, rec, p);
+			left += p;
+			have -= p * sizeof(rec[0]);
+			memmove(rec, &rec[p], have);
+		}
+		fprintf(stderr, "%llu readings, %.3f s of capture, %llu transitions\n", (unsigned long long)r.readings,
+				(double)r.cycles / hdr.ts_hz, (unsigned long long)r.transitions);
+		replay_lead(&r);
+		replay_stats(&r);
+	}
+	if (out != stdout)
+		fclose(out);
+	return 0;
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+// same start as AppTask at the first reading of the capture
+static void replay_start(replay_t *r, const capture_hdr_t *hdr, FILE *out){
+	memset(r, 0, sizeof(*r));
+	r->hdr = hdr;
+	r->out = out;
+	r->hash = 14695981039346656037ull;
+	alarm_init();
+	alarm_set_cfg(&hdr->cfg);
+	alarm_set_state((blink_mode)hdr->rate, hdr->led);
+	filter_init(&r->filter, hdr->filter, hdr->mavg_log2);
+	trend_init(&r->trend, trend_win);
+	r->horizon = (uint32_t)((uint64_t)trend_ms * hdr->ts_hz / 1000u);
+	r->lead_min = UINT64_MAX;
+	stats_init(&r->stats, stats_win, &hdr->cfg);
+}
+
+// the readings of channel 0 through filter_block() and range_check(), as AppTask does
+static void replay_chunk(replay_t *r, const capture_rec_t *rec, uint32_t n){
+	uint16_t block[FILTER_BLOCK_MAX];
+	uint32_t ts[FILTER_BLOCK_MAX];
+	uint32_t i, k, len, warning;
+
+	while (n > 0u){
+		for (len = 0u, k = 0u; k < n && len < FILTER_BLOCK_MAX; k++){
+			if (rec[k].ch != 0u)
+				continue;
+			block[len] = rec[k].code;
+			ts[len++] = rec[k].ts;
+		}
+		rec += k;
+		n -= k;
+		filter_block(&r->filter, block, len);
+		if (stats_win && len > 0u)
+			stats_block(&r->stats, block, len, ts[len - 1u]);
+		for (i = 0u; i < len; i++){
+			if (r->readings++)
+				r->cycles += (uint32_t)(ts[i] - r->last_ts);
+			r->last_ts = ts[i];
+			warning = alarm_warning;
+			if (!range_check(block[i])){
+				if (r->horizon == 0u)
+					continue;
+				// line through the readings up to this one, as AppTask after range_check_block()
+				trend_add(&r->trend, block[i], ts[i]);
+				if (!alarm_predict(&r->trend, r->horizon, trend_min))
+					continue;
+				if (alarm_warning)
+					r->warn_at = r->cycles;
+				else
+					r->false_warn++;
+				if (r->out)
+					fprintf(r->out, "%llu %.6f %s\n", (unsigned long long)r->cycles, (double)r->cycles / r->hdr->ts_hz,
+							alarm_warning ? "warn" : "clear");
+				continue;
+			}
+			if (r->horizon != 0u){
+				trend_add(&r->trend, block[i], ts[i]);
+				if (warning){
+					uint64_t lead = r->cycles - r->warn_at;
+
+					r->warned++;
+					r->lead_sum += lead;
+					r->lead_min = lead < r->lead_min ? lead : r->lead_min;
+					r->lead_max = lead > r->lead_max ? lead : r->lead_max;
+				}
+			}
+			r->transitions++;
+			r->hash = (r->hash ^ r->cycles) * 1099511628211ull;
+			r->hash = (r->hash ^ (led_rate * 16u + current_led)) * 1099511628211ull;
+			if (r->out)
+				fprintf(r->out, "%llu %.6f %s %s\n", (unsigned long long)r->cycles, (double)r->cycles / r->hdr->ts_hz,
+						rate_name(led_rate), led_name(current_led));
+		}
+	}
+}
+
+// how far ahead of range_check() the early warning announced the changes of state
+static void replay_lead(const replay_t *r){
+	double ms = 1000.0 / r->hdr->ts_hz;
+
+	if (r->horizon == 0u)
+		return;
+	if (r->warned)
+		fprintf(stderr, "early warning %u ms: %llu of %llu changes warned, lead min %.1f mean %.1f max %.1f ms\n",
+				trend_ms, (unsigned long long)r->warned, (unsigned long long)r->transitions, r->lead_min * ms,
+				(double)r->lead_sum / r->warned * ms, r->lead_max * ms);
+	else
+		fprintf(stderr, "early warning %u ms: none of %llu changes warned\n", trend_ms,
+				(unsigned long long)r->transitions);
+	fprintf(stderr, "early warning %u ms: %llu cleared without a change\n", trend_ms, (unsigned long long)r->false_warn);
+}
+
+// distributions of the filtered readings, as app_stats_report() prints them on SW2
+static void replay_stats(const replay_t *r){
+	stats_snap_t snap;
+	uint32_t     i;
+
+	if (stats_win == 0u)
+		return;
+	stats_read(&r->stats, &snap);
+	fprintf(stderr, "%u windows of %u readings\n", snap.windows, stats_win);
+	if (snap.windows > 0u)
+		stats_line("window", &snap.win);
+	// the readings after the last complete window as well
+	stats_line("total", &r->stats.all);
+	for (i = 0u; i < STATS_BANDS; i++)
+		fprintf(stderr, "band from %u.%uV %10.3f s\n", i / 2u, (i % 2u) * 5u,
+				(double)r->stats.all.band_ts[i] / r->hdr->ts_hz);
+	for (i = 0u; i < STATS_BINS; i++)
+		if (r->stats.all.hist[i] + r->stats.cur.hist[i] != 0u)
+			fprintf(stderr, "codes %5u.. %10u\n", i << STATS_BIN_SHIFT, r->stats.all.hist[i] + r->stats.cur.hist[i]);
+}
+
+static void stats_line(const char *name, const stats_sum_t *sum){
+	fprintf(stderr, "stats %-6s %10u readings min %5u max %5u mean %8.2f sd %8.2f\n", name, sum->n, sum->min, sum->max,
+			(double)sum->mean / (1u << STATS_MEAN_SHIFT), sqrt((double)stats_var(sum) / (1u << STATS_MEAN_SHIFT)));
+}
+
+static int read_full(int fd, void *buf, size_t len){
+	ssize_t n;
+
+	while (len > 0u){
+		if ((n = read(fd, buf, len)) <= 0)
+			return -1;
+		buf = (uint8_t *)buf + n;
+		len -= (size_t)n;
+	}
+	return 0;
+}
+
+static const char *rate_name(blink_mode rate){
+	switch (rate){
+		case BLINK_SHORT:		return "short";
+		case BLINK_LONG:		return "long";
+		case BLINK_SHORTEST:	return "shortest";
+		case BLINK_NONE:		return "none";
+		default:				return "?";
+	}
+}
+
+static const char *led_name(uint32_t pin){
+	return pin == BOARD_GPIO_LED_GREEN ? "green" : pin == BOARD_GPIO_LED_BLUE ? "blue" : "red";
+}
+
+static double wall(void){
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
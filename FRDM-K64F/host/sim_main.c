@@ -0,0 +1,696 @@
+/*
+*********************************************************************************************************
+* Host simulation of the battery alarm. The sampling path of app.c (DMA interrupt -> AppTask ->
+* range_check()) runs on the simulated peripherals of hal_sim.c; each batch goes through pipeline_batch(),
+* the stages of AppTask, with those of app_cfg.h that take the single channel without compare function
+* (decimation, history, statistics, early warning). The following figures are reported:
+*  - sample-to-LED latency: from the FTM0 trigger of a sample to the GPIO write it causes (PROF_TRIG_TO_LED)
+*  - throughput: samples processed per simulated second, samples lost because AppTask was late
+*  - CPU load of interrupts and task
+* With -e the ADC0 compare function is armed with the band of the current state (APP_CFG_ADC_COMPARE_EN):
+* AppTask only wakes for readings leaving it. Every conversion also feeds a reference state machine that
+* sees all the samples, the transitions of AppTask missing from the reference sequence are reported.
+* With -k the FTM0 trigger scans that many inputs on ADC0 and ADC1 through the linked eDMA channels
+* (APP_CFG_MON_CH_NBR): channel 0 drives the LEDs as above, the others go through monitor.c and their
+* transitions are compared with a reference state machine per channel. Each input carries the same
+* wave, shifted in phase by its channel.
+* With -l the blink wave is toggled by the eDMA at each FTM1 overflow (APP_CFG_BLINK_DMA_EN) instead of
+* ftm1_int_handler. In both modes the FTM1 interrupts and the delay of each edge of the wave pin from its
+* overflow are reported; the ISR edge is taken at the first instruction of the handler.
+* With -a the FTM0 period follows the signal as in AppTask (APP_CFG_RATE_EN, rate.c), from
+* 2^APP_CFG_RATE_PS_FAST to 2^APP_CFG_RATE_PS_SLOW times APP_CFG_ADC_TRIG_MOD + 1 bus cycles. In all modes the
+* transitions of AppTask are matched with those of the noise-free wave stepped every SIM_DENSE_CYCLES and
+* their detection latency is reported, with the conversions, DMA interrupts, task wake-ups and CPU cycles
+* per second as an energy proxy; run without -a (and -p for a fixed rate) for the baseline.
+* With -u the readings are also streamed (APP_CFG_STREAM_EN) through the simulated UART TX DMA at -r baud
+* and the frames are written to the given file or pty, to be read by stream_decode.
+* With -d the raw readings of channel 0 are written to the given file as a capture (capture.h), to be
+* replayed by replay: it gives the same transitions as AppTask here.
+*
+* The probes of prof.h read the simulated cycle counter: code sections take no simulated time and show as
+* 0 cycles, the trigger-to-LED latency includes the modelled conversion, DMA, interrupt and task delays.
+*
+* Build (from FRDM-K64F):
+*   gcc -O2 -DAPP_HOST_BUILD -DMON_CH_MAX=16 -IOS3-KSDK -Ihost OS3-KSDK/alarm.c OS3-KSDK/band.c OS3-KSDK/trend.c OS3-KSDK/journal.c OS3-KSDK/filter.c OS3-KSDK/spsc.c OS3-KSDK/prof.c OS3-KSDK/frame.c OS3-KSDK/stream.c OS3-KSDK/monitor.c OS3-KSDK/rate.c OS3-KSDK/capture.c OS3-KSDK/decim.c OS3-KSDK/stats.c OS3-KSDK/history.c OS3-KSDK/pipeline.c host/hal_sim.c host/sim_main.c -o sim -lm
+*
+* Usage: sim [-t seconds] [-p ftm0 prescaler] [-m ftm0 mod] [-b samples per DMA half]
+*            [-c task cycles per sample] [-f filter] [-w ramp|sine|step] [-n noise lsb] [-s seed] [-e]
+*            [-u stream output] [-r baud] [-k channels] [-l] [-a] [-d capture output]
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <math.h>
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <time.h>
+#include  <unistd.h>
+
+#include  <app_cfg.h>
+#include  <hal.h>
+#include  <alarm.h>
+#include  <filter.h>
+#include  <band.h>
+#include  <spsc.h>
+#include  <prof.h>
+#include  <stream.h>
+#include  <monitor.h>
+#include  <rate.h>
+#include  <capture.h>
+#include  <decim.h>
+#include  <history.h>
+#include  <stats.h>
+#include  <trend.h>
+#include  <pipeline.h>
+#include  "hal_sim.h"
+
+/*
+*********************************************************************************************************
+*                                            LOCAL DEFINES
+*********************************************************************************************************
+*/
+
+#define SIM_CTX_SWITCH_CYCLES	200u					// OSTaskSemPend() return and context switch to AppTask
+#define SIM_BLOCK_MAX			(SPSC_SIZE / 2u)		// build with -DSPSC_SIZE=... for longer blocks
+#define SIM_SEQ_MAX				(1u << 20)				// transitions kept for the comparison with the reference
+#define SIM_RECENT				16u						// last transitions of each channel of the scan
+#define SIM_DENSE_CYCLES		1200u					// 10us step of the noise-free reference of the latency
+
+/*
+*********************************************************************************************************
+*                                             DATA TYPES
+*********************************************************************************************************
+*/
+
+typedef enum sim_wave {
+	WAVE_RAMP,											// triangle 0 V -> 3.3 V -> 0 V
+	WAVE_SINE,
+	WAVE_STEP											// square wave crossing all the bands
+} sim_wave_t;
+
+typedef struct sim_input {
+	sim_wave_t	wave;
+	double		period_s;
+	double		noise_lsb;
+} sim_input_t;
+
+/*
+*********************************************************************************************************
+*                                       LOCAL GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+static volatile uint16_t	adc_ring[2u * SIM_BLOCK_MAX];
+static uint32_t				adc_ring_half;
+static uint32_t				adc_block_size;
+static spsc_t				adc_queue;
+static spsc_sample_t		adc_batch[SIM_BLOCK_MAX];
+static uint16_t				adc_block[SIM_BLOCK_MAX];
+static filter_t				adc_filter;
+static uint32_t				sem_count;					// task semaphore of AppTask
+static uint32_t				task_cycles = 400u;			// -c
+static uint32_t				mon_cycles;					// task time of the other rails of the batch
+
+// stages of AppTask, those of app_cfg.h and of the options
+static pipeline_t			adc_pipeline;
+static decim_t				adc_decim;
+static stats_t				adc_stats;
+static trend_t				adc_trend;
+static struct {
+	history_hdr_t			hdr;
+	history_chunk_t			ring[APP_CFG_HISTORY_CHUNKS];
+} app_history;
+static history_t			adc_history;
+static rate_t				adc_rate;
+static uint32_t				rate_mod;					// FTM0 modulo of the fastest level
+static uint64_t				processed, transitions;
+
+static uint32_t				channels = 1u;				// inputs of the scan
+static uint8_t				scan_ch[2][HAL_SCAN_MAX];	// ADCH of the inputs of ADC0 and ADC1
+static mon_t				adc_mon;
+
+static int					blink_dma;					// -l
+static uint64_t				edge_nbr, edge_sum, edge_min = UINT64_MAX, edge_max;	// wave edge from FTM1 overflow
+
+static FILE				   *stream_out;
+static stream_t				adc_stream;
+
+static FILE				   *capture_out;
+static capture_hdr_t		capture_hdr;				// nbr: records of the batch, written after it
+static capture_rec_t		capture_rec[SIM_BLOCK_MAX];
+static uint32_t				capture_total;
+
+
+// reference: the range check run on every conversion, without compare function and filter
+static band_table_t			ref_tbl;
+static uint32_t				ref_state;
+static uint8_t				ref_seq[SIM_SEQ_MAX];
+static uint32_t				ref_nbr;
+static uint8_t				app_seq[SIM_SEQ_MAX];
+static uint64_t				app_cycle[SIM_SEQ_MAX];		// simulated time of the transitions of AppTask
+static uint32_t				app_nbr;
+static uint8_t				dense_seq[SIM_SEQ_MAX];		// noise-free wave stepped every SIM_DENSE_CYCLES
+static uint64_t				dense_cycle[SIM_SEQ_MAX];
+static uint32_t				dense_nbr;
+static uint32_t				ref_ch_state[MON_CH_MAX];	// reference of the channels of monitor.c
+static uint32_t				ref_ch_changes[MON_CH_MAX];
+static uint32_t				ref_ch_readings[MON_CH_MAX];
+static uint32_t				ref_ch_recent[MON_CH_MAX][SIM_RECENT];	// reading index of the transitions
+static uint32_t				app_ch_readings[MON_CH_MAX];
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static void     dma_int_handler(void);
+static void     ftm1_int_handler(void);
+static uint16_t input(uint64_t cycle, uint32_t adc, uint32_t adch, void *arg);
+static double   wave_code(const sim_input_t *in, uint64_t cycle, uint32_t ch);
+static void     dense_run(const sim_input_t *in, uint32_t state, uint64_t end);
+static void     latency(double *mean_ms, double *max_ms, uint32_t *matched);
+static double   gauss(void);
+static uint32_t band_state(void);
+static void     ref_check(uint16_t code);
+static uint32_t ref_step(const band_table_t *tbl, uint32_t state, uint16_t code);
+static uint32_t seq_missed(void);
+static uint32_t ref_ch_consumed(uint32_t ch);
+static void     uart_hook(const uint8_t *buf, uint32_t len, uint64_t cycle);
+static void     gpio_hook(uint32_t pin, uint8_t level, uint64_t cycle);
+static void     app_step(uint32_t i);
+static void     app_change(uint32_t i);
+static void     app_rate_set(uint32_t level);
+
+/*
+*********************************************************************************************************
+*                                                main()
+*********************************************************************************************************
+*/
+
+int main(int argc, char **argv){
+	sim_input_t	in = { WAVE_RAMP, 20.0, 0.0 };
+	double		seconds = 60.0;
+	uint32_t	block = APP_CFG_ADC_BLOCK_SIZE, n, i;
+	int			ps = -1, mod = -1, opt;
+	uint32_t	filter = APP_CFG_FILTER;
+	int			compare = APP_CFG_ADC_COMPARE_EN == DEF_ENABLED;
+	uint32_t	baud = APP_CFG_STREAM_BAUD;
+	uint64_t	end, readings = 0u, busy = 0u;
+	const uint8_t adc0_ch[] = APP_CFG_MON_ADC0_CH;
+	const uint8_t adc1_ch[] = APP_CFG_MON_ADC1_CH;
+	uint32_t	ch;
+	int			adaptive = 0;
+	uint64_t	wakeups = 0u;
+	double		lat_mean, lat_max, secs;
+	uint32_t	matched, state0;
+	prof_stat_t	lat;
+	clock_t		wall;
+
+	while ((opt = getopt(argc, argv, "t:p:m:b:c:f:w:n:s:eu:r:k:lad:")) != -1){
+		switch (opt){
+			case 't': seconds = atof(optarg); break;
+			case 'p': ps = atoi(optarg); break;
+			case 'm': mod = atoi(optarg); break;
+			case 'b':
+				block = (uint32_t)atoi(optarg);
+				block = block < 1u ? 1u : block > SIM_BLOCK_MAX ? SIM_BLOCK_MAX : block;
+				break;
+			case 'c': task_cycles = (uint32_t)atoi(optarg); break;
+			case 'f':
+				for (filter = 0u; filter < FILTER_TYPE_NBR && strcmp(optarg, filter_name(filter)); filter++)
+					;
+				break;
+			case 'w':
+				in.wave = !strcmp(optarg, "sine") ? WAVE_SINE : !strcmp(optarg, "step") ? WAVE_STEP : WAVE_RAMP;
+				break;
+			case 'n': in.noise_lsb = atof(optarg); break;
+			case 's': srand((unsigned)atoi(optarg)); break;
+			case 'e': compare = 1; break;
+			case 'u':
+				if ((stream_out = fopen(optarg, "wb")) == NULL){
+					perror(optarg);
+					return 1;
+				}
+				break;
+			case 'r': baud = (uint32_t)atoi(optarg); break;
+			case 'k': channels = (uint32_t)atoi(optarg); break;
+			case 'l': blink_dma = 1; break;
+			case 'a': adaptive = 1; break;
+			case 'd':
+				if ((capture_out = fopen(optarg, "wb")) == NULL){
+					perror(optarg);
+					return 1;
+				}
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-t s] [-p ps] [-m mod] [-b block] [-c cycles] [-f none|mavg|fir|median3|median5] [-w ramp|sine|step] [-n lsb] [-s seed] [-e] [-u file] [-r baud] [-k channels] [-l] [-a] [-d file]\n",
+						argv[0]);
+				return 1;
+		}
+	}
+
+	// as in app.c: 1 or an even number of inputs, whole scans in a half, neither compare nor stream
+	if (channels > 1u){
+		if (channels % 2u || channels > 2u * HAL_SCAN_MAX || channels > MON_CH_MAX || compare || stream_out){
+			fprintf(stderr, "-k: 1 or an even number up to %u channels, without -e and -u\n",
+					2u * HAL_SCAN_MAX < MON_CH_MAX ? 2u * HAL_SCAN_MAX : MON_CH_MAX);
+			return 1;
+		}
+		block = block < channels ? channels : block - block % channels;
+		for (ch = 0u; ch < channels / 2u; ch++){
+			scan_ch[0][ch] = adc0_ch[ch];
+			scan_ch[1][ch] = adc1_ch[ch];
+		}
+	}
+
+	// as in app.c, the adaptive rate only on the single channel without compare function
+	if (adaptive && (channels > 1u || compare)){
+		fprintf(stderr, "-a: without -k and -e\n");
+		return 1;
+	}
+
+	// as in app.c, the compare function wakes AppTask for single raw samples
+	if (compare){
+		block = 1u;
+		filter = FILTER_NONE;
+	}
+
+	sim_reset();
+	sim_set_input(input, &in);
+
+	// same sequence as main() and AppTask
+	adc_block_size = block;
+	spsc_init(&adc_queue);
+	if (channels > 1u)
+		hal_adc_scan_setup(adc_ring, 2u * block, scan_ch[0], scan_ch[1], channels / 2u, dma_int_handler);
+	else
+		hal_ftm0_adc0_trigger_setup(adc_ring, 2u * block, dma_int_handler);
+	if (blink_dma)
+		hal_ftm1_dma_setup(BOARD_GPIO_LED_RED, kGpioWave1Out);
+	else
+		hal_ftm1_setup(ftm1_int_handler);
+	sim_set_gpio_hook(gpio_hook);
+	if (ps >= 0)
+		sim_regs.ftm0.sc = (sim_regs.ftm0.sc & ~SIM_FTM_SC_PS_MASK) | ((uint32_t)ps & SIM_FTM_SC_PS_MASK);
+	if (mod >= 0)
+		sim_regs.ftm0.mod = (uint32_t)mod;
+	if (adaptive){
+		rate_mod = mod >= 0 ? (uint32_t)mod : APP_CFG_ADC_TRIG_MOD;
+		app_rate_set(0u);
+		rate_init(&adc_rate, APP_CFG_RATE_PS_SLOW - APP_CFG_RATE_PS_FAST + 1u, hal_adc_trigger_cycles(), block,
+				  APP_CFG_RATE_NEAR);
+	}
+	if (stream_out){
+		sim_set_uart_hook(uart_hook);
+		stream_init(&adc_stream, baud);
+	}
+	alarm_init();
+	filter_init(&adc_filter, filter, APP_CFG_FILTER_MAVG_LOG2);
+	decim_init(&adc_decim, APP_CFG_DECIM_LOG2, APP_CFG_DECIM_ORDER);
+	if (capture_out){
+		// the number of records is only known at the end
+		capture_init(&capture_hdr, hal_ts_hz(), hal_adc_trigger_cycles() << APP_CFG_DECIM_LOG2, alarm_cfg(),
+					 filter, APP_CFG_FILTER_MAVG_LOG2, led_rate, BAND_LED_RED);
+		capture_hdr.nbr = CAPTURE_NBR_STREAM;
+		fwrite(&capture_hdr, sizeof(capture_hdr), 1u, capture_out);
+		capture_hdr.nbr = 0u;
+	}
+
+	// the stages of AppTask: the options, and those of app_cfg.h that stand for channel 0 alone and need
+	// every reading, as in app.c
+	pipeline_init(&adc_pipeline);
+	adc_pipeline.filter = &adc_filter;
+	adc_pipeline.block = adc_block;
+	adc_pipeline.step = app_step;
+	adc_pipeline.change = app_change;
+	if (stream_out)
+		adc_pipeline.stream = &adc_stream;
+	if (channels > 1u)
+		adc_pipeline.mon = &adc_mon;
+	if (capture_out){
+		adc_pipeline.capture = &capture_hdr;
+		adc_pipeline.capture_rec = capture_rec;
+		adc_pipeline.capture_cap = SIM_BLOCK_MAX;
+	}
+	adc_pipeline.compare = (uint32_t)compare;
+	if (adaptive){
+		adc_pipeline.rate = &adc_rate;
+		adc_pipeline.rate_set = app_rate_set;
+	}
+	if (channels == 1u && !compare){
+		if (APP_CFG_DECIM_LOG2 > 0u)
+			adc_pipeline.decim = &adc_decim;
+		if (APP_CFG_HISTORY_EN == DEF_ENABLED){
+			history_init(&adc_history, &app_history.hdr, APP_CFG_HISTORY_CHUNKS, hal_ts_hz(),
+						 APP_CFG_HISTORY_AVG_LOG2);
+			adc_pipeline.history = &adc_history;
+			adc_pipeline.history_budget = APP_CFG_HISTORY_BUDGET;
+		}
+		if (APP_CFG_STATS_EN == DEF_ENABLED){
+			stats_init(&adc_stats, APP_CFG_STATS_WIN, alarm_cfg());
+			adc_pipeline.stats = &adc_stats;
+		}
+		if (APP_CFG_TREND_EN == DEF_ENABLED){
+			trend_init(&adc_trend, APP_CFG_TREND_WIN);
+			adc_pipeline.trend = &adc_trend;
+			adc_pipeline.trend_horizon = APP_CFG_TREND_HORIZON_MS * (hal_ts_hz() / 1000u);
+			adc_pipeline.trend_min_codes = APP_CFG_TREND_MIN_CODES;
+		}
+	}
+	band_build(&ref_tbl, &band_cfg_default);
+	ref_state = state0 = band_state();
+	mon_init(&adc_mon, channels);
+	for (ch = 1u; ch < channels; ch++){
+		if (ch <= kGpioAlarm7 - kGpioAlarm1 + 1u)
+			mon_set_output(&adc_mon, ch, kGpioAlarm1 + ch - 1u, APP_CFG_MON_ALARM_LEDS);
+		ref_ch_state[ch] = adc_mon.state[ch];
+	}
+
+	end = (uint64_t)(seconds * SIM_CORE_HZ);
+	wall = clock();
+	while (sim_now() < end){
+		uint64_t	start;
+
+		if (sem_count == 0u){
+			if (!sim_idle())
+				break;
+			continue;
+		}
+		sem_count = 0u;
+		wakeups++;
+
+		start = sim_now();
+		sim_advance(SIM_CTX_SWITCH_CYCLES);
+		while (sim_now() < end && (n = spsc_pop(&adc_queue, adc_batch, block)) > 0u){
+			readings += n;
+			mon_cycles = 0u;
+			for (i = 0u; channels > 1u && i < n; i++){
+				app_ch_readings[adc_batch[i].ch]++;
+				mon_cycles += adc_batch[i].ch != 0u ? task_cycles : 0u;
+			}
+			(void)pipeline_batch(&adc_pipeline, adc_batch, n);
+			if (capture_out){
+				fwrite(capture_rec, sizeof(capture_rec[0]), capture_hdr.nbr, capture_out);
+				capture_total += capture_hdr.nbr;
+				capture_hdr.nbr = 0u;
+			}
+		}
+		busy += sim_now() - start;
+	}
+	wall = clock() - wall;
+
+	printf("simulated time      %.3f s (%.1f x real time)\n", (double)sim_now() / SIM_CORE_HZ,
+			((double)sim_now() / SIM_CORE_HZ) / ((double)wall / CLOCKS_PER_SEC + 1e-9));
+	printf("ftm0 triggers       %llu\n", (unsigned long long)sim_stats.ftm0_triggers);
+	printf("adc conversions     %llu\n", (unsigned long long)sim_stats.adc_conversions);
+	printf("dma irqs            %llu\n", (unsigned long long)sim_stats.dma_irqs);
+	printf("ftm1 irqs           %llu\n", (unsigned long long)sim_stats.ftm1_irqs);
+	if (edge_nbr)
+		printf("blink edges         %llu by %s, from overflow min %llu max %llu mean %.1f cycles\n",
+				(unsigned long long)edge_nbr, blink_dma ? "eDMA" : "ISR", (unsigned long long)edge_min,
+				(unsigned long long)edge_max, (double)edge_sum / edge_nbr);
+	printf("samples processed   %llu (%.1f samples/s)\n", (unsigned long long)processed,
+			processed / ((double)sim_now() / SIM_CORE_HZ));
+	if (channels > 1u){
+		uint32_t diff = 0u;
+
+		printf("scan                %u channels, %llu readings (%.1f readings/s per channel)\n", channels,
+				(unsigned long long)readings, readings / ((double)sim_now() / SIM_CORE_HZ) / channels);
+		for (ch = 1u; ch < channels; ch++){
+			printf("  channel %2u        %u transitions, reference %u, state %u, alarm %u\n", ch,
+					adc_mon.changes[ch], ref_ch_consumed(ch), adc_mon.state[ch], adc_mon.alarm[ch]);
+			diff += adc_mon.changes[ch] != ref_ch_consumed(ch);
+		}
+		printf("  mismatches        %u channels\n", diff);
+	}
+	printf("queue               produced %u consumed %u overruns %u samples\n", adc_queue.produced,
+			adc_queue.consumed, adc_queue.overruns);
+	printf("transitions         %llu\n", (unsigned long long)transitions);
+	if (filter == FILTER_NONE)
+		printf("reference           %u transitions, %u missed by AppTask\n", ref_nbr, seq_missed());
+	if (stream_out)
+		printf("stream              %u frames, %u dropped, %u bytes (%.2f bytes/sample) at %u baud\n",
+				adc_stream.frames, adc_stream.dropped, adc_stream.bytes,
+				processed ? (double)adc_stream.bytes / processed : 0.0, baud);
+	if (stream_out)
+		fclose(stream_out);
+	if (capture_out){
+		capture_hdr.nbr = capture_total;
+		printf("capture             %u readings\n", capture_hdr.nbr);
+		if (fseek(capture_out, 0L, SEEK_SET) == 0)
+			fwrite(&capture_hdr, sizeof(capture_hdr), 1u, capture_out);
+		fclose(capture_out);
+	}
+	prof_snapshot(PROF_TRIG_TO_LED, &lat);
+	if (lat.nbr)
+		printf("sample-to-LED       min %u max %u mean %.0f cycles (max %.2f us)\n", lat.min, lat.max,
+				(double)lat.sum / lat.nbr, lat.max * 1e6 / SIM_CORE_HZ);
+	prof_dump();
+	printf("cpu load            isr %.4f%% task %.4f%%\n", 100.0 * sim_stats.isr_cycles / sim_now(),
+			100.0 * busy / sim_now());
+	if (adaptive){
+		printf("adaptive rate       level %u, %u faster %u slower, blocks by level", adc_rate.level, adc_rate.ups,
+				adc_rate.downs);
+		for (i = 0u; i < adc_rate.levels; i++)
+			printf(" %u", adc_rate.blocks[i]);
+		printf("\n");
+	}
+	if (adc_pipeline.decim)
+		printf("decimation          by %u order %u, %u outputs\n", 1u << adc_decim.log2, adc_decim.order,
+				adc_decim.outputs);
+	if (adc_pipeline.history)
+		printf("history             %u batches over %u cycles\n", adc_pipeline.history_over, APP_CFG_HISTORY_BUDGET);
+	if (adc_pipeline.trend)
+		printf("early warning       %u, %u raised\n", alarm_warning, adc_pipeline.warnings);
+	secs = (double)sim_now() / SIM_CORE_HZ;
+	printf("energy proxy        %.1f conversions/s, %.2f dma irqs/s, %.2f wakeups/s, %.0f cpu cycles/s\n",
+			sim_stats.adc_conversions / secs, sim_stats.dma_irqs / secs, wakeups / secs,
+			(sim_stats.isr_cycles + busy) / secs);
+	if (channels == 1u && filter == FILTER_NONE && in.noise_lsb == 0.0){
+		dense_run(&in, state0, sim_now());
+		latency(&lat_mean, &lat_max, &matched);
+		printf("detection latency   %u of %u reference transitions, mean %.2f ms max %.2f ms\n", matched,
+				dense_nbr, lat_mean, lat_max);
+	}
+	return 0;
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+static void dma_int_handler(void){
+	PROF_START(t);
+
+	// move the completed half out of the ring, stamped with the FTM0 triggers as on the board
+	spsc_push_scan(&adc_queue, &adc_ring[adc_ring_half * adc_block_size], adc_block_size, channels,
+				   channels > 1u ? 2u : 1u, hal_adc_trigger_ts(), hal_adc_trigger_cycles());
+	adc_ring_half ^= 1u;
+
+	// enable main task
+	sem_count++;
+
+	// allow other DMA requests
+	hal_dma_clear_int();
+	PROF_STOP(PROF_DMA_ISR, t);
+}
+
+static void ftm1_int_handler(void){
+	PROF_START(t);
+
+	hal_ftm1_clear_int();
+
+	blink_toggle();
+	PROF_STOP(PROF_FTM1_ISR, t);
+}
+
+static uint16_t input(uint64_t cycle, uint32_t adc, uint32_t adch, void *arg){
+	const sim_input_t *in = arg;
+	uint32_t ch = 0u;
+	double code;
+
+	// channel of the scan reading this input
+	if (channels > 1u)
+		for (ch = adc; ch < channels && scan_ch[adc][ch / 2u] != adch; ch += 2u)
+			;
+	code = wave_code(in, cycle, ch) + in->noise_lsb * gauss();
+	code = code < 0.0 ? 0.0 : code > 65535.0 ? 65535.0 : code;
+	if (ch == 0u){
+		ref_check((uint16_t)code);
+	} else if (ch < channels){
+		uint32_t state = ref_step(&ref_tbl, ref_ch_state[ch], (uint16_t)code);
+
+		if (state != ref_ch_state[ch])
+			ref_ch_recent[ch][ref_ch_changes[ch]++ % SIM_RECENT] = ref_ch_readings[ch];
+		ref_ch_readings[ch]++;
+		ref_ch_state[ch] = state;
+	}
+	return (uint16_t)code;
+}
+
+// noise-free code of the wave of a channel, delayed by ch / channels of the period
+static double wave_code(const sim_input_t *in, uint64_t cycle, uint32_t ch){
+	double phase = fmod((double)cycle / SIM_CORE_HZ + in->period_s * ch / channels, in->period_s) / in->period_s;
+
+	switch (in->wave){
+		case WAVE_SINE:
+			return 32767.5 + 32767.5 * sin(2.0 * M_PI * phase);
+		case WAVE_STEP:
+			return (double)VOLT_05 * (1u + (uint32_t)(phase * 6.0) % 6u) + (VOLT_10 - VOLT_05) / 2.0;
+		case WAVE_RAMP:
+		default:
+			return 65535.0 * (phase < 0.5 ? 2.0 * phase : 2.0 - 2.0 * phase);
+	}
+}
+
+// transitions of channel 0 stepped every SIM_DENSE_CYCLES, whatever the rate of FTM0
+static void dense_run(const sim_input_t *in, uint32_t state, uint64_t end){
+	uint32_t next;
+	uint64_t cycle;
+
+	for (cycle = 0u; cycle < end; cycle += SIM_DENSE_CYCLES){
+		next = ref_step(&ref_tbl, state, (uint16_t)wave_code(in, cycle, 0u));
+		if (next != state && dense_nbr < SIM_SEQ_MAX){
+			dense_cycle[dense_nbr] = cycle;
+			dense_seq[dense_nbr++] = (uint8_t)next;
+		}
+		state = next;
+	}
+}
+
+// delay of the transitions of AppTask from the matching ones of the dense reference, in order
+static void latency(double *mean_ms, double *max_ms, uint32_t *matched){
+	uint32_t i = 0u, j;
+	double d, sum = 0.0;
+
+	*max_ms = 0.0;
+	*matched = 0u;
+	for (j = 0u; j < app_nbr; j++){
+		while (i < dense_nbr && (dense_seq[i] != app_seq[j] || dense_cycle[i] > app_cycle[j]))
+			i++;
+		if (i == dense_nbr)
+			break;
+		d = 1e3 * (double)(app_cycle[j] - dense_cycle[i]) / SIM_CORE_HZ;
+		sum += d;
+		if (d > *max_ms)
+			*max_ms = d;
+		(*matched)++;
+		i++;
+	}
+	*mean_ms = *matched ? sum / *matched : 0.0;
+}
+
+// state of the band table for led_rate/current_led
+static uint32_t band_state(void){
+	uint32_t led = current_led == BOARD_GPIO_LED_GREEN ? BAND_LED_GREEN :
+				   current_led == BOARD_GPIO_LED_BLUE ? BAND_LED_BLUE : BAND_LED_RED;
+
+	return BAND_STATE(led_rate, led);
+}
+
+static void ref_check(uint16_t code){
+	uint32_t state = ref_step(&ref_tbl, ref_state, code);
+
+	if (state == ref_state)
+		return;
+	ref_state = state;
+	if (ref_nbr < SIM_SEQ_MAX)
+		ref_seq[ref_nbr++] = (uint8_t)ref_state;
+}
+
+// next state of a reference state machine; a change back to the same state is not possible
+static uint32_t ref_step(const band_table_t *tbl, uint32_t state, uint16_t code){
+	uint8_t act = band_classify(tbl, state, code);
+	uint32_t rate = state / BAND_LED_NBR;
+	uint32_t led = state % BAND_LED_NBR;
+
+	if (act == BAND_NOP)
+		return state;
+	if (BAND_ACT_RATE(act) != BAND_KEEP)
+		rate = BAND_ACT_RATE(act);
+	if (BAND_ACT_LED(act) != BAND_KEEP)
+		led = BAND_ACT_LED(act);
+	return BAND_STATE(rate, led);
+}
+
+// transitions of the reference that AppTask went through, in order; the others were missed
+static uint32_t seq_missed(void){
+	uint32_t i, j = 0u;
+
+	for (i = 0u; i < ref_nbr && j < app_nbr; i++)
+		if (ref_seq[i] == app_seq[j])
+			j++;
+	return ref_nbr - j;
+}
+
+// transitions of the reference among the readings AppTask consumed, the half being filled at the end of
+// the run is left out; exact as long as the queue had no overrun
+static uint32_t ref_ch_consumed(uint32_t ch){
+	uint32_t n = ref_ch_changes[ch];
+	uint32_t k;
+
+	for (k = 0u; k < SIM_RECENT && k < ref_ch_changes[ch]; k++)
+		if (ref_ch_recent[ch][(ref_ch_changes[ch] - 1u - k) % SIM_RECENT] >= app_ch_readings[ch])
+			n--;
+	return n;
+}
+
+static void uart_hook(const uint8_t *buf, uint32_t len, uint64_t cycle){
+	(void)cycle;
+	fwrite(buf, 1u, len, stream_out);
+}
+
+// task time of a reading of channel 0 before its range checking, after mon_check_batch() for the first
+static void app_step(uint32_t i){
+	sim_advance(task_cycles + (i == 0u ? mon_cycles : 0u));
+	processed++;
+}
+
+// transition of AppTask, at the time of the reading that caused it
+static void app_change(uint32_t i){
+	(void)i;
+	transitions++;
+	if (app_nbr < SIM_SEQ_MAX){
+		app_cycle[app_nbr] = sim_now();
+		app_seq[app_nbr++] = (uint8_t)band_state();
+	}
+}
+
+// FTM0 period of a level of the adaptive rate, app_rate_set() of app.c
+static void app_rate_set(uint32_t level){
+	uint32_t ps, mod;
+
+	rate_ftm(APP_CFG_RATE_PS_FAST, rate_mod, level, &ps, &mod);
+	hal_adc_trigger_rate(ps, mod);
+}
+
+static double gauss(void){
+	double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+	double v = (rand() + 1.0) / (RAND_MAX + 2.0);
+
+	return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+// delay of the edges of the wave pin from the FTM1 overflow that caused them
+static void gpio_hook(uint32_t pin, uint8_t level, uint64_t cycle){
+	uint64_t ovf = sim_ftm1_overflow_cycle();
+
+	(void)level;
+	if (pin != kGpioWave1Out || ovf == UINT64_MAX)
+		return;
+	edge_nbr++;
+	edge_sum += cycle - ovf;
+	if (cycle - ovf < edge_min)
+		edge_min = cycle - ovf;
+	if (cycle - ovf > edge_max)
+		edge_max = cycle - ovf;
+}
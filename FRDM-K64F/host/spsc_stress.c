@@ -0,0 +1,171 @@
+/*
+*********************************************************************************************************
+* Host stress test of the sample queue of spsc.c. A producer thread pushes blocks of readings as fast as
+* dma_int_handler could, a consumer thread pops them in batches as AppTask does. Every sample carries its
+* sequence number in ts (and the low 16 bits in code), so the consumer can check that samples arrive in
+* order, uncorrupted, and that the gaps add up to the overruns counted by the producer.
+*
+* Build (from FRDM-K64F):
+*   gcc -O2 -pthread -DAPP_HOST_BUILD -IOS3-KSDK OS3-KSDK/spsc.c host/spsc_stress.c -o spsc_stress
+*
+* Usage: spsc_stress [-n samples] [-b producer block] [-c consumer batch] [-p producer delay loops]
+*                    [-d consumer delay loops] [-y]
+* -y makes the producer yield after every block and the consumer when the queue is empty, so that the two threads interleave on a single CPU.
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <pthread.h>
+#include  <sched.h>
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <time.h>
+#include  <unistd.h>
+
+#include  <spsc.h>
+
+/*
+*********************************************************************************************************
+*                                       LOCAL GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+static spsc_t			queue;
+static uint32_t			total = 100000000u;
+static uint32_t			block = 16u;
+static uint32_t			batch = 16u;
+static uint32_t			prod_delay;						// busy loops between two blocks, sets the rate
+static uint32_t			delay;
+static int				yield;
+static volatile int		done;
+
+static uint32_t			received;
+static uint32_t			gaps;							// samples missing from the sequence
+static uint32_t			errors;							// out of order or corrupted samples
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static void *producer(void *arg);
+static void *consumer(void *arg);
+
+/*
+*********************************************************************************************************
+*                                                main()
+*********************************************************************************************************
+*/
+
+int main(int argc, char **argv){
+	pthread_t		prod, cons;
+	struct timespec	t0, t1;
+	double			s;
+	int				opt;
+
+	while ((opt = getopt(argc, argv, "n:b:c:p:d:y")) != -1){
+		switch (opt){
+			case 'n': total = (uint32_t)atol(optarg); break;
+			case 'b': block = (uint32_t)atoi(optarg); break;
+			case 'c': batch = (uint32_t)atoi(optarg); break;
+			case 'p': prod_delay = (uint32_t)atoi(optarg); break;
+			case 'd': delay = (uint32_t)atoi(optarg); break;
+			case 'y': yield = 1; break;
+			default:
+				fprintf(stderr, "usage: %s [-n samples] [-b block] [-c batch] [-p delay] [-d delay] [-y]\n", argv[0]);
+				return 1;
+		}
+	}
+	block = block < 1u ? 1u : block > SPSC_SIZE ? SPSC_SIZE : block;
+	batch = batch < 1u ? 1u : batch > SPSC_SIZE ? SPSC_SIZE : batch;
+
+	spsc_init(&queue);
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	pthread_create(&cons, NULL, consumer, NULL);
+	pthread_create(&prod, NULL, producer, NULL);
+	pthread_join(prod, NULL);
+	pthread_join(cons, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	s = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+
+	printf("samples offered     %u in %.3f s (%.1f Msamples/s)\n", total, s, total / s * 1e-6);
+	printf("produced            %u\n", queue.produced);
+	printf("consumed            %u\n", queue.consumed);
+	printf("overruns            %u (%.2f%%)\n", queue.overruns, 100.0 * queue.overruns / total);
+	printf("sequence gaps       %u\n", gaps);
+	printf("errors              %u\n", errors);
+	if (errors || gaps != queue.overruns || queue.produced != queue.consumed || received != queue.consumed ||
+			queue.produced + queue.overruns != total){
+		printf("FAIL\n");
+		return 1;
+	}
+	printf("PASS\n");
+	return 0;
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+static void *producer(void *arg){
+	uint16_t	codes[SPSC_SIZE];
+	uint32_t	seq = 0u, i;
+	volatile uint32_t d;
+
+	(void)arg;
+	while (seq < total){
+		uint32_t n = total - seq < block ? total - seq : block;
+
+		for (i = 0u; i < n; i++)
+			codes[i] = (uint16_t)(seq + i);
+		// the last reading of the block is stamped, the others are one tick apart
+		spsc_push_block(&queue, codes, n, seq + n - 1u, 1u);
+		seq += n;
+		for (d = 0u; d < prod_delay; d++)
+			;
+		if (yield)
+			sched_yield();
+	}
+	__atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+static void *consumer(void *arg){
+	spsc_sample_t	out[SPSC_SIZE];
+	uint32_t		next = 0u, n, i;
+	volatile uint32_t d;
+
+	(void)arg;
+	for (;;){
+		int last = __atomic_load_n(&done, __ATOMIC_ACQUIRE);
+
+		n = spsc_pop(&queue, out, batch);
+		if (n == 0u){
+			if (last)
+				break;
+			if (yield)
+				sched_yield();
+			continue;
+		}
+		for (i = 0u; i < n; i++){
+			if (out[i].ts < next || out[i].code != (uint16_t)out[i].ts)
+				errors++;
+			else
+				gaps += out[i].ts - next;
+			next = out[i].ts + 1u;
+		}
+		received += n;
+		for (d = 0u; d < delay; d++)
+			;
+	}
+	gaps += total - next;
+	return NULL;
+}
@@ -0,0 +1,244 @@
+/*
+*********************************************************************************************************
+* Throughput benchmark of the sample stream over a pty pair, the host stand-in for the UART. A writer
+* thread encodes blocks of readings and writes them to the master side, a reader thread decodes them from
+* the slave side. Two encodings are compared:
+*  - frame : the frames of frame.c, as sent by stream.c
+*  - text  : one "%u\r\n" line per sample, as the APP_TRACE/BSP_Ser_Printf path would print them
+* For each one the achieved samples/s, the bytes per sample, the CPU time per sample of both sides and
+* the sample rate a UART at -r baud could carry are reported. With -r the writer is also paced to that
+* baud rate, 10 bits per byte.
+*
+* Build (from FRDM-K64F):
+*   gcc -O2 -pthread -DAPP_HOST_BUILD -IOS3-KSDK OS3-KSDK/frame.c host/stream_bench.c -o stream_bench -lm
+*
+* Usage: stream_bench [-t seconds] [-b samples per frame] [-r baud] [-m frame|text]
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#define _GNU_SOURCE
+#include  <fcntl.h>
+#include  <math.h>
+#include  <pthread.h>
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <termios.h>
+#include  <time.h>
+#include  <unistd.h>
+
+#include  <frame.h>
+
+/*
+*********************************************************************************************************
+*                                            LOCAL DEFINES
+*********************************************************************************************************
+*/
+
+#define BENCH_MODE_FRAME		0
+#define BENCH_MODE_TEXT			1
+
+/*
+*********************************************************************************************************
+*                                       LOCAL GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+static int				master_fd, slave_fd;
+static double			seconds = 5.0;
+static uint32_t			block = 16u;
+static uint32_t			baud;
+static int				mode = BENCH_MODE_FRAME;
+
+static volatile int		stop;
+static uint64_t			sent_samples, sent_bytes;
+static uint64_t			recv_samples;
+static double			enc_cpu, wr_cpu, rd_cpu;		// thread CPU time, seconds
+static frame_decoder_t	dec;
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static void   *writer(void *arg);
+static void   *reader(void *arg);
+static void    on_frame(const frame_t *f, void *arg);
+static void    write_all(const uint8_t *buf, uint32_t len);
+static double  clk(clockid_t id);
+
+/*
+*********************************************************************************************************
+*                                                main()
+*********************************************************************************************************
+*/
+
+int main(int argc, char **argv){
+	struct termios	tio;
+	pthread_t		wr, rd;
+	double			t0, t;
+	int				opt;
+
+	while ((opt = getopt(argc, argv, "t:b:r:m:")) != -1){
+		switch (opt){
+			case 't': seconds = atof(optarg); break;
+			case 'b': block = (uint32_t)atoi(optarg); break;
+			case 'r': baud = (uint32_t)atoi(optarg); break;
+			case 'm': mode = strcmp(optarg, "text") ? BENCH_MODE_FRAME : BENCH_MODE_TEXT; break;
+			default:
+				fprintf(stderr, "usage: %s [-t seconds] [-b samples] [-r baud] [-m frame|text]\n", argv[0]);
+				return 1;
+		}
+	}
+	block = block < 1u ? 1u : block > FRAME_SAMPLES_MAX ? FRAME_SAMPLES_MAX : block;
+
+	if ((master_fd = posix_openpt(O_RDWR | O_NOCTTY)) < 0 || grantpt(master_fd) || unlockpt(master_fd) ||
+			(slave_fd = open(ptsname(master_fd), O_RDWR | O_NOCTTY)) < 0){
+		perror("pty");
+		return 1;
+	}
+	tcgetattr(slave_fd, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(slave_fd, TCSANOW, &tio);
+	frame_decoder_init(&dec);
+
+	t0 = clk(CLOCK_MONOTONIC);
+	pthread_create(&rd, NULL, reader, NULL);
+	pthread_create(&wr, NULL, writer, NULL);
+	pthread_join(wr, NULL);
+	pthread_join(rd, NULL);
+	t = clk(CLOCK_MONOTONIC) - t0;
+
+	printf("mode                %s, %u samples per write\n", mode == BENCH_MODE_TEXT ? "text" : "frame", block);
+	printf("samples             sent %llu received %llu in %.2f s\n", (unsigned long long)sent_samples,
+			(unsigned long long)recv_samples, t);
+	printf("throughput          %.0f samples/s\n", recv_samples / t);
+	printf("bytes per sample    %.2f\n", (double)sent_bytes / sent_samples);
+	printf("encoder             %.1f ns/sample\n", enc_cpu * 1e9 / sent_samples);
+	printf("writer cpu          %.1f%% (%.1f ns/sample incl. write)\n", 100.0 * wr_cpu / t,
+			wr_cpu * 1e9 / sent_samples);
+	printf("reader cpu          %.1f%% (%.1f ns/sample incl. read)\n", 100.0 * rd_cpu / t,
+			rd_cpu * 1e9 / (recv_samples ? recv_samples : 1u));
+	if (mode == BENCH_MODE_FRAME)
+		printf("decoder             %u frames, %u crc errors, %u lost\n", dec.frames, dec.crc_errors, dec.lost);
+	if (baud)
+		printf("uart capacity       %.0f samples/s at %u baud\n", baud / 10.0 / ((double)sent_bytes / sent_samples),
+				baud);
+	return 0;
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+static void *writer(void *arg){
+	uint8_t		buf[FRAME_SIZE_MAX + FRAME_SAMPLES_MAX * 8u];
+	uint16_t	samples[FRAME_SAMPLES_MAX];
+	uint32_t	seed = 1u, phase = 0u, len, i;
+	uint16_t	seq = 0u;
+	double		start = clk(CLOCK_MONOTONIC);
+
+	(void)arg;
+	while (clk(CLOCK_MONOTONIC) - start < seconds){
+		double e0;
+
+		// slow sine with a few LSB of noise, as read from a battery
+		for (i = 0u; i < block; i++, phase++){
+			seed = seed * 1664525u + 1013904223u;
+			samples[i] = (uint16_t)(32768.0 + 20000.0 * sin(phase * 1e-4) + (seed >> 28));
+		}
+		e0 = clk(CLOCK_THREAD_CPUTIME_ID);
+		if (mode == BENCH_MODE_TEXT){
+			for (i = 0u, len = 0u; i < block; i++)
+				len += (uint32_t)sprintf((char *)&buf[len], "%u\r\n", (unsigned)samples[i]);
+		} else {
+			len = frame_encode(buf, seq++, phase, samples, sizeof(uint16_t), block);
+		}
+		enc_cpu += clk(CLOCK_THREAD_CPUTIME_ID) - e0;
+		write_all(buf, len);
+		sent_samples += block;
+		sent_bytes += len;
+		// pace to the UART
+		if (baud){
+			double due = start + sent_bytes * 10.0 / baud;
+
+			while (clk(CLOCK_MONOTONIC) < due)
+				usleep(100);
+		}
+	}
+	wr_cpu = clk(CLOCK_THREAD_CPUTIME_ID);
+	__atomic_store_n(&stop, 1, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+static void *reader(void *arg){
+	uint8_t		buf[4096];
+	char		line[16];
+	uint32_t	line_len = 0u;
+	uint32_t	idle = 0u;
+	ssize_t		n, i;
+
+	(void)arg;
+	fcntl(slave_fd, F_SETFL, O_NONBLOCK);
+	for (;;){
+		n = read(slave_fd, buf, sizeof(buf));
+		if (n <= 0){
+			// after the writer is done, wait for the rest unless nothing comes for 100 ms
+			if (__atomic_load_n(&stop, __ATOMIC_ACQUIRE) && (recv_samples >= sent_samples || ++idle > 2000u))
+				break;
+			usleep(50);
+			continue;
+		}
+		idle = 0u;
+		if (mode == BENCH_MODE_TEXT){
+			for (i = 0; i < n; i++){
+				if (buf[i] == '\n'){
+					line[line_len] = '\0';
+					(void)strtoul(line, NULL, 10);
+					recv_samples++;
+					line_len = 0u;
+				} else if (buf[i] != '\r' && line_len < sizeof(line) - 1u){
+					line[line_len++] = (char)buf[i];
+				}
+			}
+		} else {
+			frame_decode(&dec, buf, (uint32_t)n, on_frame, NULL);
+		}
+	}
+	rd_cpu = clk(CLOCK_THREAD_CPUTIME_ID);
+	return NULL;
+}
+
+static void on_frame(const frame_t *f, void *arg){
+	(void)arg;
+	recv_samples += f->nbr;
+}
+
+static void write_all(const uint8_t *buf, uint32_t len){
+	while (len > 0u){
+		ssize_t n = write(master_fd, buf, len);
+
+		if (n <= 0){
+			usleep(50);
+			continue;
+		}
+		buf += n;
+		len -= (uint32_t)n;
+	}
+}
+
+static double clk(clockid_t id){
+	struct timespec ts;
+
+	clock_gettime(id, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
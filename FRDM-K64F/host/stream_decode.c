@@ -0,0 +1,220 @@
+/*
+*********************************************************************************************************
+* Decoder of the sample stream of stream.c. Reads the frames from a serial port, a pty or a file (stdin
+* by default), checks them and reports frames, CRC errors, lost frames and the sample rate, both on the
+* wall clock and on the timestamps of the board. -o writes every sample as "ts,code" lines. -d writes
+* them as a capture (capture.h) for replay, with the bands and filter of app_cfg.h; "-d -" sends it to
+* stdout, the report then goes to stderr.
+*
+* Build (from FRDM-K64F):
+*   gcc -O2 -DAPP_HOST_BUILD -IOS3-KSDK OS3-KSDK/frame.c OS3-KSDK/band.c OS3-KSDK/capture.c host/stream_decode.c -o stream_decode
+*
+* Usage: stream_decode [-r baud] [-o csv] [-d capture] [-q] [port or file]
+*   e.g. stream_decode -r 921600 /dev/ttyACM0
+*        stream_decode -r 921600 -q -d - /dev/ttyACM0 | replay
+*********************************************************************************************************
+*/
+
+/*
+*********************************************************************************************************
+*                                             INCLUDE FILES
+*********************************************************************************************************
+*/
+
+#include  <fcntl.h>
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <termios.h>
+#include  <time.h>
+#include  <unistd.h>
+
+#include  <app_cfg.h>
+#include  <band.h>
+#include  <filter.h>
+#include  <frame.h>
+#include  <capture.h>
+
+/*
+*********************************************************************************************************
+*                                            LOCAL DEFINES
+*********************************************************************************************************
+*/
+
+#define DECODE_CORE_HZ			120000000.0				// clock of the timestamps
+
+/*
+*********************************************************************************************************
+*                                       LOCAL GLOBAL VARIABLES
+*********************************************************************************************************
+*/
+
+static FILE				   *csv;
+static FILE				   *capture;
+static capture_hdr_t		capture_hdr;
+static uint64_t				samples;
+static uint64_t				ts_span;					// cycles from the first to the last frame
+static uint32_t				ts_last;
+static uint32_t				ts_step;					// cycles between two samples, from the last frames
+static uint32_t				nbr_last;
+
+/*
+*********************************************************************************************************
+*                                      LOCAL FUNCTION PROTOTYPES
+*********************************************************************************************************
+*/
+
+static void    on_frame(const frame_t *f, void *arg);
+static speed_t tty_speed(uint32_t baud);
+static double  wall(void);
+
+/*
+*********************************************************************************************************
+*                                                main()
+*********************************************************************************************************
+*/
+
+int main(int argc, char **argv){
+	frame_decoder_t	d;
+	uint8_t			buf[4096];
+	uint32_t		baud = 0u;
+	int				fd = 0, quiet = 0, opt;
+	double			t0, t, last_report;
+	ssize_t			n;
+	FILE		   *report = stdout;
+
+	while ((opt = getopt(argc, argv, "r:o:d:q")) != -1){
+		switch (opt){
+			case 'r': baud = (uint32_t)atoi(optarg); break;
+			case 'o':
+				if ((csv = fopen(optarg, "w")) == NULL){
+					perror(optarg);
+					return 1;
+				}
+				break;
+			case 'd':
+				if (!strcmp(optarg, "-")){
+					capture = stdout;
+					report = stderr;
+				} else if ((capture = fopen(optarg, "wb")) == NULL){
+					perror(optarg);
+					return 1;
+				}
+				break;
+			case 'q': quiet = 1; break;
+			default:
+				fprintf(stderr, "usage: %s [-r baud] [-o csv] [-d capture] [-q] [port or file]\n", argv[0]);
+				return 1;
+		}
+	}
+	if (optind < argc && (fd = open(argv[optind], O_RDONLY | O_NOCTTY)) < 0){
+		perror(argv[optind]);
+		return 1;
+	}
+	// raw mode on serial ports and ptys, so that no byte is translated
+	if (isatty(fd)){
+		struct termios tio;
+
+		tcgetattr(fd, &tio);
+		cfmakeraw(&tio);
+		if (baud){
+			cfsetispeed(&tio, tty_speed(baud));
+			cfsetospeed(&tio, tty_speed(baud));
+		}
+		tcsetattr(fd, TCSANOW, &tio);
+	}
+
+	if (capture){
+		// the period and the number of records are only known at the end, when the file can be rewound
+		capture_init(&capture_hdr, (uint32_t)DECODE_CORE_HZ, 0u, &band_cfg_default, APP_CFG_FILTER,
+					 APP_CFG_FILTER_MAVG_LOG2, BLINK_NONE, BAND_LED_RED);
+		capture_hdr.nbr = CAPTURE_NBR_STREAM;
+		fwrite(&capture_hdr, sizeof(capture_hdr), 1u, capture);
+		fflush(capture);
+	}
+	frame_decoder_init(&d);
+	t0 = last_report = wall();
+	while ((n = read(fd, buf, sizeof(buf))) > 0){
+		frame_decode(&d, buf, (uint32_t)n, on_frame, NULL);
+		t = wall();
+		if (!quiet && t - last_report >= 1.0){
+			fprintf(stderr, "%8.1f s  %u frames  %llu samples  %.1f samples/s  crc %u  lost %u\n", t - t0,
+					d.frames, (unsigned long long)samples, samples / (t - t0), d.crc_errors, d.lost);
+			last_report = t;
+		}
+	}
+	t = wall() - t0;
+
+	fprintf(report, "frames              %u\n", d.frames);
+	fprintf(report, "samples             %llu\n", (unsigned long long)samples);
+	fprintf(report, "crc errors          %u\n", d.crc_errors);
+	fprintf(report, "lost frames         %u\n", d.lost);
+	fprintf(report, "bytes skipped       %u\n", d.skipped);
+	fprintf(report, "wall clock          %.3f s, %.1f samples/s\n", t, samples / t);
+	if (ts_span)
+		fprintf(report, "board clock         %.3f s, %.1f samples/s\n", ts_span / DECODE_CORE_HZ,
+				(samples - nbr_last) / (ts_span / DECODE_CORE_HZ));
+	if (csv)
+		fclose(csv);
+	if (capture){
+		capture_hdr.nbr = (uint32_t)samples;
+		capture_hdr.period = ts_step;
+		if (fseek(capture, 0L, SEEK_SET) == 0)
+			fwrite(&capture_hdr, sizeof(capture_hdr), 1u, capture);
+		fclose(capture);
+	}
+	return d.crc_errors ? 2 : 0;
+}
+
+/*
+*********************************************************************************************************
+*                                           LOCAL FUNCTIONS
+*********************************************************************************************************
+*/
+
+static void on_frame(const frame_t *f, void *arg){
+	uint32_t i;
+
+	(void)arg;
+	if (samples){
+		ts_span += (uint32_t)(f->ts - ts_last);
+		ts_step = (uint32_t)(f->ts - ts_last) / nbr_last;
+	}
+	ts_last = f->ts;
+	nbr_last = f->nbr;
+	samples += f->nbr;
+	if (csv)
+		for (i = 0u; i < f->nbr; i++)
+			fprintf(csv, "%u,%u\n", (unsigned)(f->ts + i * ts_step), (unsigned)f->samples[i]);
+	if (capture){
+		for (i = 0u; i < f->nbr; i++){
+			capture_rec_t rec = { f->ts + i * ts_step, f->samples[i], 0u };
+
+			fwrite(&rec, sizeof(rec), 1u, capture);
+		}
+		fflush(capture);
+	}
+}
+
+static speed_t tty_speed(uint32_t baud){
+	switch (baud){
+		case 9600u:		return B9600;
+		case 19200u:	return B19200;
+		case 38400u:	return B38400;
+		case 57600u:	return B57600;
+		case 115200u:	return B115200;
+		case 230400u:	return B230400;
+		case 460800u:	return B460800;
+		case 921600u:	return B921600;
+		case 1000000u:	return B1000000;
+		case 2000000u:	return B2000000;
+		default:		return B115200;
+	}
+}
+
+static double wall(void){
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}